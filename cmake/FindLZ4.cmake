@@ -0,0 +1,18 @@
+# - Try to find LZ4
+# Once done, this will define
+#
+#  LZ4_FOUND - system has LZ4
+#  LZ4_INCLUDE_DIRS - the LZ4 include directories
+#  LZ4_LIBRARIES - link these to use LZ4
+
+include(LibFindMacros)
+
+libfind_pkg_check_modules(LZ4_PKGCONF liblz4)
+
+find_path(LZ4_INCLUDE_DIR lz4.h PATHS ${LZ4_PKGCONF_INCLUDE_DIRS})
+find_library(LZ4_LIBRARY NAMES lz4 liblz4 PATHS ${LZ4_PKGCONF_LIBRARY_DIRS})
+
+set(LZ4_PROCESS_INCLUDES LZ4_INCLUDE_DIR)
+set(LZ4_PROCESS_LIBS LZ4_LIBRARY)
+
+libfind_process(LZ4)
@@ -0,0 +1,18 @@
+# - Try to find WebP
+# Once done, this will define
+#
+#  WebP_FOUND - system has WebP
+#  WebP_INCLUDE_DIRS - the WebP include directories
+#  WebP_LIBRARIES - link these to use WebP
+
+include(LibFindMacros)
+
+libfind_pkg_check_modules(WebP_PKGCONF libwebp)
+
+find_path(WebP_INCLUDE_DIR webp/encode.h PATHS ${WebP_PKGCONF_INCLUDE_DIRS})
+find_library(WebP_LIBRARY NAMES webp libwebp PATHS ${WebP_PKGCONF_LIBRARY_DIRS})
+
+set(WebP_PROCESS_INCLUDES WebP_INCLUDE_DIR)
+set(WebP_PROCESS_LIBS WebP_LIBRARY)
+
+libfind_process(WebP)
@@ -0,0 +1,78 @@
+/*
+ * cache_lookup_benchmark.cpp
+ *
+ * Measures the latency of CacheStructure lookups against the number of cached tiles.
+ * Only the meta-data of the entries is relevant for lookups, so no operator is executed.
+ *
+ * Usage: mapping_cache_lookup_benchmark [num_runs]
+ */
+
+#include "cache/node/node_cache.h"
+#include "datatypes/raster.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+
+// Fills a cache with a grid of 256x256 tiles covering the world and returns the avg. lookup time in us
+static double measure(size_t num_entries, size_t num_lookups) {
+	const uint32_t tile_res = 256;
+	const SpatialReference bounds = SpatialReference::extent(CrsId::from_epsg_code(4326));
+	TemporalReference tref(TIMETYPE_UNIX, 0, 1);
+
+	size_t tiles = std::ceil(std::sqrt(num_entries));
+	double dx = (bounds.x2 - bounds.x1) / tiles;
+	double dy = (bounds.y2 - bounds.y1) / tiles;
+
+	CacheStructure<uint64_t,NodeCacheEntry<GenericRaster>> cache("lookup-benchmark", false);
+	std::vector<QueryRectangle> queries;
+	for ( size_t i = 0; i < num_entries; i++ ) {
+		double x1 = bounds.x1 + (i % tiles) * dx;
+		double y1 = bounds.y1 + (i / tiles) * dy;
+		QueryRectangle qr(
+			SpatialReference(bounds.crsId, x1, y1, x1+dx, y1+dy),
+			tref,
+			QueryResolution::pixels(tile_res,tile_res)
+		);
+		CacheCube cube( SpatioTemporalReference(qr,qr) );
+		cube.resolution_info.restype = QueryResolution::Type::PIXELS;
+		cube.resolution_info.pixel_scale_x = Interval(dx/tile_res,dx/tile_res);
+		cube.resolution_info.pixel_scale_y = Interval(dy/tile_res,dy/tile_res);
+		cube.resolution_info.actual_pixel_scale_x = dx/tile_res;
+		cube.resolution_info.actual_pixel_scale_y = dy/tile_res;
+
+		cache.put( i, std::make_shared<NodeCacheEntry<GenericRaster>>(i, CacheEntry(cube, tile_res*tile_res, ProfilingData()), nullptr) );
+		queries.push_back(qr);
+	}
+
+	std::default_random_engine generator;
+	std::uniform_int_distribution<size_t> distribution(0,num_entries-1);
+
+	auto start = std::chrono::steady_clock::now();
+	for ( size_t i = 0; i < num_lookups; i++ )
+		cache.query( queries[distribution(generator)] );
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / (double) num_lookups;
+}
+
+int main(int argc, const char* argv[]) {
+	const std::vector<size_t> entry_counts{1000,10000,50000,100000};
+	const size_t num_lookups = 10000;
+	int num_runs = argc > 1 ? atoi(argv[1]) : 3;
+	if ( num_runs < 1 ) {
+		std::cerr << "Usage: " << argv[0] << " [num_runs]" << std::endl;
+		return 1;
+	}
+
+	for ( auto num_entries : entry_counts ) {
+		double accum = 0;
+		for ( int run = 0; run < num_runs; run++ )
+			accum += measure(num_entries, num_lookups);
+		std::cout << "Avg. lookup time with " << num_entries << " entries: " << (accum/num_runs) << "us" << std::endl;
+	}
+	return 0;
+}
@@ -13,6 +13,7 @@
 #include "services/httpparsing.h"
 #include "services/ogcservice.h"
 
+#include <atomic>
 #include <mutex>
 #include <random>
 
@@ -252,6 +253,69 @@ void process_del_cons() {
 	}
 }
 
+/**
+ * Closed-loop load: Each client keeps exactly one request in flight on a persistent
+ * connection to the index and fetches the result before issuing the next request.
+ * @return the number of successfully answered requests
+ */
+size_t run_closed_loop(std::queue<QTriple> queries, int num_clients) {
+	std::mutex qmtx;
+	std::atomic<size_t> answered(0);
+
+	auto client = [&]() {
+		try {
+			auto con = BlockingConnection::create(host, port, true, ClientConnection::MAGIC_NUMBER);
+			QTriple q;
+			while ( true ) {
+				{
+					std::lock_guard<std::mutex> guard(qmtx);
+					if ( queries.empty() )
+						return;
+					q = queries.front();
+					queries.pop();
+				}
+				auto resp = con->write_and_read(ClientConnection::CMD_GET, BaseRequest(q.type, q.semantic_id, q.query));
+				uint8_t rc = resp->read<uint8_t>();
+				if ( rc == ClientConnection::RESP_OK ) {
+					DeliveryResponse dr(*resp);
+					auto dc = BlockingConnection::create(dr.host, dr.port, true, DeliveryConnection::MAGIC_NUMBER);
+					dc->write_and_read(DeliveryConnection::CMD_GET, dr.delivery_id);
+					answered++;
+				}
+				else
+					Log::debug("Received error for request: %s", resp->read<std::string>().c_str());
+			}
+		} catch (const std::exception &ex) {
+			Log::error("Closed-loop client failed: %s", ex.what());
+		}
+	};
+
+	std::vector<std::thread> clients;
+	for ( int i = 0; i < num_clients; i++ )
+		clients.emplace_back(client);
+	for ( auto &t : clients )
+		t.join();
+	return answered;
+}
+
+/**
+ * Measures the throughput of the index-server for 1, 2, 4, ... up to the given number
+ * of concurrent clients. A warm-up run with the maximum number of clients fills the
+ * caches first, so all measured runs are answered from the same cache-state.
+ */
+void run_throughput(const std::queue<QTriple> &queries, int max_clients) {
+	Log::info("Warm-up with %d clients.", max_clients);
+	run_closed_loop(queries, max_clients);
+
+	for ( int clients = 1; clients <= max_clients; clients *= 2 ) {
+		auto start = CacheCommon::time_millis();
+		size_t answered = run_closed_loop(queries, clients);
+		time_t duration = std::max((time_t) 1, CacheCommon::time_millis() - start);
+		Log::info("Clients: %3d, answered: %lu/%lu, duration: %ldms, throughput: %.1f requests/s",
+			clients, answered, queries.size(), duration, answered * 1000.0 / duration);
+	}
+}
+
 std::queue<QTriple> btw_queries(int num_queries) {
 	return queries_from_spec(num_queries, cache_exp::btw, 64, 512 );
 }
@@ -275,7 +339,7 @@ std::queue<QTriple> replay_logs(const char *logfile) {
 	std::ostream nullstream(nullptr);
 	Parameters _p;
 	HTTPService::HTTPResponseStream _hrs(nullptr);
-	OGCServiceWrapper ogc(_p, _hrs, nullstream);
+	OGCServiceWrapper ogc(_p, _p, _hrs, nullstream);
 
 	FILE *f = fopen(logfile, "r");
 	char line[10000];
@@ -385,9 +449,7 @@ std::queue<QTriple> replay_logs(const char *logfile) {
 	return queries;
 }
 
-std::queue<QTriple> create_run( int argc, char *argv[] ) {
-	(void) argc;
-	std::string workload = argv[2];
+std::queue<QTriple> create_run( const std::string &workload ) {
 
 	if ( workload == "btw_dis")
 		return disjoint_queries_from_spec(30000, cache_exp::btw, 64, 256 );
@@ -414,6 +476,13 @@ int main(int argc, char *argv[]) {
 	std::queue<QTriple> qs;
 	int inter_arrival;
 
+	// Closed-loop throughput: nbclient closed <max_clients> [workload]
+	if ( argc >= 3 && std::string(argv[1]) == "closed" ) {
+		qs = argc > 3 ? create_run(argv[3]) : queries_from_spec(3000, cache_exp::btw, 64, 256 );
+		run_throughput(qs, atoi(argv[2]));
+		return 0;
+	}
+
 	if ( argc < 3 ) {
 		inter_arrival = 6;
 		qs = queries_from_spec(3000, cache_exp::btw, 64, 256 );
@@ -421,7 +490,7 @@ int main(int argc, char *argv[]) {
 	}
 	else {
 		inter_arrival = atoi(argv[1]);
-		qs = create_run(argc,argv);
+		qs = create_run(argv[2]);
 	}
 
 	auto c = BlockingConnection::create(host, port, true,
@@ -27,6 +27,8 @@ IndexCacheManager::IndexCacheManager(const IndexConfig &config) :
 	poly_cache(CacheType::POLYGON,config.reorg_strategy,config.relevance_function),
 	plot_cache(CacheType::PLOT,config.reorg_strategy,config.relevance_function){
 
+	raster_cache.cache->set_max_downsampling(config.max_downsampling);
+
 	all_caches.push_back(raster_cache);
 	all_caches.push_back(point_cache);
 	all_caches.push_back(line_cache);
@@ -12,17 +12,19 @@
 
 IndexConfig IndexConfig::fromConfiguration() {
 	IndexConfig result;
-	result.port = Configuration::getInt("indexserver.port");
-	result.scheduler = Configuration::get("indexserver.scheduler","default");
-	result.reorg_strategy = Configuration::get("indexserver.reorg.strategy");
-	result.relevance_function = Configuration::get("indexserver.reorg.relevance","lru");
-	result.update_interval = Configuration::getInt("indexserver.reorg.interval");
-	result.batching_enabled = Configuration::getBool("indexserver.batching.enable",true);
+	result.port = Configuration::get<int>("indexserver.port");
+	result.scheduler = Configuration::get<std::string>("indexserver.scheduler","default");
+	result.reorg_strategy = Configuration::get<std::string>("indexserver.reorg.strategy");
+	result.relevance_function = Configuration::get<std::string>("indexserver.reorg.relevance","lru");
+	result.update_interval = Configuration::get<int>("indexserver.reorg.interval");
+	result.batching_enabled = Configuration::get<bool>("indexserver.batching.enable",true);
+	result.lookup_threads = Configuration::get<int>("indexserver.lookup.threads",0);
+	result.max_downsampling = Configuration::get<double>("indexserver.downsampling.factor",1);
 	return result;
 }
 
 IndexConfig::IndexConfig() :
-	port(0), update_interval(0), batching_enabled(true) {
+	port(0), update_interval(0), batching_enabled(true), lookup_threads(0), max_downsampling(1) {
 
 }
 
@@ -34,6 +36,8 @@ std::string IndexConfig::to_string() const {
 		ss << "  Reorg-Strategy    : " << reorg_strategy << std::endl;
 		ss << "  Relevance-Function: " << relevance_function << std::endl;
 		ss << "  Update-Interval   : " << update_interval << std::endl;
-		ss << "  Batching          : " << batching_enabled;
+		ss << "  Batching          : " << batching_enabled << std::endl;
+		ss << "  Lookup-Threads    : " << lookup_threads << std::endl;
+		ss << "  Max-Downsampling  : " << max_downsampling;
 		return ss.str();
 }
@@ -21,6 +21,8 @@ public:
 	std::string scheduler;
 	int update_interval;
 	bool batching_enabled;
+	int lookup_threads;
+	double max_downsampling;
 
 	std::string to_string() const;
 };
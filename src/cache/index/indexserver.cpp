@@ -29,7 +29,8 @@
 
 IndexServer::IndexServer(const IndexConfig &config) :
 	caches(config), config(config), shutdown(false), next_node_id(1),
-	query_manager(QueryManager::from_config(this->caches,this->nodes,config)), last_reorg(CacheCommon::time_millis()), wakeup_pipe(BinaryStream::makePipe()) {
+	query_manager(QueryManager::from_config(this->caches,this->nodes,config)), last_reorg(CacheCommon::time_millis()), wakeup_pipe(BinaryStream::makePipe()),
+	lookups(this->caches, config.lookup_threads, [this]() { wakeup(); }) {
 	Log::info("IndexServer successfully setup. %s", config.to_string().c_str());
 }
 
@@ -95,6 +96,8 @@ void IndexServer::run() {
 				read(wakeup_pipe.getReadFD(), buf, 1024);
 			}
 
+			lookups.process_finished();
+
 			process_client_connections();
 			process_nodes();
 			process_handshake(new_cons);
@@ -299,7 +302,15 @@ void IndexServer::process_client_connections() {
 				case ClientState::AWAIT_RESPONSE:
 					Log::debug("Client-request read: %s", cc.get_request().to_string().c_str() );
 					try {
-						query_manager->add_request(cc.id, cc.get_request());
+						auto &req = cc.get_request();
+						if ( !lookups.is_concurrent() || !query_manager->requires_lookup() )
+							query_manager->add_request(cc.id, req);
+						else if ( !query_manager->attach_request(cc.id, req) ) {
+							uint64_t client_id = cc.id;
+							lookups.submit(req.type, req.semantic_id, req.query, [this,client_id,req]( const IndexLookupPool::Result &res ) {
+								finish_client_lookup(client_id, req, res);
+							});
+						}
 						it = suspend_client(it);
 					} catch ( const std::exception &ex ) {
 						Log::warn("QueryManager returned error while adding request: %s",ex.what());
@@ -328,6 +339,51 @@ void IndexServer::process_client_connections() {
 	}
 }
 
+void IndexServer::finish_client_lookup(uint64_t client_id, const BaseRequest& req, const IndexLookupPool::Result& res) {
+	try {
+		if ( is_valid(req.type, res) )
+			query_manager->complete_request(client_id, req, res);
+		else
+			query_manager->complete_request(client_id, req, caches.get_cache(req.type).query(req.semantic_id, req.query));
+	} catch ( const std::exception &ex ) {
+		Log::warn("QueryManager returned error while adding request: %s",ex.what());
+		auto cc = suspended_client_connections.find(client_id);
+		if ( cc != suspended_client_connections.end() ) {
+			cc->second->send_error("Unable to serve request. Try again later!");
+			resume_client(cc);
+		}
+	}
+}
+
+void IndexServer::finish_worker_lookup(uint32_t node_id, uint64_t worker_id, const IndexLookupPool::Result& res) {
+	// The worker or its node might have failed in the meantime
+	auto ni = nodes.find(node_id);
+	if ( ni == nodes.end() )
+		return;
+	auto &workers = ni->second->get_busy_workers();
+	auto wi = workers.find(worker_id);
+	if ( wi == workers.end() || wi->second->get_state() != WorkerState::QUERY_REQUESTED ) {
+		Log::debug("Worker %lu went away during index-lookup.", worker_id);
+		return;
+	}
+
+	if ( is_valid(wi->second->get_query().type, res) )
+		query_manager->complete_worker_query(*wi->second, res);
+	else
+		query_manager->process_worker_query(*wi->second);
+}
+
+bool IndexServer::is_valid(CacheType type, const IndexLookupPool::Result& res) {
+	auto &cache = caches.get_cache(type);
+	try {
+		for ( auto &e : res.items )
+			cache.get( IndexCacheKey(e->semantic_id, e->id) );
+		return true;
+	} catch ( const NoSuchElementException &nse ) {
+		return false;
+	}
+}
+
 void IndexServer::process_worker_connections(Node &node) {
 	std::vector<uint64_t> finished_workers;
 	for (auto &e : node.get_busy_workers() ) {
@@ -390,7 +446,16 @@ void IndexServer::process_worker_connections(Node &node) {
 				}
 				case WorkerState::QUERY_REQUESTED: {
 					Log::debug("Worker issued cache-query: %s", wc.get_query().to_string().c_str());
-					query_manager->process_worker_query(wc);
+					if ( lookups.is_concurrent() && query_manager->requires_lookup() ) {
+						auto &req = wc.get_query();
+						uint32_t node_id = node.id;
+						uint64_t worker_id = wc.id;
+						lookups.submit(req.type, req.semantic_id, req.query, [this,node_id,worker_id]( const IndexLookupPool::Result &res ) {
+							finish_worker_lookup(node_id, worker_id, res);
+						});
+					}
+					else
+						query_manager->process_worker_query(wc);
 					break;
 				}
 				default: {
@@ -11,6 +11,7 @@
 #include "cache/index/node.h"
 #include "cache/index/index_cache_manager.h"
 #include "cache/index/querymanager.h"
+#include "cache/index/lookup_pool.h"
 
 #include "cache/common.h"
 
@@ -38,7 +39,9 @@
  * this node must use this id to register themselves at the index.
  *
  * Client-connections may issue requests to the server.
- * The server handles everything in a single thread.
+ * All connections are handled by a single event-loop. Lookups in the
+ * index-cache may be performed by a pool of threads (see IndexLookupPool),
+ * their results are processed by the event-loop again.
  */
 class IndexServer {
 	friend class TestIdxServer;
@@ -103,6 +106,32 @@ private:
 	 */
 	void process_client_connections();
 
+	/**
+	 * Adds the request of a client to the query-manager, after the lookup
+	 * in the index-cache finished
+	 * @param client_id the id of the client-connection
+	 * @param req the request of the client
+	 * @param res the result of the lookup
+	 */
+	void finish_client_lookup( uint64_t client_id, const BaseRequest &req, const IndexLookupPool::Result &res );
+
+	/**
+	 * Answers the cache-query of a worker, after the lookup in the index-cache finished
+	 * @param node_id the id of the worker's node
+	 * @param worker_id the id of the worker-connection
+	 * @param res the result of the lookup
+	 */
+	void finish_worker_lookup( uint32_t node_id, uint64_t worker_id, const IndexLookupPool::Result &res );
+
+	/**
+	 * Checks whether all entries of the given lookup-result are still present in the index.
+	 * Entries may be removed or moved to another node, while lookups are running.
+	 * @param type the type of the looked up cache
+	 * @param res the result of the lookup
+	 * @return whether the result is still valid
+	 */
+	bool is_valid( CacheType type, const IndexLookupPool::Result &res );
+
 	// Adjusts the cache according to the given reorg
 	/**
 	 * After successful movement of entries, this method reflects the new location
@@ -155,6 +184,9 @@ private:
 	time_t last_reorg;
 
 	BinaryStream wakeup_pipe;
+
+	// Performs lookups in the index-cache, must be destroyed before the caches and the wakeup-pipe
+	IndexLookupPool lookups;
 };
 
 #endif /* INDEX_INDEXSERVER_H_ */
@@ -0,0 +1,58 @@
+#include "cache/index/lookup_pool.h"
+#include "util/log.h"
+
+IndexLookupPool::IndexLookupPool(IndexCacheManager& caches, int num_threads, std::function<void()> notify) :
+	caches(caches), notify(std::move(notify)), executor(num_threads), next_id(1) {
+}
+
+IndexLookupPool::~IndexLookupPool() {
+	// Cancel lookups not started yet and wait for the running ones
+	pending.clear();
+}
+
+bool IndexLookupPool::is_concurrent() const {
+	return executor.get_num_threads() > 0;
+}
+
+void IndexLookupPool::submit(CacheType type, const std::string& semantic_id, const QueryRectangle& query, Callback callback) {
+	if ( !is_concurrent() ) {
+		callback( caches.get_cache(type).query(semantic_id, query) );
+		return;
+	}
+
+	uint64_t id = next_id++;
+	auto future = executor.submit( [this,id,type,semantic_id,query]() {
+		std::pair<uint64_t,Result> res(id, Result(query));
+		try {
+			res.second = caches.get_cache(type).query(semantic_id, query);
+		} catch ( const std::exception &e ) {
+			Log::warn("Index-lookup failed, answering with a miss: %s", e.what());
+		}
+		{
+			std::lock_guard<std::mutex> g(mtx);
+			finished.push_back( std::move(res) );
+		}
+		notify();
+	});
+	pending.emplace( id, Lookup{ std::move(callback), std::move(future) } );
+}
+
+size_t IndexLookupPool::process_finished() {
+	std::deque<std::pair<uint64_t,Result>> done;
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		done.swap(finished);
+	}
+
+	for ( auto &p : done ) {
+		auto it = pending.find(p.first);
+		Callback callback = std::move(it->second.callback);
+		pending.erase(it);
+		callback( p.second );
+	}
+	return done.size();
+}
+
+size_t IndexLookupPool::get_num_pending() const {
+	return pending.size();
+}
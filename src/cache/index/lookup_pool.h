@@ -0,0 +1,84 @@
+#ifndef CACHE_INDEX_LOOKUP_POOL_H_
+#define CACHE_INDEX_LOOKUP_POOL_H_
+
+#include "cache/index/index_cache_manager.h"
+#include "util/task_executor.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Performs index-cache lookups on a pool of threads, so the event-loop of the
+ * index-server is not blocked by them.
+ * The cache-structures of the index are kept per semantic id and guarded by
+ * their own read-write locks. Hence, lookups for different workflows run in
+ * parallel, while the event-loop keeps adding and removing entries.
+ *
+ * The callbacks of finished lookups are invoked by the event-loop in
+ * process_finished(), so they may access its state without further locking.
+ * Without threads, lookups are performed and their callbacks invoked
+ * directly on submit.
+ */
+class IndexLookupPool {
+public:
+	typedef CacheQueryResult<IndexCacheEntry> Result;
+	typedef std::function<void(const Result&)> Callback;
+
+	/**
+	 * Constructs a new instance
+	 * @param caches the caches to query
+	 * @param num_threads the number of threads performing lookups
+	 * @param notify invoked by the lookup threads after a lookup finished, e.g. to wake up the event-loop
+	 */
+	IndexLookupPool( IndexCacheManager &caches, int num_threads, std::function<void()> notify );
+	~IndexLookupPool();
+
+	IndexLookupPool( const IndexLookupPool& ) = delete;
+	IndexLookupPool& operator=( const IndexLookupPool& ) = delete;
+
+	/**
+	 * @return whether lookups are performed concurrently to the caller
+	 */
+	bool is_concurrent() const;
+
+	/**
+	 * Schedules a lookup. If the lookup fails, it is answered with a full miss.
+	 * @param type the type of the requested data
+	 * @param semantic_id the semantic id of the requested data
+	 * @param query the requested extent
+	 * @param callback invoked with the result by process_finished()
+	 */
+	void submit( CacheType type, const std::string &semantic_id, const QueryRectangle &query, Callback callback );
+
+	/**
+	 * Invokes the callbacks of all finished lookups
+	 * @return the number of invoked callbacks
+	 */
+	size_t process_finished();
+
+	/**
+	 * @return the number of lookups whose callbacks were not invoked yet
+	 */
+	size_t get_num_pending() const;
+
+private:
+	class Lookup {
+	public:
+		Callback callback;
+		TaskFuture<void> future;
+	};
+
+	IndexCacheManager &caches;
+	const std::function<void()> notify;
+	TaskExecutor executor;
+	uint64_t next_id;
+	// accessed by the event-loop only. Destroyed before the executor, waiting for running lookups.
+	std::unordered_map<uint64_t,Lookup> pending;
+
+	std::mutex mtx;
+	std::deque<std::pair<uint64_t,Result>> finished;
+};
+
+#endif /* CACHE_INDEX_LOOKUP_POOL_H_ */
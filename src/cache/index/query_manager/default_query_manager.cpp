@@ -20,29 +20,30 @@ bool DefaultQueryManager::use_reorg() const {
 }
 
 void DefaultQueryManager::add_request(uint64_t client_id, const BaseRequest &req ) {
+	if ( attach_request(client_id, req) )
+		return;
+	auto &cache = caches.get_cache(req.type);
+	complete_request(client_id, req, cache.query(req.semantic_id, req.query));
+}
+
+bool DefaultQueryManager::requires_lookup() const {
+	return true;
+}
+
+bool DefaultQueryManager::attach_request(uint64_t client_id, const BaseRequest& req) {
 	stats.issued();
-	TIME_EXEC("QueryManager.add_request");
+	TIME_EXEC("QueryManager.attach_request");
+	return enable_batching && add_to_satisfying_query(client_id, req);
+}
 
-	if ( enable_batching ) {
-		// Check if running jobs satisfy the given query
-		for (auto &qi : queries) {
-			if (qi.second->satisfies(req)) {
-				qi.second->add_client(client_id);
-				return;
-			}
-		}
+void DefaultQueryManager::complete_request(uint64_t client_id, const BaseRequest& req, const CacheQueryResult<IndexCacheEntry>& res) {
+	TIME_EXEC("QueryManager.complete_request");
 
-		// Check if pending jobs satisfy the given query
-		for (auto &j : pending_jobs) {
-			if (j.second->satisfies(req)) {
-				j.second->add_client(client_id);
-				return;
-			}
-		}
+	if ( enable_batching ) {
+		// Queries added while the lookup was performed might satisfy the request
+		if ( add_to_satisfying_query(client_id, req) )
+			return;
 
-		// Perform a cache-query
-		auto &cache = caches.get_cache(req.type);
-		auto res = cache.query(req.semantic_id, req.query);
 		stats.add_query(res.hit_ratio);
 		Log::debug("QueryResult: %s", res.to_string().c_str());
 
@@ -55,35 +56,35 @@ void DefaultQueryManager::add_request(uint64_t client_id, const BaseRequest &req
 				}
 			}
 		}
-		// Create a new job
-		auto job = create_job(req,res);
-		job->add_client(client_id);
-		add_query(std::move(job));
 	}
 	else {
-		// Perform a cache-query
-		auto &cache = caches.get_cache(req.type);
-		auto res = cache.query(req.semantic_id, req.query);
 		stats.add_query(res.hit_ratio);
 		Log::debug("QueryResult: %s", res.to_string().c_str());
-		auto job = create_job(req,res);
-		job->add_client(client_id);
-		add_query(std::move(job));
 	}
+	// Create a new job
+	auto job = create_job(req,res);
+	job->add_client(client_id);
+	add_query(std::move(job));
 }
 
 void DefaultQueryManager::process_worker_query(WorkerConnection& con) {
+	auto &req = con.get_query();
+	auto &cache = caches.get_cache(req.type);
+	complete_worker_query(con, cache.query(req.semantic_id, req.query));
+}
+
+void DefaultQueryManager::complete_worker_query(WorkerConnection& con, const CacheQueryResult<IndexCacheEntry>& res) {
 	auto &req = con.get_query();
 	try {
 		queries.at(con.id);
-		auto &cache = caches.get_cache(req.type);
-		auto res = cache.query(req.semantic_id, req.query);
 		Log::debug("QueryResult: %s", res.to_string().c_str());
 
 		stats.add_query(res.hit_ratio);
+		if (res.downsampled)
+			stats.downsampled_hits++;
 
 		// Full single hit
-		if (res.items.size() == 1 && !res.has_remainder()) {
+		if (res.items.size() == 1 && !res.has_remainder() && !res.downsampled) {
 			Log::debug("Full HIT. Sending reference.");
 			IndexCacheKey key(req.semantic_id, res.items.front()->id);
 			auto node = nodes.at(key.get_node_id());
@@ -99,7 +100,7 @@ void DefaultQueryManager::process_worker_query(WorkerConnection& con) {
 				auto &node = nodes.at(e->id.first);
 				entries.push_back(CacheRef(node->host, node->port, e->id.second, e->bounds));
 			}
-			PuzzleRequest pr( req.type, req.semantic_id, req.query, std::move(res.remainder), std::move(entries) );
+			PuzzleRequest pr( req.type, req.semantic_id, req.query, res.remainder, std::move(entries) );
 			con.send_partial_hit(pr);
 		}
 		// Full miss
@@ -132,11 +133,33 @@ void DefaultQueryManager::process_worker_query(WorkerConnection& con) {
 // PRIVATE
 //
 
+bool DefaultQueryManager::add_to_satisfying_query(uint64_t client_id, const BaseRequest& req) {
+	// Check if running jobs satisfy the given query
+	for (auto &qi : queries) {
+		if (qi.second->satisfies(req)) {
+			qi.second->add_client(client_id);
+			return true;
+		}
+	}
+
+	// Check if pending jobs satisfy the given query
+	for (auto &j : pending_jobs) {
+		if (j.second->satisfies(req)) {
+			j.second->add_client(client_id);
+			return true;
+		}
+	}
+	return false;
+}
+
 std::unique_ptr<PendingQuery> DefaultQueryManager::create_job( const BaseRequest &req, const CacheQueryResult<IndexCacheEntry>& res) {
 	TIME_EXEC("DefaultQueryManager.create_job");
 
+	if (res.downsampled)
+		stats.downsampled_hits++;
+
 	// Full single hit
-	if (res.items.size() == 1 && !res.has_remainder()) {
+	if (res.items.size() == 1 && !res.has_remainder() && !res.downsampled) {
 		stats.single_local_hits++;
 		Log::debug("Full HIT. Sending reference.");
 		IndexCacheKey key(req.semantic_id, res.items.front()->id);
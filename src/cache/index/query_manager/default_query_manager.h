@@ -88,7 +88,11 @@ class DefaultQueryManager : public QueryManager {
 public:
 	DefaultQueryManager(const std::map<uint32_t,std::shared_ptr<Node>> &nodes,IndexCacheManager &caches, bool enable_batching);
 	void add_request( uint64_t client_id, const BaseRequest &req );
+	bool requires_lookup() const;
+	bool attach_request( uint64_t client_id, const BaseRequest &req );
+	void complete_request( uint64_t client_id, const BaseRequest &req, const CacheQueryResult<IndexCacheEntry> &res );
 	void process_worker_query(WorkerConnection& con);
+	void complete_worker_query(WorkerConnection& con, const CacheQueryResult<IndexCacheEntry> &res);
 	bool use_reorg() const;
 protected:
 	std::unique_ptr<PendingQuery> recreate_job( const RunningQuery &query );
@@ -96,6 +100,14 @@ private:
 	IndexCacheManager &caches;
 	bool enable_batching;
 
+	/**
+	 * Adds the given client to a running or pending query satisfying the request
+	 * @param client_id the connection-id of the client
+	 * @param req the request
+	 * @return whether a satisfying query was found
+	 */
+	bool add_to_satisfying_query( uint64_t client_id, const BaseRequest &req );
+
 	/**
 	 * Creates a new job based on the given request and cache-query result
 	 * @param req the request
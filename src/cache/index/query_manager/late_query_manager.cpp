@@ -76,11 +76,13 @@ uint64_t LateJob::submit(const std::map<uint32_t, std::shared_ptr<Node> >& nmap)
 	auto res = cache.query( request.semantic_id, request.query );
 
 	tmp.add_query(res.hit_ratio);
+	if (res.downsampled)
+		tmp.downsampled_hits++;
 
 	uint64_t worker = 0;
 
 	// Full single hit
-	if (res.items.size() == 1 && !res.has_remainder()) {
+	if (res.items.size() == 1 && !res.has_remainder() && !res.downsampled) {
 		tmp.single_local_hits++;
 		Log::debug("Full HIT. Sending reference.");
 		IndexCacheKey key(request.semantic_id, res.items.front()->id);
@@ -201,9 +203,11 @@ void LateQueryManager::process_worker_query(WorkerConnection& con) {
 		Log::debug("QueryResult: %s", res.to_string().c_str());
 
 		stats.add_query(res.hit_ratio);
+		if (res.downsampled)
+			stats.downsampled_hits++;
 
 		// Full single hit
-		if (res.items.size() == 1 && !res.has_remainder()) {
+		if (res.items.size() == 1 && !res.has_remainder() && !res.downsampled) {
 			Log::debug("Full HIT. Sending reference.");
 			IndexCacheKey key(req.semantic_id, res.items.front()->id);
 			auto node = nodes.at(key.get_node_id());
@@ -219,7 +223,7 @@ void LateQueryManager::process_worker_query(WorkerConnection& con) {
 				auto &node = nodes.at(e->id.first);
 				entries.push_back(CacheRef(node->host, node->port, e->id.second,e->bounds));
 			}
-			PuzzleRequest pr( req.type, req.semantic_id, req.query, std::move(res.remainder), std::move(entries) );
+			PuzzleRequest pr( req.type, req.semantic_id, req.query, res.remainder, std::move(entries) );
 			con.send_partial_hit(pr);
 		}
 		// Full miss
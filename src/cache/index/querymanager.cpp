@@ -36,6 +36,26 @@ std::unique_ptr<QueryManager> QueryManager::from_config( IndexCacheManager &mgr,
 QueryManager::QueryManager(const std::map<uint32_t, std::shared_ptr<Node>> &nodes ) : nodes(nodes) {
 }
 
+bool QueryManager::requires_lookup() const {
+	return false;
+}
+
+bool QueryManager::attach_request(uint64_t client_id, const BaseRequest& req) {
+	(void) client_id;
+	(void) req;
+	return false;
+}
+
+void QueryManager::complete_request(uint64_t client_id, const BaseRequest& req, const CacheQueryResult<IndexCacheEntry>& res) {
+	(void) res;
+	add_request(client_id, req);
+}
+
+void QueryManager::complete_worker_query(WorkerConnection& con, const CacheQueryResult<IndexCacheEntry>& res) {
+	(void) res;
+	process_worker_query(con);
+}
+
 void QueryManager::schedule_pending_jobs() {
 
 	size_t num_workers = 0;
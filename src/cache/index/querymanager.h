@@ -156,12 +156,47 @@ public:
 	 */
 	virtual void add_request( uint64_t client_id, const BaseRequest &req ) = 0;
 
+	/**
+	 * @return whether add_request and process_worker_query perform a lookup in the index-cache.
+	 * In this case, the lookup may be performed concurrently and the request is then
+	 * added in two steps: attach_request and complete_request. Worker-queries are
+	 * answered by complete_worker_query.
+	 */
+	virtual bool requires_lookup() const;
+
+	/**
+	 * First step of adding a client-request: Attaches the client to a running or pending
+	 * query, satisfying the request.
+	 * @param client_id the connection-id of the client issued this query
+	 * @param req the query-spec
+	 * @return whether the client was attached. If not, complete_request must be invoked
+	 * with the result of the lookup
+	 */
+	virtual bool attach_request( uint64_t client_id, const BaseRequest &req );
+
+	/**
+	 * Second step of adding a client-request: Queues a new job for the given request,
+	 * based on the result of the lookup in the index-cache.
+	 * @param client_id the connection-id of the client issued this query
+	 * @param req the query-spec
+	 * @param res the result of the lookup
+	 */
+	virtual void complete_request( uint64_t client_id, const BaseRequest &req, const CacheQueryResult<IndexCacheEntry> &res );
+
 	/**
 	 * Processes cache-requests from workers.
 	 * @param con the worker-connection issued the cache-query
 	 */
 	virtual void process_worker_query(WorkerConnection& con) = 0;
 
+	/**
+	 * Answers a cache-request from a worker, based on the result of a lookup
+	 * performed concurrently.
+	 * @param con the worker-connection issued the cache-query
+	 * @param res the result of the lookup
+	 */
+	virtual void complete_worker_query(WorkerConnection& con, const CacheQueryResult<IndexCacheEntry> &res);
+
 	/**
 	 * Schedules the jobs waiting for exectuion, according to their
 	 * preferred node.
@@ -6,7 +6,7 @@
  */
 
 #include "cache/manager.h"
-#include "cache/priv/connection.h"
+#include "cache/priv/connection_pool.h"
 
 #include "datatypes/raster.h"
 #include "datatypes/pointcollection.h"
@@ -34,6 +34,33 @@ void CacheManager::init( CacheManager *instance ) {
 	CacheManager::instance = instance;
 }
 
+//
+// Wrapper defaults
+//
+
+template<typename T>
+bool CacheWrapper<T>::put_shared(const std::string& semantic_id,
+		cow_ptr<T>& item, const QueryRectangle &query, const QueryProfiler &profiler) {
+	auto owned = item.release();
+	bool res = put(semantic_id, owned, query, profiler);
+	item = cow_ptr<T>(std::move(owned));
+	return res;
+}
+
+template<typename T>
+cow_ptr<T> CacheWrapper<T>::query_shared(GenericOperator& op,
+		const QueryRectangle& rect, QueryProfiler &profiler) {
+	return cow_ptr<T>(query(op, rect, profiler));
+}
+
+template<typename T>
+std::unique_ptr<InFlightRegistry::Lease> CacheWrapper<T>::begin_computation(
+		const std::string& semantic_id, const QueryRectangle& rect) {
+	(void) semantic_id;
+	(void) rect;
+	return std::make_unique<InFlightRegistry::Lease>();
+}
+
 //
 // NOP-Wrapper
 //
@@ -99,7 +126,8 @@ CacheWrapper<ProvenanceCollection>& NopCacheManager::get_provenance_cache() {
 
 template<typename T>
 ClientCacheWrapper<T>::ClientCacheWrapper(CacheType type, const std::string& idx_host,
-		int idx_port) : type(type), idx_host(idx_host), idx_port(idx_port) {
+		int idx_port, BlockingConnectionPool &idx_pool, BlockingConnectionPool &delivery_pool) :
+		type(type), idx_host(idx_host), idx_port(idx_port), idx_pool(idx_pool), delivery_pool(delivery_pool) {
 }
 
 template<typename T>
@@ -121,9 +149,8 @@ std::unique_ptr<T> ClientCacheWrapper<T>::query(
 	std::unique_ptr<BinaryReadBuffer> idx_resp;
 
 	try {
-		auto idx_con = BlockingConnection::create(idx_host, idx_port, true, ClientConnection::MAGIC_NUMBER);
 		BaseRequest req(type,op.getSemanticId(),rect);
-		idx_resp = idx_con->write_and_read(ClientConnection::CMD_GET, req);
+		idx_resp = idx_pool.write_and_read(idx_host, idx_port, ClientConnection::CMD_GET, req);
 	} catch ( const NetworkException &ne ) {
 		Log::error("Could not talk to index-server (%s:%d): %s", idx_host.c_str(), idx_port, ne.what());
 		std::throw_with_nested(OperatorException());
@@ -136,8 +163,7 @@ std::unique_ptr<T> ClientCacheWrapper<T>::query(
 			Log::debug("Contacting delivery-server: %s:%d, delivery_id: %d", dr.host.c_str(), dr.port, dr.delivery_id);
 
 			try {
-				auto del_con = BlockingConnection::create(dr.host, dr.port, true, DeliveryConnection::MAGIC_NUMBER);
-				auto del_resp = del_con->write_and_read(DeliveryConnection::CMD_GET, dr.delivery_id);
+				auto del_resp = delivery_pool.write_and_read_once(dr.host, dr.port, DeliveryConnection::CMD_GET, dr.delivery_id);
 
 				uint8_t del_rc = del_resp->read<uint8_t>();
 				switch (del_rc) {
@@ -203,14 +229,26 @@ std::unique_ptr<ProvenanceCollection> ClientCacheWrapper<ProvenanceCollection>::
 // Client-cache
 //
 
-ClientCacheManager::ClientCacheManager(const std::string& idx_host, int idx_port) :
+ClientCacheManager::ClientCacheManager(const std::string& idx_host, int idx_port, size_t max_idle, int idle_timeout) :
 	idx_host(idx_host), idx_port(idx_port),
-	raster_cache(CacheType::RASTER, idx_host, idx_port),
-	point_cache(CacheType::POINT, idx_host, idx_port),
-	line_cache(CacheType::LINE, idx_host, idx_port),
-	poly_cache(CacheType::POLYGON, idx_host, idx_port),
-	plot_cache(CacheType::PLOT, idx_host, idx_port),
-	provenance_cache(CacheType::UNKNOWN, idx_host, idx_port){
+	idx_pool(std::make_unique<BlockingConnectionPool>(ClientConnection::MAGIC_NUMBER, max_idle, idle_timeout)),
+	delivery_pool(std::make_unique<BlockingConnectionPool>(DeliveryConnection::MAGIC_NUMBER, max_idle, idle_timeout)),
+	raster_cache(CacheType::RASTER, idx_host, idx_port, *idx_pool, *delivery_pool),
+	point_cache(CacheType::POINT, idx_host, idx_port, *idx_pool, *delivery_pool),
+	line_cache(CacheType::LINE, idx_host, idx_port, *idx_pool, *delivery_pool),
+	poly_cache(CacheType::POLYGON, idx_host, idx_port, *idx_pool, *delivery_pool),
+	plot_cache(CacheType::PLOT, idx_host, idx_port, *idx_pool, *delivery_pool),
+	provenance_cache(CacheType::UNKNOWN, idx_host, idx_port, *idx_pool, *delivery_pool){
+}
+
+ClientCacheManager::~ClientCacheManager() = default;
+
+ConnectionPoolStats ClientCacheManager::get_index_connection_stats() const {
+	return idx_pool->get_stats();
+}
+
+ConnectionPoolStats ClientCacheManager::get_delivery_connection_stats() const {
+	return delivery_pool->get_stats();
 }
 
 CacheWrapper<GenericRaster>& ClientCacheManager::get_raster_cache() {
@@ -237,6 +275,13 @@ CacheWrapper<ProvenanceCollection>& ClientCacheManager::get_provenance_cache() {
 	return provenance_cache;
 }
 
+template class CacheWrapper<GenericRaster> ;
+template class CacheWrapper<PointCollection> ;
+template class CacheWrapper<LineCollection> ;
+template class CacheWrapper<PolygonCollection> ;
+template class CacheWrapper<GenericPlot> ;
+template class CacheWrapper<ProvenanceCollection> ;
+
 template class NopCacheWrapper<GenericRaster> ;
 template class NopCacheWrapper<PointCollection> ;
 template class NopCacheWrapper<LineCollection> ;
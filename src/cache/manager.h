@@ -10,13 +10,18 @@
 
 #include "cache/node/node_cache.h"
 #include "cache/priv/shared.h"
+#include "cache/priv/inflight.h"
 
 #include "operators/operator.h"
 
+#include "util/cow_ptr.h"
+
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 
+class BlockingConnectionPool;
+class ConnectionPoolStats;
 
 /**
  * Interface hiding a single cache and providing
@@ -46,6 +51,44 @@ public:
 	 * @return the result satisfying the given query parameters
 	 */
 	virtual std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler) = 0;
+
+	/**
+	 * Inserts an item into the cache. Implementations may take over the item
+	 * and share it with the cache instead of storing a copy. Afterwards, the
+	 * item still holds the result, but may have become read-only.
+	 * The default implementation delegates to put.
+	 * @param semantic_id the semantic id
+	 * @param item the data-item to cache
+	 * @param query the query which produced the result
+	 * @param profiler the profiler which recorded the costs of the query-execution
+	 * @return whether the entry was stored in the cache or not
+	 */
+	virtual bool put_shared(const std::string &semantic_id, cow_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
+
+	/**
+	 * Queries for an item satisfying the given request.
+	 * In contrast to query, the result may be shared with the cache. It is
+	 * only copied, if the caller requests write access.
+	 * The default implementation delegates to query.
+	 * @param op the operator-graph of the query
+	 * @param rect the query-rectangle
+	 * @param profiler the profiler recording costs of query-execution
+	 * @return the result satisfying the given query parameters
+	 */
+	virtual cow_ptr<T> query_shared(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
+
+	/**
+	 * Announces the computation of a result after a query missed, so that
+	 * concurrent queries for the same result can wait for it instead of
+	 * computing it again. The returned lease must be kept until the result
+	 * was put into the cache.
+	 * The default implementation does not coordinate computations.
+	 * @param semantic_id the semantic id of the result
+	 * @param rect the query-rectangle which missed
+	 * @return the lease for computing the result, or nullptr if the result was
+	 *         computed by another query meanwhile and the cache should be queried again
+	 */
+	virtual std::unique_ptr<InFlightRegistry::Lease> begin_computation(const std::string &semantic_id, const QueryRectangle &rect);
 };
 
 /**
@@ -138,12 +181,14 @@ private:
  * This is an implementation of the CacheWrapper which should be used
  * on the client-side to access the cluster.
  * The query-method always delegates requests to the index-server
- * and fetches responses from the corresponding node.
+ * and fetches responses from the corresponding node. Connections
+ * are taken from the given pools.
  */
 template<typename T>
 class ClientCacheWrapper : public CacheWrapper<T> {
 public:
-	ClientCacheWrapper( CacheType type, const std::string &idx_host, int idx_port );
+	ClientCacheWrapper( CacheType type, const std::string &idx_host, int idx_port,
+			BlockingConnectionPool &idx_pool, BlockingConnectionPool &delivery_pool );
 	bool put(const std::string &semantic_id, const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
 	std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
 protected:
@@ -152,6 +197,8 @@ private:
 	CacheType type;
 	const std::string idx_host;
 	const int idx_port;
+	BlockingConnectionPool &idx_pool;
+	BlockingConnectionPool &delivery_pool;
 };
 
 /**
@@ -164,19 +211,35 @@ public:
 	 * Constructs a new instance
 	 * @param idx_host the hostname of the index-server
 	 * @param idx_port the port, the index-server listens
+	 * @param max_idle the maximum number of idle connections kept open per server
+	 * @param idle_timeout the number of seconds after which idle connections are closed
 	 */
-	ClientCacheManager(const std::string &idx_host, int idx_port);
+	ClientCacheManager(const std::string &idx_host, int idx_port, size_t max_idle = 4, int idle_timeout = 60);
+	~ClientCacheManager();
 	CacheWrapper<GenericRaster>& get_raster_cache();
 	CacheWrapper<PointCollection>& get_point_cache();
 	CacheWrapper<LineCollection>& get_line_cache();
 	CacheWrapper<PolygonCollection>& get_polygon_cache();
 	CacheWrapper<GenericPlot>& get_plot_cache();
 	CacheWrapper<ProvenanceCollection>& get_provenance_cache();
+
+	/**
+	 * @return the usage of the connections to the index-server
+	 */
+	ConnectionPoolStats get_index_connection_stats() const;
+
+	/**
+	 * @return the usage of the connections to the delivery-servers of the nodes
+	 */
+	ConnectionPoolStats get_delivery_connection_stats() const;
 private:
 
 	std::string idx_host;
 	int idx_port;
 
+	std::unique_ptr<BlockingConnectionPool> idx_pool;
+	std::unique_ptr<BlockingConnectionPool> delivery_pool;
+
 	ClientCacheWrapper<GenericRaster> raster_cache;
 	ClientCacheWrapper<PointCollection> point_cache;
 	ClientCacheWrapper<LineCollection> line_cache;
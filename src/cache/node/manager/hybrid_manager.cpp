@@ -86,6 +86,12 @@ bool HybridCacheWrapper<T>::put(const std::string& semantic_id,
 template<typename T>
 std::unique_ptr<T> HybridCacheWrapper<T>::query(GenericOperator& op,
 		const QueryRectangle& rect, QueryProfiler &profiler) {
+	return query_shared(op,rect,profiler).release();
+}
+
+template<typename T>
+cow_ptr<T> HybridCacheWrapper<T>::query_shared(GenericOperator& op,
+		const QueryRectangle& rect, QueryProfiler &profiler) {
 
 	CacheQueryResult<NodeCacheEntry<T>> qres = this->cache.query(op.getSemanticId(), rect);
 	for ( auto &e : qres.items ) {
@@ -94,11 +100,13 @@ std::unique_ptr<T> HybridCacheWrapper<T>::query(GenericOperator& op,
 	}
 
 	this->stats.add_query(qres.hit_ratio);
+	if ( qres.downsampled )
+		this->stats.add_downsampled_hit();
 
 	// Full single local hit
-	if ( !qres.has_remainder() && qres.items.size() == 1 ) {
+	if ( !qres.has_remainder() && qres.items.size() == 1 && !qres.downsampled ) {
 		this->stats.add_single_local_hit();
-		return qres.items.front()->copy_data();
+		return cow_ptr<T>(qres.items.front()->data);
 	}
 	// Partial or Full puzzle
 	else if ( qres.has_hit() ) {
@@ -112,7 +120,7 @@ std::unique_ptr<T> HybridCacheWrapper<T>::query(GenericOperator& op,
 		for ( auto &ne : qres.items )
 			items.push_back(ne->data);
 
-		return PuzzleUtil::process(op,rect,qres.remainder,items,profiler);
+		return cow_ptr<T>(PuzzleUtil::process(mgr,op,rect,qres.remainder,items,profiler));
 	}
 	else {
 		this->stats.add_miss();
@@ -15,23 +15,59 @@
 #include "datatypes/polygoncollection.h"
 #include "datatypes/plot.h"
 
+#include "operators/provenance.h"
+
 #include "util/log.h"
 
+#include <unistd.h>
+
 
 template<class T>
 LocalCacheWrapper<T>::LocalCacheWrapper(LocalCacheManager &mgr, const std::string &repl, size_t size, CacheType type ) :
-	NodeCacheWrapper<T>(mgr, size, type ), mgr(mgr), replacement(std::make_unique<LocalReplacement<T>>( LocalRelevanceFunction::by_name(repl))) {
+	NodeCacheWrapper<T>(mgr, size, type ), mgr(mgr), replacement(std::make_unique<LocalReplacement<T>>( LocalReplacementPolicy::by_name(repl))), spill_min_costs(0) {
+}
+
+template<class T>
+void LocalCacheWrapper<T>::enable_spill(std::unique_ptr<SpillStore> store, double min_costs) {
+	std::lock_guard<std::mutex> g(rem_mtx);
+	spill = std::move(store);
+	spill_min_costs = min_costs;
 }
 
 template<class T>
 bool LocalCacheWrapper<T>::put(const std::string &semantic_id,
 		const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler) {
-	size_t size = SizeUtil::get_byte_size(*item);
+	auto meta = prepare_put(semantic_id, *item, query, profiler);
+	if ( meta ) {
+		replacement->inserted(this->cache.put(semantic_id,item,*meta));
+		return true;
+	}
+	return false;
+}
+
+template<class T>
+bool LocalCacheWrapper<T>::put_shared(const std::string &semantic_id,
+		cow_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler) {
+	auto meta = prepare_put(semantic_id, *item, query, profiler);
+	if ( meta ) {
+		// Hand the item over to the cache instead of storing a copy
+		if ( !item.is_shared() )
+			NodeCacheWrapper<T>::make_shareable(item.mutate());
+		replacement->inserted(this->cache.put(semantic_id,item.share(),*meta));
+		return true;
+	}
+	return false;
+}
+
+template<class T>
+std::unique_ptr<CacheEntry> LocalCacheWrapper<T>::prepare_put(const std::string &semantic_id, const T &item,
+		const QueryRectangle &query, const QueryProfiler &profiler) {
+	size_t size = SizeUtil::get_byte_size(item);
 
 	this->stats.add_result_bytes(size);
 
 	if ( mgr.get_strategy().do_cache(profiler,size) && size <= this->cache.get_max_size() ) {
-		CacheCube cube = NodeCacheWrapper<T>::get_bounds(*item, query);
+		CacheCube cube = NodeCacheWrapper<T>::get_bounds(item, query);
         // TODO: find proper way to determine min/max overview resolution
 		// Min/Max resolution hack
 //		if ( query.restype == QueryResolution::Type::PIXELS ) {
@@ -53,40 +89,158 @@ bool LocalCacheWrapper<T>::put(const std::string &semantic_id,
 //			else if ( scale_y > cube.resolution_info.pixel_scale_y.b )
 //				cube.resolution_info.pixel_scale_y.b = std::numeric_limits<double>::infinity();
 //		}
+		auto entry = std::make_unique<CacheEntry>( cube, size + sizeof(NodeCacheEntry<T>), profiler);
+		mgr.get_strategy().record_access(semantic_id, cube);
 		// Perform put
-		Log::trace("Adding item to local cache");
+		std::vector<Spilled> spilled;
 		{
 			std::lock_guard<std::mutex> g(rem_mtx);
-			auto rems = replacement->get_removals(this->cache,size);
-			for ( auto &r : rems ) {
-				Log::trace("Dropping entry due to space requirement: %s", r.NodeCacheKey::to_string().c_str());
-				this->cache.remove(r);
+			if ( !replacement->admit(this->cache, mgr.get_strategy(), semantic_id, *entry) ) {
+				Log::trace("Item not admitted to local cache");
+				return nullptr;
 			}
+			Log::trace("Adding item to local cache");
+			spilled = evict(replacement->get_removals(this->cache,size));
 		}
-		this->cache.put(semantic_id,item,CacheEntry( cube, size + sizeof(NodeCacheEntry<T>), profiler));
-		return true;
+		write_spilled(spilled);
+		return entry;
 	}
-	return false;
+	return nullptr;
+}
+
+template<class T>
+std::vector<typename LocalCacheWrapper<T>::Spilled> LocalCacheWrapper<T>::evict(const std::vector<LocalRef> &victims) {
+	std::vector<Spilled> spilled;
+	for ( auto &r : victims ) {
+		if ( spill && CachingStrategy::get_costs(r.profile, CachingStrategy::Type::UNCACHED) >= spill_min_costs ) {
+			try {
+				auto e = this->cache.make_cold(r);
+				if ( !e->is_cold() )
+					spilled.push_back( Spilled{r, e->data} );
+			} catch ( const NoSuchElementException &nse ) {
+			}
+			continue;
+		}
+		Log::trace("Dropping entry due to space requirement: %s", r.NodeCacheKey::to_string().c_str());
+		this->cache.remove(r);
+	}
+	return spilled;
+}
+
+template<class T>
+void LocalCacheWrapper<T>::write_spilled(const std::vector<Spilled> &spilled) {
+	for ( auto &s : spilled ) {
+		std::vector<LocalRef> dropped;
+		try {
+			BinaryWriteBuffer buffer;
+			write_item(buffer, *s.data);
+			Log::trace("Spilling entry due to space requirement: %s", s.ref.NodeCacheKey::to_string().c_str());
+			dropped = spill->append(s.ref, buffer);
+		} catch ( const CacheException &ce ) {
+			Log::warn("Spilling entry %s failed: %s", s.ref.NodeCacheKey::to_string().c_str(), ce.what());
+			dropped.push_back(s.ref);
+		}
+
+		// Entries promoted meanwhile stay in memory
+		std::lock_guard<std::mutex> g(rem_mtx);
+		for ( auto &v : dropped ) {
+			Log::trace("Dropping spilled entry due to space requirement: %s", v.NodeCacheKey::to_string().c_str());
+			this->cache.remove_cold(v);
+		}
+	}
+}
+
+template<class T>
+std::shared_ptr<const T> LocalCacheWrapper<T>::fault_in(const std::string &semantic_id, const NodeCacheEntry<T> &entry) {
+	NodeCacheKey key(semantic_id, entry.entry_id);
+	std::unique_ptr<BinaryReadBuffer> buffer;
+	try {
+		buffer = spill->read(entry.entry_id);
+	} catch ( const NoSuchElementException &nse ) {
+		// Promoted by a concurrent query or dropped
+		auto current = this->cache.get(key);
+		if ( current->is_cold() )
+			throw;
+		return current->data;
+	}
+
+	auto item = read_item(*buffer);
+	NodeCacheWrapper<T>::make_shareable(*item);
+	std::shared_ptr<const T> data(std::move(item));
+
+	if ( entry.size > this->cache.get_max_size() )
+		return data;
+
+	std::vector<Spilled> spilled;
+	{
+		std::lock_guard<std::mutex> g(rem_mtx);
+		spill->remove(entry.entry_id);
+		spilled = evict(replacement->get_removals(this->cache, entry.size));
+		try {
+			auto hot = this->cache.make_hot(key, data);
+			if ( hot->data == data )
+				replacement->inserted(MetaCacheEntry(this->cache.type, key, *hot));
+			data = hot->data;
+		} catch ( const NoSuchElementException &nse ) {
+			// Dropped meanwhile
+		}
+	}
+	write_spilled(spilled);
+	return data;
 }
 
 template<class T>
 std::unique_ptr<T> LocalCacheWrapper<T>::query(GenericOperator& op,
 		const QueryRectangle& rect, QueryProfiler &profiler) {
+	return query_shared(op,rect,profiler).release();
+}
+
+template<class T>
+cow_ptr<T> LocalCacheWrapper<T>::query_shared(GenericOperator& op,
+		const QueryRectangle& rect, QueryProfiler &profiler) {
 	if ( mgr.get_worker_context().get_puzzle_depth() > op.getDepth() )
 		throw NoSuchElementException("No query");
 
 	CacheQueryResult<NodeCacheEntry<T>> qres = this->cache.query(op.getSemanticId(), rect);
+
+	// Fault in spilled entries first -- if one cannot be read, the query is a miss
+	std::vector<std::shared_ptr<const T>> items;
+	items.reserve(qres.items.size());
+	bool cold_hit = false;
+	for ( auto &e : qres.items ) {
+		if ( e->is_cold() ) {
+			try {
+				items.push_back(fault_in(op.getSemanticId(), *e));
+				cold_hit = true;
+			} catch ( const std::exception &ex ) {
+				Log::warn("Reading spilled entry %s failed: %s", e->to_string().c_str(), ex.what());
+				this->stats.add_query(0);
+				this->stats.add_miss();
+				throw NoSuchElementException("MISS");
+			}
+		}
+		else {
+			items.push_back(e->data);
+			replacement->accessed(*e);
+		}
+	}
+
 	for ( auto &e : qres.items ) {
 		// Track costs
 		profiler.addTotalCosts(e->profile);
+		mgr.get_strategy().record_access(op.getSemanticId(), e->bounds);
 	}
 
 	this->stats.add_query(qres.hit_ratio);
+	if ( qres.downsampled )
+		this->stats.add_downsampled_hit();
+	if ( cold_hit )
+		this->stats.add_cold_hit();
 
 	// Full single local hit
-	if ( !qres.has_remainder() && qres.items.size() == 1 ) {
+	if ( !qres.has_remainder() && qres.items.size() == 1 && !qres.downsampled ) {
 		this->stats.add_single_local_hit();
-		return qres.items.front()->copy_data();
+		return cow_ptr<T>(items.front());
 	}
 	// Partial or Full puzzle
 	else if ( qres.has_hit() ) {
@@ -95,13 +249,8 @@ std::unique_ptr<T> LocalCacheWrapper<T>::query(GenericOperator& op,
 		else
 			this->stats.add_multi_local_hit();
 
-		std::vector<std::shared_ptr<const T>> items;
-		items.reserve(qres.items.size());
-		for ( auto &ne : qres.items )
-			items.push_back(ne->data);
-
 		PuzzleGuard pg(mgr.get_worker_context());
-		return PuzzleUtil::process(op,rect,qres.remainder,items,profiler);
+		return cow_ptr<T>(PuzzleUtil::process(mgr,op,rect,qres.remainder,items,profiler));
 	}
 	else {
 		this->stats.add_miss();
@@ -133,6 +282,45 @@ std::unique_ptr<T> LocalCacheWrapper<T>::process_puzzle(
 	throw MustNotHappenException("No external puzzling allowed in local cache manager!");
 }
 
+template<class T>
+void LocalCacheWrapper<T>::write_item(BinaryWriteBuffer &buffer, const T &item) {
+	// The item outlives the buffer
+	buffer.write(item, true);
+}
+
+template<>
+void LocalCacheWrapper<GenericRaster>::write_item(BinaryWriteBuffer &buffer, const GenericRaster &item) {
+	const_cast<GenericRaster&>(item).serialize(buffer, true);
+}
+
+template<>
+void LocalCacheWrapper<ProvenanceCollection>::write_item(BinaryWriteBuffer &buffer, const ProvenanceCollection &item) {
+	(void) buffer;
+	(void) item;
+	throw CacheException("Provenance cannot be spilled");
+}
+
+template<class T>
+std::unique_ptr<T> LocalCacheWrapper<T>::read_item(BinaryReadBuffer &buffer) {
+	return std::make_unique<T>(buffer);
+}
+
+template<>
+std::unique_ptr<GenericRaster> LocalCacheWrapper<GenericRaster>::read_item(BinaryReadBuffer &buffer) {
+	return GenericRaster::deserialize(buffer);
+}
+
+template<>
+std::unique_ptr<GenericPlot> LocalCacheWrapper<GenericPlot>::read_item(BinaryReadBuffer &buffer) {
+	return GenericPlot::deserialize(buffer);
+}
+
+template<>
+std::unique_ptr<ProvenanceCollection> LocalCacheWrapper<ProvenanceCollection>::read_item(BinaryReadBuffer &buffer) {
+	(void) buffer;
+	throw CacheException("Provenance cannot be spilled");
+}
+
 //
 // MGR
 //
@@ -151,6 +339,23 @@ LocalCacheManager::LocalCacheManager(const std::string &strategy, const std::str
 						std::make_unique<LocalCacheWrapper<ProvenanceCollection>>(*this, replacement,provenance_cache_size, CacheType::UNKNOWN)) {
 }
 
+void LocalCacheManager::enable_spill(const std::string &directory, const std::string &replacement, double min_costs,
+		size_t raster_size, size_t point_size, size_t line_size, size_t polygon_size, size_t plot_size) {
+	auto create = [&]( const std::string &name, size_t size ) {
+		return std::make_unique<SpillStore>(directory, concat(name, "_", getpid()), size, LocalReplacementPolicy::by_name(replacement));
+	};
+	if ( raster_size > 0 )
+		static_cast<LocalCacheWrapper<GenericRaster>&>(get_raster_cache()).enable_spill(create("raster", raster_size), min_costs);
+	if ( point_size > 0 )
+		static_cast<LocalCacheWrapper<PointCollection>&>(get_point_cache()).enable_spill(create("points", point_size), min_costs);
+	if ( line_size > 0 )
+		static_cast<LocalCacheWrapper<LineCollection>&>(get_line_cache()).enable_spill(create("lines", line_size), min_costs);
+	if ( polygon_size > 0 )
+		static_cast<LocalCacheWrapper<PolygonCollection>&>(get_polygon_cache()).enable_spill(create("polygons", polygon_size), min_costs);
+	if ( plot_size > 0 )
+		static_cast<LocalCacheWrapper<GenericPlot>&>(get_plot_cache()).enable_spill(create("plots", plot_size), min_costs);
+}
+
 template class LocalCacheWrapper<GenericRaster>;
 template class LocalCacheWrapper<PointCollection>;
 template class LocalCacheWrapper<LineCollection>;
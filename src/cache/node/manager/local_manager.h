@@ -10,6 +10,7 @@
 
 #include "cache/node/node_manager.h"
 #include "cache/node/manager/local_replacement.h"
+#include "cache/node/manager/spill_store.h"
 #include "cache/node/puzzle_util.h"
 
 
@@ -25,13 +26,66 @@ public:
 	LocalCacheWrapper( LocalCacheManager &mgr, const std::string &repl, size_t size, CacheType type );
 	bool put(const std::string &semantic_id, const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
 	std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
+	bool put_shared(const std::string &semantic_id, cow_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
+	cow_ptr<T> query_shared(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
 	std::unique_ptr<T> process_puzzle( const PuzzleRequest& request, QueryProfiler &parent_profiler );
 	MetaCacheEntry put_local(const std::string &semantic_id, const std::unique_ptr<T> &item, CacheEntry &&info );
 	void remove_local(const NodeCacheKey &key);
+
+	/**
+	 * Enables spilling of evicted entries to disk
+	 * @param store the store holding the spilled entries
+	 * @param min_costs the min. computation costs of an entry to be spilled instead of dropped
+	 */
+	void enable_spill( std::unique_ptr<SpillStore> store, double min_costs );
 private:
+	/**
+	 * Checks whether the given item should be cached and admitted by the
+	 * caching strategy and, if so, frees the space required to store it.
+	 * @return the meta-information for the new entry or nullptr, if the item should not be cached
+	 */
+	std::unique_ptr<CacheEntry> prepare_put(const std::string &semantic_id, const T &item, const QueryRectangle &query, const QueryProfiler &profiler);
+
+	/**
+	 * An entry that was made cold, but whose data is not written to disk yet
+	 */
+	struct Spilled {
+		LocalRef ref;
+		std::shared_ptr<const T> data;
+	};
+
+	/**
+	 * Drops the given entries from memory. Entries worth keeping stay in
+	 * the cache as cold entries and must be passed to write_spilled().
+	 * Must be called while holding rem_mtx.
+	 * @return the entries to write to disk
+	 */
+	std::vector<Spilled> evict(const std::vector<LocalRef> &victims);
+
+	/**
+	 * Writes the data of the given cold entries to disk. Entries which
+	 * cannot be written, or which are dropped from the spill store for
+	 * space, are removed from the cache.
+	 * Must be called without holding rem_mtx. Until then, queries for
+	 * these entries are misses.
+	 */
+	void write_spilled(const std::vector<Spilled> &spilled);
+
+	/**
+	 * Reads the data of the given cold entry back from disk and
+	 * promotes the entry to memory, if it fits.
+	 * @return the data of the entry
+	 */
+	std::shared_ptr<const T> fault_in(const std::string &semantic_id, const NodeCacheEntry<T> &entry);
+
+	static void write_item(BinaryWriteBuffer &buffer, const T &item);
+	static std::unique_ptr<T> read_item(BinaryReadBuffer &buffer);
+
 	std::mutex rem_mtx;
 	LocalCacheManager &mgr;
 	std::unique_ptr<LocalReplacement<T>> replacement;
+	std::unique_ptr<SpillStore> spill;
+	double spill_min_costs;
 };
 
 
@@ -40,6 +94,16 @@ public:
 	LocalCacheManager( const std::string &strategy, const std::string &replacement,
 			size_t raster_cache_size, size_t point_cache_size, size_t line_cache_size,
 			size_t polygon_cache_size, size_t plot_cache_size, size_t provenance_cache_size );
+
+	/**
+	 * Enables spilling of evicted entries to disk. A cache-type with a spill-size
+	 * of 0 does not spill. Provenance is never spilled.
+	 * @param directory the directory holding the spilled entries
+	 * @param replacement the replacement-policy of the spilled entries
+	 * @param min_costs the min. computation costs of an entry to be spilled instead of dropped
+	 */
+	void enable_spill( const std::string &directory, const std::string &replacement, double min_costs,
+			size_t raster_size, size_t point_size, size_t line_size, size_t polygon_size, size_t plot_size );
 };
 
 
@@ -15,7 +15,7 @@
 
 #include "operators/provenance.h"
 
-std::unique_ptr<LocalRelevanceFunction> LocalRelevanceFunction::by_name(
+std::unique_ptr<LocalReplacementPolicy> LocalReplacementPolicy::by_name(
 		const std::string& name) {
 
 	std::string lc;
@@ -26,74 +26,216 @@ std::unique_ptr<LocalRelevanceFunction> LocalRelevanceFunction::by_name(
 		return std::make_unique<LocalLRU>();
 	else if ( lc == "costlru" )
 		return std::make_unique<LocalCostLRU>();
+	else if ( lc == "clock" )
+		return std::make_unique<LocalClock>();
 	throw ArgumentException(concat("Unknown replacement: ", name));
 
 }
 
-void LocalRelevanceFunction::new_turn() {
+//
+// LRU
+//
+
+void LocalLRU::inserted(const LocalRef& ref) {
+	entries.push_front(ref);
+	index[ref.entry_id] = entries.begin();
+}
+
+void LocalLRU::accessed(uint64_t entry_id) {
+	auto it = index.find(entry_id);
+	if ( it != index.end() )
+		entries.splice(entries.begin(), entries, it->second);
+}
+
+void LocalLRU::removed(uint64_t entry_id) {
+	auto it = index.find(entry_id);
+	if ( it != index.end() ) {
+		entries.erase(it->second);
+		index.erase(it);
+	}
+}
+
+bool LocalLRU::empty() const {
+	return entries.empty();
+}
+
+LocalRef LocalLRU::pop_victim() {
+	LocalRef result = entries.back();
+	index.erase(result.entry_id);
+	entries.pop_back();
+	return result;
+}
+
+const LocalRef& LocalLRU::peek_victim() const {
+	return entries.back();
+}
+
+//
+// Cost LRU
+//
+
+LocalCostLRU::LocalCostLRU() : inflation(0) {}
+
+double LocalCostLRU::priority(const Item& item) const {
+	return inflation + item.hits * item.value;
+}
+
+void LocalCostLRU::inserted(const LocalRef& ref) {
+	double costs = CachingStrategy::get_costs(ref.profile,CachingStrategy::Type::UNCACHED);
+	Item item(ref, costs / std::max<uint64_t>(ref.size,1));
+	double p = priority(item);
+	index[ref.entry_id] = entries.emplace(p, std::move(item));
+}
+
+void LocalCostLRU::accessed(uint64_t entry_id) {
+	auto it = index.find(entry_id);
+	if ( it == index.end() )
+		return;
+	Item item = std::move(it->second->second);
+	entries.erase(it->second);
+	item.hits++;
+	double p = priority(item);
+	it->second = entries.emplace(p, std::move(item));
+}
+
+void LocalCostLRU::removed(uint64_t entry_id) {
+	auto it = index.find(entry_id);
+	if ( it != index.end() ) {
+		entries.erase(it->second);
+		index.erase(it);
+	}
+}
+
+bool LocalCostLRU::empty() const {
+	return entries.empty();
+}
+
+LocalRef LocalCostLRU::pop_victim() {
+	auto first = entries.begin();
+	inflation = first->first;
+	LocalRef result = first->second.ref;
+	index.erase(result.entry_id);
+	entries.erase(first);
+	return result;
+}
+
+const LocalRef& LocalCostLRU::peek_victim() const {
+	return entries.begin()->second.ref;
 }
 
-bool LocalLRU::operator ()(const LocalRef& e1, const LocalRef& e2) const  {
-	return e1.last_access < e2.last_access;
+//
+// CLOCK
+//
+
+LocalClock::LocalClock() : hand(entries.end()) {}
+
+void LocalClock::inserted(const LocalRef& ref) {
+	// Insert right behind the hand, so the new entry is inspected last
+	index[ref.entry_id] = entries.insert(hand, Item(ref));
 }
 
-LocalCostLRU::LocalCostLRU() : now(0) {}
+void LocalClock::accessed(uint64_t entry_id) {
+	auto it = index.find(entry_id);
+	if ( it != index.end() )
+		it->second->referenced = true;
+}
 
-void LocalCostLRU::new_turn()  {
-	now = CacheCommon::time_millis();
+void LocalClock::removed(uint64_t entry_id) {
+	auto it = index.find(entry_id);
+	if ( it != index.end() ) {
+		if ( hand == it->second )
+			hand++;
+		entries.erase(it->second);
+		index.erase(it);
+	}
 }
 
-bool LocalCostLRU::operator ()(const LocalRef& e1, const LocalRef& e2) const  {
-	double f1 = 1.0 - (((now - e1.last_access) / 60000) * 0.01);
-	double f2 = 1.0 - (((now - e2.last_access) / 60000) * 0.01);
+bool LocalClock::empty() const {
+	return entries.empty();
+}
 
-	double c1 = CachingStrategy::get_costs(e1.profile,CachingStrategy::Type::UNCACHED);
-	double c2 = CachingStrategy::get_costs(e2.profile,CachingStrategy::Type::UNCACHED);
+LocalRef LocalClock::pop_victim() {
+	while ( true ) {
+		if ( hand == entries.end() )
+			hand = entries.begin();
+		if ( hand->referenced ) {
+			hand->referenced = false;
+			hand++;
+		}
+		else {
+			LocalRef result = hand->ref;
+			index.erase(result.entry_id);
+			hand = entries.erase(hand);
+			return result;
+		}
+	}
+}
 
-	return (c1 * f1) < (c2 * f2);
+const LocalRef& LocalClock::peek_victim() const {
+	// Same sweep as pop_victim(), without clearing the flags
+	std::list<Item>::const_iterator it = hand;
+	for ( size_t i = 0; i < entries.size(); i++ ) {
+		if ( it == entries.end() )
+			it = entries.begin();
+		if ( !it->referenced )
+			return it->ref;
+		it++;
+	}
+	// All entries are referenced: the hand clears every flag and comes back to its start
+	return (hand == entries.end() ? entries.begin() : std::list<Item>::const_iterator(hand))->ref;
 }
 
 //
 // IMPL
 //
 template<class T>
-LocalReplacement<T>::LocalReplacement(std::unique_ptr<LocalRelevanceFunction> relevance) : relevance(std::move(relevance)) {
+LocalReplacement<T>::LocalReplacement(std::unique_ptr<LocalReplacementPolicy> policy) : policy(std::move(policy)) {
+}
+
+template<class T>
+void LocalReplacement<T>::inserted(const MetaCacheEntry& entry) {
+	std::lock_guard<std::mutex> g(mtx);
+	policy->inserted(LocalRef(entry, entry));
+}
+
+template<class T>
+void LocalReplacement<T>::accessed(const NodeCacheEntry<T>& entry) {
+	std::lock_guard<std::mutex> g(mtx);
+	policy->accessed(entry.entry_id);
 }
 
 template<class T>
 std::vector<LocalRef> LocalReplacement<T>::get_removals(NodeCache<T>& cache,
 		size_t space_required) {
-	std::vector<LocalRef> all_entries;
+	std::vector<LocalRef> result;
 
-	size_t avail = (cache.get_current_size() > cache.get_max_size()) ? 0 : cache.get_max_size() - cache.get_current_size();
+	size_t avail = get_available(cache);
 	if ( avail < space_required ) {
-		CacheHandshake hs = cache.get_all();
-		for (auto &p : hs.get_items()) {
-			for (auto &e : p.second)
-				all_entries.push_back(LocalRef(p.first, e));
+		std::lock_guard<std::mutex> g(mtx);
+		size_t space_freed = 0;
+		while ( space_freed < space_required - avail && !policy->empty() ) {
+			result.push_back( policy->pop_victim() );
+			space_freed += result.back().size;
 		}
-		relevance->new_turn();
-		return compute_removals(all_entries, space_required-avail);
 	}
-	return all_entries;
+	return result;
 }
 
 template<class T>
-std::vector<LocalRef> LocalReplacement<T>::compute_removals(
-		std::vector<LocalRef>& all_entries, size_t space_required) {
-
-	std::vector<LocalRef> result;
-	std::sort(all_entries.begin(), all_entries.end(), std::ref(*relevance) );
-
-	size_t space_freed = 0;
-	auto i = all_entries.begin();
+bool LocalReplacement<T>::admit(NodeCache<T>& cache, const CachingStrategy& strategy,
+		const std::string& semantic_id, const CacheEntry& candidate) {
+	if ( get_available(cache) >= candidate.size )
+		return true;
+	std::lock_guard<std::mutex> g(mtx);
+	if ( policy->empty() )
+		return true;
+	auto &victim = policy->peek_victim();
+	return strategy.admit(semantic_id, candidate, victim.semantic_id, victim);
+}
 
-	while ( space_freed < space_required && i != all_entries.end() ) {
-		space_freed += i->size;
-		result.push_back( *i );
-		i++;
-	}
-	return result;
+template<class T>
+size_t LocalReplacement<T>::get_available(NodeCache<T>& cache) {
+	return (cache.get_current_size() > cache.get_max_size()) ? 0 : cache.get_max_size() - cache.get_current_size();
 }
 
 template class LocalReplacement<GenericRaster>;
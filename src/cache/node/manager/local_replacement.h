@@ -9,66 +9,183 @@
 #define CACHE_NODE_MANAGER_LOCAL_REPLACEMENT_H_
 
 #include "cache/node/node_cache.h"
+#include "cache/priv/caching_strategy.h"
 #include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 
 class LocalRef: public NodeCacheKey, public CacheEntry {
 public:
 	LocalRef(const std::string &semantic_id, const HandshakeEntry &e) :
 			NodeCacheKey(semantic_id, e.entry_id), CacheEntry(e) {
 	}
+	LocalRef(const NodeCacheKey &key, const CacheEntry &e) :
+			NodeCacheKey(key), CacheEntry(e) {
+	}
 };
 
 
 /**
- * Defines an ordering on cache-entries, so
- * that after sorting them, the least relevant entries
- * are at the end of the sorted structure
+ * Keeps the entries of a single cache ordered by their relevance.
+ * The order is updated incrementally on every insert and access, so
+ * selecting victims only touches the entries actually evicted.
+ * Implementations are not thread-safe, calls are serialized by LocalReplacement.
  */
-class LocalRelevanceFunction {
+class LocalReplacementPolicy {
 public:
-	static std::unique_ptr<LocalRelevanceFunction> by_name( const std::string &name );
-	virtual ~LocalRelevanceFunction() = default;
-	virtual void new_turn();
+	static std::unique_ptr<LocalReplacementPolicy> by_name( const std::string &name );
+	virtual ~LocalReplacementPolicy() = default;
+
+	/**
+	 * Adds a new entry to the policy
+	 * @param ref the entry
+	 */
+	virtual void inserted( const LocalRef &ref ) = 0;
+
 	/**
-	 * Compares the given entries by their relevance. If e1 is more relevant
-	 * than e2, true is returned.
-	 * @param e1 the first entry
-	 * @param e2 the second entry
-	 * @return whether e1 is more relevant than e2
+	 * Marks the given entry as used. Unknown ids are ignored.
+	 * @param entry_id the id of the entry
 	 */
-	virtual bool operator() ( const LocalRef &e1, const LocalRef &e2 ) const = 0;
+	virtual void accessed( uint64_t entry_id ) = 0;
+
+	/**
+	 * Removes the given entry from the policy. Unknown ids are ignored.
+	 * @param entry_id the id of the entry
+	 */
+	virtual void removed( uint64_t entry_id ) = 0;
+
+	/**
+	 * @return whether the policy holds no entries
+	 */
+	virtual bool empty() const = 0;
+
+	/**
+	 * Removes the least relevant entry from the policy. Must not be called if empty.
+	 * @return the removed entry
+	 */
+	virtual LocalRef pop_victim() = 0;
+
+	/**
+	 * Tells which entry pop_victim() would remove next. Must not be called if empty.
+	 * @return the least relevant entry
+	 */
+	virtual const LocalRef& peek_victim() const = 0;
 };
 
 /**
- * Simple LRU-Implementation of the relevance function
+ * Simple LRU-Implementation, backed by a list in access order
  */
-class LocalLRU : public LocalRelevanceFunction {
+class LocalLRU : public LocalReplacementPolicy {
 public:
-	bool operator() ( const LocalRef &e1, const LocalRef &e2 ) const;
+	void inserted( const LocalRef &ref );
+	void accessed( uint64_t entry_id );
+	void removed( uint64_t entry_id );
+	bool empty() const;
+	LocalRef pop_victim();
+	const LocalRef& peek_victim() const;
+private:
+	// most recently used first
+	std::list<LocalRef> entries;
+	std::unordered_map<uint64_t,std::list<LocalRef>::iterator> index;
 };
 
 /**
- * A cost based LRU implementation of the relevance function.
- * Main factor for the ordering are the computation costs. They are
- * weighted with a time since the last access to the entry.
+ * A cost based replacement, following Greedy-Dual-Size-Frequency.
+ * Each entry gets the priority L + accesses * costs / size, where
+ * costs are the computation costs of the entry and L is the priority
+ * of the last victim. Raising L with every eviction ages entries
+ * which were not accessed for a long time.
  */
-class LocalCostLRU : public LocalRelevanceFunction {
+class LocalCostLRU : public LocalReplacementPolicy {
 public:
 	LocalCostLRU();
-	void new_turn();
-	bool operator() ( const LocalRef &e1, const LocalRef &e2 ) const;
+	void inserted( const LocalRef &ref );
+	void accessed( uint64_t entry_id );
+	void removed( uint64_t entry_id );
+	bool empty() const;
+	LocalRef pop_victim();
+	const LocalRef& peek_victim() const;
 private:
-	time_t now;
+	class Item {
+	public:
+		Item( const LocalRef &ref, double value ) : ref(ref), value(value), hits(1) {}
+		LocalRef ref;
+		// costs per byte
+		double value;
+		uint32_t hits;
+	};
+	typedef std::multimap<double,Item> PriorityMap;
+	double priority( const Item &item ) const;
+	double inflation;
+	// lowest priority first
+	PriorityMap entries;
+	std::unordered_map<uint64_t,PriorityMap::iterator> index;
+};
+
+/**
+ * CLOCK-Implementation approximating LRU. Accesses only set a reference
+ * flag, victims are found by a hand sweeping over the entries and
+ * clearing the flags on its way.
+ */
+class LocalClock : public LocalReplacementPolicy {
+public:
+	LocalClock();
+	void inserted( const LocalRef &ref );
+	void accessed( uint64_t entry_id );
+	void removed( uint64_t entry_id );
+	bool empty() const;
+	LocalRef pop_victim();
+	const LocalRef& peek_victim() const;
+private:
+	class Item {
+	public:
+		Item( const LocalRef &ref ) : ref(ref), referenced(false) {}
+		LocalRef ref;
+		bool referenced;
+	};
+	std::list<Item> entries;
+	std::unordered_map<uint64_t,std::list<Item>::iterator> index;
+	// the next candidate; end() wraps around to begin()
+	std::list<Item>::iterator hand;
 };
 
 template<class T>
 class LocalReplacement {
 public:
-	LocalReplacement( std::unique_ptr<LocalRelevanceFunction> relevance );
+	LocalReplacement( std::unique_ptr<LocalReplacementPolicy> policy );
+
+	/**
+	 * Registers an entry just added to the cache
+	 * @param entry the new entry
+	 */
+	void inserted( const MetaCacheEntry &entry );
+
+	/**
+	 * Registers a hit on the given entry
+	 * @param entry the entry used to answer a query
+	 */
+	void accessed( const NodeCacheEntry<T> &entry );
+
+	/**
+	 * Selects the entries to drop from the given cache in order to
+	 * fit a new entry of the given size. The returned entries are
+	 * no longer tracked and must be removed from the cache.
+	 */
 	std::vector<LocalRef> get_removals(NodeCache<T> &cache, size_t space_required);
+
+	/**
+	 * Asks the given strategy whether a new entry should be cached at
+	 * the expense of the next victim. Entries fitting into the free
+	 * space of the cache are always admitted.
+	 */
+	bool admit(NodeCache<T> &cache, const CachingStrategy &strategy, const std::string &semantic_id, const CacheEntry &candidate);
 private:
-	std::vector<LocalRef> compute_removals(std::vector<LocalRef> &all_entries, size_t space_required);
-	std::unique_ptr<LocalRelevanceFunction> relevance;
+	static size_t get_available(NodeCache<T> &cache);
+
+	std::mutex mtx;
+	std::unique_ptr<LocalReplacementPolicy> policy;
 };
 
 #endif /* CACHE_NODE_MANAGER_LOCAL_REPLACEMENT_H_ */
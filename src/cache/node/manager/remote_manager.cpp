@@ -87,6 +87,12 @@ bool RemoteCacheWrapper<T>::put(const std::string& semantic_id,
 template<typename T>
 std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 		const QueryRectangle& rect, QueryProfiler &profiler) {
+	return query_shared(op,rect,profiler).release();
+}
+
+template<typename T>
+cow_ptr<T> RemoteCacheWrapper<T>::query_shared(GenericOperator& op,
+		const QueryRectangle& rect, QueryProfiler &profiler) {
 	if ( op.getDepth() == 0 || mgr.get_worker_context().get_puzzle_depth() > op.getDepth() )
 		throw NoSuchElementException("No query");
 
@@ -100,14 +106,16 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 	// Only process locally if there is no remainder
 	if (!qres.has_remainder()) {
 		this->stats.add_query(qres.hit_ratio);
+		if (qres.downsampled)
+			this->stats.add_downsampled_hit();
 
 		// Track costs
 		for (auto &e : qres.items)
 			profiler.addTotalCosts(e->profile);
 
-		if (qres.items.size() == 1) {
+		if (qres.items.size() == 1 && !qres.downsampled) {
 			this->stats.add_single_local_hit();
-			return qres.items.front()->copy_data();
+			return cow_ptr<T>(qres.items.front()->data);
 		}
 		// puzzle
 		else {
@@ -117,7 +125,7 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 			for (auto &ne : qres.items) {
 				items.push_back(ne->data);
 			}
-			return PuzzleUtil::process(op, rect, qres.remainder, items, profiler);
+			return cow_ptr<T>(PuzzleUtil::process(mgr, op, rect, qres.remainder, items, profiler));
 		}
 	}
 
@@ -144,7 +152,7 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 				CacheCommon::qr_to_string(rect).c_str(),
 				op.getSemanticId().c_str());
 		try {
-			return retriever.load(op.getSemanticId(), CacheRef(*resp), profiler);
+			return cow_ptr<T>(retriever.load(op.getSemanticId(), CacheRef(*resp), profiler));
 		} catch ( const DeliveryException &de ) {
 			throw NoSuchElementException("Remote-entry gone!");
 		}
@@ -177,7 +185,7 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 		Log::trace("Partial remote HIT for query: %s on %s: %s",
 				CacheCommon::qr_to_string(rect).c_str(),
 				op.getSemanticId().c_str(), pr.to_string().c_str());
-		return process_puzzle_int(op,pr, profiler);
+		return cow_ptr<T>(process_puzzle_int(op,pr, profiler));
 		break;
 	}
 	default: {
@@ -220,32 +228,8 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::process_puzzle_int( GenericOperator &o
 		const PuzzleRequest& request, QueryProfiler& profiler) {
 
 	TIME_EXEC("CacheManager.puzzle");
-
-	std::vector<std::shared_ptr<const T>> parts;
-
-	std::vector<Cube<3>> rems;
-	rems.insert(rems.begin(), request.remainder.begin(), request.remainder.end());
-
-	for (auto &ref : request.parts) {
-		try {
-			parts.push_back(retriever.fetch(request.semantic_id, ref, profiler));
-		} catch ( const NoSuchElementException &nse ) {
-			Log::debug("Puzzle-piece gone, adding to remainders");
-			SpatialReference sref(request.query.crsId,ref.bounds.get_dimension(0).a,ref.bounds.get_dimension(1).a,
-					ref.bounds.get_dimension(0).b,ref.bounds.get_dimension(1).b);
-
-			rems.push_back(ref.bounds);
-		}
-	}
-
-	// All parts gone!
-	if ( parts.empty() ) {
-		throw NoSuchElementException("All puzzle pieces gone!");
-	}
-	else {
-		PuzzleGuard pg(mgr.get_worker_context());
-		return PuzzleUtil::process(op, request.query, request.remainder, parts, profiler);
-	}
+	PuzzleGuard pg(mgr.get_worker_context());
+	return PuzzleUtil::process(mgr, op, request, retriever, profiler);
 }
 
 ////////////////////////////////////////////////////////////
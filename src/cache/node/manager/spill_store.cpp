@@ -0,0 +1,143 @@
+#include "cache/node/manager/spill_store.h"
+#include "util/exceptions.h"
+#include "util/log.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+const size_t SpillStore::DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
+
+SpillStore::Segment::Segment(const std::string& path) :
+	path(path), stream(BinaryStream::createFile(path.c_str())), length(0), live(0) {
+}
+
+SpillStore::SpillStore(const std::string& directory, const std::string& name, size_t max_size,
+		std::unique_ptr<LocalReplacementPolicy> policy, size_t segment_size) :
+	directory(directory), name(name), max_size(max_size), segment_size(segment_size),
+	current_size(0), next_segment(0), policy(std::move(policy)) {
+	if ( mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST )
+		throw CacheException(concat("Unable to create spill directory ", directory, ": ", strerror(errno)));
+	Log::debug("Creating new spill store %s/%s with capacity: %d bytes", directory.c_str(), name.c_str(), max_size);
+}
+
+SpillStore::~SpillStore() {
+	for ( auto &p : segments )
+		unlink(p.second.path.c_str());
+}
+
+std::vector<LocalRef> SpillStore::append(const LocalRef& ref, BinaryWriteBuffer& buffer) {
+	std::lock_guard<std::mutex> g(mtx);
+	auto old = records.find(ref.entry_id);
+	if ( old != records.end() ) {
+		policy->removed(ref.entry_id);
+		drop(old);
+	}
+
+	Segment &seg = get_append_segment();
+	uint32_t seg_id = segments.rbegin()->first;
+	int fd = seg.stream.getWriteFD();
+	size_t offset = seg.length;
+	try {
+		seg.stream.write(buffer);
+	} catch ( const NetworkException &ne ) {
+		// Skip whatever was written partially
+		seg.length = lseek(fd, 0, SEEK_END);
+		throw CacheException(concat("Unable to spill entry ", ref.entry_id, ": ", ne.what()));
+	}
+	seg.length = lseek(fd, 0, SEEK_END);
+
+	size_t length = seg.length - offset;
+	seg.live += length;
+	current_size += length;
+	records.emplace(ref.entry_id, Record(seg_id, offset, length));
+
+	LocalRef spilled(ref);
+	spilled.size = length;
+	policy->inserted(spilled);
+
+	std::vector<LocalRef> result;
+	while ( current_size > max_size && !policy->empty() ) {
+		result.push_back(policy->pop_victim());
+		drop(records.find(result.back().entry_id));
+	}
+	return result;
+}
+
+std::unique_ptr<BinaryReadBuffer> SpillStore::read(uint64_t entry_id) {
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+
+	void *map;
+	size_t map_length, start;
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		auto it = records.find(entry_id);
+		if ( it == records.end() )
+			throw NoSuchElementException(concat("No spilled record for entry: ", entry_id));
+
+		auto &rec = it->second;
+		// Mappings must start at a page boundary
+		size_t map_offset = rec.offset - rec.offset % page_size;
+		start = rec.offset - map_offset;
+		map_length = start + rec.length;
+		map = mmap(nullptr, map_length, PROT_READ, MAP_PRIVATE, segments.at(rec.segment).stream.getReadFD(), map_offset);
+		if ( map == MAP_FAILED )
+			throw CacheException(concat("Unable to map spilled entry ", entry_id, ": ", strerror(errno)));
+		policy->accessed(entry_id);
+	}
+	// The mapping stays valid, even if the segment is deleted meanwhile
+	madvise(map, map_length, MADV_SEQUENTIAL);
+	try {
+		auto result = std::make_unique<BinaryReadBuffer>((const char *) map + start, map_length - start);
+		munmap(map, map_length);
+		return result;
+	} catch (...) {
+		munmap(map, map_length);
+		throw;
+	}
+}
+
+void SpillStore::remove(uint64_t entry_id) {
+	std::lock_guard<std::mutex> g(mtx);
+	auto it = records.find(entry_id);
+	if ( it != records.end() ) {
+		policy->removed(entry_id);
+		drop(it);
+	}
+}
+
+size_t SpillStore::get_current_size() const {
+	std::lock_guard<std::mutex> g(mtx);
+	return current_size;
+}
+
+size_t SpillStore::get_num_segments() const {
+	std::lock_guard<std::mutex> g(mtx);
+	return segments.size();
+}
+
+SpillStore::Segment& SpillStore::get_append_segment() {
+	if ( segments.empty() || segments.rbegin()->second.length >= segment_size ) {
+		uint32_t id = next_segment++;
+		auto path = concat(directory, "/", name, "_", id, ".spill");
+		segments.emplace(std::piecewise_construct, std::forward_as_tuple(id), std::forward_as_tuple(path));
+	}
+	return segments.rbegin()->second;
+}
+
+void SpillStore::drop(std::unordered_map<uint64_t,Record>::iterator record) {
+	auto seg = segments.find(record->second.segment);
+	seg->second.live -= record->second.length;
+	current_size -= record->second.length;
+	records.erase(record);
+
+	// The segment currently appended to is kept until it is full
+	bool appending = seg->first + 1 == next_segment && seg->second.length < segment_size;
+	if ( seg->second.live == 0 && !appending ) {
+		unlink(seg->second.path.c_str());
+		segments.erase(seg);
+	}
+}
@@ -0,0 +1,127 @@
+#ifndef CACHE_NODE_MANAGER_SPILL_STORE_H_
+#define CACHE_NODE_MANAGER_SPILL_STORE_H_
+
+#include "cache/node/manager/local_replacement.h"
+#include "util/binarystream.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Second tier for entries evicted from a local node-cache.
+ * Entries are serialized into append-only segment files inside a local
+ * directory and read back by mapping their record into memory.
+ * The size limit applies to the live records. Since segments are never
+ * rewritten, disk space is reclaimed once all records of a segment are removed.
+ * Victims are selected by an own replacement-policy.
+ * All methods are thread-safe.
+ */
+class SpillStore {
+public:
+	/** The size (in bytes) after which a new segment is started */
+	static const size_t DEFAULT_SEGMENT_SIZE;
+
+	/**
+	 * Creates a new instance. The directory is created if it does not exist.
+	 * @param directory the directory holding the segment files
+	 * @param name the prefix of the segment files, unique per directory
+	 * @param max_size the max. size (in bytes) of all live records
+	 * @param policy the replacement-policy selecting the records to evict
+	 * @param segment_size the size (in bytes) after which a new segment is started
+	 */
+	SpillStore( const std::string &directory, const std::string &name, size_t max_size,
+			std::unique_ptr<LocalReplacementPolicy> policy, size_t segment_size = DEFAULT_SEGMENT_SIZE );
+
+	/**
+	 * Deletes all segment files
+	 */
+	~SpillStore();
+
+	SpillStore( const SpillStore& ) = delete;
+	SpillStore& operator=( const SpillStore& ) = delete;
+
+	/**
+	 * Appends the given buffer as record of the given entry. Records
+	 * are evicted until all live records fit into the store again.
+	 * @param ref the entry the record belongs to
+	 * @param buffer the serialized entry
+	 * @return the evicted entries, possibly including the given one
+	 */
+	std::vector<LocalRef> append( const LocalRef &ref, BinaryWriteBuffer &buffer );
+
+	/**
+	 * Reads the record of the given entry and marks it as used
+	 * @param entry_id the id of the entry
+	 * @return a buffer holding the serialized entry
+	 */
+	std::unique_ptr<BinaryReadBuffer> read( uint64_t entry_id );
+
+	/**
+	 * Removes the record of the given entry. Unknown ids are ignored.
+	 * @param entry_id the id of the entry
+	 */
+	void remove( uint64_t entry_id );
+
+	/**
+	 * @return the maximum size (in bytes) of all live records
+	 */
+	size_t get_max_size() const { return max_size; }
+
+	/**
+	 * @return the size (in bytes) of all live records
+	 */
+	size_t get_current_size() const;
+
+	/**
+	 * @return the number of segment files currently on disk
+	 */
+	size_t get_num_segments() const;
+
+private:
+	class Segment {
+	public:
+		Segment( const std::string &path );
+		std::string path;
+		BinaryStream stream;
+		// the bytes written to the file
+		size_t length;
+		// the bytes of all live records
+		size_t live;
+	};
+
+	class Record {
+	public:
+		Record( uint32_t segment, size_t offset, size_t length ) : segment(segment), offset(offset), length(length) {}
+		uint32_t segment;
+		size_t offset;
+		size_t length;
+	};
+
+	/**
+	 * @return the segment to append to, starting a new one if the current is full
+	 */
+	Segment& get_append_segment();
+
+	/**
+	 * Drops the given record and deletes its segment, if it holds no live records anymore
+	 */
+	void drop( std::unordered_map<uint64_t,Record>::iterator record );
+
+	const std::string directory;
+	const std::string name;
+	const size_t max_size;
+	const size_t segment_size;
+	size_t current_size;
+	uint32_t next_segment;
+
+	mutable std::mutex mtx;
+	std::unique_ptr<LocalReplacementPolicy> policy;
+	std::map<uint32_t,Segment> segments;
+	std::unordered_map<uint64_t,Record> records;
+};
+
+#endif /* CACHE_NODE_MANAGER_SPILL_STORE_H_ */
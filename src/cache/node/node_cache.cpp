@@ -25,7 +25,7 @@
 
 template<typename EType>
 NodeCacheEntry<EType>::NodeCacheEntry(uint64_t entry_id, const CacheEntry &meta,
-		std::shared_ptr<EType> result) :
+		std::shared_ptr<const EType> result) :
 		CacheEntry(meta), entry_id(entry_id), data(result) {
 }
 
@@ -102,6 +102,8 @@ template<typename EType>
 void NodeCache<EType>::remove(const NodeCacheKey& key) {
 	try {
 		auto entry = this->remove_int(key.semantic_id, key.entry_id);
+		if ( entry->is_cold() )
+			return;
 		if ( entry->size > current_size )
 			current_size = 0;
 		else
@@ -111,14 +113,49 @@ void NodeCache<EType>::remove(const NodeCacheKey& key) {
 	}
 }
 
+template<typename EType>
+void NodeCache<EType>::remove_cold(const NodeCacheKey& key) {
+	try {
+		if ( this->get_int(key.semantic_id, key.entry_id)->is_cold() )
+			this->remove_int(key.semantic_id, key.entry_id);
+	} catch (const NoSuchElementException &nse) {
+	}
+}
+
+template<typename EType>
+std::shared_ptr<const NodeCacheEntry<EType>> NodeCache<EType>::make_cold(const NodeCacheKey& key) {
+	auto entry = this->get_int(key.semantic_id, key.entry_id);
+	if ( entry->is_cold() )
+		return entry;
+	auto cold = std::make_shared<NodeCacheEntry<EType>>(key.entry_id, *entry, nullptr);
+	this->replace_int(key.semantic_id, key.entry_id, cold);
+	current_size -= std::min<size_t>(entry->size, current_size);
+	return entry;
+}
+
+template<typename EType>
+std::shared_ptr<const NodeCacheEntry<EType>> NodeCache<EType>::make_hot(const NodeCacheKey& key,
+		const std::shared_ptr<const EType>& data) {
+	auto entry = this->get_int(key.semantic_id, key.entry_id);
+	if ( !entry->is_cold() )
+		return entry;
+	auto hot = std::make_shared<NodeCacheEntry<EType>>(key.entry_id, *entry, data);
+	this->replace_int(key.semantic_id, key.entry_id, hot);
+	current_size += hot->size;
+	return hot;
+}
+
 template<typename EType>
 const MetaCacheEntry NodeCache<EType>::put(const std::string &semantic_id,
 		const std::unique_ptr<EType> &item, const CacheEntry &meta) {
+	return put(semantic_id, std::shared_ptr<const EType>(item->clone()), meta);
+}
+
+template<typename EType>
+const MetaCacheEntry NodeCache<EType>::put(const std::string &semantic_id,
+		const std::shared_ptr<const EType> &item, const CacheEntry &meta) {
 	uint64_t id = next_id++;
-	auto cpy = item->clone();
-	auto entry = std::shared_ptr<NodeCacheEntry<EType>>(
-			new NodeCacheEntry<EType>(id, meta,
-					std::shared_ptr<EType>(cpy.release())));
+	auto entry = std::make_shared<NodeCacheEntry<EType>>(id, meta, item);
 	this->put_int(semantic_id, id, entry);
 	current_size += entry->size;
 	return MetaCacheEntry(type, semantic_id, id, *entry);
@@ -33,13 +33,18 @@ public:
 	 * @param result the data to cache
 	 *
 	 */
-	NodeCacheEntry( uint64_t entry_id, const CacheEntry &meta, std::shared_ptr<EType> result );
+	NodeCacheEntry( uint64_t entry_id, const CacheEntry &meta, std::shared_ptr<const EType> result );
 
 	/**
 	 * @return a copy of the cached data
 	 */
 	std::unique_ptr<EType> copy_data() const;
 
+	/**
+	 * @return whether the data of this entry was spilled to disk and is not held in memory
+	 */
+	bool is_cold() const { return data == nullptr; }
+
 	/**
 	 * @return a human readable representation
 	 */
@@ -78,12 +83,50 @@ public:
 	 */
 	const MetaCacheEntry put( const std::string &semantic_id, const std::unique_ptr<EType> &item, const CacheEntry &meta);
 
+	/**
+	 * Adds an entry to the cache. The given data-item is stored without copying it,
+	 * so it must not be modified afterwards and must be safe for concurrent reads.
+	 * @param semantic_id the semantic id
+	 * @param item the data-item to cache
+	 * @param meta the meta-data
+	 * @return the meta-data of the newly created entry including its unique id
+	 */
+	const MetaCacheEntry put( const std::string &semantic_id, const std::shared_ptr<const EType> &item, const CacheEntry &meta);
+
 	/**
 	 * Removes the entry with the given key
 	 * @param key the key of the entry to remove
 	 */
 	void remove( const NodeCacheKey &key );
 
+	/**
+	 * Removes the entry with the given key, if it is cold. Hot entries and
+	 * missing entries are left untouched.
+	 * Must not be executed concurrently to transitions between hot and cold.
+	 * @param key the key of the entry to remove
+	 */
+	void remove_cold( const NodeCacheKey &key );
+
+	/**
+	 * Replaces the entry with the given key by a cold copy without data, after
+	 * its data was spilled to disk. The cold entry remains queryable, but no longer
+	 * counts towards the size of this cache. Cold entries are left untouched.
+	 * Transitions between hot and cold must not be executed concurrently.
+	 * @param key the key of the entry
+	 * @return the replaced entry
+	 */
+	std::shared_ptr<const NodeCacheEntry<EType>> make_cold( const NodeCacheKey &key );
+
+	/**
+	 * Replaces the cold entry with the given key by a copy holding the given data,
+	 * read back from disk. Hot entries are left untouched.
+	 * Transitions between hot and cold must not be executed concurrently.
+	 * @param key the key of the entry
+	 * @param data the data of the entry
+	 * @return the hot entry
+	 */
+	std::shared_ptr<const NodeCacheEntry<EType>> make_hot( const NodeCacheKey &key, const std::shared_ptr<const EType> &data );
+
 	/**
 	 * Retrieves the cached item with the given key
 	 * @param key the key of the item to retrieve
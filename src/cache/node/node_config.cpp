@@ -16,10 +16,13 @@ NodeConfig NodeConfig::fromConfiguration() {
 	result.index_port = Configuration::get<int>("indexserver.port");
 	result.delivery_port = Configuration::get<int>("nodeserver.port");
 	result.num_workers = Configuration::get<int>("nodeserver.threads",4);
+	result.num_puzzle_threads = Configuration::get<int>("nodeserver.puzzle.threads",4);
 	result.mgr_impl = Configuration::get<std::string>("nodeserver.cache.manager");
 
 	result.caching_strategy = Configuration::get<std::string>("nodeserver.cache.strategy");
 	result.local_replacement = Configuration::get<std::string>("nodeserver.cache.local.replacement", "lru");
+	result.max_downsampling = Configuration::get<double>("nodeserver.cache.downsampling.factor", 1);
+	result.downsampling_method = Configuration::get<std::string>("nodeserver.cache.downsampling.method", "average");
 
 	//TODO: cpptoml can access int64_t but not long. Old method was getting a long, data field is of type size_t.
 	result.raster_size = Configuration::get<size_t>("nodeserver.cache.raster.size");
@@ -27,6 +30,15 @@ NodeConfig NodeConfig::fromConfiguration() {
 	result.line_size = Configuration::get<size_t>("nodeserver.cache.lines.size");
 	result.polygon_size = Configuration::get<size_t>("nodeserver.cache.polygons.size");
 	result.plot_size = Configuration::get<size_t>("nodeserver.cache.plots.size");
+
+	result.spill_directory = Configuration::get<std::string>("nodeserver.cache.spill.directory", "");
+	result.spill_replacement = Configuration::get<std::string>("nodeserver.cache.spill.replacement", "lru");
+	result.spill_min_costs = Configuration::get<double>("nodeserver.cache.spill.min_costs", 0);
+	result.spill_raster_size = Configuration::get<size_t>("nodeserver.cache.spill.raster.size", 0);
+	result.spill_point_size = Configuration::get<size_t>("nodeserver.cache.spill.points.size", 0);
+	result.spill_line_size = Configuration::get<size_t>("nodeserver.cache.spill.lines.size", 0);
+	result.spill_polygon_size = Configuration::get<size_t>("nodeserver.cache.spill.polygons.size", 0);
+	result.spill_plot_size = Configuration::get<size_t>("nodeserver.cache.spill.plots.size", 0);
 	return result;
 }
 
@@ -34,11 +46,19 @@ NodeConfig::NodeConfig() :
 		index_port(0),
 		delivery_port(0),
 		num_workers(1),
+		num_puzzle_threads(0),
 		raster_size(0),
 		point_size(0),
 		line_size(0),
 		polygon_size(0),
-		plot_size(0) {
+		plot_size(0),
+		max_downsampling(1),
+		spill_min_costs(0),
+		spill_raster_size(0),
+		spill_point_size(0),
+		spill_line_size(0),
+		spill_polygon_size(0),
+		spill_plot_size(0) {
 }
 
 std::string NodeConfig::to_string() const {
@@ -48,13 +68,21 @@ std::string NodeConfig::to_string() const {
 	ss << "  Index-Port       : " << index_port << std::endl;
 	ss << "  Delivery-Port    : " << delivery_port << std::endl;
 	ss << "  #Workers         : " << num_workers << std::endl;
+	ss << "  #Puzzle-Threads  : " << num_puzzle_threads << std::endl;
 	ss << "  Manager-Impl     : " << mgr_impl << std::endl;
 	ss << "  Caching-Strategy : " << caching_strategy << std::endl;
 	ss << "  Local-Replacement: " << local_replacement << std::endl;
+	ss << "  Max-Downsampling : " << max_downsampling << std::endl;
+	ss << "  Downsampling     : " << downsampling_method << std::endl;
 	ss << "  Raster-Size      : " << raster_size << std::endl;
 	ss << "  Point-Size       : " << point_size << std::endl;
 	ss << "  Line-Size        : " << line_size << std::endl;
 	ss << "  Polygon-Size     : " << polygon_size << std::endl;
-	ss << "  Plot-Size        : " << plot_size;
+	ss << "  Plot-Size        : " << plot_size << std::endl;
+	ss << "  Spill-Directory  : " << spill_directory << std::endl;
+	ss << "  Spill-Replacement: " << spill_replacement << std::endl;
+	ss << "  Spill-Min-Costs  : " << spill_min_costs << std::endl;
+	ss << "  Spill-Sizes      : " << spill_raster_size << " / " << spill_point_size << " / " << spill_line_size
+	   << " / " << spill_polygon_size << " / " << spill_plot_size;
 	return ss.str();
 }
@@ -21,6 +21,7 @@ public:
 
 	int delivery_port;
 	int num_workers;
+	int num_puzzle_threads;
 
 
 	std::string mgr_impl;
@@ -33,6 +34,17 @@ public:
 
 	std::string caching_strategy;
 	std::string local_replacement;
+	double max_downsampling;
+	std::string downsampling_method;
+
+	std::string spill_directory;
+	std::string spill_replacement;
+	double spill_min_costs;
+	size_t spill_raster_size;
+	size_t spill_point_size;
+	size_t spill_line_size;
+	size_t spill_polygon_size;
+	size_t spill_plot_size;
 
 	std::string to_string() const;
 
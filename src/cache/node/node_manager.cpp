@@ -61,6 +61,16 @@ void ActiveQueryStats::add_miss() {
 	misses++;
 }
 
+void ActiveQueryStats::add_downsampled_hit() {
+	std::lock_guard<std::mutex> g(mtx);
+	downsampled_hits++;
+}
+
+void ActiveQueryStats::add_cold_hit() {
+	std::lock_guard<std::mutex> g(mtx);
+	cold_hits++;
+}
+
 void ActiveQueryStats::add_result_bytes(uint64_t bytes) {
 	std::lock_guard<std::mutex> g(mtx);
 	result_bytes+=bytes;
@@ -127,6 +137,12 @@ std::shared_ptr<const NodeCacheEntry<T>> NodeCacheWrapper<T>::get(const NodeCach
 	return cache.get(key);
 }
 
+template<typename T>
+std::unique_ptr<InFlightRegistry::Lease> NodeCacheWrapper<T>::begin_computation(
+		const std::string& semantic_id, const QueryRectangle& rect) {
+	return inflight.begin(semantic_id, rect);
+}
+
 template<typename T>
 QueryStats NodeCacheWrapper<T>::get_and_reset_query_stats() {
 	return stats.get_and_reset();
@@ -157,6 +173,18 @@ CacheCube NodeCacheWrapper<ProvenanceCollection>::get_bounds(const ProvenanceCol
 	return CacheCube(rect);
 }
 
+template<typename T>
+void NodeCacheWrapper<T>::make_shareable(T& item) {
+	(void) item;
+}
+
+template<>
+void NodeCacheWrapper<GenericRaster>::make_shareable(GenericRaster& item) {
+	// Copying a raster switches it to the cpu -- which must not happen concurrently.
+	// This also gives views their own buffer, so a cached raster does not keep a larger one alive.
+	item.setRepresentation(GenericRaster::Representation::CPU);
+}
+
 ////////////////////////////////////////////////////////////
 //
 // NodeCacheManager
@@ -214,14 +242,23 @@ std::unique_ptr<NodeCacheManager> NodeCacheManager::from_config( const NodeConfi
 	std::transform(config.mgr_impl.cbegin(),config.mgr_impl.cend(),mgrlc.begin(),::tolower);
 
 
+	std::unique_ptr<NodeCacheManager> result;
 	if ( mgrlc == "remote" )
-		return std::make_unique<RemoteCacheManager>(config.caching_strategy, config.raster_size, config.point_size, config.line_size, config.polygon_size, config.plot_size, config.provenance_size);
-	else if ( mgrlc == "local" )
-		return std::make_unique<LocalCacheManager>(config.caching_strategy, config.local_replacement, config.raster_size, config.point_size, config.line_size, config.polygon_size, config.plot_size, config.provenance_size);
+		result = std::make_unique<RemoteCacheManager>(config.caching_strategy, config.raster_size, config.point_size, config.line_size, config.polygon_size, config.plot_size, config.provenance_size);
+	else if ( mgrlc == "local" ) {
+		auto local = std::make_unique<LocalCacheManager>(config.caching_strategy, config.local_replacement, config.raster_size, config.point_size, config.line_size, config.polygon_size, config.plot_size, config.provenance_size);
+		if ( !config.spill_directory.empty() )
+			local->enable_spill(config.spill_directory, config.spill_replacement, config.spill_min_costs,
+					config.spill_raster_size, config.spill_point_size, config.spill_line_size, config.spill_polygon_size, config.spill_plot_size);
+		result = std::move(local);
+	}
 	else if ( mgrlc == "hybrid" )
-		return std::make_unique<HybridCacheManager>(config.caching_strategy, config.raster_size, config.point_size, config.line_size, config.polygon_size, config.plot_size, config.provenance_size);
+		result = std::make_unique<HybridCacheManager>(config.caching_strategy, config.raster_size, config.point_size, config.line_size, config.polygon_size, config.plot_size, config.provenance_size);
 	else
 		throw ArgumentException(concat("Unknown manager impl: ", config.mgr_impl));
+
+	result->raster_wrapper->cache.set_max_downsampling(config.max_downsampling);
+	return result;
 }
 
 
@@ -297,3 +334,17 @@ PuzzleGuard::PuzzleGuard(WorkerContext& ctx) : ctx(ctx) {
 PuzzleGuard::~PuzzleGuard() {
 	ctx.puzzling--;
 }
+
+DelegationGuard::Origin::Origin(const WorkerContext& worker) :
+	puzzling(worker.puzzling), index_connection(worker.index_connection) {
+}
+
+DelegationGuard::DelegationGuard(WorkerContext& ctx, const Origin& origin) : ctx(ctx), former(ctx) {
+	ctx.puzzling = origin.puzzling;
+	ctx.index_connection = origin.index_connection;
+}
+
+DelegationGuard::~DelegationGuard() {
+	ctx.puzzling = former.puzzling;
+	ctx.index_connection = former.index_connection;
+}
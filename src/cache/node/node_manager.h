@@ -44,6 +44,12 @@ public:
 	/** Adds a partial remote hit, with remainders */
 	void add_multi_remote_partial();
 
+	/** Adds a hit answered by downsampling entries of a finer resolution */
+	void add_downsampled_hit();
+
+	/** Adds a hit answered using entries spilled to disk */
+	void add_cold_hit();
+
 	/** Adds the given amount of bytes */
 	void add_result_bytes(uint64_t bytes);
 
@@ -73,6 +79,7 @@ private:
  */
 class WorkerContext {
 	friend class PuzzleGuard;
+	friend class DelegationGuard;
 public:
 	/** Constructs a new instance */
 	WorkerContext();
@@ -108,6 +115,37 @@ private:
 	WorkerContext &ctx;
 };
 
+/**
+ * Lets the current thread work on behalf of a worker, e.g. while computing
+ * a part of the worker's query on the thread of an executor. Until the guard
+ * is destroyed, the thread shares the worker's connection to the index and
+ * continues at its puzzle-depth.
+ */
+class DelegationGuard {
+public:
+	/**
+	 * The state of a worker, captured on the worker's thread
+	 */
+	class Origin {
+		friend class DelegationGuard;
+	public:
+		Origin( const WorkerContext &worker );
+	private:
+		int puzzling;
+		BlockingConnection* index_connection;
+	};
+
+	/**
+	 * @param ctx the context of the current thread
+	 * @param origin the state of the worker to act for
+	 */
+	DelegationGuard( WorkerContext &ctx, const Origin &origin );
+	~DelegationGuard();
+private:
+	WorkerContext &ctx;
+	Origin former;
+};
+
 //
 // Node-Cache
 // Gives uniform access to the real cache-implementation
@@ -181,6 +219,11 @@ public:
 	 */
 	std::shared_ptr<const NodeCacheEntry<T>> get(const NodeCacheKey &key) const;
 
+	/**
+	 * Coordinates concurrent computations of the same result on this node
+	 */
+	std::unique_ptr<InFlightRegistry::Lease> begin_computation(const std::string &semantic_id, const QueryRectangle &rect);
+
 	QueryStats get_and_reset_query_stats();
 
 	CacheType get_type() const;
@@ -188,9 +231,17 @@ public:
 protected:
 	CacheCube get_bounds( const T &item, const QueryRectangle &rect ) const;
 
+	/**
+	 * Prepares the given item for being shared with the cache, i.e. for
+	 * concurrent read-access by multiple queries.
+	 * @param item the item to prepare
+	 */
+	static void make_shareable( T &item );
+
 	NodeCacheManager &mgr;
 	NodeCache<T> cache;
 	ActiveQueryStats stats;
+	InFlightRegistry inflight;
 };
 
 class NodeCacheManager : public CacheManager {
@@ -216,9 +267,9 @@ public:
 			std::unique_ptr<NodeCacheWrapper<ProvenanceCollection>> provenance_wrapper);
 
 	/**
-	 * @return the thread-sensitve worker-context
+	 * @return the thread-sensitve worker-context of the calling thread
 	 */
-	WorkerContext &get_worker_context();
+	static WorkerContext &get_worker_context();
 
 	const CachingStrategy &get_strategy() const;
 
@@ -114,8 +114,8 @@ void NodeServer::process_create_request(BlockingConnection &index_con,
 	QueryProfiler profiler;
 	switch ( request.type ) {
 		case CacheType::RASTER: {
-			auto res = op->getCachedRaster( request.query, QueryTools(profiler) );
-			finish_request( index_con, std::shared_ptr<const GenericRaster>(res.release()) );
+			auto res = op->getCachedRasterShared( request.query, QueryTools(profiler) );
+			finish_request( index_con, res.share() );
 			break;
 		}
 		case CacheType::POINT: {
@@ -7,10 +7,12 @@
 
 #include "cache/node/nodeserver.h"
 #include "cache/node/node_config.h"
+#include "cache/node/puzzle_util.h"
 #include "cache/manager.h"
 #include "cache/common.h"
 #include "util/configuration.h"
 #include "util/log.h"
+#include "util/task_executor.h"
 #include "raster/opencl.h"
 #include <signal.h>
 #include <iostream>
@@ -70,6 +72,12 @@ int main(void) {
 #endif
 	CachingStrategy::init();
 
+	// Queries must be processed on the worker threads, which hold the connections to the index
+	TaskExecutor::init(0);
+	// Puzzles are processed on threads acting on behalf of the requesting worker
+	PuzzleUtil::init(cfg.num_puzzle_threads);
+	PuzzleUtil::set_downsampling_method(cfg.downsampling_method);
+
 	// Inititalize cache
 	std::unique_ptr<NodeCacheManager> cache_impl = NodeCacheManager::from_config(cfg);
 
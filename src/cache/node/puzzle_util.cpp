@@ -20,6 +20,7 @@
 #include "util/log.h"
 
 #include <limits>
+#include <mutex>
 
 /**
  * Helper class to combine attribtue arrays
@@ -61,47 +62,216 @@ void AttributeArraysHelper::append_arr(AttributeArrays::AttributeArray<T>& dest,
 	dest.array.insert(dest.array.end(), src.array.begin(), src.array.end());
 }
 
+//
+// Executor
+//
+
+static std::unique_ptr<TaskExecutor> executor;
+static std::mutex executor_mtx;
+
+void PuzzleUtil::init(int num_threads) {
+	std::lock_guard<std::mutex> g(executor_mtx);
+	executor.reset(new TaskExecutor(num_threads));
+}
+
+TaskExecutor& PuzzleUtil::get_executor() {
+	std::lock_guard<std::mutex> g(executor_mtx);
+	if (!executor)
+		executor.reset(new TaskExecutor(0));
+	return *executor;
+}
+
+//
+// Downsampling
+//
+
+static bool downsample_nearest = false;
+
+void PuzzleUtil::set_downsampling_method(const std::string &method) {
+	if ( method == "average" )
+		downsample_nearest = false;
+	else if ( method == "nearest" )
+		downsample_nearest = true;
+	else
+		throw ArgumentException(concat("Unknown downsampling method: ", method));
+}
+
 template<class T>
-std::unique_ptr<T> PuzzleUtil::process(GenericOperator &op,
+std::shared_ptr<const T> PuzzleUtil::fit_piece(const QueryRectangle &query,
+		const std::shared_ptr<const T> &piece) {
+	(void) query;
+	return piece;
+}
+
+template<>
+std::shared_ptr<const GenericRaster> PuzzleUtil::fit_piece(const QueryRectangle &query,
+		const std::shared_ptr<const GenericRaster> &piece) {
+	QueryCube qc(query);
+	if ( query.restype != QueryResolution::Type::PIXELS ||
+		 CacheCommon::resolution_matches(piece->pixel_scale_x, piece->pixel_scale_y, qc.pixel_scale_x, qc.pixel_scale_y) )
+		return piece;
+
+	TIME_EXEC("PuzzleUtil.downsample");
+	// Snap the extent of the piece to the pixel-grid of the query, like the remainders
+	auto snap = [](double v, double ref, double scale) {
+		return ref + std::round( (v-ref) / scale ) * scale;
+	};
+	double x1 = snap(piece->stref.x1, query.x1, qc.pixel_scale_x);
+	double x2 = snap(piece->stref.x2, query.x1, qc.pixel_scale_x);
+	double y1 = snap(piece->stref.y1, query.y1, qc.pixel_scale_y);
+	double y2 = snap(piece->stref.y2, query.y1, qc.pixel_scale_y);
+	uint32_t width = std::max<long>( 1, std::lround( (x2-x1) / qc.pixel_scale_x ) );
+	uint32_t height = std::max<long>( 1, std::lround( (y2-y1) / qc.pixel_scale_y ) );
+
+	QueryRectangle target( SpatialReference(query.crsId, x1, y1, x1 + width * qc.pixel_scale_x, y1 + height * qc.pixel_scale_y),
+						   piece->stref, QueryResolution::pixels(width, height) );
+
+	// Neither method modifies the piece. fitToQueryRectangle may return a view of it, which keeps the
+	// cached buffer alive; that is fine, because the fitted piece is dropped once the puzzle is finished.
+	auto &raster = const_cast<GenericRaster&>(*piece);
+	if ( downsample_nearest )
+		return std::shared_ptr<const GenericRaster>( raster.fitToQueryRectangle(target).release() );
+	return std::shared_ptr<const GenericRaster>( raster.downsample(target).release() );
+}
+
+template<class R>
+class PuzzleUtil::Task {
+public:
+	/**
+	 * Schedules the given function on the executor
+	 * @param mgr the manager of the requesting worker
+	 * @param function the function to execute, receiving the profiler to use
+	 */
+	template<typename F>
+	Task(NodeCacheManager &mgr, F function) :
+		profiler(std::make_shared<QueryProfiler>()), future(schedule(mgr, profiler, function)) {
+	}
+	Task(Task &&) = default;
+
+	/**
+	 * Waits for the result. The task may be run by the calling thread, if it was not started yet.
+	 * @param parent_profiler the profiler to merge the costs of the task into
+	 * @return the result of the task
+	 */
+	R get(QueryProfiler &parent_profiler) {
+		QueryProfilerStoppingGuard guard(parent_profiler);
+		try {
+			R result = future.get();
+			parent_profiler.merge(*profiler);
+			return result;
+		} catch (...) {
+			parent_profiler.merge(*profiler);
+			throw;
+		}
+	}
+
+private:
+	template<typename F>
+	static TaskFuture<R> schedule(NodeCacheManager &mgr, std::shared_ptr<QueryProfiler> profiler, F function) {
+		DelegationGuard::Origin origin(mgr.get_worker_context());
+		return get_executor().submit([&mgr, origin, profiler, function]() {
+			DelegationGuard guard(mgr.get_worker_context(), origin);
+			return function(*profiler);
+		});
+	}
+
+	std::shared_ptr<QueryProfiler> profiler;
+	TaskFuture<R> future;
+};
+
+//
+// Process
+//
+
+template<class T>
+std::unique_ptr<T> PuzzleUtil::process(NodeCacheManager &mgr, GenericOperator &op,
 		const QueryRectangle& query, const std::vector<Cube<3> >& remainder,
 		const std::vector<std::shared_ptr<const T> >& items,
 		QueryProfiler &profiler) {
 
 	TIME_EXEC("PuzzleUtil.process_puzzle");
-	Log::trace("Processing puzzle-request with %ld available items and %ld remainders: %s", items.size(), remainder.size());
+	Log::trace("Processing puzzle-request with %ld available items and %ld remainders", items.size(), remainder.size());
+
+	std::vector<std::shared_ptr<const T>> parts;
+	parts.reserve(items.size());
+	for (auto &item : items)
+		parts.push_back(fit_piece(query, item));
 
-	// Create remainder
-	Log::trace("Creating remainder queries.");
+	std::vector<Task<std::unique_ptr<T>>> remainders;
+	start_remainders<T>(mgr, query, op, *parts.front(), remainder, remainders);
+	return finish(query, std::move(parts), remainders, profiler);
+}
+
+template<class T>
+std::unique_ptr<T> PuzzleUtil::process(NodeCacheManager &mgr, GenericOperator &op,
+		const PuzzleRequest &request, const PieceRetriever<T> &retriever,
+		QueryProfiler &profiler) {
 
-	auto ref = items.front();
-	auto remainders = compute_remainders<T>(query, op, *ref, remainder, profiler);
+	TIME_EXEC("PuzzleUtil.process_puzzle");
+	Log::trace("Processing puzzle-request: %s", request.to_string().c_str());
+
+	std::vector<Task<std::shared_ptr<const T>>> fetches;
+	fetches.reserve(request.parts.size());
+	for (auto &ref : request.parts) {
+		fetches.emplace_back(mgr, [&retriever, &request, ref](QueryProfiler &qp) {
+			return fit_piece(request.query, retriever.fetch(request.semantic_id, ref, qp));
+		});
+	}
 
-	std::vector<std::shared_ptr<const T>> all_items = items;
+	std::vector<std::shared_ptr<const T>> parts;
+	std::vector<Cube<3>> gone;
+	std::vector<Task<std::unique_ptr<T>>> remainders;
+	for (size_t i = 0; i < fetches.size(); i++) {
+		try {
+			parts.push_back(fetches[i].get(profiler));
+		} catch ( const NoSuchElementException &nse ) {
+			Log::debug("Puzzle-piece gone, adding to remainders");
+			gone.push_back(request.parts[i].bounds);
+			continue;
+		}
+		// The first piece serves as reference for the remainders, which are computed while fetching the others
+		if (parts.size() == 1)
+			start_remainders<T>(mgr, request.query, op, *parts.front(), request.remainder, remainders);
+	}
 
-	for (auto &r : remainders)
-		all_items.push_back(std::shared_ptr<const T>(r.release()));
+	if ( parts.empty() )
+		throw NoSuchElementException("All puzzle pieces gone!");
 
-	auto bounds = enlarge_puzzle(query, all_items);
-	auto result = puzzle(bounds, all_items);
-	Log::trace("Finished processing puzzle-request:");
-	return result;
+	start_remainders<T>(mgr, request.query, op, *parts.front(), gone, remainders);
+	return finish(request.query, std::move(parts), remainders, profiler);
 }
 
 template<class T>
-std::vector<std::unique_ptr<T> > PuzzleUtil::compute_remainders(
-		const QueryRectangle& query, GenericOperator &op, const T& ref_result, const std::vector<Cube<3> >& remainder, QueryProfiler& profiler) {
-	TIME_EXEC("PuzzleUtil.compute_remainders");
-	std::vector<std::unique_ptr<T>> result;
+std::unique_ptr<T> PuzzleUtil::finish(const QueryRectangle &query,
+		std::vector<std::shared_ptr<const T>> parts,
+		std::vector<Task<std::unique_ptr<T>>> &remainders, QueryProfiler &profiler) {
 	{
-		QueryProfilerStoppingGuard sg(profiler);
-		auto rem_queries = get_remainder_queries(query, remainder, ref_result);
-		for (auto &rqr : rem_queries) {
-			result.push_back(compute<T>(op, rqr, profiler));
-		}
+		TIME_EXEC("PuzzleUtil.compute_remainders");
+		for (auto &task : remainders)
+			parts.push_back(std::shared_ptr<const T>(task.get(profiler).release()));
 	}
+
+	auto bounds = enlarge_puzzle(query, parts);
+	auto result = puzzle(bounds, parts);
+	Log::trace("Finished processing puzzle-request");
 	return result;
 }
 
+template<class T>
+void PuzzleUtil::start_remainders(NodeCacheManager &mgr,
+		const QueryRectangle& query, GenericOperator &op, const T& ref_result,
+		const std::vector<Cube<3> >& remainder, std::vector<Task<std::unique_ptr<T>>> &tasks) {
+	auto rem_queries = get_remainder_queries(query, remainder, ref_result);
+	const std::string semantic_id = op.getSemanticId();
+	const int depth = op.getDepth();
+	for (auto &rqr : rem_queries) {
+		tasks.emplace_back(mgr, [semantic_id, depth, rqr](QueryProfiler &qp) {
+			auto instance = GenericOperator::fromJSON(semantic_id, depth);
+			return compute<T>(*instance, rqr, qp);
+		});
+	}
+}
+
 template<class T>
 std::vector<QueryRectangle> PuzzleUtil::get_remainder_queries(
 		const QueryRectangle& query, const std::vector<Cube<3> >& remainder, const T& ref_result) {
@@ -554,12 +724,19 @@ std::unique_ptr<ProvenanceCollection> RemoteRetriever<ProvenanceCollection>::rea
 // INSTANTIATE ALL
 //
 
-template std::unique_ptr<GenericRaster> PuzzleUtil::process<GenericRaster>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericRaster>>&, QueryProfiler&);
-template std::unique_ptr<PointCollection> PuzzleUtil::process<PointCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PointCollection>>&, QueryProfiler&);
-template std::unique_ptr<LineCollection> PuzzleUtil::process<LineCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const LineCollection>>&, QueryProfiler&);
-template std::unique_ptr<PolygonCollection> PuzzleUtil::process<PolygonCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PolygonCollection>>&, QueryProfiler&);
-template std::unique_ptr<GenericPlot> PuzzleUtil::process<GenericPlot>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericPlot>>&, QueryProfiler&);
-template std::unique_ptr<ProvenanceCollection> PuzzleUtil::process<ProvenanceCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const ProvenanceCollection>>&, QueryProfiler&);
+template std::unique_ptr<GenericRaster> PuzzleUtil::process<GenericRaster>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericRaster>>&, QueryProfiler&);
+template std::unique_ptr<PointCollection> PuzzleUtil::process<PointCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PointCollection>>&, QueryProfiler&);
+template std::unique_ptr<LineCollection> PuzzleUtil::process<LineCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const LineCollection>>&, QueryProfiler&);
+template std::unique_ptr<PolygonCollection> PuzzleUtil::process<PolygonCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PolygonCollection>>&, QueryProfiler&);
+template std::unique_ptr<GenericPlot> PuzzleUtil::process<GenericPlot>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericPlot>>&, QueryProfiler&);
+template std::unique_ptr<ProvenanceCollection> PuzzleUtil::process<ProvenanceCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const ProvenanceCollection>>&, QueryProfiler&);
+
+template std::unique_ptr<GenericRaster> PuzzleUtil::process<GenericRaster>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<GenericRaster>&, QueryProfiler&);
+template std::unique_ptr<PointCollection> PuzzleUtil::process<PointCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<PointCollection>&, QueryProfiler&);
+template std::unique_ptr<LineCollection> PuzzleUtil::process<LineCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<LineCollection>&, QueryProfiler&);
+template std::unique_ptr<PolygonCollection> PuzzleUtil::process<PolygonCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<PolygonCollection>&, QueryProfiler&);
+template std::unique_ptr<GenericPlot> PuzzleUtil::process<GenericPlot>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<GenericPlot>&, QueryProfiler&);
+template std::unique_ptr<ProvenanceCollection> PuzzleUtil::process<ProvenanceCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<ProvenanceCollection>&, QueryProfiler&);
 
 template class LocalRetriever<GenericRaster> ;
 template class LocalRetriever<GenericPlot> ;
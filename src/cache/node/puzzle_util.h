@@ -11,16 +11,98 @@
 #include "cache/node/node_manager.h"
 #include "cache/priv/requests.h"
 #include "operators/operator.h"
+#include "util/task_executor.h"
 
+template<class T> class PieceRetriever;
+
+/**
+ * Combines cached pieces and computed remainders to the result of a query.
+ *
+ * The remainders are computed and remote pieces fetched concurrently on an executor,
+ * so the latency of a puzzle tends towards that of its slowest piece. The threads
+ * of the executor act on behalf of the requesting worker, see DelegationGuard.
+ *
+ * Raster-pieces of a finer resolution than requested are downsampled into the
+ * pixel-grid of the query before puzzling.
+ */
 class PuzzleUtil {
 	template <class T> friend class LocalCacheWrapper;
 public:
+	/**
+	 * Sets the number of threads computing remainders and fetching pieces.
+	 * Without threads, all work is done by the requesting worker.
+	 * @param num_threads the number of threads
+	 */
+	static void init( int num_threads );
+
+	/**
+	 * Sets the method used for downsampling raster-pieces of a finer resolution
+	 * @param method either "average" or "nearest"
+	 */
+	static void set_downsampling_method( const std::string &method );
+
+	/**
+	 * Computes the remainders of a puzzle and combines them with the given parts
+	 * @param mgr the manager of the requesting worker
+	 * @param op the operator to compute the remainders with
+	 * @param query the query-rectangle of the request
+	 * @param remainder the remainders to compute
+	 * @param parts the available pieces
+	 * @param profiler the profiler to use
+	 * @return the combined result
+	 */
 	template<class T>
-	static std::unique_ptr<T> process(GenericOperator &op,
+	static std::unique_ptr<T> process(NodeCacheManager &mgr, GenericOperator &op,
 			const QueryRectangle &query, const std::vector<Cube<3>> &remainder,
 			const std::vector<std::shared_ptr<const T>> &parts,
 			QueryProfiler &profiler);
+
+	/**
+	 * Processes the given puzzle-request. The pieces are fetched concurrently and
+	 * the computation of the remainders starts as soon as the first piece arrived.
+	 * Pieces no longer available are computed as additional remainders.
+	 * @param mgr the manager of the requesting worker
+	 * @param op the operator to compute the remainders with
+	 * @param request the puzzle-request
+	 * @param retriever the retriever to fetch the pieces with
+	 * @param profiler the profiler to use
+	 * @return the combined result
+	 * @throws NoSuchElementException if all pieces are gone
+	 */
+	template<class T>
+	static std::unique_ptr<T> process(NodeCacheManager &mgr, GenericOperator &op,
+			const PuzzleRequest &request, const PieceRetriever<T> &retriever,
+			QueryProfiler &profiler);
 private:
+	/**
+	 * A part of a puzzle processed on the executor. It uses its own profiler,
+	 * which is merged into the requesting one when the result is retrieved.
+	 */
+	template<class R>
+	class Task;
+
+	static TaskExecutor &get_executor();
+
+	/**
+	 * Brings the given piece to the resolution of the query. Only raster-pieces
+	 * of a different resolution are affected, these are resampled into the
+	 * query's pixel-grid, keeping their extent.
+	 * @param query the query-rectangle of the request
+	 * @param piece the piece to fit
+	 * @return the piece in the resolution of the query. For rasters, this may be a view sharing
+	 *   the buffer of the piece, so it must not outlive the puzzle.
+	 */
+	template<class T>
+	static std::shared_ptr<const T> fit_piece(const QueryRectangle &query,
+			const std::shared_ptr<const T> &piece);
+
+	/**
+	 * Combines the given pieces and the results of the given remainder-computations
+	 */
+	template<class T>
+	static std::unique_ptr<T> finish(const QueryRectangle &query,
+			std::vector<std::shared_ptr<const T>> parts,
+			std::vector<Task<std::unique_ptr<T>>> &remainders, QueryProfiler &profiler);
 
 	/**
 	 * Enlarges the result of the puzzle-request to the maximum bounding cube.
@@ -33,17 +115,19 @@ private:
 			const std::vector<std::shared_ptr<const T>>& items);
 
 	/**
-	 * Conmputes the remainder-queries
-	 * @param semantic_id the semantic id
+	 * Starts the computation of the remainder-queries. Each computation uses
+	 * its own instance of the operator, because operators need not be reentrant.
+	 * @param mgr the manager of the requesting worker
+	 * @param query the query-rectangle of the request
+	 * @param op the operator to compute the remainders with
 	 * @param ref_result a result used as reference for resolution computation
-	 * @param request the puzzle-request
-	 * @param qp the profiler to use
-	 * @return the results of the remainder queries
+	 * @param remainder the remainders to compute
+	 * @param tasks the vector to add the computations to
 	 */
 	template<class T>
-	static std::vector<std::unique_ptr<T>> compute_remainders(
+	static void start_remainders(NodeCacheManager &mgr,
 			const QueryRectangle& query, GenericOperator &op, const T& ref_result,
-			const std::vector<Cube<3> >& remainder, QueryProfiler& profiler);
+			const std::vector<Cube<3> >& remainder, std::vector<Task<std::unique_ptr<T>>> &tasks);
 
 	template<class T>
 	static std::vector<QueryRectangle> get_remainder_queries(
@@ -156,7 +156,7 @@ CacheHandshake::CacheHandshake(BinaryReadBuffer& buffer) : CacheContent(buffer)
 ///////////////////////////////////////////////////////////
 
 QueryStats::QueryStats() : single_local_hits(0), multi_local_hits(0), multi_local_partials(0),
-	single_remote_hits(0), multi_remote_hits(0), multi_remote_partials(0), misses(0), result_bytes(0), lost_puts(0), queries(0), ratios(0) {
+	single_remote_hits(0), multi_remote_hits(0), multi_remote_partials(0), misses(0), downsampled_hits(0), cold_hits(0), result_bytes(0), lost_puts(0), queries(0), ratios(0) {
 }
 
 QueryStats::QueryStats(BinaryReadBuffer& buffer) :
@@ -167,6 +167,8 @@ QueryStats::QueryStats(BinaryReadBuffer& buffer) :
 	multi_remote_hits(buffer.read<uint32_t>()),
 	multi_remote_partials(buffer.read<uint32_t>()),
 	misses(buffer.read<uint32_t>()),
+	downsampled_hits(buffer.read<uint32_t>()),
+	cold_hits(buffer.read<uint32_t>()),
 	result_bytes(buffer.read<uint64_t>()),
 	lost_puts(buffer.read<uint64_t>()),
 	queries(buffer.read<uint64_t>()),
@@ -182,6 +184,8 @@ QueryStats QueryStats::operator +(const QueryStats& stats) const {
 	res.multi_remote_hits += stats.multi_remote_hits;
 	res.multi_remote_partials += stats.multi_remote_partials;
 	res.misses += stats.misses;
+	res.downsampled_hits += stats.downsampled_hits;
+	res.cold_hits += stats.cold_hits;
 	res.result_bytes += stats.result_bytes;
 	res.lost_puts += stats.lost_puts;
 	res.queries += stats.queries;
@@ -197,6 +201,8 @@ QueryStats& QueryStats::operator +=(const QueryStats& stats) {
 	multi_remote_hits += stats.multi_remote_hits;
 	multi_remote_partials += stats.multi_remote_partials;
 	misses += stats.misses;
+	downsampled_hits += stats.downsampled_hits;
+	cold_hits += stats.cold_hits;
 	result_bytes += stats.result_bytes;
 	lost_puts += stats.lost_puts;
 	queries += stats.queries;
@@ -207,7 +213,7 @@ QueryStats& QueryStats::operator +=(const QueryStats& stats) {
 void QueryStats::serialize(BinaryWriteBuffer& buffer, bool) const {
 	buffer << single_local_hits << multi_local_hits << multi_local_partials;
 	buffer << single_remote_hits << multi_remote_hits << multi_remote_partials;
-	buffer << misses << result_bytes << lost_puts << queries << ratios;
+	buffer << misses << downsampled_hits << cold_hits << result_bytes << lost_puts << queries << ratios;
 }
 
 void QueryStats::add_query(double ratio) {
@@ -227,6 +233,8 @@ void QueryStats::reset() {
 	multi_remote_hits = 0;
 	multi_remote_partials = 0;
 	misses = 0;
+	downsampled_hits = 0;
+	cold_hits = 0;
 	result_bytes = 0;
 	lost_puts = 0;
 	queries = 0;
@@ -243,6 +251,8 @@ std::string QueryStats::to_string() const {
 	ss << "  remote multi hits : " << multi_remote_hits << std::endl;
 	ss << "  remote partials   : " << multi_remote_partials << std::endl;
 	ss << "  misses            : " << misses << std::endl;
+	ss << "  downsampled hits  : " << downsampled_hits << std::endl;
+	ss << "  cold hits         : " << cold_hits << std::endl;
 	ss << "  hit-ratio         : " << (ratios / queries) << std::endl;
 	ss << "  cache-queries     : " << queries << std::endl;
 	ss << "  result-bytes      : " << result_bytes << std::endl;
@@ -365,6 +375,8 @@ std::string SystemStats::to_string() const {
 	ss << "  partial single node       : " << multi_local_partials << std::endl;
 	ss << "  partial multiple nodes    : " << multi_remote_partials << std::endl;
 	ss << "  misses                    : " << misses << std::endl;
+	ss << "  downsampled hits          : " << downsampled_hits << std::endl;
+	ss << "  cold hits                 : " << cold_hits << std::endl;
 	ss << "  result-bytes              : " << result_bytes << std::endl;
 	ss << "  lost puts                 : " << lost_puts << std::endl;
 	ss << "  hit ratio                 : " << get_hit_ratio() << std::endl;
@@ -171,6 +171,10 @@ public:
 	uint32_t multi_remote_hits;
 	uint32_t multi_remote_partials;
 	uint32_t misses;
+	// hits answered by downsampling entries of a finer resolution, additionally counted as one of the above
+	uint32_t downsampled_hits;
+	// hits answered using entries spilled to disk, additionally counted as one of the above
+	uint32_t cold_hits;
 
 	uint64_t result_bytes;
 	uint64_t lost_puts;
@@ -7,6 +7,7 @@
 
 
 #include "cache/priv/cache_structure.h"
+#include "cache/priv/remainder_partition.h"
 #include "cache/node/node_cache.h"
 #include "cache/index/index_cache.h"
 #include "cache/common.h"
@@ -54,15 +55,15 @@ std::string CacheQueryInfo<KType>::to_string() const {
 
 template<typename EType>
 CacheQueryResult<EType>::CacheQueryResult(const QueryRectangle& query) :
-	covered(query), hit_ratio(0) {
+	covered(query), hit_ratio(0), downsampled(false) {
 	remainder.push_back( Cube3(query.x1,query.x2,query.y1,query.y2,query.t1,query.t2) );
 }
 
 template<typename EType>
-CacheQueryResult<EType>::CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio) :
+CacheQueryResult<EType>::CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio, bool downsampled) :
 	covered(query), hit_ratio(hit_ratio),
 	items(items),
-	remainder( remainder ) {
+	remainder( remainder ), downsampled(downsampled) {
 }
 
 template<typename EType>
@@ -82,10 +83,175 @@ std::string CacheQueryResult<EType>::to_string() const {
 	",  has_remainder: ", has_remainder(),
 	",  num remainders: ", remainder.size(),
 	",  num items: ", items.size(),
+	",  downsampled: ", downsampled,
 	"]");
 }
 
 
+//////////////////////////////////////////////////////////////
+//
+// CACHE INDEX
+//
+//////////////////////////////////////////////////////////////
+
+template<typename EType>
+const int CacheIndex<EType>::MIN_LEVEL;
+
+template<typename EType>
+const int CacheIndex<EType>::MAX_LEVEL;
+
+template<typename EType>
+size_t CacheIndex<EType>::CellHash::operator()(const CellId& id) const {
+	return std::hash<int64_t>()(id.first) * 31 + std::hash<int64_t>()(id.second);
+}
+
+template<typename EType>
+CacheIndex<EType>::Level::Level() : num_entries(0) {
+}
+
+template<typename EType>
+CacheIndex<EType>::Partition::Partition(const CrsId& crsId, timetype_t timetype) :
+	crsId(crsId), timetype(timetype) {
+}
+
+template<typename EType>
+bool CacheIndex<EType>::get_position(const CacheCube& bounds, int& level, CellId& cell) {
+	auto &x = bounds.get_dimension(0);
+	auto &y = bounds.get_dimension(1);
+
+	if ( !std::isfinite(x.a) || !std::isfinite(x.b) || !std::isfinite(y.a) || !std::isfinite(y.b) )
+		return false;
+
+	double extent = std::max(x.distance(), y.distance());
+	if ( extent > 0 )
+		std::frexp(extent, &level);
+	else
+		level = MIN_LEVEL;
+	level = std::min( MAX_LEVEL, std::max(MIN_LEVEL,level) );
+
+	double cell_size = std::ldexp(1.0, level);
+	double cx = std::floor(x.a / cell_size);
+	double cy = std::floor(y.a / cell_size);
+
+	// Keep cell-coordinates safely inside the integer range
+	const double limit = std::ldexp(1.0, 52);
+	if ( std::abs(cx) > limit || std::abs(cy) > limit )
+		return false;
+
+	cell = CellId( (int64_t) cx, (int64_t) cy );
+	return true;
+}
+
+template<typename EType>
+const typename CacheIndex<EType>::Partition* CacheIndex<EType>::get_partition(const CrsId& crsId, timetype_t timetype) const {
+	for ( auto &p : partitions ) {
+		if ( p.crsId == crsId && p.timetype == timetype )
+			return &p;
+	}
+	return nullptr;
+}
+
+template<typename EType>
+bool CacheIndex<EType>::remove_from(std::vector<std::shared_ptr<EType>>& list, const std::shared_ptr<EType>& entry) {
+	for ( auto it = list.begin(); it != list.end(); it++ ) {
+		if ( *it == entry ) {
+			// Order does not matter -- swap with last
+			std::swap(*it, list.back());
+			list.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+template<typename EType>
+void CacheIndex<EType>::insert(const std::shared_ptr<EType>& entry) {
+	const CacheCube &bounds = entry->bounds;
+	Partition *p = const_cast<Partition*>(get_partition(bounds.crsId, bounds.timetype));
+	if ( p == nullptr ) {
+		partitions.push_back( Partition(bounds.crsId, bounds.timetype) );
+		p = &partitions.back();
+	}
+
+	int level;
+	CellId cell;
+	if ( get_position(bounds, level, cell) ) {
+		Level &l = p->levels[level];
+		l.cells[cell].push_back(entry);
+		l.num_entries++;
+	}
+	else
+		p->unbounded.push_back(entry);
+}
+
+template<typename EType>
+void CacheIndex<EType>::remove(const std::shared_ptr<EType>& entry) {
+	const CacheCube &bounds = entry->bounds;
+	Partition *p = const_cast<Partition*>(get_partition(bounds.crsId, bounds.timetype));
+	if ( p == nullptr )
+		return;
+
+	int level;
+	CellId cell;
+	if ( !get_position(bounds, level, cell) ) {
+		remove_from(p->unbounded, entry);
+		return;
+	}
+
+	auto lit = p->levels.find(level);
+	if ( lit == p->levels.end() )
+		return;
+
+	auto cit = lit->second.cells.find(cell);
+	if ( cit != lit->second.cells.end() && remove_from(cit->second, entry) ) {
+		lit->second.num_entries--;
+		if ( cit->second.empty() )
+			lit->second.cells.erase(cit);
+		if ( lit->second.num_entries == 0 )
+			p->levels.erase(lit);
+	}
+}
+
+template<typename EType>
+std::vector<std::shared_ptr<EType>> CacheIndex<EType>::find(const QueryCube& qc) const {
+	std::vector<std::shared_ptr<EType>> result;
+
+	const Partition *p = get_partition(qc.crsId, qc.timetype);
+	if ( p == nullptr )
+		return result;
+
+	result.insert(result.end(), p->unbounded.begin(), p->unbounded.end());
+
+	auto &x = qc.get_dimension(0);
+	auto &y = qc.get_dimension(1);
+
+	for ( auto &lp : p->levels ) {
+		const Level &l = lp.second;
+		double cell_size = std::ldexp(1.0, lp.first);
+
+		// Entries are stored by their lower left corner, so look one cell further to the lower left
+		double cx1 = std::floor(x.a / cell_size) - 1, cx2 = std::floor(x.b / cell_size);
+		double cy1 = std::floor(y.a / cell_size) - 1, cy2 = std::floor(y.b / cell_size);
+		double num_cells = (cx2-cx1+1) * (cy2-cy1+1);
+
+		// Visiting all cells is cheaper (or the query is unbounded)
+		if ( !(num_cells <= l.cells.size()) ) {
+			for ( auto &c : l.cells )
+				result.insert(result.end(), c.second.begin(), c.second.end());
+			continue;
+		}
+
+		for ( int64_t cx = cx1; cx <= cx2; cx++ ) {
+			for ( int64_t cy = cy1; cy <= cy2; cy++ ) {
+				auto it = l.cells.find( CellId(cx,cy) );
+				if ( it != l.cells.end() )
+					result.insert(result.end(), it->second.begin(), it->second.end());
+			}
+		}
+	}
+	return result;
+}
+
 //////////////////////////////////////////////////////////////
 //
 // CACHE STRUCTURE
@@ -93,7 +259,8 @@ std::string CacheQueryResult<EType>::to_string() const {
 //////////////////////////////////////////////////////////////
 
 template<typename KType, typename EType>
-CacheStructure<KType, EType>::CacheStructure(const std::string &semantic_id, bool query_exact) : semantic_id(semantic_id), query_exact_only(query_exact), _size(0) {
+CacheStructure<KType, EType>::CacheStructure(const std::string &semantic_id, bool query_exact, double max_downsampling) :
+	semantic_id(semantic_id), query_exact_only(query_exact), max_downsampling(max_downsampling), _size(0) {
 }
 
 
@@ -101,8 +268,11 @@ template<typename KType, typename EType>
 void CacheStructure<KType, EType>::put(const KType& key, const std::shared_ptr<EType>& result) {
 	ExclusiveLockGuard g(lock);
 //	Log::trace("Inserting new entry. Id: %d", key );
-	_size += result->size;
-	entries.emplace(key, result);
+	auto res = entries.emplace(key, result);
+	if ( res.second ) {
+		_size += result->size;
+		index.insert(result);
+	}
 }
 
 template<typename KType, typename EType>
@@ -122,12 +292,27 @@ std::shared_ptr<EType> CacheStructure<KType, EType>::remove(const KType& key) {
 	if ( iter != entries.end() ) {
 		auto result = iter->second;
 		entries.erase(iter);
+		index.remove(result);
 		_size -= result->size;
 		return result;
 	}
 	throw NoSuchElementException("No cache-entry found");
 }
 
+template<typename KType, typename EType>
+std::shared_ptr<EType> CacheStructure<KType, EType>::replace(const KType& key, const std::shared_ptr<EType>& result) {
+	ExclusiveLockGuard g(lock);
+	auto iter = entries.find(key);
+	if ( iter == entries.end() )
+		throw NoSuchElementException("No cache-entry found");
+	auto old = iter->second;
+	iter->second = result;
+	index.remove(old);
+	index.insert(result);
+	_size = _size - old->size + result->size;
+	return old;
+}
+
 template<typename KType, typename EType>
 std::vector<std::shared_ptr<EType> > CacheStructure<KType, EType>::get_all() const {
 	SharedLockGuard g(lock);
@@ -148,11 +333,12 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query_exact(
 		const QueryRectangle& spec) const {
 
 	const QueryCube qc(spec);
-	for ( auto &e : entries ) {
-		CacheCube &bounds = e.second->bounds;
+	SharedLockGuard g(lock);
+	for ( auto &e : index.find(qc) ) {
+		CacheCube &bounds = e->bounds;
 
 		if ( bounds == qc )
-			return CacheQueryResult<EType>( QueryRectangle(spec), std::vector<Cube<3>>(), std::vector<std::shared_ptr<const EType>>{e.second}, 1.0);
+			return CacheQueryResult<EType>( QueryRectangle(spec), std::vector<Cube<3>>(), std::vector<std::shared_ptr<const EType>>{e}, 1.0);
 	}
 	return CacheQueryResult<EType>( spec );
 }
@@ -183,6 +369,7 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query(const QueryRec
 
 	std::vector<std::shared_ptr<const EType>> used_entries;
 	std::vector<Cube<3>> remainders{qc}, tmp_remainders;
+	bool downsampled = false;
 
 	used_entries.reserve(candidates.size());
 
@@ -190,8 +377,9 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query(const QueryRec
 		bool used = false;
 		const CacheQueryInfo<EType> &info = candidates.top();
 
-		// Skip incompatible resolutions
+		// Skip incompatible resolutions -- when downsampling, all pieces are brought to the query's resolution
 		if ( spec.restype == QueryResolution::Type::PIXELS &&
+			 max_downsampling <= 1 &&
 			 !used_entries.empty() &&
 			 !CacheCommon::resolution_matches(
 				 info.entry->bounds, used_entries.front()->bounds)	) {
@@ -218,22 +406,23 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query(const QueryRec
 
 		if ( used ) {
 			used_entries.push_back( info.entry );
+			downsampled |= !info.entry->bounds.resolution_info.matches(qc);
 		}
 		candidates.pop();
 	}
 
-	// Union remainders
-	auto u_rems = union_remainders(remainders);
+	// Decompose the uncovered part into few remainders
+	auto u_rems = RemainderPartition::compute(qc, remainders);
 
 	double rem_volume = 0;
 	for ( auto &rem : u_rems ) {
-		rem_volume += rem.volume();
+		rem_volume += RemainderPartition::relative_volume(qc, rem);
 	}
 	// Return miss if we have a low coverage (<10%)
-	if ( rem_volume/ qc.volume() > 0.9 )
+	if ( rem_volume > 0.9 )
 		return CacheQueryResult<EType>( spec );
 
-	double hit_ratio = 1.0 - rem_volume / qc.volume();
+	double hit_ratio = 1.0 - rem_volume;
 
 	// Entend expected result
 	auto new_query = enlarge_expected_result(qc, used_entries, u_rems);
@@ -244,7 +433,7 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query(const QueryRec
 			rem.set_dimension(2, new_query.t1, new_query.t2);
 	}
 
-	return CacheQueryResult<EType>( std::move(new_query), std::move(u_rems), std::move(used_entries), hit_ratio );
+	return CacheQueryResult<EType>( std::move(new_query), std::move(u_rems), std::move(used_entries), hit_ratio, downsampled );
 }
 
 template<typename KType, typename EType>
@@ -254,12 +443,12 @@ std::priority_queue<CacheQueryInfo<EType>> CacheStructure<KType, EType>::get_que
 //	Log::trace("Fetching candidates for query: %s", CacheCommon::qr_to_string(spec).c_str() );
 	std::priority_queue<CacheQueryInfo<EType>> partials;
 
-	for (auto &e : entries) {
-		CacheCube &bounds = e.second->bounds;
+	for (auto &e : index.find(qc)) {
+		CacheCube &bounds = e->bounds;
 
-		if ( qc.crsId == bounds.crsId &&
-			 qc.timetype == bounds.timetype &&
-			 bounds.resolution_info.matches(qc) &&
+		bool matches = bounds.resolution_info.matches(qc);
+
+		if ( (matches || bounds.resolution_info.matches_finer(qc, max_downsampling)) &&
 			 bounds.intersects(qc) ) {
 
 			// Raster
@@ -269,11 +458,14 @@ std::priority_queue<CacheQueryInfo<EType>> CacheStructure<KType, EType>::get_que
 
 			// Coverage = score for now
 			double score = bounds.intersect(qc).volume() / qc.volume();
-			Log::trace("Score for entry %s: %f", key_to_string(e.first).c_str(), score);
-			partials.push( CacheQueryInfo<EType>( e.second, score ) );
+			// On equal coverage, prefer entries not requiring downsampling
+			if ( !matches )
+				score *= 1.0 - 1e-6;
+			Log::trace("Score for candidate %s: %f", bounds.to_string().c_str(), score);
+			partials.push( CacheQueryInfo<EType>( e, score ) );
 
 			// Short circuit full hits
-			if ( (1.0-score) <= std::numeric_limits<double>::epsilon() ) {
+			if ( matches && (1.0-score) <= std::numeric_limits<double>::epsilon() ) {
 				break;
 			}
 
@@ -283,35 +475,6 @@ std::priority_queue<CacheQueryInfo<EType>> CacheStructure<KType, EType>::get_que
 	return std::move(partials);
 }
 
-template<typename KType, typename EType>
-std::vector<Cube<3> > CacheStructure<KType, EType>::union_remainders(
-		std::vector<Cube<3> >& work) const {
-
-	std::vector<Cube<3>> result;
-
-	while ( !work.empty() ) {
-		// Take one cube
-		auto current = work.back();
-		work.pop_back();
-
-		// See if it can be combined with any of the remaining cubes
-		// If so: start over since we maybe can add more now
-		auto i = work.begin();
-		while ( i != work.end() ) {
-			auto tmp = current.combine(*i);
-			if ( tmp.volume() < (current.volume() + i->volume()) * 1.01 ) {
-				current = std::move(tmp);
-				work.erase(i);
-				i = work.begin();
-			}
-			else
-				i++;
-		}
-		result.push_back(current);
-	}
-	return result;
-}
-
 template<typename KType, typename EType>
 QueryRectangle CacheStructure<KType, EType>::enlarge_expected_result( const QueryCube &qc,
 	const std::vector<std::shared_ptr<const EType>> &hits, const std::vector<Cube<3>> &remainders) const {
@@ -376,8 +539,8 @@ QueryRectangle CacheStructure<KType, EType>::enlarge_expected_result( const Quer
 	// RASTER ONLY
 	// calculate resolution
 	if ( qc.restype == QueryResolution::Type::PIXELS ) {
-		int w = std::ceil( qc.pixel_scale_x / (values[1]-values[0]));
-		int h = std::ceil( qc.pixel_scale_y / (values[3]-values[2]));
+		int w = std::round( (values[1]-values[0]) / qc.pixel_scale_x );
+		int h = std::round( (values[3]-values[2]) / qc.pixel_scale_y );
 		qr = QueryResolution::pixels(w,h);
 	}
 
@@ -423,7 +586,13 @@ std::string CacheStructure< std::pair<uint32_t, uint64_t>, IndexCacheEntry>::key
 
 
 template<typename KType, typename EType>
-Cache<KType, EType>::Cache(bool query_exact) : query_exact(query_exact) {
+Cache<KType, EType>::Cache(bool query_exact) : query_exact(query_exact), max_downsampling(1) {
+}
+
+template<typename KType, typename EType>
+void Cache<KType, EType>::set_max_downsampling(double factor) {
+	std::lock_guard<std::mutex> guard(mtx);
+	max_downsampling = factor;
 }
 
 template<typename KType, typename EType>
@@ -460,6 +629,12 @@ std::shared_ptr<EType> Cache<KType, EType>::remove_int(
 //	return res;
 }
 
+template<typename KType, typename EType>
+std::shared_ptr<EType> Cache<KType, EType>::replace_int(
+	const std::string& semantic_id, const KType& key, const std::shared_ptr<EType>& entry) {
+	return get_cache(semantic_id).replace(key, entry);
+}
+
 template<typename KType, typename EType>
 std::unordered_map<std::string, std::vector<std::shared_ptr<EType>> > Cache<KType,
 		EType>::get_all_int() const {
@@ -481,7 +656,7 @@ CacheStructure<KType, EType>& Cache<KType, EType>::get_cache(
 	auto got = caches.find(semantic_id);
 	if (got == caches.end() && create) {
 		Log::trace("No cache-structure found for semantic_id: %s. Creating.", semantic_id.c_str() );
-		auto e = caches.emplace(semantic_id, std::make_unique<CacheStructure<KType,EType>>(semantic_id,query_exact));
+		auto e = caches.emplace(semantic_id, std::make_unique<CacheStructure<KType,EType>>(semantic_id,query_exact,max_downsampling));
 		return *e.first->second;
 	}
 	else if (got != caches.end())
@@ -490,6 +665,12 @@ CacheStructure<KType, EType>& Cache<KType, EType>::get_cache(
 		throw NoSuchElementException("No structure present for given semantic id");
 }
 
+template class CacheIndex<NodeCacheEntry<GenericRaster>>;
+template class CacheIndex<NodeCacheEntry<PointCollection>>;
+template class CacheIndex<NodeCacheEntry<LineCollection>>;
+template class CacheIndex<NodeCacheEntry<PolygonCollection>>;
+template class CacheIndex<NodeCacheEntry<GenericPlot>>;
+template class CacheIndex<NodeCacheEntry<ProvenanceCollection>>;
 template class CacheQueryResult<NodeCacheEntry<GenericRaster>>;
 template class CacheQueryResult<NodeCacheEntry<PointCollection>>;
 template class CacheQueryResult<NodeCacheEntry<LineCollection>>;
@@ -511,6 +692,7 @@ template class Cache<uint64_t, NodeCacheEntry<GenericPlot>>;
 template class Cache<uint64_t, NodeCacheEntry<ProvenanceCollection>>;
 
 
+template class CacheIndex<IndexCacheEntry>;
 template class CacheQueryResult<IndexCacheEntry>;
 template class CacheStructure<std::pair<uint32_t, uint64_t>, IndexCacheEntry> ;
 template class Cache<std::pair<uint32_t, uint64_t>, IndexCacheEntry> ;
@@ -68,8 +68,9 @@ public:
 	 * @param query the original query
 	 * @param remainder the list of remainder queries
 	 * @param keys the list of entry-keys required
+	 * @param downsampled whether entries of a finer resolution are used
 	 */
-	CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio );
+	CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio, bool downsampled = false );
 
 	/**
 	 * @return whether the query has at least one hit in the cache
@@ -90,6 +91,97 @@ public:
 	double hit_ratio;
 	std::vector<std::shared_ptr<const EType>> items;
 	std::vector<Cube<3>> remainder;
+	// Entries of a finer resolution must be downsampled, so even a single item requires puzzling
+	bool downsampled;
+};
+
+/**
+ * Spatial index over the bounds of the entries held by a cache-structure.
+ * Entries are partitioned by their crs and timetype and each partition is
+ * organized as a hierarchical grid: The level of an entry is derived from its
+ * spatial extent (cell-size is the next power of two), and the entry is stored
+ * in the single cell containing its lower left corner. Hence, all entries of
+ * a level intersecting a query are found in the cells overlapping the query
+ * extended by one cell-size to the lower left.
+ * Temporal bounds are not indexed and must be checked by the caller.
+ */
+template<typename EType>
+class CacheIndex {
+public:
+	/**
+	 * Adds the given entry to the index
+	 * @param entry the entry to add
+	 */
+	void insert( const std::shared_ptr<EType> &entry );
+
+	/**
+	 * Removes the given entry from the index
+	 * @param entry the entry to remove
+	 */
+	void remove( const std::shared_ptr<EType> &entry );
+
+	/**
+	 * Retrieves all entries with matching crs and timetype, whose spatial
+	 * bounds may intersect the given cube.
+	 * @param qc the cube to search for
+	 * @return a superset of all entries spatially intersecting the given cube
+	 */
+	std::vector<std::shared_ptr<EType>> find( const QueryCube &qc ) const;
+private:
+	/** Levels are clamped to this range to keep cell-coordinates in integer range */
+	static const int MIN_LEVEL = -20;
+	static const int MAX_LEVEL = 64;
+
+	typedef std::pair<int64_t,int64_t> CellId;
+
+	struct CellHash {
+		size_t operator()( const CellId &id ) const;
+	};
+
+	/**
+	 * A single level of the grid
+	 */
+	class Level {
+	public:
+		Level();
+		std::unordered_map<CellId,std::vector<std::shared_ptr<EType>>,CellHash> cells;
+		size_t num_entries;
+	};
+
+	/**
+	 * All entries sharing the same crs and timetype
+	 */
+	class Partition {
+	public:
+		Partition( const CrsId &crsId, timetype_t timetype );
+		CrsId crsId;
+		timetype_t timetype;
+		std::map<int,Level> levels;
+		// Entries with non-finite bounds, always reported as candidates
+		std::vector<std::shared_ptr<EType>> unbounded;
+	};
+
+	/**
+	 * Calculates the grid-position for the given bounds
+	 * @param bounds the bounds of the entry
+	 * @param level receives the level of the entry
+	 * @param cell receives the cell-coordinates of the entry
+	 * @return false if the bounds cannot be placed into the grid
+	 */
+	static bool get_position( const CacheCube &bounds, int &level, CellId &cell );
+
+	/**
+	 * @return the partition for the given crs and timetype, nullptr if none exists
+	 */
+	const Partition* get_partition( const CrsId &crsId, timetype_t timetype ) const;
+
+	/**
+	 * Removes the given entry from the given list
+	 * @return whether the entry was found
+	 */
+	static bool remove_from( std::vector<std::shared_ptr<EType>> &list, const std::shared_ptr<EType> &entry );
+
+	std::vector<Partition> partitions;
 };
 
 /**
@@ -100,8 +192,12 @@ class CacheStructure {
 public:
 	/**
 	 * Creates a new instance
+	 * @param semantic_id the semantic id of all entries
+	 * @param query_exact whether only exact matches are reported
+	 * @param max_downsampling the maximum factor by which the resolution of reported
+	 *        raster-entries may be finer than requested, 1 for matching resolutions only
 	 */
-	CacheStructure( const std::string &semantic_id, bool query_exact );
+	CacheStructure( const std::string &semantic_id, bool query_exact, double max_downsampling = 1 );
 	CacheStructure( const CacheStructure<KType,EType> & ) = delete;
 	CacheStructure( CacheStructure<KType,EType> && ) = delete;
 
@@ -122,6 +218,14 @@ public:
 	 */
 	std::shared_ptr<EType> remove( const KType &key );
 
+	/**
+	 * Atomically replaces the entry with the given key. Both entries must have the same bounds.
+	 * @param key the key of the entry to replace
+	 * @param result the new entry
+	 * @return the replaced entry
+	 */
+	std::shared_ptr<EType> replace( const KType &key, const std::shared_ptr<EType> &result );
+
 	/**
 	 * Retrieves the entry with the given key from the cache
 	 * @param key the key of the entry to retrieve
@@ -165,14 +269,6 @@ private:
 	 */
 	std::priority_queue<CacheQueryInfo<EType>> get_query_candidates( const QueryCube &qc ) const;
 
-	/**
-	 * Tries to minimize the remainder-queries by unioning them. The uinion of two remainders
-	 * is built, if the volumen of the new remainder does not exceed the volumes of the original remainders (by more than 1%)
-	 * @param remainders the list of remainders
-	 * @return the minimal list of remainder queries
-	 */
-	std::vector<Cube<3>> union_remainders( std::vector<Cube<3>> &remainders ) const;
-
 	/**
 	 * Calculates the size of the result, which may be larger than requested. This information may be used
 	 * to combine client-queries more efficiently.
@@ -194,7 +290,9 @@ public:
 	const std::string semantic_id;
 private:
 	const bool query_exact_only;
+	const double max_downsampling;
 	std::map<KType, std::shared_ptr<EType>> entries;
+	CacheIndex<EType> index;
 	mutable RWLock lock;
 	uint64_t _size;
 };
@@ -219,6 +317,14 @@ public:
 	 * @return the search result description
 	 */
 	virtual const CacheQueryResult<EType> query( const std::string &semantic_id, const QueryRectangle &qr ) const;
+
+	/**
+	 * Allows answering raster-queries with entries of a finer resolution, which are
+	 * downsampled when puzzling the result. Only affects structures created afterwards,
+	 * so it should be set before inserting the first entry.
+	 * @param factor the maximum factor by which the resolution of an entry may be finer than requested
+	 */
+	void set_max_downsampling( double factor );
 protected:
 	/**
 	 * Inserts an element into the cache-structure for the given semantic id
@@ -248,6 +354,15 @@ protected:
 	 * @return the removed entry
 	 */
 	std::shared_ptr<EType> remove_int( const std::string &semantic_id, const KType &key );
+
+	/**
+	 * Replaces the entry with the given key and semantic id
+	 * @param semantic_id the semantic id
+	 * @param key the entry's unique key
+	 * @param entry the new entry
+	 * @return the replaced entry
+	 */
+	std::shared_ptr<EType> replace_int( const std::string &semantic_id, const KType &key, const std::shared_ptr<EType> &entry );
 private:
 	/**
 	 * Helper to retrieve the cache-structure for a given semantic id
@@ -259,6 +374,7 @@ private:
 	mutable std::unordered_map<std::string,std::unique_ptr<CacheStructure<KType,EType>>> caches;
 	mutable std::mutex mtx;
 	const bool query_exact;
+	double max_downsampling;
 };
 
 #endif /* CACHE_STRUCTURE_H_ */
@@ -13,6 +13,8 @@
 #include "util/exceptions.h"
 #include "util/concat.h"
 
+#include <algorithm>
+
 
 
 ///////////////////////////////////////////////////////////
@@ -30,9 +32,25 @@ std::unique_ptr<CachingStrategy> CachingStrategy::by_name(const std::string& nam
 		return std::make_unique<SimpleThresholdStrategy>(Type::SELF);
 	else if ( name == "uncached")
 			return std::make_unique<SimpleThresholdStrategy>(Type::UNCACHED);
+	else if ( name == "tinylfu")
+		return std::make_unique<TinyLFUStrategy>();
 	throw ArgumentException(concat("Unknown Caching-Strategy: ", name));
 }
 
+void CachingStrategy::record_access(const std::string& semantic_id, const CacheCube& bounds) const {
+	(void) semantic_id;
+	(void) bounds;
+}
+
+bool CachingStrategy::admit(const std::string& semantic_id, const CacheEntry& candidate,
+		const std::string& victim_semantic_id, const CacheEntry& victim) const {
+	(void) semantic_id;
+	(void) candidate;
+	(void) victim_semantic_id;
+	(void) victim;
+	return true;
+}
+
 double CachingStrategy::fixed_caching_time(0);
 double CachingStrategy::caching_time_per_byte(0);
 
@@ -132,3 +150,85 @@ bool SimpleThresholdStrategy::do_cache(const QueryProfiler& profiler, size_t byt
 	// Assume 1 put and at least 2 gets
 	return get_costs(profiler,type) >= 3 * get_caching_costs(bytes);
 }
+
+///////////////////////////////////////////////////////////
+//
+// TinyLFUStrategy
+//
+///////////////////////////////////////////////////////////
+
+TinyLFUStrategy::TinyLFUStrategy(size_t width) :
+	width(1), sample_size(0), additions(0) {
+	while ( this->width < width )
+		this->width <<= 1;
+	sample_size = 10 * this->width;
+	counters.resize(DEPTH * this->width, 0);
+}
+
+bool TinyLFUStrategy::do_cache(const QueryProfiler& profiler, size_t bytes) const {
+	(void) profiler;
+	(void) bytes;
+	return true;
+}
+
+uint64_t TinyLFUStrategy::hash(const std::string& semantic_id, const CacheCube& bounds) {
+	uint64_t h = std::hash<std::string>()(semantic_id);
+	for ( int i = 0; i < 3; i++ ) {
+		auto &dim = bounds.get_dimension(i);
+		h = h * 31 + std::hash<double>()(dim.a);
+		h = h * 31 + std::hash<double>()(dim.b);
+	}
+	// Finalizer of splitmix64, spreads the bits for the row indices
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+size_t TinyLFUStrategy::index(uint64_t hash, int row) const {
+	uint64_t h2 = (hash >> 32) | 1;
+	return row * width + ((hash + row * h2) & (width - 1));
+}
+
+uint32_t TinyLFUStrategy::estimate(uint64_t hash) const {
+	uint8_t result = MAX_COUNT;
+	for ( int i = 0; i < DEPTH; i++ )
+		result = std::min(result, counters[index(hash, i)]);
+	return result;
+}
+
+uint32_t TinyLFUStrategy::estimate(const std::string& semantic_id, const CacheCube& bounds) const {
+	std::lock_guard<std::mutex> g(mtx);
+	return estimate(hash(semantic_id, bounds));
+}
+
+void TinyLFUStrategy::record_access(const std::string& semantic_id, const CacheCube& bounds) const {
+	uint64_t h = hash(semantic_id, bounds);
+	std::lock_guard<std::mutex> g(mtx);
+	// Conservative update: only raise the counters holding the minimum
+	uint8_t min = estimate(h);
+	if ( min == MAX_COUNT )
+		return;
+	for ( int i = 0; i < DEPTH; i++ ) {
+		uint8_t &c = counters[index(h, i)];
+		if ( c == min )
+			c++;
+	}
+
+	if ( ++additions >= sample_size ) {
+		for ( auto &c : counters )
+			c >>= 1;
+		additions /= 2;
+	}
+}
+
+bool TinyLFUStrategy::admit(const std::string& semantic_id, const CacheEntry& candidate,
+		const std::string& victim_semantic_id, const CacheEntry& victim) const {
+	uint32_t cf = estimate(semantic_id, candidate.bounds);
+	uint32_t vf = estimate(victim_semantic_id, victim.bounds);
+	double cv = cf * get_costs(candidate.profile, Type::UNCACHED);
+	double vv = vf * get_costs(victim.profile, Type::UNCACHED);
+	return cv > vv || (cv == vv && cf > vf);
+}
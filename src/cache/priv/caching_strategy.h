@@ -8,8 +8,11 @@
 #ifndef CACHING_STRATEGY_H_
 #define CACHING_STRATEGY_H_
 
+#include "cache/priv/shared.h"
 #include "operators/queryprofiler.h"
 #include <memory>
+#include <mutex>
+#include <vector>
 
 
 /**
@@ -79,6 +82,26 @@ public:
 	 * @param size the size of the result in bytes
 	 */
 	virtual bool do_cache( const QueryProfiler &profiler, size_t bytes ) const = 0;
+
+	/**
+	 * Records a request for the entry with the given bounds, either a hit
+	 * or a miss followed by an attempt to cache the computed result.
+	 * @param semantic_id the semantic id of the entry
+	 * @param bounds the bounds of the entry
+	 */
+	virtual void record_access( const std::string &semantic_id, const CacheCube &bounds ) const;
+
+	/**
+	 * Tells whether a new entry should be cached if this requires evicting
+	 * the given victim. The default admits all entries.
+	 * @param semantic_id the semantic id of the new entry
+	 * @param candidate the new entry
+	 * @param victim_semantic_id the semantic id of the victim
+	 * @param victim the entry the replacement would evict first
+	 * @return whether the new entry should be cached
+	 */
+	virtual bool admit( const std::string &semantic_id, const CacheEntry &candidate,
+			const std::string &victim_semantic_id, const CacheEntry &victim ) const;
 };
 
 /**
@@ -111,4 +134,43 @@ private:
 	Type   type;
 };
 
+/**
+ * Admission control following TinyLFU. Requests for entries are counted
+ * in a count-min sketch, whose counters are halved periodically so the
+ * estimates follow the recent popularity of entries.
+ * All results are cached as long as there is free space. If an entry has
+ * to be evicted, the new entry is only cached if its estimated frequency
+ * times its computation costs exceeds the victim's. This keeps the working
+ * set in the cache while results used only once are scanned.
+ */
+class TinyLFUStrategy : public CachingStrategy {
+public:
+	/**
+	 * @param width the number of counters per row of the sketch, rounded up to a power of 2
+	 */
+	TinyLFUStrategy( size_t width = 65536 );
+	bool do_cache( const QueryProfiler &profiler, size_t bytes ) const;
+	void record_access( const std::string &semantic_id, const CacheCube &bounds ) const;
+	bool admit( const std::string &semantic_id, const CacheEntry &candidate,
+			const std::string &victim_semantic_id, const CacheEntry &victim ) const;
+
+	/**
+	 * @return the estimated number of recent requests for the given entry
+	 */
+	uint32_t estimate( const std::string &semantic_id, const CacheCube &bounds ) const;
+private:
+	static const int DEPTH = 4;
+	static const uint8_t MAX_COUNT = 15;
+	static uint64_t hash( const std::string &semantic_id, const CacheCube &bounds );
+	size_t index( uint64_t hash, int row ) const;
+	uint32_t estimate( uint64_t hash ) const;
+
+	size_t width;
+	/** Number of recorded requests after which all counters are halved */
+	size_t sample_size;
+	mutable std::mutex mtx;
+	mutable std::vector<uint8_t> counters;
+	mutable size_t additions;
+};
+
 #endif /* CACHING_STRATEGY_H_ */
@@ -25,6 +25,11 @@
 
 
 std::unique_ptr<BinaryReadBuffer> BlockingConnection::read()  {
+	std::lock_guard<std::mutex> g(mtx);
+	return read_unlocked();
+}
+
+std::unique_ptr<BinaryReadBuffer> BlockingConnection::read_unlocked()  {
 	auto result = std::make_unique<BinaryReadBuffer>();
 	socket.read(*result);
 	return result;
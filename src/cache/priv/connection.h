@@ -24,7 +24,9 @@
 
 
 /**
- * Models a simple blocking connection
+ * Models a simple blocking connection.
+ * It may be shared by several threads: writes and requests, i.e. a write
+ * followed by the read of its response, are performed atomically.
  */
 class BlockingConnection {
 public:
@@ -76,14 +78,19 @@ public:
 	 */
 	template<typename... Params>
 	std::unique_ptr<BinaryReadBuffer> write_and_read(const Params &... params) {
-		write(params...);
-		return read();
+		std::lock_guard<std::mutex> g(mtx);
+		write_unlocked(params...);
+		return read_unlocked();
 	}
 
 	int get_read_fd() const { return socket.getReadFD(); };
 	int get_write_fd() const { return socket.getWriteFD(); };
 
 private:
+	template<typename... Params>
+	void write_unlocked(const Params &... params);
+	std::unique_ptr<BinaryReadBuffer> read_unlocked();
+
 	template<typename Head>
 	void _internal_write(BinaryWriteBuffer &buffer, const Head &head);
 
@@ -91,6 +98,7 @@ private:
 	void _internal_write(BinaryWriteBuffer &buffer, const Head &head, const Tail &... tail);
 protected:
 	BinaryStream socket;
+	std::mutex mtx;
 };
 
 template<typename... Params>
@@ -102,6 +110,12 @@ std::unique_ptr<BlockingConnection> BlockingConnection::create(const std::string
 
 template<typename... Params>
 void BlockingConnection::write(const Params &... params) {
+	std::lock_guard<std::mutex> g(mtx);
+	write_unlocked(params...);
+}
+
+template<typename... Params>
+void BlockingConnection::write_unlocked(const Params &... params) {
 	BinaryWriteBuffer buffer;
 	_internal_write(buffer, params...);
 	socket.write(buffer);
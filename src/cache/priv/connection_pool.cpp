@@ -0,0 +1,89 @@
+#include "cache/priv/connection_pool.h"
+
+#include <poll.h>
+
+
+ConnectionPoolStats::ConnectionPoolStats() : created(0), reused(0), reconnects(0) {
+}
+
+std::string ConnectionPoolStats::to_string() const {
+	return concat("ConnectionPoolStats[created: ", created, ", reused: ", reused, ", reconnects: ", reconnects, "]");
+}
+
+
+BlockingConnectionPool::IdleConnection::IdleConnection(const std::string& host, int port, std::unique_ptr<BlockingConnection> con) :
+	host(host), port(port), con(std::move(con)), returned(time(nullptr)) {
+}
+
+BlockingConnectionPool::BlockingConnectionPool(uint32_t magic_number, size_t max_idle, int idle_timeout) :
+	magic_number(magic_number), max_idle(max_idle), idle_timeout(idle_timeout), created(0), reused(0), reconnects(0) {
+}
+
+std::unique_ptr<BlockingConnection> BlockingConnectionPool::checkout(const std::string& host, int port) {
+	std::list<IdleConnection> closing;
+	std::unique_ptr<BlockingConnection> result;
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		time_t now = time(nullptr);
+		for ( auto it = idle.begin(); it != idle.end(); ) {
+			auto current = it++;
+			if ( current->returned + idle_timeout < now )
+				closing.splice(closing.end(), idle, current);
+			else if ( !result && current->port == port && current->host == host ) {
+				result = std::move(current->con);
+				idle.erase(current);
+			}
+		}
+	}
+	// Closed outside of the lock
+	closing.clear();
+
+	if ( result && !is_alive(*result) ) {
+		reconnects++;
+		result.reset();
+	}
+	return result;
+}
+
+std::unique_ptr<BlockingConnection> BlockingConnectionPool::connect(const std::string& host, int port) {
+	auto result = BlockingConnection::create(host, port, true, magic_number);
+	created++;
+	return result;
+}
+
+void BlockingConnectionPool::checkin(const std::string& host, int port, std::unique_ptr<BlockingConnection> con) {
+	std::unique_ptr<BlockingConnection> closing;
+	std::lock_guard<std::mutex> g(mtx);
+	size_t count = 0;
+	for ( auto &c : idle )
+		if ( c.port == port && c.host == host )
+			count++;
+	if ( count < max_idle )
+		idle.emplace_front(host, port, std::move(con));
+	else
+		closing = std::move(con);
+}
+
+bool BlockingConnectionPool::is_alive(const BlockingConnection& con) {
+	// An idle connection must not have anything to read. If it has, the
+	// server closed it or it is out of sync.
+	struct pollfd pfd;
+	pfd.fd = con.get_read_fd();
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	int res = poll(&pfd, 1, 0);
+	return res == 0;
+}
+
+ConnectionPoolStats BlockingConnectionPool::get_stats() const {
+	ConnectionPoolStats result;
+	result.created = created;
+	result.reused = reused;
+	result.reconnects = reconnects;
+	return result;
+}
+
+size_t BlockingConnectionPool::get_idle_count() const {
+	std::lock_guard<std::mutex> g(mtx);
+	return idle.size();
+}
@@ -0,0 +1,137 @@
+#ifndef CACHE_PRIV_CONNECTION_POOL_H_
+#define CACHE_PRIV_CONNECTION_POOL_H_
+
+#include "cache/priv/connection.h"
+
+#include <atomic>
+#include <ctime>
+#include <list>
+#include <mutex>
+
+/**
+ * Counters describing the use of a connection-pool
+ */
+class ConnectionPoolStats {
+public:
+	ConnectionPoolStats();
+	std::string to_string() const;
+	/** Connections opened, including reconnects */
+	uint64_t created;
+	/** Requests served by an already open connection */
+	uint64_t reused;
+	/** Pooled connections found closed or failing and replaced */
+	uint64_t reconnects;
+};
+
+/**
+ * A thread-safe pool of blocking connections, keyed by host and port.
+ * Connections are kept open after a request finished, so subsequent
+ * requests save the connection setup and handshake.
+ *
+ * Before an idle connection is reused, it is checked for having been
+ * closed by the server. If a request on a reused connection fails anyway,
+ * it is repeated once on a fresh connection. Requests that must not be
+ * processed twice (e.g. fetching a delivery) are sent with write_and_read_once.
+ */
+class BlockingConnectionPool {
+public:
+	/**
+	 * @param magic_number the handshake sent on every new connection
+	 * @param max_idle the maximum number of idle connections per server
+	 * @param idle_timeout the number of seconds after which idle connections are closed
+	 */
+	BlockingConnectionPool( uint32_t magic_number, size_t max_idle, int idle_timeout );
+	BlockingConnectionPool( const BlockingConnectionPool& ) = delete;
+	BlockingConnectionPool& operator=( const BlockingConnectionPool& ) = delete;
+
+	/**
+	 * Sends the given request to the given server and reads the response
+	 * @param host the hostname of the server
+	 * @param port the port of the server
+	 * @param params the request
+	 * @return the response
+	 */
+	template<typename... Params>
+	std::unique_ptr<BinaryReadBuffer> write_and_read( const std::string &host, int port, const Params &... params );
+
+	/**
+	 * Sends the given request to the given server and reads the response.
+	 * Unlike write_and_read, the request is never repeated once it has been
+	 * sent, since the server may already have processed it.
+	 * @param host the hostname of the server
+	 * @param port the port of the server
+	 * @param params the request
+	 * @return the response
+	 */
+	template<typename... Params>
+	std::unique_ptr<BinaryReadBuffer> write_and_read_once( const std::string &host, int port, const Params &... params );
+
+	ConnectionPoolStats get_stats() const;
+
+	/**
+	 * @return the number of idle connections
+	 */
+	size_t get_idle_count() const;
+private:
+	class IdleConnection {
+	public:
+		IdleConnection( const std::string &host, int port, std::unique_ptr<BlockingConnection> con );
+		std::string host;
+		int port;
+		std::unique_ptr<BlockingConnection> con;
+		time_t returned;
+	};
+
+	/**
+	 * @return an idle connection to the given server or nullptr
+	 */
+	std::unique_ptr<BlockingConnection> checkout( const std::string &host, int port );
+	std::unique_ptr<BlockingConnection> connect( const std::string &host, int port );
+	void checkin( const std::string &host, int port, std::unique_ptr<BlockingConnection> con );
+	static bool is_alive( const BlockingConnection &con );
+
+	template<typename... Params>
+	std::unique_ptr<BinaryReadBuffer> request( bool retry, const std::string &host, int port, const Params &... params );
+
+	const uint32_t magic_number;
+	const size_t max_idle;
+	const int idle_timeout;
+	mutable std::mutex mtx;
+	// most recently returned first
+	std::list<IdleConnection> idle;
+	std::atomic<uint64_t> created, reused, reconnects;
+};
+
+template<typename... Params>
+std::unique_ptr<BinaryReadBuffer> BlockingConnectionPool::write_and_read( const std::string &host, int port, const Params &... params ) {
+	return request(true, host, port, params...);
+}
+
+template<typename... Params>
+std::unique_ptr<BinaryReadBuffer> BlockingConnectionPool::write_and_read_once( const std::string &host, int port, const Params &... params ) {
+	return request(false, host, port, params...);
+}
+
+template<typename... Params>
+std::unique_ptr<BinaryReadBuffer> BlockingConnectionPool::request( bool retry, const std::string &host, int port, const Params &... params ) {
+	auto con = checkout(host, port);
+	if ( con ) {
+		try {
+			auto result = con->write_and_read(params...);
+			reused++;
+			checkin(host, port, std::move(con));
+			return result;
+		} catch ( const NetworkException &ne ) {
+			// The server may have dropped the connection after our check
+			reconnects++;
+			if ( !retry )
+				throw;
+		}
+	}
+	con = connect(host, port);
+	auto result = con->write_and_read(params...);
+	checkin(host, port, std::move(con));
+	return result;
+}
+
+#endif /* CACHE_PRIV_CONNECTION_POOL_H_ */
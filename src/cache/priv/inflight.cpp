@@ -0,0 +1,81 @@
+#include "cache/priv/inflight.h"
+
+#include <cmath>
+
+InFlightRegistry::Lease::Lease() : registry(nullptr), id(0) {
+}
+
+InFlightRegistry::Lease::Lease(InFlightRegistry& registry, uint64_t id) : registry(&registry), id(id) {
+}
+
+InFlightRegistry::Lease::~Lease() {
+	if ( registry != nullptr )
+		registry->finish(id);
+}
+
+InFlightRegistry::Computation::Computation(uint64_t id, const std::string& semantic_id, const QueryRectangle& rect) :
+	id(id), semantic_id(semantic_id), cube(rect), owner(std::this_thread::get_id()) {
+}
+
+static bool same_scale( double s1, double s2 ) {
+	return std::abs(s1 - s2) <= 1e-9 * std::max(std::abs(s1), std::abs(s2));
+}
+
+bool InFlightRegistry::Computation::covers(const std::string& semantic_id, const QueryCube& cube) const {
+	if ( this->semantic_id != semantic_id ||
+		 this->cube.crsId != cube.crsId || this->cube.timetype != cube.timetype ||
+		 this->cube.restype != cube.restype )
+		return false;
+	if ( cube.restype != QueryResolution::Type::NONE &&
+		 (!same_scale(this->cube.pixel_scale_x, cube.pixel_scale_x) || !same_scale(this->cube.pixel_scale_y, cube.pixel_scale_y)) )
+		return false;
+	return this->cube.contains(cube);
+}
+
+InFlightRegistry::InFlightRegistry() : next_id(1), waiting(0) {
+}
+
+std::unique_ptr<InFlightRegistry::Lease> InFlightRegistry::begin(const std::string& semantic_id, const QueryRectangle& rect) {
+	QueryCube cube(rect);
+	std::unique_lock<std::mutex> g(mtx);
+	for ( auto &c : running ) {
+		if ( !c.covers(semantic_id, cube) )
+			continue;
+		// Never wait for ourselves
+		if ( c.owner == std::this_thread::get_id() )
+			return std::make_unique<Lease>();
+		uint64_t id = c.id;
+		waiting++;
+		cv.wait(g, [this,id]() { return !is_running(id); });
+		waiting--;
+		return nullptr;
+	}
+	uint64_t id = next_id++;
+	running.emplace_back(id, semantic_id, rect);
+	return std::unique_ptr<Lease>(new Lease(*this, id));
+}
+
+size_t InFlightRegistry::get_running() const {
+	std::lock_guard<std::mutex> g(mtx);
+	return running.size();
+}
+
+size_t InFlightRegistry::get_waiting() const {
+	std::lock_guard<std::mutex> g(mtx);
+	return waiting;
+}
+
+void InFlightRegistry::finish(uint64_t id) {
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		running.remove_if([id](const Computation &c) { return c.id == id; });
+	}
+	cv.notify_all();
+}
+
+bool InFlightRegistry::is_running(uint64_t id) const {
+	for ( auto &c : running )
+		if ( c.id == id )
+			return true;
+	return false;
+}
@@ -0,0 +1,87 @@
+#ifndef CACHE_PRIV_INFLIGHT_H_
+#define CACHE_PRIV_INFLIGHT_H_
+
+#include "cache/priv/shared.h"
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * Keeps track of results which are computed after a cache-miss (single-flight).
+ * Concurrent queries for a result that is already being computed wait for
+ * the computation to finish and are then answered by the cache, instead of
+ * computing the same result again.
+ * A query waits for a computation with the same semantic id whose query-cube
+ * covers its own cube at the same resolution. Partially overlapping queries
+ * are computed in parallel, as waiting would serialize them.
+ */
+class InFlightRegistry {
+public:
+	/**
+	 * The registration of a running computation. Waiting queries are released
+	 * when it is destroyed, i.e. after the result was put into the cache or
+	 * its computation failed.
+	 */
+	class Lease {
+		friend class InFlightRegistry;
+	public:
+		/**
+		 * Constructs a lease which is not registered anywhere
+		 */
+		Lease();
+		~Lease();
+		Lease( const Lease& ) = delete;
+		Lease& operator=( const Lease& ) = delete;
+	private:
+		Lease( InFlightRegistry &registry, uint64_t id );
+		InFlightRegistry *registry;
+		uint64_t id;
+	};
+
+	InFlightRegistry();
+
+	/**
+	 * Registers the computation of the result of the given query. If a
+	 * computation covering the query is already running, waits for it.
+	 * @param semantic_id the semantic id of the result
+	 * @param rect the query-rectangle which missed in the cache
+	 * @return the lease for the new computation, or nullptr if the
+	 *         caller waited for another computation and should query the cache again
+	 */
+	std::unique_ptr<Lease> begin( const std::string &semantic_id, const QueryRectangle &rect );
+
+	/**
+	 * @return the number of running computations
+	 */
+	size_t get_running() const;
+
+	/**
+	 * @return the number of queries waiting for a running computation
+	 */
+	size_t get_waiting() const;
+private:
+	class Computation {
+	public:
+		Computation( uint64_t id, const std::string &semantic_id, const QueryRectangle &rect );
+		bool covers( const std::string &semantic_id, const QueryCube &cube ) const;
+		uint64_t id;
+		std::string semantic_id;
+		QueryCube cube;
+		std::thread::id owner;
+	};
+
+	void finish( uint64_t id );
+	bool is_running( uint64_t id ) const;
+
+	mutable std::mutex mtx;
+	std::condition_variable cv;
+	uint64_t next_id;
+	size_t waiting;
+	// Only a few computations run at once, so a list is sufficient
+	std::list<Computation> running;
+};
+
+#endif /* CACHE_PRIV_INFLIGHT_H_ */
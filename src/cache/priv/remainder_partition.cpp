@@ -0,0 +1,259 @@
+#include "cache/priv/remainder_partition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+
+const double RemainderPartition::MERGE_OVERHEAD = 0.05;
+const size_t RemainderPartition::MERGE_WINDOW = 8;
+
+/**
+ * The sorted bounds of the grid-cells along one dimension of the query
+ */
+class GridAxis {
+public:
+	GridAxis( const Interval &query, double pixel_scale, const std::vector<Cube<3>> &cubes, int dim ) :
+		query(query), pixel_scale(pixel_scale), tolerance((query.b - query.a) * 1e-9) {
+		coords.push_back(query.a);
+		coords.push_back(query.b);
+		for ( auto &c : cubes ) {
+			coords.push_back( snap(c.get_dimension(dim).a) );
+			coords.push_back( snap(c.get_dimension(dim).b) );
+		}
+		std::sort(coords.begin(), coords.end());
+		coords.erase( std::unique(coords.begin(), coords.end(), [this](double a, double b) {
+			return b - a <= tolerance;
+		}), coords.end() );
+	}
+
+	/**
+	 * @return the number of cells
+	 */
+	size_t size() const {
+		return coords.size() - 1;
+	}
+
+	/**
+	 * @return the cells covered by the given interval, as [first,last)
+	 */
+	std::pair<size_t,size_t> cells( const Interval &i ) const {
+		return std::make_pair( index_of(snap(i.a)), index_of(snap(i.b)) );
+	}
+
+	double operator[]( size_t idx ) const {
+		return coords[idx];
+	}
+
+private:
+	double snap( double v ) const {
+		if ( pixel_scale > 0 )
+			v = query.a + std::round( (v - query.a) / pixel_scale ) * pixel_scale;
+		return std::min( std::max(v, query.a), query.b );
+	}
+
+	size_t index_of( double v ) const {
+		return std::lower_bound(coords.begin(), coords.end(), v - tolerance) - coords.begin();
+	}
+
+	const Interval query;
+	const double pixel_scale;
+	const double tolerance;
+	std::vector<double> coords;
+};
+
+/**
+ * @return whether the interiors of the given cubes intersect
+ */
+static bool overlaps( const Cube<3> &c1, const Cube<3> &c2 ) {
+	for ( int i = 0; i < 3; i++ ) {
+		auto &d1 = c1.get_dimension(i);
+		auto &d2 = c2.get_dimension(i);
+		if ( d1.a >= d2.b || d2.a >= d1.b )
+			return false;
+	}
+	return true;
+}
+
+std::vector<Cube<3>> RemainderPartition::compute( const QueryCube &query, const std::vector<Cube<3>> &uncovered ) {
+	if ( uncovered.empty() )
+		return std::vector<Cube<3>>();
+	auto result = partition(query, uncovered);
+	merge(query, result);
+	return result;
+}
+
+double RemainderPartition::relative_volume( const QueryCube &query, const Cube<3> &cube ) {
+	return cube.volume() / query.volume();
+}
+
+std::vector<Cube<3>> RemainderPartition::partition( const QueryCube &query, const std::vector<Cube<3>> &uncovered ) {
+	bool raster = query.restype == QueryResolution::Type::PIXELS;
+	GridAxis ax( query.get_dimension(0), raster ? query.pixel_scale_x : 0, uncovered, 0 );
+	GridAxis ay( query.get_dimension(1), raster ? query.pixel_scale_y : 0, uncovered, 1 );
+	GridAxis at( query.get_dimension(2), 0, uncovered, 2 );
+
+	const size_t nx = ax.size(), ny = ay.size(), nt = at.size();
+	enum : uint8_t { COVERED, UNCOVERED, ASSIGNED };
+	std::vector<uint8_t> cells( nx * ny * nt, COVERED );
+	auto cell = [&]( size_t x, size_t y, size_t t ) -> uint8_t& {
+		return cells[ (t * ny + y) * nx + x ];
+	};
+	auto all_uncovered = [&]( size_t x1, size_t x2, size_t y1, size_t y2, size_t t1, size_t t2 ) {
+		for ( size_t t = t1; t < t2; t++ )
+			for ( size_t y = y1; y < y2; y++ )
+				for ( size_t x = x1; x < x2; x++ )
+					if ( cell(x,y,t) != UNCOVERED )
+						return false;
+		return true;
+	};
+
+	// Mark the cells of all uncovered cubes. Cubes thinner than half a pixel span no cells.
+	for ( auto &c : uncovered ) {
+		auto cx = ax.cells(c.get_dimension(0));
+		auto cy = ay.cells(c.get_dimension(1));
+		auto ct = at.cells(c.get_dimension(2));
+		for ( size_t t = ct.first; t < ct.second; t++ )
+			for ( size_t y = cy.first; y < cy.second; y++ )
+				for ( size_t x = cx.first; x < cx.second; x++ )
+					cell(x,y,t) = UNCOVERED;
+	}
+
+	// Greedily grow maximal boxes: along x first, then y, then time
+	std::vector<Cube<3>> result;
+	for ( size_t t = 0; t < nt; t++ ) {
+		for ( size_t y = 0; y < ny; y++ ) {
+			for ( size_t x = 0; x < nx; x++ ) {
+				if ( cell(x,y,t) != UNCOVERED )
+					continue;
+
+				size_t x2 = x + 1, y2 = y + 1, t2 = t + 1;
+				while ( x2 < nx && cell(x2,y,t) == UNCOVERED )
+					x2++;
+				while ( y2 < ny && all_uncovered(x,x2,y2,y2+1,t,t+1) )
+					y2++;
+				while ( t2 < nt && all_uncovered(x,x2,y,y2,t2,t2+1) )
+					t2++;
+
+				for ( size_t bt = t; bt < t2; bt++ )
+					for ( size_t by = y; by < y2; by++ )
+						for ( size_t bx = x; bx < x2; bx++ )
+							cell(bx,by,bt) = ASSIGNED;
+
+				result.push_back( Cube3( ax[x], ax[x2], ay[y], ay[y2], at[t], at[t2] ) );
+			}
+		}
+	}
+	return result;
+}
+
+/**
+ * A possible merge of two remainders, together with all remainders its bounding box overlaps
+ */
+struct MergeCandidate {
+	double saving;
+	size_t first, second;
+	bool operator<( const MergeCandidate &other ) const {
+		return saving < other.saving;
+	}
+};
+
+void RemainderPartition::merge( const QueryCube &query, std::vector<Cube<3>> &remainders ) {
+	if ( remainders.size() < 2 )
+		return;
+
+	// Remainders by the lower x-bound. Only remainders close to each other in
+	// this order are considered as merge partners.
+	std::vector<Cube<3>> boxes = std::move(remainders);
+	std::vector<bool> alive( boxes.size(), true );
+	std::multimap<double,size_t> sweep;
+	std::vector<std::multimap<double,size_t>::iterator> sweep_pos;
+	for ( size_t i = 0; i < boxes.size(); i++ )
+		sweep_pos.push_back( sweep.emplace( boxes[i].get_dimension(0).a, i ) );
+
+	std::vector<size_t> members;
+	Cube<3> box;
+	auto evaluate = [&]( size_t i, size_t j ) {
+		box = boxes[i].combine(boxes[j]);
+		members.assign({i, j});
+
+		// The merged remainder replaces all remainders it overlaps
+		bool grown = true;
+		while ( grown ) {
+			grown = false;
+			auto end = sweep.lower_bound( box.get_dimension(0).b );
+			for ( auto it = sweep.begin(); it != end; ++it ) {
+				size_t k = it->second;
+				if ( std::find(members.begin(), members.end(), k) == members.end() &&
+					 overlaps(box, boxes[k]) ) {
+					box = box.combine(boxes[k]);
+					members.push_back(k);
+					grown = true;
+				}
+			}
+		}
+
+		double separate = 0;
+		for ( auto m : members )
+			separate += MERGE_OVERHEAD + relative_volume(query, boxes[m]);
+		return separate - (MERGE_OVERHEAD + relative_volume(query, box));
+	};
+
+	std::priority_queue<MergeCandidate> candidates;
+	auto add_candidates = [&]( size_t i ) {
+		auto pos = sweep_pos[i];
+		auto it = pos;
+		for ( size_t n = 0; n < MERGE_WINDOW && it != sweep.begin(); n++ ) {
+			--it;
+			double saving = evaluate(i, it->second);
+			if ( saving > 0 )
+				candidates.push( MergeCandidate{saving, i, it->second} );
+		}
+		it = pos;
+		for ( size_t n = 0; n < MERGE_WINDOW && ++it != sweep.end(); n++ ) {
+			double saving = evaluate(i, it->second);
+			if ( saving > 0 )
+				candidates.push( MergeCandidate{saving, i, it->second} );
+		}
+	};
+
+	// Pairs within the window of each other, each evaluated once
+	for ( auto it = sweep.begin(); it != sweep.end(); ++it ) {
+		auto other = it;
+		for ( size_t n = 0; n < MERGE_WINDOW && ++other != sweep.end(); n++ ) {
+			double saving = evaluate(it->second, other->second);
+			if ( saving > 0 )
+				candidates.push( MergeCandidate{saving, it->second, other->second} );
+		}
+	}
+
+	while ( !candidates.empty() ) {
+		MergeCandidate c = candidates.top();
+		candidates.pop();
+		if ( !alive[c.first] || !alive[c.second] )
+			continue;
+
+		// Earlier merges may have changed the overlapped remainders
+		double saving = evaluate(c.first, c.second);
+		if ( saving <= 0 )
+			continue;
+		if ( saving < c.saving && !candidates.empty() && saving < candidates.top().saving ) {
+			candidates.push( MergeCandidate{saving, c.first, c.second} );
+			continue;
+		}
+
+		for ( auto m : members ) {
+			alive[m] = false;
+			sweep.erase( sweep_pos[m] );
+		}
+		size_t merged = boxes.size();
+		boxes.push_back(box);
+		alive.push_back(true);
+		sweep_pos.push_back( sweep.emplace( box.get_dimension(0).a, merged ) );
+		add_candidates(merged);
+	}
+
+	for ( size_t i = 0; i < boxes.size(); i++ )
+		if ( alive[i] )
+			remainders.push_back( boxes[i] );
+}
@@ -0,0 +1,61 @@
+#ifndef CACHE_PRIV_REMAINDER_PARTITION_H_
+#define CACHE_PRIV_REMAINDER_PARTITION_H_
+
+#include "cache/priv/shared.h"
+
+#include <vector>
+
+/**
+ * Decomposes the part of a query not covered by cache-entries into few,
+ * well-shaped remainders. Each remainder is a computation of the whole
+ * operator-graph, so fewer remainders are worth recomputing some cached data.
+ *
+ * The bounds of all uncovered cubes span a grid over the query. For rasters,
+ * these bounds are snapped to the pixel-grid of the query, so slivers thinner
+ * than half a pixel vanish. The uncovered cells of the grid are partitioned
+ * into maximal boxes, which are finally merged while the merged computation
+ * is estimated to be cheaper than the separate ones.
+ */
+class RemainderPartition {
+public:
+	/**
+	 * The estimated overhead of computing a remainder, as fraction of the query's volume.
+	 * Two remainders are merged, if their bounding box is at most this much larger than both.
+	 */
+	static const double MERGE_OVERHEAD;
+
+	/**
+	 * The number of neighbours, in order of their lower x-bound, each remainder is tried to be merged with.
+	 */
+	static const size_t MERGE_WINDOW;
+
+	/**
+	 * Computes the remainders for the given uncovered cubes
+	 * @param query the query
+	 * @param uncovered disjoint cubes inside the query, not covered by any cache-entry
+	 * @return the remainders, covering all uncovered cubes
+	 */
+	static std::vector<Cube<3>> compute( const QueryCube &query, const std::vector<Cube<3>> &uncovered );
+
+	/**
+	 * @param query the query
+	 * @param cube a cube inside the query
+	 * @return the volume of the given cube as fraction of the query's volume
+	 */
+	static double relative_volume( const QueryCube &query, const Cube<3> &cube );
+
+private:
+	/**
+	 * Partitions the uncovered cells of the grid into maximal boxes
+	 */
+	static std::vector<Cube<3>> partition( const QueryCube &query, const std::vector<Cube<3>> &uncovered );
+
+	/**
+	 * Merges remainders while the computation of the merged one is estimated to be cheaper.
+	 * Remainders are swept along the x-axis and candidate pairs are kept in a priority queue,
+	 * so the best merge is found without rescanning all pairs after every merge.
+	 */
+	static void merge( const QueryCube &query, std::vector<Cube<3>> &remainders );
+};
+
+#endif /* CACHE_PRIV_REMAINDER_PARTITION_H_ */
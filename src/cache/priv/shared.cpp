@@ -56,6 +56,14 @@ bool ResolutionInfo::matches(const QueryCube& query) const {
     );
 }
 
+bool ResolutionInfo::matches_finer(const QueryCube& query, double max_factor) const {
+	// Tolerate rounding errors of the pixel-scales
+	const double max_ratio = max_factor * (1 + 1e-9);
+	return query.restype == QueryResolution::Type::PIXELS && restype == query.restype &&
+		actual_pixel_scale_x <= query.pixel_scale_x && query.pixel_scale_x <= actual_pixel_scale_x * max_ratio &&
+		actual_pixel_scale_y <= query.pixel_scale_y && query.pixel_scale_y <= actual_pixel_scale_y * max_ratio;
+}
+
 std::string ResolutionInfo::to_string() const {
 	return concat("Resolution[ x: ", actual_pixel_scale_x, ", y: ", actual_pixel_scale_y, " ranges: ", pixel_scale_x.to_string(), "x", pixel_scale_y.to_string(), "]" );
 }
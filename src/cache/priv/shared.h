@@ -59,6 +59,15 @@ public:
 	 */
 	bool matches( const QueryCube &query ) const;
 
+	/**
+	 * Checks if the resolution is finer than the one of the given query, but at most
+	 * by the given factor. The query may then be answered by downsampling.
+	 * @param query The query to check the resolution for
+	 * @param max_factor the maximum ratio of the query's pixel-scale to this one
+	 * @return whether the resolution may be downsampled to the one of the query
+	 */
+	bool matches_finer( const QueryCube &query, double max_factor ) const;
+
 	/**
 	 * @return a string-representation of this resolution
 	 */
@@ -89,7 +89,10 @@ int main() {
 		} else if(cacheType == "remote") {
 			std::string host = Configuration::get<std::string>("indexserver.host");
 			int port = Configuration::get<int>("indexserver.port");
-			cm = std::make_unique<ClientCacheManager>(host,port);
+			cm = std::make_unique<ClientCacheManager>(host,port,
+					Configuration::get<size_t>("cache.pool.max_idle", 4),
+					Configuration::get<int>("cache.pool.idle_timeout", 60)
+			);
 		} else {
 			throw ArgumentException("Invalid cache.type");
 		}
@@ -1,7 +1,10 @@
 
 #include "datatypes/polygoncollection.h"
 #include "util/binarystream.h"
+#include "util/task_executor.h"
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 
 
@@ -339,6 +342,13 @@ SpatialReference PolygonCollection::getCollectionMBR() const{
  * PointInCollectionBulkTester
  */
 
+// rings with fewer edges are tested without bands
+static const uint32_t BAND_MIN_EDGES = 32;
+static const uint32_t EDGES_PER_BAND = 8;
+static const uint32_t MAX_BANDS = 4096;
+static const size_t RTREE_FANOUT = 16;
+static const size_t POINTS_PER_TASK = 16384;
+
 PolygonCollection::PointInCollectionBulkTester::PointInCollectionBulkTester(const PolygonCollection& polygonCollection) : polygonCollection(polygonCollection){
 	performPrecalculation();
 }
@@ -363,26 +373,192 @@ void PolygonCollection::PointInCollectionBulkTester::precalculateRing(size_t coo
 	}
 }
 
+void PolygonCollection::PointInCollectionBulkTester::buildBands(Ring &ring){
+	ring.firstBand = bandOffsets.size();
+	ring.bandCount = 0;
+	ring.bandHeight = 0;
+
+	uint32_t numberOfCorners = ring.coordinateIndexStop - ring.coordinateIndexStart - 1;
+	double height = ring.box.y2 - ring.box.y1;
+	if(numberOfCorners < BAND_MIN_EDGES || !(height > 0))
+		return;
+
+	uint32_t bandCount = std::min(MAX_BANDS, numberOfCorners / EDGES_PER_BAND);
+	double bandHeight = height / bandCount;
+	auto band = [&](double y) -> uint32_t {
+		double b = (y - ring.box.y1) / bandHeight;
+		if(!(b > 0))
+			return 0;
+		return std::min(bandCount - 1, (uint32_t) b);
+	};
+
+	// an edge is listed in every band its y-range intersects. Bands are computed with the same function for
+	// edges and points, so every edge crossing the height of a point is listed in the band of the point.
+	std::vector<uint32_t> counts(bandCount + 1, 0);
+	for(uint32_t i = 0, j = numberOfCorners - 1; i < numberOfCorners; j = i++){
+		const Coordinate& c_i = polygonCollection.coordinates[ring.coordinateIndexStart + i];
+		const Coordinate& c_j = polygonCollection.coordinates[ring.coordinateIndexStart + j];
+		uint32_t b1 = band(std::min(c_i.y, c_j.y)), b2 = band(std::max(c_i.y, c_j.y));
+		for(uint32_t b = b1; b <= b2; ++b)
+			++counts[b + 1];
+	}
+	for(uint32_t b = 0; b < bandCount; ++b)
+		counts[b + 1] += counts[b];
+
+	size_t edgeOffset = bandEdges.size();
+	for(auto count : counts)
+		bandOffsets.push_back(edgeOffset + count);
+	bandEdges.resize(edgeOffset + counts.back());
+
+	for(uint32_t i = 0, j = numberOfCorners - 1; i < numberOfCorners; j = i++){
+		const Coordinate& c_i = polygonCollection.coordinates[ring.coordinateIndexStart + i];
+		const Coordinate& c_j = polygonCollection.coordinates[ring.coordinateIndexStart + j];
+		uint32_t b1 = band(std::min(c_i.y, c_j.y)), b2 = band(std::max(c_i.y, c_j.y));
+		for(uint32_t b = b1; b <= b2; ++b)
+			bandEdges[edgeOffset + counts[b]++] = i;
+	}
+
+	ring.bandCount = bandCount;
+	ring.bandHeight = bandHeight;
+}
+
+/*
+ * Orders the given entries with the sort-tile-recursive algorithm, so that consecutive groups of
+ * RTREE_FANOUT entries are spatially close.
+ */
+template<typename GetBox>
+static void sortTileRecursive(std::vector<uint32_t>& entries, GetBox getBox){
+	auto centerX = [&](uint32_t e) { auto b = getBox(e); return b.x1 + b.x2; };
+	auto centerY = [&](uint32_t e) { auto b = getBox(e); return b.y1 + b.y2; };
+
+	std::sort(entries.begin(), entries.end(), [&](uint32_t a, uint32_t b) { return centerX(a) < centerX(b); });
+
+	size_t groups = (entries.size() + RTREE_FANOUT - 1) / RTREE_FANOUT;
+	size_t slices = (size_t) std::ceil(std::sqrt((double) groups));
+	size_t sliceSize = slices * RTREE_FANOUT;
+	for(size_t start = 0; start < entries.size(); start += sliceSize){
+		auto end = entries.begin() + std::min(entries.size(), start + sliceSize);
+		std::sort(entries.begin() + start, end, [&](uint32_t a, uint32_t b) { return centerY(a) < centerY(b); });
+	}
+}
+
+void PolygonCollection::PointInCollectionBulkTester::buildTree(){
+	nodes.clear();
+	treePolygons.resize(polygons.size());
+	for(uint32_t i = 0; i < polygons.size(); ++i)
+		treePolygons[i] = i;
+	if(polygons.empty())
+		return;
+
+	auto merge = [](Box &box, const Box &other) {
+		box.x1 = std::min(box.x1, other.x1);
+		box.y1 = std::min(box.y1, other.y1);
+		box.x2 = std::max(box.x2, other.x2);
+		box.y2 = std::max(box.y2, other.y2);
+	};
+
+	// leaves
+	sortTileRecursive(treePolygons, [&](uint32_t p) -> const Box& { return rings[polygons[p].firstRing].box; });
+	std::vector<Node> level;
+	for(size_t start = 0; start < treePolygons.size(); start += RTREE_FANOUT){
+		Node node;
+		node.firstChild = start;
+		node.childCount = std::min(RTREE_FANOUT, treePolygons.size() - start);
+		node.leaf = true;
+		node.box = rings[polygons[treePolygons[start]].firstRing].box;
+		for(size_t i = 1; i < node.childCount; ++i)
+			merge(node.box, rings[polygons[treePolygons[start + i]].firstRing].box);
+		level.push_back(node);
+	}
+
+	// inner nodes, until only the root is left. Children of a node are stored consecutively.
+	while(level.size() > 1){
+		std::vector<uint32_t> order(level.size());
+		for(uint32_t i = 0; i < level.size(); ++i)
+			order[i] = i;
+		sortTileRecursive(order, [&](uint32_t n) -> const Box& { return level[n].box; });
+
+		std::vector<Node> parents;
+		for(size_t start = 0; start < order.size(); start += RTREE_FANOUT){
+			Node node;
+			node.firstChild = nodes.size();
+			node.childCount = std::min(RTREE_FANOUT, order.size() - start);
+			node.leaf = false;
+			node.box = level[order[start]].box;
+			for(size_t i = 0; i < node.childCount; ++i){
+				merge(node.box, level[order[start + i]].box);
+				nodes.push_back(level[order[start + i]]);
+			}
+			parents.push_back(node);
+		}
+		level = std::move(parents);
+	}
+	// the root is the last node
+	nodes.push_back(level[0]);
+}
+
 void PolygonCollection::PointInCollectionBulkTester::performPrecalculation(){
-	constants.reserve(polygonCollection.coordinates.size());
-	multiples.reserve(polygonCollection.coordinates.size());
+	constants.resize(polygonCollection.coordinates.size());
+	multiples.resize(polygonCollection.coordinates.size());
 
 	for(auto feature : polygonCollection){
 		for(auto polygon : feature){
+			Polygon p;
+			p.feature = feature;
+			p.firstRing = rings.size();
+			p.ringCount = 0;
 			for(auto ring : polygon){
-				precalculateRing(polygonCollection.start_ring[ring.getRingIndex()], polygonCollection.start_ring[ring.getRingIndex() + 1]);
+				Ring r;
+				r.coordinateIndexStart = polygonCollection.start_ring[ring.getRingIndex()];
+				r.coordinateIndexStop = polygonCollection.start_ring[ring.getRingIndex() + 1];
+				precalculateRing(r.coordinateIndexStart, r.coordinateIndexStop);
+
+				auto mbr = polygonCollection.calculateMBR(r.coordinateIndexStart, r.coordinateIndexStop);
+				r.box = Box{mbr.x1, mbr.y1, mbr.x2, mbr.y2};
+				buildBands(r);
+				rings.push_back(r);
+				++p.ringCount;
 			}
+			if(p.ringCount > 0)
+				polygons.push_back(p);
 		}
 	}
+
+	buildTree();
 }
 
-bool PolygonCollection::PointInCollectionBulkTester::pointInRing(const Coordinate& coordinate, size_t coordinateIndexStart, size_t coordinateIndexStop) const {
+template<typename Callback>
+void PolygonCollection::PointInCollectionBulkTester::findPolygons(const Coordinate& coordinate, Callback callback) const {
+	if(nodes.empty())
+		return;
+
+	std::vector<uint32_t> stack;
+	stack.push_back(nodes.size() - 1);
+	while(!stack.empty()){
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if(!node.box.contains(coordinate))
+			continue;
+
+		for(uint32_t i = node.firstChild; i < node.firstChild + node.childCount; ++i){
+			if(!node.leaf)
+				stack.push_back(i);
+			else if(!callback(treePolygons[i]))
+				return;
+		}
+	}
+}
+
+bool PolygonCollection::PointInCollectionBulkTester::pointInRing(const Coordinate& coordinate, const Ring& ring) const {
+	if(!ring.box.contains(coordinate))
+		return false;
+
 	//Algorithm from http://alienryderflex.com/polygon/
-	size_t numberOfCorners = coordinateIndexStop - coordinateIndexStart - 1;
-	size_t i, j = numberOfCorners - 1;
+	size_t coordinateIndexStart = ring.coordinateIndexStart;
+	uint32_t numberOfCorners = ring.coordinateIndexStop - coordinateIndexStart - 1;
 	bool oddNodes = false;
 
-	for (i=0; i < numberOfCorners; ++i) {
+	auto testEdge = [&](uint32_t i, uint32_t j) {
 		const Coordinate& c_i = polygonCollection.coordinates[coordinateIndexStart + i];
 		const Coordinate& c_j = polygonCollection.coordinates[coordinateIndexStart + j];
 
@@ -390,68 +566,77 @@ bool PolygonCollection::PointInCollectionBulkTester::pointInRing(const Coordinat
 		||  (c_j.y < coordinate.y && c_i.y >= coordinate.y)) {
 			oddNodes ^= (coordinate.y * multiples[coordinateIndexStart + i] + constants[coordinateIndexStart + i] < coordinate.x);
 		}
-		j = i;
+	};
+
+	if(ring.bandCount == 0){
+		for(uint32_t i = 0, j = numberOfCorners - 1; i < numberOfCorners; j = i++)
+			testEdge(i, j);
+	}
+	else {
+		double b = (coordinate.y - ring.box.y1) / ring.bandHeight;
+		uint32_t band = b > 0 ? std::min(ring.bandCount - 1, (uint32_t) b) : 0;
+		const uint32_t *offsets = &bandOffsets[ring.firstBand + band];
+		for(uint32_t e = offsets[0]; e < offsets[1]; ++e){
+			uint32_t i = bandEdges[e];
+			testEdge(i, i == 0 ? numberOfCorners - 1 : i - 1);
+		}
 	}
 
 	return oddNodes;
 }
 
+bool PolygonCollection::PointInCollectionBulkTester::pointInPolygon(const Coordinate& coordinate, const Polygon& polygon) const {
+	if(!pointInRing(coordinate, rings[polygon.firstRing]))
+		return false;
+	for(uint32_t r = polygon.firstRing + 1; r < polygon.firstRing + polygon.ringCount; ++r){
+		if(pointInRing(coordinate, rings[r]))
+			return false;
+	}
+	return true;
+}
+
 bool PolygonCollection::PointInCollectionBulkTester::pointInCollection(const Coordinate& coordinate) const {
-	for(auto feature : polygonCollection){
-		for(auto polygon : feature){
-			bool contained = true;
-			size_t ringIndex = 0;
-			for(auto ring : polygon){
-				if(ringIndex == 0){
-					if(!pointInRing(coordinate, polygonCollection.start_ring[ring.getRingIndex()], polygonCollection.start_ring[ring.getRingIndex() + 1])){
-						contained = false;
-						break;
-					}
-				}
-				else {
-					if(pointInRing(coordinate, polygonCollection.start_ring[ring.getRingIndex()], polygonCollection.start_ring[ring.getRingIndex() + 1])){
-						contained = false;
-						break;
-					}
-				}
+	bool contained = false;
+	findPolygons(coordinate, [&](uint32_t p) {
+		contained = pointInPolygon(coordinate, polygons[p]);
+		return !contained;
+	});
+	return contained;
+}
 
-				++ringIndex;
-			}
-			if(contained)
-				return true;
-		}
+std::vector<bool> PolygonCollection::PointInCollectionBulkTester::pointsInCollection(const std::vector<Coordinate>& coordinates) const {
+	// std::vector<bool> cannot be written concurrently
+	std::vector<char> contained(coordinates.size(), false);
+
+	auto &executor = TaskExecutor::get_instance();
+	std::vector<TaskFuture<void>> futures;
+	for(size_t start = 0; start < coordinates.size(); start += POINTS_PER_TASK){
+		size_t end = std::min(coordinates.size(), start + POINTS_PER_TASK);
+		futures.push_back(executor.submit([this, &coordinates, &contained, start, end] {
+			for(size_t i = start; i < end; ++i)
+				contained[i] = pointInCollection(coordinates[i]);
+		}));
 	}
+	for(auto &future : futures)
+		future.get();
 
-	return false;
+	return std::vector<bool>(contained.begin(), contained.end());
 }
 
 std::vector<uint32_t> PolygonCollection::PointInCollectionBulkTester::polygonsContainingPoint(const Coordinate& coordinate) const {
-	std::vector<uint32_t> result;
-	for(auto feature : polygonCollection){
-		for(auto polygon : feature){
-			bool contained = true;
-			size_t ringIndex = 0;
-			for(auto ring : polygon){
-				if(ringIndex == 0){
-					if(!pointInRing(coordinate, polygonCollection.start_ring[ring.getRingIndex()], polygonCollection.start_ring[ring.getRingIndex() + 1])){
-						contained = false;
-						break;
-					}
-				}
-				else {
-					if(pointInRing(coordinate, polygonCollection.start_ring[ring.getRingIndex()], polygonCollection.start_ring[ring.getRingIndex() + 1])){
-						contained = false;
-						break;
-					}
-				}
-
-				++ringIndex;
-			}
-			if(contained)
-				result.push_back(feature);
-		}
-	}
+	std::vector<uint32_t> containing;
+	findPolygons(coordinate, [&](uint32_t p) {
+		if(pointInPolygon(coordinate, polygons[p]))
+			containing.push_back(p);
+		return true;
+	});
 
+	// report the features in the order of the collection
+	std::sort(containing.begin(), containing.end());
+	std::vector<uint32_t> result;
+	result.reserve(containing.size());
+	for(auto p : containing)
+		result.push_back(polygons[p].feature);
 	return result;
 }
 
@@ -404,6 +404,10 @@ public:
 	 * This class should be used to test many points for containment in a PolygonCollection
 	 * on instantiation it performs pre-calculations in order to make tests faster
 	 * if the corresponding PolygonCollection is changed the results will be faulty
+	 *
+	 * The pre-calculations build a packed R-tree over the bounding boxes of the polygons, so only polygons
+	 * near a point are tested. Rings with many edges are additionally split into horizontal bands,
+	 * each listing the edges it intersects, so only the edges at the height of a point are tested.
 	 */
 	class PointInCollectionBulkTester {
 	public:
@@ -416,6 +420,13 @@ public:
 		 */
 		bool pointInCollection(const Coordinate& coordinate) const;
 
+		/**
+		 * tests many coordinates at once, using the threads of the TaskExecutor
+		 * @param coordinates the coordinates to test
+		 * @return for each coordinate, whether it is contained by at least one feature in polygonCollection
+		 */
+		std::vector<bool> pointsInCollection(const std::vector<Coordinate>& coordinates) const;
+
 		/**
 		 * compute the indexes of all features that spatially contain the given coordinate
 		 * @param coordinate the coordinate to test
@@ -424,12 +435,47 @@ public:
 		std::vector<uint32_t> polygonsContainingPoint(const Coordinate& coordinate) const;
 
 	private:
+		struct Box {
+			double x1, y1, x2, y2;
+			// a point on the lower border is outside, as it cannot cross any edge
+			bool contains(const Coordinate& c) const { return c.x >= x1 && c.x <= x2 && c.y > y1 && c.y <= y2; }
+		};
+		struct Ring {
+			uint32_t coordinateIndexStart, coordinateIndexStop;
+			Box box;
+			// the bands of the ring are described by bandOffsets[firstBand .. firstBand + bandCount]
+			uint32_t firstBand, bandCount;
+			double bandHeight;
+		};
+		struct Polygon {
+			uint32_t feature;
+			// the first ring is the outer ring, the others are holes
+			uint32_t firstRing, ringCount;
+		};
+		struct Node {
+			Box box;
+			// children are nodes, or for leaves entries of treePolygons
+			uint32_t firstChild, childCount;
+			bool leaf;
+		};
+
 		const PolygonCollection& polygonCollection;
 		std::vector<double> constants, multiples;
+		std::vector<Ring> rings;
+		std::vector<Polygon> polygons;
+		std::vector<uint32_t> bandOffsets, bandEdges;
+		std::vector<Node> nodes;
+		std::vector<uint32_t> treePolygons;
 
 		void performPrecalculation();
 		void precalculateRing(size_t coordinateIndexStart, size_t coordinateIndexStop);
-		bool pointInRing(const Coordinate& coordinate, size_t coordinateIndexStart, size_t coordinateIndexStop) const;
+		void buildBands(Ring &ring);
+		void buildTree();
+		bool pointInRing(const Coordinate& coordinate, const Ring& ring) const;
+		bool pointInPolygon(const Coordinate& coordinate, const Polygon& polygon) const;
+		// calls callback for all polygons whose bounding box contains the coordinate, until it returns false
+		template<typename Callback>
+		void findPolygons(const Coordinate& coordinate, Callback callback) const;
 	};
 
 public:
@@ -88,9 +88,15 @@ template<typename T> class Raster2D;
 
 class GenericRaster : public GridSpatioTemporalResult {
 	public:
+		/*
+		 * A VIEW shares the buffer of the raster it was cut, flipped or fitted from. Reading it with
+		 * getData() or setRepresentation(CPU) copies its pixels into a buffer of its own.
+		 * Writing to the source of a view copies the source's buffer, so the view keeps its pixels.
+		 */
 		enum Representation {
 			CPU = 1,
-			OPENCL = 2
+			OPENCL = 2,
+			VIEW = 3
 		};
 
 		virtual void setRepresentation(Representation r) = 0;
@@ -115,8 +121,11 @@ class GenericRaster : public GridSpatioTemporalResult {
 
 		virtual void toPGM(const char *filename, bool avg = false) = 0;
 		virtual void toYUV(const char *filename) = 0;
-		virtual void toPNG(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, Raster2D<uint8_t> *overlay = nullptr) = 0;
-		virtual void toJPEG(const char *filename, const Colorizer &colorizer, bool flipx = false, bool flipy = false) = 0;
+		// compression is the zlib level from 0 (fastest) to 9 (smallest), -1 for the default
+		virtual void toPNG(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, Raster2D<uint8_t> *overlay = nullptr, int compression = -1) = 0;
+		// quality ranges from 0 to 100, -1 for the default. JPEG blends transparent colors onto the background (0xAABBGGRR)
+		virtual void toJPEG(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, int quality = -1, uint32_t background = 0xffffffff) = 0;
+		virtual void toWebP(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, int quality = -1) = 0;
 		virtual void toGDAL(const char *filename, const char *driver, bool flipx = false, bool flipy = false) = 0;
 
 		virtual const void *getData() = 0;
@@ -134,6 +143,8 @@ class GenericRaster : public GridSpatioTemporalResult {
 		virtual std::unique_ptr<GenericRaster> scale(int width, int height=0, int depth=0) = 0;
 		virtual std::unique_ptr<GenericRaster> flip(bool flipx, bool flipy) = 0;
 		virtual std::unique_ptr<GenericRaster> fitToQueryRectangle(const QueryRectangle &qrect) = 0;
+		// like fitToQueryRectangle, but averages all pixels whose centers lie inside a target pixel, ignoring no_data
+		virtual std::unique_ptr<GenericRaster> downsample(const QueryRectangle &qrect) = 0;
 
 		virtual void print(int x, int y, double value, const char *text, int maxlen = -1) = 0;
 		virtual void printCentered(double value, const char *text);
@@ -1,124 +1,136 @@
 
 #include "datatypes/raster/raster_priv.h"
 #include "datatypes/raster/typejuggling.h"
+#include "datatypes/raster/palette.h"
 #include "datatypes/colorizer.h"
 
-
 #include <jpeglib.h>
+#include <setjmp.h>
 #include <stdio.h>
+#include <memory>
+#include <vector>
+
+
+/*
+ * libjpeg destination manager writing into a std::ostream, so the image can be
+ * streamed into a response without a temporary file.
+ */
+static const size_t JPEG_BUFFER_SIZE = 64 * 1024;
+
+struct JPEGStreamDestination {
+	struct jpeg_destination_mgr pub;
+	std::ostream *output;
+	JOCTET buffer[JPEG_BUFFER_SIZE];
+};
+
+static void jpeg_stream_init(j_compress_ptr cinfo) {
+	auto dest = (JPEGStreamDestination *) cinfo->dest;
+	dest->pub.next_output_byte = dest->buffer;
+	dest->pub.free_in_buffer = JPEG_BUFFER_SIZE;
+}
 
+static boolean jpeg_stream_empty(j_compress_ptr cinfo) {
+	// libjpeg expects the whole buffer to be written, regardless of free_in_buffer
+	auto dest = (JPEGStreamDestination *) cinfo->dest;
+	dest->output->write((const char *) dest->buffer, JPEG_BUFFER_SIZE);
+	dest->pub.next_output_byte = dest->buffer;
+	dest->pub.free_in_buffer = JPEG_BUFFER_SIZE;
+	return TRUE;
+}
 
-// adopted from http://svn.code.sf.net/p/libjpeg-turbo/code/trunk/example.c
-// TODO: Error handling
-template<typename T> void Raster2D<T>::toJPEG(const char *filename, const Colorizer &colorizer, bool flipx, bool flipy) {
-	const int quality = 95;
+static void jpeg_stream_term(j_compress_ptr cinfo) {
+	auto dest = (JPEGStreamDestination *) cinfo->dest;
+	dest->output->write((const char *) dest->buffer, JPEG_BUFFER_SIZE - dest->pub.free_in_buffer);
+}
 
-	throw ConverterException("toJPEG currently broken; do not use");
-	// The Colorizers have changed.
-#if 0
-	if (!RasterTypeInfo<T>::isinteger)
-		throw MetadataException("toJPEG cannot write float rasters");
-	if (lcrs.dimensions != 2)
-		throw MetadataException("toJPEG can only handle rasters with 2 dimensions");
+/*
+ * libjpeg's default error handler exits the process, so errors jump back into toJPEG instead
+ */
+struct JPEGErrorHandler {
+	struct jpeg_error_mgr pub;
+	jmp_buf jump;
+	char message[JMSG_LENGTH_MAX];
+};
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+	auto handler = (JPEGErrorHandler *) cinfo->err;
+	(*cinfo->err->format_message)(cinfo, handler->message);
+	longjmp(handler->jump, 1);
+}
 
-	this->setRepresentation(GenericRaster::Representation::CPU);
 
-	FILE *file = nullptr;
-	if (filename != nullptr) {
-		file = fopen(filename, "w");
-		if (!file)
-			throw ExporterException("Could not write to file");
+template<typename T> void Raster2D<T>::toJPEG(std::ostream &output, const Colorizer &colorizer, bool flipx, bool flipy, int quality, uint32_t background) {
+	if (quality == -1)
+		quality = 90;
+	if (quality < 0 || quality > 100)
+		throw ArgumentException(concat("Invalid JPEG quality: ", quality));
+	if (width == 0 || height == 0)
+		throw ExporterException("Cannot write an empty JPEG");
+
+	this->setRepresentationForReading();
+
+	color_t colors[256];
+	double actual_min, actual_max;
+	fill_raster_palette(colorizer, dd, colors, actual_min, actual_max);
+
+	// JPEG has no alpha channel, so the palette is blended onto the background
+	JSAMPLE palette[256][3];
+	for (int i=0;i<256;i++) {
+		uint32_t alpha = (colors[i] >> 24) & 0xff;
+		for (int c=0;c<3;c++) {
+			uint32_t fg = (colors[i] >> (8*c)) & 0xff;
+			uint32_t bg = (background >> (8*c)) & 0xff;
+			palette[i][c] = (fg * alpha + bg * (255 - alpha) + 127) / 255;
+		}
 	}
 
-	T max = dd.max;
-	T min = dd.min;
-	auto range = RasterTypeInfo<T>::getRange(min, max);
-
-	colorizer.setRange(range);
+	PaletteQuantizer<T> quantizer(dd, actual_min, actual_max, (size_t) width * height);
+	std::vector<uint8_t> indices(width);
+	std::vector<T> scratch;
+	std::vector<JSAMPLE> row(3 * (size_t) width);
+	auto dest = std::make_unique<JPEGStreamDestination>();
+	dest->output = &output;
+	dest->pub.init_destination = jpeg_stream_init;
+	dest->pub.empty_output_buffer = jpeg_stream_empty;
+	dest->pub.term_destination = jpeg_stream_term;
 
 	struct jpeg_compress_struct cinfo;
-	struct jpeg_error_mgr jerr;
-	JSAMPROW row_pointer[1];
+	JPEGErrorHandler error_handler;
+	cinfo.err = jpeg_std_error(&error_handler.pub);
+	error_handler.pub.error_exit = jpeg_error_exit;
+	// Nothing with a destructor may be created between here and the last libjpeg call
+	if (setjmp(error_handler.jump)) {
+		jpeg_destroy_compress(&cinfo);
+		throw ExporterException(concat("libjpeg failed to write the image: ", error_handler.message));
+	}
 
-	cinfo.err = jpeg_std_error(&jerr);
 	jpeg_create_compress(&cinfo);
-
-	jpeg_stdio_dest(&cinfo, filename != nullptr ? file : stdout);
-
-	int width = lcrs.size[0];
-	int height = lcrs.size[1];
-
+	cinfo.dest = &dest->pub;
 	cinfo.image_width = width;
 	cinfo.image_height = height;
-	/*
-	if (bpp == 8) {
-		cinfo.input_components = 1;
-		cinfo.in_color_space = JCS_GRAYSCALE; // I wish we had alpha. Oh well.
-	}
-	else if (bpp == 32) */ {
-		cinfo.input_components = 3;
-		cinfo.in_color_space = JCS_RGB; // I wish we had alpha. Oh well.
-	}
-
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
 	jpeg_set_defaults(&cinfo);
-
 	jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
-
-
 	jpeg_start_compress(&cinfo, TRUE);
 
-	/*if (bpp == 8) {
-		int row_stride = width;
-		JSAMPLE *row = new JSAMPLE[ row_stride ];
-		while (cinfo.next_scanline < cinfo.image_height) {
-			int y = cinfo.next_scanline;
-			int py = flipy ? height-y : y;
-			for (int x=0;x<width;x++) {
-				int px = flipx ? width-x : x;
-				JSAMPLE color = colorizer.colorize8(get(px, py) - dd.min);
-				if (x == 0 || y == 0 || x == width-1 || y == height-1)
-					color = 255;
-				row[x] = color;
-			}
-			row_pointer[0] = row;
-			(void) jpeg_write_scanlines(&cinfo, row_pointer, 1);
+	JSAMPROW row_pointer[1] = { row.data() };
+	while (cinfo.next_scanline < cinfo.image_height) {
+		uint32_t y = cinfo.next_scanline;
+		uint32_t py = flipy ? height-y-1 : y;
+		quantizer.quantize(getRow(py, scratch), indices.data(), width);
+		for (uint32_t x=0;x<width;x++) {
+			const JSAMPLE *color = palette[indices[flipx ? width-x-1 : x]];
+			row[3*x  ] = color[0];
+			row[3*x+1] = color[1];
+			row[3*x+2] = color[2];
 		}
-		delete [] row;
-	}
-	else if (bpp == 32) */{
-		int row_stride = width * 3;
-		JSAMPLE *row = new JSAMPLE[ row_stride ];
-		while (cinfo.next_scanline < cinfo.image_height) {
-			int y = cinfo.next_scanline;
-			int py = flipy ? height-y-1 : y;
-			for (int x=0;x<width;x++) {
-				int px = flipx ? width-x-1 : x;
-				uint32_t color = colorizer.colorize(get(px, py) - dd.min);
-				if (x == 0 || y == 0 || x == width-1 || y == height-1)
-					color = color_from_rgba(255,0,0,255);
-				row[3*x  ] = (color >>  0) & 0xff; // red
-				row[3*x+1] = (color >>  8) & 0xff; // green
-				row[3*x+2] = (color >> 16) & 0xff; // blue
-				// no alpha :(
-			}
-			row_pointer[0] = row;
-			(void) jpeg_write_scanlines(&cinfo, row_pointer, 1);
-		}
-		delete [] row;
+		jpeg_write_scanlines(&cinfo, row_pointer, 1);
 	}
 
 	jpeg_finish_compress(&cinfo);
-
-	if (filename != nullptr)
-		fclose(file);
-
 	jpeg_destroy_compress(&cinfo);
-#endif
 }
 
 
-template<> void Raster2D<float>::toJPEG(const char *, const Colorizer &, bool, bool) {
-	throw ConverterException("toJPEG cannot write float rasters");
-}
-
 RASTER_PRIV_INSTANTIATE_ALL
@@ -1,23 +1,194 @@
 
 #include "datatypes/raster/raster_priv.h"
 #include "datatypes/raster/typejuggling.h"
+#include "datatypes/raster/palette.h"
 #include "datatypes/colorizer.h"
 
-#include <png.h>
-#include <stdio.h>
+#include "util/task_executor.h"
+
+#include <zlib.h>
+#include <string.h>
 #include <sstream>
+#include <algorithm>
 #include <cmath>
-#include <limits>
+#include <functional>
+#include <vector>
 
 
-static void png_write_wrapper(png_structp png_ptr, png_bytep data, png_size_t length) {
-	std::ostream *stream = (std::ostream *) png_get_io_ptr(png_ptr);
-	stream->write((const char *) data, length);
+/*
+ * PNG encoding
+ *
+ * Rows are quantized into palette indices, filtered and deflated in strips of about
+ * STRIP_BYTES on the TaskExecutor. Like pigz, every strip is a separate raw deflate stream
+ * ending on a byte boundary, so the strips can simply be concatenated into one zlib stream.
+ */
+static const size_t STRIP_BYTES = 128 * 1024;
+
+static void write_uint32(std::ostream &output, uint32_t value) {
+	char bytes[4] = { (char) (value >> 24), (char) (value >> 16), (char) (value >> 8), (char) value };
+	output.write(bytes, 4);
 }
 
+static void write_chunk(std::ostream &output, const char *type, const uint8_t *data, size_t length) {
+	write_uint32(output, length);
+	output.write(type, 4);
+	output.write((const char *) data, length);
+	uLong crc = crc32(0, (const Bytef *) type, 4);
+	// crc32() resets the checksum when called with a null pointer
+	if (length > 0)
+		crc = crc32(crc, data, length);
+	write_uint32(output, crc);
+}
 
-template<typename T> void Raster2D<T>::toPNG(std::ostream &output, const Colorizer &colorizer, bool flipx, bool flipy, Raster2D<uint8_t> *overlay) {
-	this->setRepresentation(GenericRaster::Representation::CPU);
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+	int p = (int) a + b - c;
+	int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc)
+		return a;
+	return pb <= pc ? b : c;
+}
+
+/*
+ * Writes the filter type and the filtered row to out. Like libpng with
+ * PNG_FILTER_NONE | PNG_FILTER_PAETH, the filter with the smallest sum of
+ * absolute differences is chosen.
+ */
+static void filter_row(const uint8_t *prev, const uint8_t *cur, uint32_t width, uint8_t *out) {
+	uint8_t *filtered = out + 1;
+	uint64_t sum_none = 0, sum_paeth = 0;
+	for (uint32_t x=0;x<width;x++) {
+		uint8_t predicted = x == 0 ? paeth(0, prev[0], 0) : paeth(cur[x-1], prev[x], prev[x-1]);
+		filtered[x] = cur[x] - predicted;
+		sum_none += cur[x] < 128 ? cur[x] : 256 - cur[x];
+		sum_paeth += filtered[x] < 128 ? filtered[x] : 256 - filtered[x];
+	}
+	if (sum_none <= sum_paeth) {
+		out[0] = 0;
+		memcpy(filtered, cur, width);
+	}
+	else
+		out[0] = 4;
+}
+
+struct DeflatedStrip {
+	std::vector<uint8_t> data;
+	uLong adler;
+	size_t raw_length;
+};
+
+static DeflatedStrip deflate_strip(uint32_t width, uint32_t y1, uint32_t y2, bool last, int compression,
+		const std::function<void(uint32_t, uint8_t *)> &produce_row) {
+	std::vector<uint8_t> prev(width, 0), cur(width);
+	if (y1 > 0)
+		produce_row(y1-1, prev.data());
+
+	size_t stride = (size_t) width + 1;
+	std::vector<uint8_t> raw(stride * (y2-y1));
+	for (uint32_t y=y1;y<y2;y++) {
+		produce_row(y, cur.data());
+		filter_row(prev.data(), cur.data(), width, &raw[(y-y1) * stride]);
+		std::swap(prev, cur);
+	}
+
+	DeflatedStrip result;
+	result.raw_length = raw.size();
+	result.adler = adler32(adler32(0, nullptr, 0), raw.data(), raw.size());
+
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, compression, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		throw ExporterException("Could not initialize zlib");
+	// a sync flush adds at most 5 bytes per 16k, plus its own 5 byte marker
+	result.data.resize(deflateBound(&zs, raw.size()) + raw.size() / 16384 * 5 + 16);
+	zs.next_in = raw.data();
+	zs.avail_in = raw.size();
+	zs.next_out = result.data.data();
+	zs.avail_out = result.data.size();
+	int res = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+	bool complete = last ? res == Z_STREAM_END : (res == Z_OK && zs.avail_in == 0 && zs.avail_out > 0);
+	result.data.resize(zs.total_out);
+	deflateEnd(&zs);
+	if (!complete)
+		throw ExporterException("zlib failed to compress a PNG strip");
+	return result;
+}
+
+/*
+ * Writes an 8 bit palette PNG, with the rows provided by produce_row. produce_row
+ * is called concurrently and possibly more than once per row.
+ */
+static void write_palette_png(std::ostream &output, uint32_t width, uint32_t height, const uint32_t colors[256],
+		int compression, const std::function<void(uint32_t, uint8_t *)> &produce_row) {
+	if (width == 0 || height == 0)
+		throw ExporterException("Cannot write an empty PNG");
+	if (compression < Z_DEFAULT_COMPRESSION || compression > Z_BEST_COMPRESSION)
+		throw ArgumentException(concat("Invalid PNG compression level: ", compression));
+
+	// Start compressing all strips
+	uint32_t strip_rows = std::max<size_t>(1, STRIP_BYTES / ((size_t) width + 1));
+	auto &executor = TaskExecutor::get_instance();
+	std::vector<TaskFuture<DeflatedStrip>> strips;
+	strips.reserve((height + strip_rows - 1) / strip_rows);
+	for (uint32_t y=0;y<height;y+=strip_rows) {
+		uint32_t y2 = std::min(height, y + strip_rows);
+		strips.emplace_back(executor.submit([width, y, y2, height, compression, &produce_row]() {
+			return deflate_strip(width, y, y2, y2 == height, compression, produce_row);
+		}));
+	}
+
+	// Meanwhile write the headers
+	static const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	output.write((const char *) signature, 8);
+
+	uint8_t ihdr[13] = {
+		(uint8_t) (width >> 24), (uint8_t) (width >> 16), (uint8_t) (width >> 8), (uint8_t) width,
+		(uint8_t) (height >> 24), (uint8_t) (height >> 16), (uint8_t) (height >> 8), (uint8_t) height,
+		8, 3, 0, 0, 0 // bit depth, palette, deflate, adaptive filtering, no interlacing
+	};
+	write_chunk(output, "IHDR", ihdr, 13);
+
+	uint8_t plte[3*256], trns[256];
+	for (uint32_t i=0;i<256;i++) {
+		uint32_t c = colors[i];
+		plte[3*i]   = (c >>  0) & 0xff;
+		plte[3*i+1] = (c >>  8) & 0xff;
+		plte[3*i+2] = (c >> 16) & 0xff;
+		trns[i]     = (c >> 24) & 0xff;
+	}
+	write_chunk(output, "PLTE", plte, 3*256);
+	write_chunk(output, "tRNS", trns, 256);
+
+	// The zlib header announces the compression level
+	int level = compression == Z_DEFAULT_COMPRESSION ? 6 : compression;
+	uint8_t cmf = 0x78;
+	uint8_t flg = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+	flg += 31 - ((cmf << 8) + flg) % 31;
+
+	// One IDAT chunk per strip, in order
+	uLong adler = adler32(0, nullptr, 0);
+	std::vector<uint8_t> idat;
+	for (size_t i=0;i<strips.size();i++) {
+		DeflatedStrip strip = strips[i].get();
+		adler = adler32_combine(adler, strip.adler, strip.raw_length);
+
+		idat.clear();
+		if (i == 0) {
+			idat.push_back(cmf);
+			idat.push_back(flg);
+		}
+		idat.insert(idat.end(), strip.data.begin(), strip.data.end());
+		if (i == strips.size()-1) {
+			for (int shift = 24; shift >= 0; shift -= 8)
+				idat.push_back((adler >> shift) & 0xff);
+		}
+		write_chunk(output, "IDAT", idat.data(), idat.size());
+	}
+	write_chunk(output, "IEND", nullptr, 0);
+}
+
+
+template<typename T> void Raster2D<T>::toPNG(std::ostream &output, const Colorizer &colorizer, bool flipx, bool flipy, Raster2D<uint8_t> *overlay, int compression) {
+	this->setRepresentationForReading();
 
 	if (overlay) {
 		// do not use the overlay if the size does not match
@@ -41,20 +212,8 @@ template<typename T> void Raster2D<T>::toPNG(std::ostream &output, const Coloriz
 
 
 	uint32_t colors[256];
-	colors[0] = colorizer.getNoDataColor();
-	colors[1] = colorizer.getDefaultColor();
-
-    double actual_min = colorizer.minValue();
-    double actual_max = colorizer.maxValue();
-
-    unsigned int num_colors = 254;
-
-    if (dd.unit.isDiscrete()) {
-        // this assumes classes are consecutive
-        num_colors = actual_max - actual_min + 1;
-    }
-
-    colorizer.fillPalette(&colors[2], num_colors, actual_min, actual_max);
+	double actual_min, actual_max;
+	fill_raster_palette(colorizer, dd, colors, actual_min, actual_max);
 
 	if (overlay) {
 		std::ostringstream msg;
@@ -63,86 +222,22 @@ template<typename T> void Raster2D<T>::toPNG(std::ostream &output, const Coloriz
 	}
 
 
-	// prepare PNG output
-	png_structp png_ptr = png_create_write_struct(
-			PNG_LIBPNG_VER_STRING,
-			NULL, NULL, NULL
-			/*
-			(png_voidp) user_error_ptr,
-			user_error_fn,
-			user_warning_fn
-			*/
-	);
-	if (!png_ptr)
-		throw ExporterException("Could not initialize libpng");
-
-	png_infop info_ptr = png_create_info_struct(png_ptr);
-	if (!info_ptr) {
-		png_destroy_write_struct(&png_ptr, (png_infopp) NULL);
-		throw ExporterException("Could not initialize libpng");
-	}
-
-	// write into the provided ostream
-	png_set_write_fn(png_ptr, &output, png_write_wrapper, nullptr);
-
-	// start PNG output, headers first
-	png_set_IHDR(png_ptr, info_ptr,
-		width, height,
-		8, PNG_COLOR_TYPE_PALETTE,
-		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT
-	);
-
-	// transform into png_color array to set PLTE chunk
-	png_color colors_rgb[256];
-	png_byte colors_a[256];
-	for (uint32_t i=0;i<256;i++) {
-		uint32_t c = colors[i];
-		colors_rgb[i].red   = (c >>  0) & 0xff;
-		colors_rgb[i].green = (c >>  8) & 0xff;
-		colors_rgb[i].blue  = (c >> 16) & 0xff;
-		colors_a[i]         = (c >> 24) & 0xff;
-	}
-	png_set_PLTE(png_ptr, info_ptr, colors_rgb, 256);
-	png_set_tRNS(png_ptr, info_ptr, colors_a, 256, nullptr);
-
-
-/*	if (bpp == 32) {
-		png_set_IHDR(png_ptr, info_ptr,
-			lcrs.size[0],  lcrs.size[1],
-			8, PNG_COLOR_TYPE_RGB_ALPHA,
-			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT
-		);
-	}*/
-
-	png_write_info(png_ptr, info_ptr);
-	png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE | PNG_FILTER_PAETH);
-
-	uint8_t *row = new uint8_t[ width ];
-	for (uint32_t y=0;y<height;y++) {
+	PaletteQuantizer<T> quantizer(dd, actual_min, actual_max, (size_t) width * height);
+	write_palette_png(output, width, height, colors, compression, [&](uint32_t y, uint8_t *row) {
 		uint32_t py = flipy ? height-y-1 : y;
-		for (uint32_t x=0;x<width;x++) {
-			uint32_t px = flipx ? width-x-1 : x;
-			T v = get(px, py);
-			if (overlay && overlay->get(x, y) == 1) {
-				row[x] = 1;
-			}
-			else if (dd.is_no_data(v)) {
-				row[x] = 0;
-			}
-			else if (v < actual_min || v > actual_max) {
-				row[x] = 1;
-			}
-			else {
-				if (actual_min == actual_max)
-					row[x] = 3;
-				else {
-					if(dd.unit.isDiscrete())
-						row[x] = v - actual_min + 2;
-					else
-						row[x] = round(253.0 * ((float) v - actual_min) / (actual_max - actual_min)) + 2;
+		std::vector<T> scratch;
+		quantizer.quantize(getRow(py, scratch), row, width);
+		if (flipx)
+			std::reverse(row, row + width);
+
+		if (overlay) {
+			for (uint32_t x=0;x<width;x++) {
+				if (overlay->get(x, y) == 1) {
+					row[x] = 1;
+					continue;
 				}
-			}
-			if (overlay && row[x] != 1) {
+				if (row[x] == 1)
+					continue;
 				// calculate the distance to the closest image border
 				int distx = std::min(x, width-1 - x);
 				int disty = std::min(y, height-1 - y);
@@ -151,38 +246,8 @@ template<typename T> void Raster2D<T>::toPNG(std::ostream &output, const Coloriz
 				else if (disty == 0 && (distx < 32 || distx > width/2-16))
 					row[x] = 1;
 			}
-
-		}
-		png_write_row(png_ptr, (png_bytep) row);
-	}
-	delete [] row;
-
-/*
-	else if (bpp == 32) {
-		T nodata = (T) dd.no_data;
-		uint32_t *row = new uint32_t[ width ];
-		for (int y=0;y<height;y++) {
-			int py = flipy ? height-y : y;
-			for (int x=0;x<width;x++) {
-				int px = flipx ? width-x : x;
-				T rawvalue = get(px, py);
-				uint32_t value = rawvalue - min;
-				if (dd.has_no_data && rawvalue == nodata)
-					row[x] = color_from_rgba(0,0,0,0);
-				else
-					row[x] = colorizer.colorize32(value);
-				if (x == 0 || y == 0 || x == width-1 || y == height-1)
-					row[x] = color_from_rgba(255,0,0,255); // 0xff0000ff;
-			}
-			png_write_row(png_ptr, (png_bytep) row);
 		}
-		delete [] row;
-	}
-*/
-
-	png_write_end(png_ptr, info_ptr);
-
-	png_destroy_write_struct(&png_ptr, &info_ptr);
+	});
 }
 
 
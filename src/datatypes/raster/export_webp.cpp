@@ -0,0 +1,82 @@
+
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/typejuggling.h"
+#include "datatypes/raster/palette.h"
+#include "datatypes/colorizer.h"
+
+#include <vector>
+
+#ifdef MAPPING_WITH_WEBP
+#include <webp/encode.h>
+
+/*
+ * Passes the encoded data to the output stream as soon as libwebp produces it
+ */
+static int webp_stream_writer(const uint8_t *data, size_t data_size, const WebPPicture *picture) {
+	auto output = (std::ostream *) picture->custom_ptr;
+	output->write((const char *) data, data_size);
+	return output->good() ? 1 : 0;
+}
+#endif
+
+
+template<typename T> void Raster2D<T>::toWebP(std::ostream &output, const Colorizer &colorizer, bool flipx, bool flipy, int quality) {
+#ifndef MAPPING_WITH_WEBP
+	throw ExporterException("toWebP is not available, mapping was built without libwebp");
+#else
+	if (quality == -1)
+		quality = 80;
+	if (quality < 0 || quality > 100)
+		throw ArgumentException(concat("Invalid WebP quality: ", quality));
+	if (width == 0 || height == 0)
+		throw ExporterException("Cannot write an empty WebP");
+
+	this->setRepresentationForReading();
+
+	color_t colors[256];
+	double actual_min, actual_max;
+	fill_raster_palette(colorizer, dd, colors, actual_min, actual_max);
+
+	// libwebp only encodes complete pictures, so the colorized image is built in memory
+	PaletteQuantizer<T> quantizer(dd, actual_min, actual_max, (size_t) width * height);
+	std::vector<uint8_t> indices(width);
+	std::vector<T> scratch;
+	std::vector<uint8_t> rgba(4 * (size_t) width * height);
+	for (uint32_t y=0;y<height;y++) {
+		uint32_t py = flipy ? height-y-1 : y;
+		quantizer.quantize(getRow(py, scratch), indices.data(), width);
+		uint8_t *row = &rgba[4 * (size_t) y * width];
+		for (uint32_t x=0;x<width;x++) {
+			color_t color = colors[indices[flipx ? width-x-1 : x]];
+			row[4*x  ] = (color >>  0) & 0xff;
+			row[4*x+1] = (color >>  8) & 0xff;
+			row[4*x+2] = (color >> 16) & 0xff;
+			row[4*x+3] = (color >> 24) & 0xff;
+		}
+	}
+
+	WebPConfig config;
+	WebPPicture picture;
+	if (!WebPConfigInit(&config) || !WebPPictureInit(&picture))
+		throw ExporterException("Incompatible libwebp version");
+	config.quality = quality;
+
+	picture.width = width;
+	picture.height = height;
+	if (!WebPPictureImportRGBA(&picture, rgba.data(), 4 * width)) {
+		WebPPictureFree(&picture);
+		throw ExporterException("libwebp could not import the image");
+	}
+	picture.writer = webp_stream_writer;
+	picture.custom_ptr = &output;
+
+	bool success = WebPEncode(&config, &picture);
+	int error_code = picture.error_code;
+	WebPPictureFree(&picture);
+	if (!success)
+		throw ExporterException(concat("libwebp failed to write the image, error code ", error_code));
+#endif
+}
+
+
+RASTER_PRIV_INSTANTIATE_ALL
@@ -4,6 +4,8 @@
 #include <stdio.h>
 
 template<typename T> void Raster2D<T>::toYUV(const char *filename) {
+	this->setRepresentation(GenericRaster::Representation::CPU);
+
 	if (!dd.unit.hasMinMax())
 		throw ConverterException("Cannot export as YUV because the unit does not have finite min/max");
 
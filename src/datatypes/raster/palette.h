@@ -0,0 +1,101 @@
+#ifndef RASTER_PALETTE_H
+#define RASTER_PALETTE_H 1
+
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/colorizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+
+/*
+ * Fills the 256 colors of a raster palette: 0 is the no data color, 1 the default color
+ * and 2-255 cover the colorizer's range, which is returned in min and max.
+ */
+inline void fill_raster_palette(const Colorizer &colorizer, const DataDescription &dd, color_t colors[256], double &min, double &max) {
+	colors[0] = colorizer.getNoDataColor();
+	colors[1] = colorizer.getDefaultColor();
+
+	min = colorizer.minValue();
+	max = colorizer.maxValue();
+
+	unsigned int num_colors = 254;
+	if (dd.unit.isDiscrete()) {
+		// this assumes classes are consecutive
+		num_colors = max - min + 1;
+	}
+
+	colorizer.fillPalette(&colors[2], num_colors, min, max);
+}
+
+
+/*
+ * Maps raster values to palette indices:
+ * 0 for no data, 1 for values outside the colorizer's range and 2-255 for the range itself.
+ * Small integer types use a lookup table over all possible values, if the raster is
+ * large enough to amortize building it. All other values are quantized by a
+ * branch-free loop the compiler can vectorize.
+ */
+template<typename T>
+class PaletteQuantizer {
+	public:
+		PaletteQuantizer(const DataDescription &dd, double min, double max, size_t num_pixels)
+			: dd(dd), min(min), max(max), scale(max > min ? 253.0 / (max - min) : 0), discrete(dd.unit.isDiscrete()) {
+			const size_t lut_size = (size_t) 1 << (8*std::min<size_t>(sizeof(T), 2));
+			if (std::is_integral<T>::value && sizeof(T) <= 2 && num_pixels >= lut_size / 2) {
+				lut.resize(lut_size);
+				for (size_t i=0;i<lut_size;i++) {
+					T v = (T) ((int64_t) i + std::numeric_limits<T>::min());
+					lut[i] = index_of(v);
+				}
+			}
+		}
+
+		void quantize(const T *src, uint8_t *dst, uint32_t width) const {
+			if (!lut.empty()) {
+				for (uint32_t x=0;x<width;x++)
+					dst[x] = lut[(int64_t) src[x] - std::numeric_limits<T>::min()];
+				return;
+			}
+
+			// discrete values are truncated, others rounded
+			const double factor = discrete ? 1 : scale;
+			const double offset = discrete ? 2 : 2.5;
+			const uint8_t single = max > min ? 0 : 3;
+			for (uint32_t x=0;x<width;x++) {
+				double v = src[x];
+				bool in_range = v >= min && v <= max;
+				double q = ((in_range ? v : min) - min) * factor + offset;
+				uint8_t idx = single ? single : (uint8_t) (int32_t) q;
+				dst[x] = in_range ? idx : 1;
+			}
+			if (dd.has_no_data) {
+				for (uint32_t x=0;x<width;x++)
+					if (dd.is_no_data(src[x]))
+						dst[x] = 0;
+			}
+		}
+
+	private:
+		uint8_t index_of(T v) const {
+			if (dd.is_no_data(v))
+				return 0;
+			if (!(v >= min && v <= max))
+				return 1;
+			if (min == max)
+				return 3;
+			if (discrete)
+				return v - min + 2;
+			return round(253.0 * ((double) v - min) / (max - min)) + 2;
+		}
+
+		const DataDescription &dd;
+		const double min, max, scale;
+		const bool discrete;
+		std::vector<uint8_t> lut;
+};
+
+#endif
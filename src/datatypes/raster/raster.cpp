@@ -12,6 +12,7 @@
 #include <cmath>
 #include <limits>
 #include <vector>
+#include <type_traits>
 #include <string>
 #include <sstream>
 
@@ -265,17 +266,55 @@ static void * alloc_aligned_buffer(size_t size) {
 	return data;
 }
 
+/*
+ * Allocates the pixels of a raster, followed by a guard value to detect buffer overflows
+ */
+template<typename T>
+static std::shared_ptr<T> alloc_raster_buffer(uint64_t count) {
+	size_t required_size = (count+1) * sizeof(T);
+	T *data = (T *) alloc_aligned_buffer(required_size);
+	//data = new T[count + 1];
+	data[count] = 42;
+
+	return std::shared_ptr<T>(data, [count] (T *data) {
+		if (data[count] != 42) {
+			printf("Error in Raster: guard value was overwritten. Memory corruption!\n");
+			exit(6);
+		}
+		free(data);
+		//delete [] data;
+	});
+}
+
+/*
+ * Copies the pixels of a strided layout into a contiguous buffer
+ */
+template<typename T>
+static void copy_strided(T *dest, const T *origin, ptrdiff_t row_stride, ptrdiff_t col_stride, uint32_t width, uint32_t height) {
+	for (uint32_t y=0;y<height;y++) {
+		const T *row = origin + y * row_stride;
+		T *dest_row = dest + (size_t) y * width;
+		if (col_stride == 1)
+			memcpy(dest_row, row, width * sizeof(T));
+		else {
+			for (uint32_t x=0;x<width;x++)
+				dest_row[x] = row[x * col_stride];
+		}
+	}
+}
+
 
 template<typename T, int dimensions>
 Raster<T, dimensions>::Raster(const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth)
-	: GenericRaster(datadescription, stref, width, height, depth), clhostptr(nullptr),clbuffer(nullptr), clbuffer_info(nullptr) {
-	auto count = getPixelCount();
-
-	size_t required_size = (count+1) * sizeof(T);
-	data = (T *) alloc_aligned_buffer(required_size);
-	//data = new T[count + 1];
+	: GenericRaster(datadescription, stref, width, height, depth), view_origin(nullptr), view_row_stride(0), view_col_stride(0), buffer_shared(false), clhostptr(nullptr),clbuffer(nullptr), clbuffer_info(nullptr) {
+	buffer = alloc_raster_buffer<T>(getPixelCount());
+	data = buffer.get();
+}
 
-	data[count] = 42;
+template<typename T, int dimensions>
+Raster<T, dimensions>::Raster(const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, std::shared_ptr<T> buffer, T *view_origin, ptrdiff_t view_row_stride, ptrdiff_t view_col_stride)
+	: GenericRaster(datadescription, stref, width, height, 0), data(nullptr), buffer(std::move(buffer)), view_origin(view_origin), view_row_stride(view_row_stride), view_col_stride(view_col_stride), buffer_shared(true), clhostptr(nullptr),clbuffer(nullptr), clbuffer_info(nullptr) {
+	representation = Representation::VIEW;
 }
 
 #define MAPPING_OPENCL_USE_HOST_PTR 1
@@ -303,16 +342,25 @@ Raster<T, dimensions>::~Raster() {
 	}
 #endif
 
-	if (data) {
-		if (data[getPixelCount()] != 42) {
-			printf("Error in Raster: guard value was overwritten. Memory corruption!\n");
-			exit(6);
-		}
+	// the guard value is checked when the last raster using the buffer releases it
+	data = nullptr;
+	buffer.reset();
+}
 
-		free(data);
-		//delete [] data;
-		data = nullptr;
+template<typename T, int dimensions>
+void Raster<T, dimensions>::detach() {
+	if (!buffer_shared)
+		return;
+
+	if (representation == Representation::VIEW) {
+		setRepresentation(Representation::CPU);
+		return;
 	}
+	auto copy = alloc_raster_buffer<T>(getPixelCount());
+	memcpy(copy.get(), data, getDataSize());
+	buffer = std::move(copy);
+	data = buffer.get();
+	buffer_shared = false;
 }
 
 
@@ -321,6 +369,11 @@ Raster2D<T>::Raster2D(const DataDescription &datadescription, const SpatioTempor
 	:Raster<T, 2>(datadescription, stref, width, height, depth) {
 }
 
+template<typename T>
+Raster2D<T>::Raster2D(const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, std::shared_ptr<T> buffer, T *view_origin, ptrdiff_t view_row_stride, ptrdiff_t view_col_stride)
+	:Raster<T, 2>(datadescription, stref, width, height, std::move(buffer), view_origin, view_row_stride, view_col_stride) {
+}
+
 
 template<typename T>
 Raster2D<T>::~Raster2D() {
@@ -330,6 +383,22 @@ template<typename T, int dimensions>
 void Raster<T, dimensions>::setRepresentation(Representation r) {
 	if (r == representation)
 		return;
+	if (representation == Representation::VIEW) {
+		if (r != Representation::CPU && r != Representation::OPENCL)
+			throw MetadataException("Invalid representation chosen");
+
+		// materialize the view into a buffer of its own
+		auto contiguous = alloc_raster_buffer<T>(getPixelCount());
+		copy_strided(contiguous.get(), view_origin, view_row_stride, view_col_stride, width, height);
+		buffer = std::move(contiguous);
+		data = buffer.get();
+		buffer_shared = false;
+		view_origin = nullptr;
+		view_row_stride = view_col_stride = 0;
+		representation = Representation::CPU;
+		if (r == Representation::CPU)
+			return;
+	}
 	if (r == Representation::OPENCL) {
 #ifdef MAPPING_NO_OPENCL
 		throw PlatformException("No OpenCL support");
@@ -338,6 +407,8 @@ void Raster<T, dimensions>::setRepresentation(Representation r) {
 		try {
 			//Profiler::Profiler p("migrate to GPU");
 #if MAPPING_OPENCL_USE_HOST_PTR
+			// kernels write into the host buffer, which must not change the views of this raster
+			detach();
 			clbuffer = new cl::Buffer(
 				*RasterOpenCL::getContext(),
 				CL_MEM_USE_HOST_PTR,
@@ -354,8 +425,7 @@ void Raster<T, dimensions>::setRepresentation(Representation r) {
 				nullptr //data
 			);
 			RasterOpenCL::getQueue()->enqueueWriteBuffer(*clbuffer, CL_TRUE, 0, getDataSize(), data);
-			//delete [] data;
-			free(data);
+			buffer.reset();
 			data = nullptr;
 #endif
 		}
@@ -378,11 +448,8 @@ void Raster<T, dimensions>::setRepresentation(Representation r) {
 			RasterOpenCL::getQueue()->enqueueUnmapMemObject(*clbuffer, clhostptr);
 			clhostptr = nullptr;
 #else
-			auto count = getPixelCount();
-			size_t required_size = (count+1) * sizeof(T);
-			data = (T *) alloc_aligned_buffer(required_size);
-			//data = new T[count + 1];
-			data[count] = 42;
+			buffer = alloc_raster_buffer<T>(getPixelCount());
+			data = buffer.get();
 
 			RasterOpenCL::getQueue()->enqueueReadBuffer(*clbuffer, CL_TRUE, 0, getDataSize(), data);
 #endif
@@ -410,6 +477,7 @@ void Raster2D<T>::clear(double _value) {
 	T value = (T) _value;
 
 	setRepresentation(GenericRaster::Representation::CPU);
+	detach();
 	auto size = getPixelCount();
 	for (decltype(size) i=0;i<size;i++) {
 		data[i] = value;
@@ -426,7 +494,8 @@ void Raster2D<T>::blit(const GenericRaster *genericraster, int destx, int desty,
 		throw MetadataException("blit of raster with different coordinate system");
 
 	setRepresentation(GenericRaster::Representation::CPU);
-	if (genericraster->getRepresentation() != GenericRaster::Representation::CPU)
+	detach();
+	if (genericraster->getRepresentation() != GenericRaster::Representation::CPU && genericraster->getRepresentation() != GenericRaster::Representation::VIEW)
 		throw MetadataException("blit from raster that's not in a CPU buffer");
 
 	Raster2D<T> *raster = (Raster2D<T> *) genericraster;
@@ -451,10 +520,11 @@ void Raster2D<T>::blit(const GenericRaster *genericraster, int destx, int desty,
 		}
 #elif BLIT_TYPE == 2 // 0.0246
 	int blitwidth = x2-x1;
+	std::vector<T> scratch;
 	for (int y=y1;y<y2;y++) {
 		int rowoffset_dest = y * this->width + x1;
-		int rowoffset_src = (y-desty) * raster->width + (x1-destx);
-		memcpy(&data[rowoffset_dest], &raster->data[rowoffset_src], blitwidth * sizeof(T));
+		const T *row_src = raster->getRow(y-desty, scratch);
+		memcpy(&data[rowoffset_dest], &row_src[x1-destx], blitwidth * sizeof(T));
 	}
 #else // 0.031
 	int blitwidth = x2-x1;
@@ -485,34 +555,11 @@ std::unique_ptr<GenericRaster> Raster2D<T>::cut(int x1, int y1, int z1, int widt
 		TemporalReference(stref)
 	);
 
-	auto outputraster_guard = GenericRaster::create(dd, newstref, width, height);
-	Raster2D<T> *outputraster = (Raster2D<T> *) outputraster_guard.get();
-
-#define CUT_TYPE 2
-#if CUT_TYPE == 1 // 0.0286
-	for (int y=0;y<height;y++)
-		for (int x=0;x<width;x++)
-			outputraster->set(x, y, getSafe(x+x1, y+y1));
-#elif CUT_TYPE == 2 // 0.0246
-	for (int y=0;y<height;y++) {
-		size_t rowoffset_src = (size_t) (y+y1) * width + x1;
-		size_t rowoffset_dest = (size_t) y * width;
-		memcpy(&outputraster->data[rowoffset_dest], &data[rowoffset_src], width * sizeof(T));
-	}
-/*
-#else // 0.031
-	int blitwidth = x2-x1;
-	for (int y=y1;y<y2;y++) {
-		int rowoffset_dest = y * this->width + x1;
-		int rowoffset_src = y * raster->width + x1;
-		for (int x=0;x<blitwidth;x++)
-			data[rowoffset_dest+x] = raster->data[rowoffset_src+x];
-	}
-*/
-#endif
-
-	outputraster_guard->global_attributes = this->global_attributes;
-	return outputraster_guard;
+	// the cut is a view of this raster's buffer, copied only when it is written
+	T *origin;
+	ptrdiff_t row_stride, col_stride;
+	getLayout(origin, row_stride, col_stride);
+	return createView(newstref, width, height, origin + y1 * row_stride + x1 * col_stride, row_stride, col_stride);
 }
 
 template<typename T>
@@ -557,21 +604,19 @@ std::unique_ptr<GenericRaster> Raster2D<T>::scale(int width, int height, int dep
 
 template<typename T>
 std::unique_ptr<GenericRaster> Raster2D<T>::flip(bool flipx, bool flipy) {
-	auto flipped_raster = GenericRaster::create(dd, *this);
-	Raster2D<T> *r = (Raster2D<T> *) flipped_raster.get();
-
-	setRepresentation(GenericRaster::Representation::CPU);
-
-	for (uint32_t y=0;y<height;y++) {
-		uint32_t py = flipy ? height-y-1 : y;
-		for (uint32_t x=0;x<width;x++) {
-			uint32_t px = flipx ? width-x-1 : x;
-			r->set(x, y, get(px, py));
-		}
+	// a view starting at the opposite border and walking backwards
+	T *origin;
+	ptrdiff_t row_stride, col_stride;
+	getLayout(origin, row_stride, col_stride);
+	if (flipx) {
+		origin += (ptrdiff_t) (width-1) * col_stride;
+		col_stride = -col_stride;
 	}
-
-	flipped_raster->global_attributes = this->global_attributes;
-	return flipped_raster;
+	if (flipy) {
+		origin += (ptrdiff_t) (height-1) * row_stride;
+		row_stride = -row_stride;
+	}
+	return createView(stref, width, height, origin, row_stride, col_stride);
 }
 
 
@@ -609,6 +654,75 @@ private:
 
 template<typename T>
 std::unique_ptr<GenericRaster> Raster2D<T>::fitToQueryRectangle(const QueryRectangle &qrect) {
+	// adjust sref and resolution, but keep the tref.
+	QueryRectangle target(qrect, stref, qrect);
+	GridSpatioTemporalResult grid(target, target.xres, target.yres);
+
+	T *origin;
+	ptrdiff_t row_stride, col_stride;
+	getLayout(origin, row_stride, col_stride);
+
+	GridSpatioTemporalResultProjecter p(*this, grid);
+	std::vector<int64_t> xs(grid.width), ys(grid.height);
+	for (uint32_t x=0;x<grid.width;x++)
+		xs[x] = p.getX(x);
+	for (uint32_t y=0;y<grid.height;y++)
+		ys[y] = p.getY(y);
+
+	// When every target pixel maps to the next source pixel inside this raster, the result is a view
+	auto isContiguous = [] (const std::vector<int64_t> &pixels, uint32_t size) {
+		int64_t step = pixels.size() > 1 ? pixels[1] - pixels[0] : 1;
+		if (step != 1 && step != -1)
+			return false;
+		for (size_t i=0;i<pixels.size();i++) {
+			if (pixels[i] != pixels[0] + (int64_t) i * step || pixels[i] < 0 || pixels[i] >= size)
+				return false;
+		}
+		return true;
+	};
+	if (isContiguous(xs, width) && isContiguous(ys, height)) {
+		ptrdiff_t step_x = grid.width > 1 ? xs[1] - xs[0] : 1;
+		ptrdiff_t step_y = grid.height > 1 ? ys[1] - ys[0] : 1;
+		return createView(grid.stref, grid.width, grid.height, origin + ys[0] * row_stride + xs[0] * col_stride, step_y * row_stride, step_x * col_stride);
+	}
+
+	auto out = GenericRaster::create(dd, target, target.xres, target.yres);
+	Raster2D<T> *r = (Raster2D<T> *) out.get();
+
+	for (uint32_t y=0;y<r->height;y++) {
+		//auto py = this->WorldToPixelY( r->PixelToWorldY(y) );
+		auto py = ys[y];
+		bool row_inside = py >= 0 && py < height;
+		for (uint32_t x=0;x<r->width;x++) {
+			//auto px = this->WorldToPixelX( r->PixelToWorldX(x) );
+			auto px = xs[x];
+			if (row_inside && px >= 0 && px < width)
+				r->set(x, y, origin[py * row_stride + px * col_stride]);
+			else
+				r->set(x, y, 0);
+		}
+	}
+
+	out->global_attributes = this->global_attributes;
+	return out;
+}
+
+/*
+ * Returns the range of source pixels whose centers lie inside each destination pixel.
+ * The pixels of destination pixel i are [bounds[i], bounds[i+1]).
+ */
+static std::vector<int64_t> getSourcePixelBounds(double src_origin, double src_scale, uint32_t src_size, double dest_origin, double dest_scale, uint32_t dest_size) {
+	std::vector<int64_t> bounds(dest_size+1);
+	for (uint32_t i=0;i<=dest_size;i++) {
+		double border = dest_origin + i * dest_scale;
+		int64_t p = std::ceil( (border - src_origin) / src_scale - 0.5 );
+		bounds[i] = std::min<int64_t>( std::max<int64_t>(p, 0), src_size );
+	}
+	return bounds;
+}
+
+template<typename T>
+std::unique_ptr<GenericRaster> Raster2D<T>::downsample(const QueryRectangle &qrect) {
 	setRepresentation(GenericRaster::Representation::CPU);
 
 	// adjust sref and resolution, but keep the tref.
@@ -617,14 +731,35 @@ std::unique_ptr<GenericRaster> Raster2D<T>::fitToQueryRectangle(const QueryRecta
 	auto out = GenericRaster::create(dd, target, target.xres, target.yres);
 	Raster2D<T> *r = (Raster2D<T> *) out.get();
 
+	auto xs = getSourcePixelBounds(stref.x1, pixel_scale_x, width, r->stref.x1, r->pixel_scale_x, r->width);
+	auto ys = getSourcePixelBounds(stref.y1, pixel_scale_y, height, r->stref.y1, r->pixel_scale_y, r->height);
+
+	T nodata = dd.has_no_data ? (T) dd.no_data : 0;
+	// pixels without a source pixel inside (when upsampling or at the borders) get the nearest one
 	GridSpatioTemporalResultProjecter p(*this, *out);
 	for (uint32_t y=0;y<r->height;y++) {
-		//auto py = this->WorldToPixelY( r->PixelToWorldY(y) );
-		auto py = p.getY(y);
 		for (uint32_t x=0;x<r->width;x++) {
-			//auto px = this->WorldToPixelX( r->PixelToWorldX(x) );
-			auto px = p.getX(x);
-			r->set(x, y, getSafe(px, py));
+			if (xs[x] == xs[x+1] || ys[y] == ys[y+1]) {
+				r->set(x, y, getSafe(p.getX(x), p.getY(y), nodata));
+				continue;
+			}
+			double sum = 0;
+			size_t count = 0;
+			for (auto py=ys[y];py<ys[y+1];py++) {
+				for (auto px=xs[x];px<xs[x+1];px++) {
+					T value = get(px, py);
+					if (dd.is_no_data(value))
+						continue;
+					sum += value;
+					count++;
+				}
+			}
+			if (count == 0)
+				r->set(x, y, nodata);
+			else if (std::is_integral<T>::value)
+				r->set(x, y, (T) std::round(sum / count));
+			else
+				r->set(x, y, (T) (sum / count));
 		}
 	}
 
@@ -637,6 +772,48 @@ double Raster2D<T>::getAsDouble(int x, int y, int) const {
 	return (double) get(x, y);
 }
 
+template<typename T>
+void Raster2D<T>::setRepresentationForReading() {
+	if (representation != GenericRaster::Representation::VIEW)
+		setRepresentation(GenericRaster::Representation::CPU);
+}
+
+template<typename T>
+const T *Raster2D<T>::getRow(uint32_t y, std::vector<T> &scratch) const {
+	if (representation != GenericRaster::Representation::VIEW)
+		return &data[(size_t) y * width];
+
+	const T *row = view_origin + y * view_row_stride;
+	if (view_col_stride == 1)
+		return row;
+	scratch.resize(width);
+	for (uint32_t x=0;x<width;x++)
+		scratch[x] = row[x * view_col_stride];
+	return scratch.data();
+}
+
+template<typename T>
+void Raster2D<T>::getLayout(T *&origin, ptrdiff_t &row_stride, ptrdiff_t &col_stride) {
+	if (representation == GenericRaster::Representation::VIEW) {
+		origin = view_origin;
+		row_stride = view_row_stride;
+		col_stride = view_col_stride;
+		return;
+	}
+	setRepresentation(GenericRaster::Representation::CPU);
+	origin = data;
+	row_stride = width;
+	col_stride = 1;
+}
+
+template<typename T>
+std::unique_ptr<GenericRaster> Raster2D<T>::createView(const SpatioTemporalReference &stref, uint32_t width, uint32_t height, T *origin, ptrdiff_t row_stride, ptrdiff_t col_stride) {
+	buffer_shared = true;
+	auto view = std::unique_ptr<GenericRaster>(new Raster2D<T>(dd, stref, width, height, buffer, origin, row_stride, col_stride));
+	view->global_attributes = this->global_attributes;
+	return view;
+}
+
 
 
 #include "raster_font.h"
@@ -648,6 +825,7 @@ void Raster2D<T>::print(int dest_x, int dest_y, double dvalue, const char *text,
 	T value = (T) dvalue;
 
 	this->setRepresentation(GenericRaster::CPU);
+	detach();
 
 	for (;maxlen > 0 && *text;text++, maxlen--) {
 		int src_x = (*text % 16) * 8;
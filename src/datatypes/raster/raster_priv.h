@@ -3,6 +3,9 @@
 
 #include "datatypes/raster.h"
 
+#include <atomic>
+#include <vector>
+
 /**
  * Base class for n dimensional rasters
  */
@@ -17,17 +20,37 @@ template<typename T, int dimensions> class Raster : public GenericRaster {
 		virtual void setRepresentation(Representation);
 
 		virtual const void *getData() { setRepresentation(GenericRaster::Representation::CPU); return (void *) data; };
-		virtual void *getDataForWriting() { setRepresentation(GenericRaster::Representation::CPU); return (void *) data; };
+		virtual void *getDataForWriting() { setRepresentation(GenericRaster::Representation::CPU); detach(); return (void *) data; };
 
 		virtual cl::Buffer *getCLBuffer() { return clbuffer; };
 		virtual cl::Buffer *getCLInfoBuffer() { return clbuffer_info; };
 
 		virtual size_t get_byte_size() const {
-			return GenericRaster::get_byte_size() + getDataSize() + sizeof(T*) + sizeof(void*) + 2*sizeof(cl::Buffer*);
+			return GenericRaster::get_byte_size() + getDataSize() + 2*sizeof(T*) + sizeof(std::shared_ptr<T>) + 2*sizeof(ptrdiff_t) + sizeof(void*) + 2*sizeof(cl::Buffer*);
 		}
 
 	protected:
+		/**
+		 * Creates a view of the pixels of another raster, see Representation::VIEW
+		 */
+		Raster(const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, std::shared_ptr<T> buffer, T *view_origin, ptrdiff_t view_row_stride, ptrdiff_t view_col_stride);
+
+		/**
+		 * Copies the buffer if views of this raster share it, so writing does not change the views.
+		 * A view is materialized into a buffer of its own and changes to the CPU representation.
+		 * Must be called before writing to data.
+		 */
+		void detach();
+
 		T *data;
+		// the allocated pixels, shared with all views of this raster
+		std::shared_ptr<T> buffer;
+		// pixel (x, y) of a view is view_origin[y*view_row_stride + x*view_col_stride]
+		T *view_origin;
+		ptrdiff_t view_row_stride, view_col_stride;
+		// set when a view of the buffer is created. The buffer is copied on the next write, regardless
+		// of whether the views still exist, so no thread ever writes to a buffer other rasters may read.
+		std::atomic<bool> buffer_shared;
 		void *clhostptr;
 		cl::Buffer *clbuffer;
 		cl::Buffer *clbuffer_info;
@@ -45,8 +68,9 @@ template<typename T> class Raster2D : public Raster<T, 2> {
 
 		virtual void toPGM(const char *filename, bool avg);
 		virtual void toYUV(const char *filename);
-		virtual void toPNG(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, Raster2D<uint8_t> *overlay = nullptr);
-		virtual void toJPEG(const char *filename, const Colorizer &colorizer, bool flipx = false, bool flipy = false);
+		virtual void toPNG(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, Raster2D<uint8_t> *overlay = nullptr, int compression = -1);
+		virtual void toJPEG(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, int quality = -1, uint32_t background = 0xffffffff);
+		virtual void toWebP(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, int quality = -1);
 		virtual void toGDAL(const char *filename, const char *driver, bool flipx = false, bool flipy = false);
 
 		virtual void clear(double value);
@@ -55,26 +79,54 @@ template<typename T> class Raster2D : public Raster<T, 2> {
 		virtual std::unique_ptr<GenericRaster> scale(int width, int height=0, int depth=0);
 		virtual std::unique_ptr<GenericRaster> flip(bool flipx, bool flipy);
 		virtual std::unique_ptr<GenericRaster> fitToQueryRectangle(const QueryRectangle &qrect);
+		virtual std::unique_ptr<GenericRaster> downsample(const QueryRectangle &qrect);
 		virtual void print(int x, int y, double value, const char *text, int maxlen = -1);
 
 		virtual double getAsDouble(int x, int y=0, int z=0) const;
 
+		/**
+		 * Like setRepresentation(CPU), but keeps a view as it is, so it can be read with getRow() without copying
+		 */
+		void setRepresentationForReading();
+
+		/**
+		 * Returns the pixels of row y. They are read from the buffer directly if they are adjacent,
+		 * otherwise they are copied into scratch. The raster must be in CPU or VIEW representation.
+		 */
+		const T *getRow(uint32_t y, std::vector<T> &scratch) const;
+
+		// get() and set() require the CPU or VIEW representation. set() copies the buffer first if views share it.
 		T get(int x, int y) const {
+			if (representation == GenericRaster::Representation::VIEW)
+				return view_origin[y * view_row_stride + x * view_col_stride];
 			return data[(size_t) y*width + x];
 		}
 		T getSafe(int x, int y, T def = 0) const {
 			if (x >= 0 && y >= 0 && (uint32_t) x < width && (uint32_t) y < height)
-				return data[(size_t) y*width + x];
+				return get(x, y);
 			return def;
 		}
 		void set(int x, int y, T value) {
+			if (buffer_shared)
+				detach();
 			data[(size_t) y*width + x] = value;
 		}
 		void setSafe(int x, int y, T value) {
 			if (x >= 0 && y >= 0 && (uint32_t) x < width && (uint32_t) y < height)
-				data[(size_t) y*width + x] = value;
+				set(x, y, value);
 		}
 
+	private:
+		Raster2D(const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, std::shared_ptr<T> buffer, T *view_origin, ptrdiff_t view_row_stride, ptrdiff_t view_col_stride);
+
+		/*
+		 * Returns where the pixels are: pixel (x, y) is origin[y*row_stride + x*col_stride].
+		 * Moves the raster to the CPU if it is on the OpenCL device.
+		 */
+		void getLayout(T *&origin, ptrdiff_t &row_stride, ptrdiff_t &col_stride);
+
+		std::unique_ptr<GenericRaster> createView(const SpatioTemporalReference &stref, uint32_t width, uint32_t height, T *origin, ptrdiff_t row_stride, ptrdiff_t col_stride);
+
 		// create aliases for parent classes members
 		// otherwise we'd need to write this->data every time
 		// see: two-phase lookup of dependant names
@@ -89,6 +141,13 @@ template<typename T> class Raster2D : public Raster<T, 2> {
 		using Raster<T, 2>::WorldToPixelX;
 		using Raster<T, 2>::WorldToPixelY;
 		using Raster<T, 2>::data;
+		using Raster<T, 2>::buffer;
+		using Raster<T, 2>::view_origin;
+		using Raster<T, 2>::view_row_stride;
+		using Raster<T, 2>::view_col_stride;
+		using Raster<T, 2>::buffer_shared;
+		using Raster<T, 2>::representation;
+		using Raster<T, 2>::detach;
 		using Raster<T, 2>::dd;
 		using Raster<T, 2>::getPixelCount;
 		using Raster<T, 2>::getDataSize;
@@ -5,6 +5,7 @@
 #include "datatypes/plot.h"
 #include "datatypes/colorizer.h"
 #include "rasterdb/rasterdb.h"
+#include "rasterdb/converters/converter.h"
 #include "raster/opencl.h"
 #include "cache/manager.h"
 
@@ -28,6 +29,11 @@
 #include <exception>
 #include <memory>
 #include <utility>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
 
 #include <json/json.h>
 
@@ -64,6 +70,9 @@ static void usage() {
 		printf("%s loadsource <sourcename>\n", program_name);
 		printf("%s import <sourcename> <filename> <filechannel> <sourcechannel> <time_start> <duration> <compression>\n", program_name);
 		printf("%s link <sourcename> <sourcechannel> <time_reference> <time_start> <duration>\n", program_name);
+		printf("%s convertsource <sourcename> <compression>\n", program_name);
+		printf("%s benchmarkconverters <filename> <filechannel> [<tilesize>]\n", program_name);
+		printf("%s benchmarkrasterdb <sourcename> <sourcechannel> <time> <threads> <queries> [<resolution>]\n", program_name);
 		printf("%s query <queryname> <png_filename>\n", program_name);
 		printf("%s testquery <queryname> [S|F]\n", program_name);
 		printf("%s showprovenance <queryname>\n", program_name);
@@ -208,6 +217,174 @@ static void link(int argc, char *argv[]) {
 	}
 }
 
+// convertsource <sourcename> <compression>
+static void convertsource(int argc, char *argv[]) {
+	if (argc < 4) {
+		usage();
+	}
+	try {
+		auto db = RasterDB::open(argv[2], RasterDB::READ_WRITE);
+		db->recompress(argv[3]);
+	}
+	catch (std::exception &e) {
+		printf("Failure: %s\n", e.what());
+	}
+}
+
+/*
+ * Compares all registered converters on the tiles of a raster file: compression ratio,
+ * encoding throughput and decoding throughput, the latter being relevant for queries.
+ */
+// benchmarkconverters <filename> <filechannel> [<tilesize>]
+static int benchmarkconverters(int argc, char *argv[]) {
+	if (argc < 4) {
+		usage();
+	}
+	try {
+		auto raster = GenericRaster::fromGDAL(argv[2], atoi(argv[3]));
+		uint32_t tilesize = argc > 4 ? atoi(argv[4]) : 1024;
+		if (tilesize < 1) {
+			printf("tilesize must be positive\n");
+			return 5;
+		}
+
+		std::vector<std::unique_ptr<GenericRaster>> tiles;
+		size_t raw_size = 0;
+		for (uint32_t yoff = 0; yoff < raster->height; yoff += tilesize) {
+			for (uint32_t xoff = 0; xoff < raster->width; xoff += tilesize) {
+				auto tile = GenericRaster::create(raster->dd, SpatioTemporalReference::unreferenced(), std::min(raster->width - xoff, tilesize), std::min(raster->height - yoff, tilesize));
+				tile->blit(raster.get(), -(int) xoff, -(int) yoff);
+				raw_size += tile->getDataSize();
+				tiles.push_back(std::move(tile));
+			}
+		}
+		printf("%lu tiles, %lu bytes, datatype %s\n", tiles.size(), raw_size, GDALGetDataTypeName(raster->dd.datatype));
+		printf("%-14s %10s %8s %14s %14s\n", "method", "bytes", "ratio", "encode MB/s", "decode MB/s");
+
+		for (auto &method : RasterConverter::getConverterNames()) {
+			// the numeric aliases of the old enum
+			if (isdigit(method[0]))
+				continue;
+
+			auto converter = RasterConverter::getConverter(method);
+			std::vector<std::unique_ptr<ByteBuffer>> encoded;
+			size_t encoded_size = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (auto &tile : tiles) {
+				encoded.push_back(converter->encode(tile.get()));
+				encoded_size += encoded.back()->size;
+			}
+			double encode_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			// decode repeatedly for at least a second
+			size_t decoded_bytes = 0;
+			bool correct = true;
+			start = std::chrono::steady_clock::now();
+			double decode_seconds = 0;
+			do {
+				for (size_t i=0;i<tiles.size();i++) {
+					auto decoded = converter->decode(*encoded[i], tiles[i]->dd, tiles[i]->stref, tiles[i]->width, tiles[i]->height, 0);
+					if (decoded_bytes < raw_size)
+						correct = correct && memcmp(decoded->getData(), tiles[i]->getData(), tiles[i]->getDataSize()) == 0;
+					decoded_bytes += decoded->getDataSize();
+				}
+				decode_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			} while (decode_seconds < 1.0);
+
+			printf("%-14s %10lu %8.3f %14.1f %14.1f%s\n", method.c_str(), encoded_size, (double) encoded_size / raw_size,
+				raw_size / encode_seconds / 1e6, decoded_bytes / decode_seconds / 1e6, correct ? "" : "  DECODING FAILED");
+		}
+		return 0;
+	}
+	catch (std::exception &e) {
+		printf("Failure: %s\n", e.what());
+		return 5;
+	}
+}
+
+/*
+ * Measures the throughput of concurrent queries against a local source, e.g. the ndvi source
+ * generated by the systemtests. Each query requests a random window of 1/16 to 1/2 of the source's extent.
+ */
+// benchmarkrasterdb <sourcename> <channel> <time> <threads> <queries> [<resolution>]
+static int benchmarkrasterdb(int argc, char *argv[]) {
+	if (argc < 7) {
+		usage();
+	}
+	try {
+		const char *sourcename = argv[2];
+		int channelid = atoi(argv[3]);
+		double time = atof(argv[4]);
+		int threads = atoi(argv[5]);
+		int queries = atoi(argv[6]);
+		uint32_t resolution = argc > 7 ? atoi(argv[7]) : 256;
+		if (threads < 1 || queries < 1 || resolution < 1) {
+			printf("threads, queries and resolution must be positive\n");
+			return 5;
+		}
+
+		Json::Reader reader(Json::Features::strictMode());
+		Json::Value root;
+		if (!reader.parse(RasterDB::getSourceDescription(sourcename), root)) {
+			printf("unable to read json of source %s\n", sourcename);
+			return 5;
+		}
+		auto coords = root["coords"];
+		CrsId crsId = CrsId::from_srs_string(coords["crs"].asString());
+		double x1 = coords["origin"][0].asDouble(), y1 = coords["origin"][1].asDouble();
+		double x2 = x1 + coords["size"][0].asDouble() * coords["scale"][0].asDouble();
+		double y2 = y1 + coords["size"][1].asDouble() * coords["scale"][1].asDouble();
+		if (x1 > x2)
+			std::swap(x1, x2);
+		if (y1 > y2)
+			std::swap(y1, y2);
+
+		auto db = RasterDB::open(sourcename);
+
+		std::atomic<int> next_query(0);
+		std::atomic<size_t> pixels(0);
+		std::atomic<int> failures(0);
+		auto worker = [&] (int seed) {
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<double> fraction(1.0/16, 1.0/2), position(0, 1);
+			while (next_query++ < queries) {
+				double w = (x2 - x1) * fraction(rng), h = (y2 - y1) * fraction(rng);
+				double qx = x1 + (x2 - x1 - w) * position(rng), qy = y1 + (y2 - y1 - h) * position(rng);
+				QueryRectangle rect(
+					SpatialReference(crsId, qx, qy, qx + w, qy + h),
+					TemporalReference(TIMETYPE_UNIX, time),
+					QueryResolution::pixels(resolution, resolution)
+				);
+				try {
+					QueryProfiler profiler;
+					auto raster = db->query(rect, profiler, channelid);
+					pixels += raster->getPixelCount();
+				}
+				catch (const std::exception &e) {
+					if (failures++ == 0)
+						printf("Query failed: %s\n", e.what());
+				}
+			}
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> workers;
+		for (int i=0;i<threads;i++)
+			workers.emplace_back(worker, i);
+		for (auto &w : workers)
+			w.join();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		printf("%d queries with %d threads in %.3f s: %.1f queries/s, %.1f MPixel/s, %d failed\n",
+			queries, threads, seconds, queries / seconds, pixels / seconds / 1e6, (int) failures);
+		return failures > 0 ? 5 : 0;
+	}
+	catch (std::exception &e) {
+		printf("Failure: %s\n", e.what());
+		return 5;
+	}
+}
+
 static SpatialReference sref_from_json(Json::Value &root, bool &flipx, bool &flipy){
 	if(root.isMember("spatial_reference")){
 		Json::Value& json = root["spatial_reference"];
@@ -810,6 +987,15 @@ int main(int argc, char *argv[]) {
 	else if (strcmp(command, "link") == 0) {
 		link(argc, argv);
 	}
+	else if (strcmp(command, "convertsource") == 0) {
+		convertsource(argc, argv);
+	}
+	else if (strcmp(command, "benchmarkconverters") == 0) {
+		returncode = benchmarkconverters(argc, argv);
+	}
+	else if (strcmp(command, "benchmarkrasterdb") == 0) {
+		returncode = benchmarkrasterdb(argc, argv);
+	}
 	else if (strcmp(command, "query") == 0) {
 		runquery(argc, argv);
 	}
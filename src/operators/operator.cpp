@@ -7,6 +7,7 @@
 
 #include "operators/operator.h"
 #include "cache/manager.h"
+#include "cache/node/node_manager.h"
 
 
 #include <unordered_map>
@@ -90,7 +91,7 @@ void GenericOperator::validateQRect(const QueryRectangle &rect, GenericOperator:
 		throw OperatorException("Cannot query with TIMETYPE_UNREFERENCED");
 }
 
-void GenericOperator::validateResult(const QueryRectangle &rect, SpatioTemporalResult *result) {
+void GenericOperator::validateResult(const QueryRectangle &rect, const SpatioTemporalResult *result) {
 	if (result->stref.crsId == CrsId::unreferenced())
 		throw OperatorException(concat("Operator ", type, " returned result with EPSG_UNREFERENCED"));
 	if (result->stref.timetype == TIMETYPE_UNREFERENCED)
@@ -132,6 +133,8 @@ static void d_profile(int depth, const std::string &type, const char *result, Qu
 		<< " CPU: " << profiler.self_cpu << "/" << profiler.all_cpu
 		<< " GPU: " << profiler.self_gpu << "/" << profiler.all_gpu
 		<< " I/O: " << profiler.self_io << "/" << profiler.all_io;
+	if (profiler.tilecache_hits + profiler.tilecache_misses > 0)
+		msg << " Tiles: " << profiler.tilecache_hits << " cached/" << profiler.tilecache_misses << " loaded";
 	if (bytes > 0) {
 		// Estimate the costs to cache this item
 		double cache_cpu = 0.000000005 * bytes;
@@ -143,36 +146,90 @@ static void d_profile(int depth, const std::string &type, const char *result, Qu
 	Log::info(msg.str());
 }
 
+/**
+ * Runs the given cache query. On a miss, the computation of the result is
+ * announced to the cache, which stores the lease for it in the given pointer.
+ * If an identical query is already computing the result, waits for it and
+ * repeats the query once. Misses are signalled by NoSuchElementException.
+ */
+template<typename T, typename Query>
+static auto queryCacheCoalesced(CacheWrapper<T> &cache, const std::string &semantic_id, const QueryRectangle &rect,
+		std::unique_ptr<InFlightRegistry::Lease> &lease, Query query) -> decltype(query()) {
+	try {
+		return query();
+	} catch ( NoSuchElementException &nse ) {
+		lease = cache.begin_computation(semantic_id, rect);
+		if ( lease )
+			throw;
+	}
+	return query();
+}
+
 std::unique_ptr<GenericRaster> GenericOperator::getCachedRaster(const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode) {
+	auto result = getCachedRasterShared(rect, tools);
+
+	// fitToQueryRectangle does not modify the source, but may return a view of it. The caller owns
+	// the result and may keep it around, so it gets a buffer of its own instead of pinning the cached one.
+	if (query_mode == RasterQM::EXACT) {
+		auto fitted = const_cast<GenericRaster&>(*result).fitToQueryRectangle(rect);
+		if (fitted->getRepresentation() == GenericRaster::Representation::VIEW)
+			fitted->setRepresentation(GenericRaster::Representation::CPU);
+		return fitted;
+	}
+	return result.release();
+}
+
+cow_ptr<GenericRaster> GenericOperator::getCachedRasterShared(const QueryRectangle &rect, const QueryTools &tools) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
 
 	validateQRect(rect, ResolutionRequirement::REQUIRED);
 	auto &cache = CacheManager::get_instance().get_raster_cache();
-	std::unique_ptr<GenericRaster> result;
+	cow_ptr<GenericRaster> result;
+	std::unique_ptr<InFlightRegistry::Lease> lease;
 
 	try {
-		result = cache.query( *this, rect, parent_profiler );
+		result = queryCacheCoalesced( cache, semantic_id, rect, lease, [&]() {
+			return cache.query_shared( *this, rect, parent_profiler );
+		});
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
 		{
 			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
 			TIME_EXEC("Operator.getRaster");
-			result = getRaster(rect,QueryTools(exec_profiler));
+			result = cow_ptr<GenericRaster>(getRaster(rect,QueryTools(exec_profiler)));
 		}
 		d_profile(depth, type, "raster", exec_profiler);
-		if ( cache.put(semantic_id,result,rect,exec_profiler) ) {
+		if ( cache.put_shared(semantic_id,result,rect,exec_profiler) ) {
 			parent_profiler.cached(exec_profiler);
 		}
 	}
 	validateResult(rect, result.get());
-
-	if (query_mode == RasterQM::EXACT)
-		result = result->fitToQueryRectangle(rect);
 	return result;
 }
 
+/**
+ * Queries the given cache for a feature collection and restricts the result
+ * to the given query rectangle. Collections shared with the cache are filtered
+ * into a new collection instead of being copied as a whole.
+ */
+template<typename T>
+static std::unique_ptr<T> queryCachedFeatureCollection(CacheWrapper<T> &cache, GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler) {
+	auto cached = cache.query_shared( op, rect, profiler );
+	if (rect.t1 > cached->stref.t1 || rect.t2 < cached->stref.t2
+			|| rect.x1 > cached->stref.x1 || rect.x2 < cached->stref.x2
+			|| rect.y1 > cached->stref.y1 || rect.y2 < cached->stref.y2) {
+		if (cached.is_shared())
+			return cached->filterBySpatioTemporalReferenceIntersection(rect);
+
+		auto result = cached.release();
+		result->filterBySpatioTemporalReferenceIntersectionInPlace(rect);
+		return result;
+	}
+	return cached.release();
+}
+
 std::unique_ptr<PointCollection> GenericOperator::getCachedPointCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
@@ -180,13 +237,11 @@ std::unique_ptr<PointCollection> GenericOperator::getCachedPointCollection(const
 	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
 	auto &cache = CacheManager::get_instance().get_point_cache();
 	std::unique_ptr<PointCollection> result;
+	std::unique_ptr<InFlightRegistry::Lease> lease;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
-		if (rect.t1 > result->stref.t1 || rect.t2 < result->stref.t2
-				|| rect.x1 > result->stref.x1 || rect.x2 < result->stref.x2
-				|| rect.y1 > result->stref.y1 || rect.y2 < result->stref.y2) {
-			result->filterBySpatioTemporalReferenceIntersectionInPlace(rect);
-		}
+		result = queryCacheCoalesced( cache, semantic_id, rect, lease, [&]() {
+			return queryCachedFeatureCollection( cache, *this, rect, parent_profiler );
+		});
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
@@ -215,13 +270,11 @@ std::unique_ptr<LineCollection> GenericOperator::getCachedLineCollection(const Q
 	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
 	auto &cache = CacheManager::get_instance().get_line_cache();
 	std::unique_ptr<LineCollection> result;
+	std::unique_ptr<InFlightRegistry::Lease> lease;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
-		if (rect.t1 > result->stref.t1 || rect.t2 < result->stref.t2
-				|| rect.x1 > result->stref.x1 || rect.x2 < result->stref.x2
-				|| rect.y1 > result->stref.y1 || rect.y2 < result->stref.y2) {
-			result->filterBySpatioTemporalReferenceIntersectionInPlace(rect);
-		}
+		result = queryCacheCoalesced( cache, semantic_id, rect, lease, [&]() {
+			return queryCachedFeatureCollection( cache, *this, rect, parent_profiler );
+		});
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
@@ -250,13 +303,11 @@ std::unique_ptr<PolygonCollection> GenericOperator::getCachedPolygonCollection(c
 	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
 	auto &cache = CacheManager::get_instance().get_polygon_cache();
 	std::unique_ptr<PolygonCollection> result;
+	std::unique_ptr<InFlightRegistry::Lease> lease;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
-		if (rect.t1 > result->stref.t1 || rect.t2 < result->stref.t2
-				|| rect.x1 > result->stref.x1 || rect.x2 < result->stref.x2
-				|| rect.y1 > result->stref.y1 || rect.y2 < result->stref.y2) {
-			result->filterBySpatioTemporalReferenceIntersectionInPlace(rect);
-		}
+		result = queryCacheCoalesced( cache, semantic_id, rect, lease, [&]() {
+			return queryCachedFeatureCollection( cache, *this, rect, parent_profiler );
+		});
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
@@ -286,8 +337,11 @@ std::unique_ptr<GenericPlot> GenericOperator::getCachedPlot(const QueryRectangle
 	validateQRect(rect, ResolutionRequirement::OPTIONAL);
 	auto &cache = CacheManager::get_instance().get_plot_cache();
 	std::unique_ptr<GenericPlot> result;
+	std::unique_ptr<InFlightRegistry::Lease> lease;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
+		result = queryCacheCoalesced( cache, semantic_id, rect, lease, [&]() {
+			return cache.query( *this, rect, parent_profiler );
+		});
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
@@ -351,6 +405,45 @@ std::unique_ptr<GenericRaster> GenericOperator::getRasterFromSource(int idx, con
 	auto result = sources[idx]->getCachedRaster(rect, tools, query_mode);
 	return result;
 }
+std::vector<GenericOperator::RasterFuture> GenericOperator::getRastersFromSources(int first, int count, const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode) {
+	if (first < 0 || count < 0 || first + count > sourcecounts[0])
+		throw OperatorException("getRastersFromSources() called on invalid index");
+
+	auto &executor = TaskExecutor::get_instance();
+	std::vector<RasterFuture> result;
+	result.reserve(count);
+	for (int idx = first; idx < first + count; idx++) {
+		// every source gets its own profiler, because profilers are not thread-safe
+		auto profiler = std::make_shared<QueryProfiler>();
+		GenericOperator *source = sources[idx];
+		// The executor's thread acts for this one, so a node cache sees the worker's puzzle-depth and index connection
+		DelegationGuard::Origin origin(NodeCacheManager::get_worker_context());
+		auto future = executor.submit([source, rect, profiler, query_mode, origin]() {
+			DelegationGuard guard(NodeCacheManager::get_worker_context(), origin);
+			return source->getCachedRaster(rect, QueryTools(*profiler), query_mode);
+		});
+		result.emplace_back(std::move(future), profiler, tools.profiler);
+	}
+	return result;
+}
+
+GenericOperator::RasterFuture::RasterFuture(TaskFuture<std::unique_ptr<GenericRaster>> future, std::shared_ptr<QueryProfiler> profiler, QueryProfiler &parent_profiler)
+	: future(std::move(future)), profiler(profiler), parent_profiler(parent_profiler) {
+}
+
+std::unique_ptr<GenericRaster> GenericOperator::RasterFuture::get() {
+	// the source may be computed on this thread, if no worker picked it up yet
+	QueryProfilerStoppingGuard guard(parent_profiler);
+	try {
+		auto raster = future.get();
+		parent_profiler += *profiler;
+		return raster;
+	} catch (...) {
+		parent_profiler += *profiler;
+		throw;
+	}
+}
+
 std::unique_ptr<PointCollection> GenericOperator::getPointCollectionFromSource(int idx, const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
 	if (idx < 0 || idx >= sourcecounts[1])
 		throw OperatorException("getChildPoints() called on invalid index");
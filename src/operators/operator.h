@@ -5,11 +5,14 @@
 #include "operators/provenance.h"
 #include "operators/queryrectangle.h"
 #include "operators/querytools.h"
+#include "util/cow_ptr.h"
+#include "util/task_executor.h"
 
 #include <ctime>
 #include <string>
 #include <sstream>
 #include <memory>
+#include <vector>
 
 namespace Json {
 	class Value;
@@ -60,6 +63,27 @@ class GenericOperator {
 			SINGLE_ELEMENT_FEATURES
 		};
 
+		/**
+		 * A raster requested from a source operator, which is computed concurrently.
+		 * The costs of the computation are added to the requesting operator's profiler,
+		 * once the raster is retrieved.
+		 */
+		class RasterFuture {
+			public:
+				RasterFuture(TaskFuture<std::unique_ptr<GenericRaster>> future, std::shared_ptr<QueryProfiler> profiler, QueryProfiler &parent_profiler);
+
+				/**
+				 * Waits for the raster to be computed. Exceptions of the source operator are rethrown.
+				 * This method may only be called once.
+				 * @return the raster
+				 */
+				std::unique_ptr<GenericRaster> get();
+			private:
+				TaskFuture<std::unique_ptr<GenericRaster>> future;
+				std::shared_ptr<QueryProfiler> profiler;
+				QueryProfiler &parent_profiler;
+		};
+
 		static const int MAX_INPUT_TYPES = 4;
 		static const int MAX_SOURCES = 20;
 		static std::unique_ptr<GenericOperator> fromJSON(const std::string &json, int depth = 0);
@@ -68,6 +92,11 @@ class GenericOperator {
 		virtual ~GenericOperator();
 
 		std::unique_ptr<GenericRaster> getCachedRaster(const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode = RasterQM::LOOSE);
+		/**
+		 * Returns a LOOSE raster, which may be shared with the cache. Use this for read-only
+		 * access to avoid copying cached rasters; a copy is only made on write access.
+		 */
+		cow_ptr<GenericRaster> getCachedRasterShared(const QueryRectangle &rect, const QueryTools &tools);
 		std::unique_ptr<PointCollection> getCachedPointCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
 		std::unique_ptr<LineCollection> getCachedLineCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
 		std::unique_ptr<PolygonCollection> getCachedPolygonCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
@@ -97,6 +126,14 @@ class GenericOperator {
 		virtual std::unique_ptr<GenericPlot> getPlot(const QueryRectangle &rect, const QueryTools &tools);
 
 		std::unique_ptr<GenericRaster> getRasterFromSource(int idx, const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode = RasterQM::LOOSE);
+		/**
+		 * Requests the rasters of several sources with the same query rectangle. The sources are evaluated
+		 * concurrently on the TaskExecutor, so the latency is that of the slowest source instead of the sum of all.
+		 * @param first the index of the first raster source
+		 * @param count the number of raster sources, starting at first
+		 * @return the futures of the rasters, in the order of the sources
+		 */
+		std::vector<RasterFuture> getRastersFromSources(int first, int count, const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode = RasterQM::LOOSE);
 		std::unique_ptr<PointCollection> getPointCollectionFromSource(int idx, const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
 		std::unique_ptr<LineCollection> getLineCollectionFromSource(int idx, const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
 		std::unique_ptr<PolygonCollection> getPolygonCollectionFromSource(int idx, const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
@@ -109,7 +146,7 @@ class GenericOperator {
 			OPTIONAL
 		};
 		void validateQRect(const QueryRectangle &rect, ResolutionRequirement res = ResolutionRequirement::OPTIONAL);
-		void validateResult(const QueryRectangle &rect, SpatioTemporalResult *result);
+		void validateResult(const QueryRectangle &rect, const SpatioTemporalResult *result);
 		void getRecursiveProvenance(ProvenanceCollection &pc);
 
 		int sourcecounts[MAX_INPUT_TYPES];
@@ -104,13 +104,15 @@ auto StatisticsOperator::getPlot(const QueryRectangle &rect, const QueryTools &t
     auto result = std::make_unique<LayerStatistics>();
 
     // TODO: compute statistics using OpenCL
-    for (int i = 0; i < getRasterSourceCount(); ++i) {
-        auto raster = getRasterFromSource(
-                i,
-                QueryRectangle(rect, rect, QueryResolution::pixels(rasterWidth, rasterHeight)),
-                tools,
-                RasterQM::EXACT
-        );
+    auto rasters = getRastersFromSources(
+            0,
+            getRasterSourceCount(),
+            QueryRectangle(rect, rect, QueryResolution::pixels(rasterWidth, rasterHeight)),
+            tools,
+            RasterQM::EXACT
+    );
+    for (auto &future : rasters) {
+        auto raster = future.get();
         processRaster(*result, *raster);
     }
 
@@ -208,8 +208,9 @@ RasterValueExtractionOperator::getPointCollection(const QueryRectangle &rect, co
         TemporalReference tref = TemporalReference::unreferenced();
         QueryRectangle rect2(rect, rect,
                              QueryResolution::pixels(x_resolution, y_resolution));
+        auto futures = getRastersFromSources(0, rasters, rect2, tools);
         for (int r = 0; r < rasters; r++) {
-            auto raster = getRasterFromSource(r, rect2, tools);
+            auto raster = futures[r].get();
             Profiler::Profiler p("RASTER_VALUE_TO_POINTS_OPERATOR");
             enhance(*points, *raster, names.at(r), tools.profiler);
             if (r == 0)
@@ -237,10 +238,11 @@ auto RasterValueExtractionOperator::getPolygonCollection(const QueryRectangle &r
     };
 
     // loop through rasters
+    auto rasters = getRastersFromSources(0, this->names.size(), raster_rect, tools, RasterQM::EXACT);
     for (int raster_source_id = 0; raster_source_id < this->names.size(); ++raster_source_id) {
         const std::string &name_prefix = this->names[raster_source_id];
 
-        const auto &raster = getRasterFromSource(raster_source_id, raster_rect, tools, RasterQM::EXACT);
+        const auto &raster = rasters[raster_source_id].get();
 
         for (const std::string &suffix : {"mean", "stdev", "min", "max"}) {
             polygon_collection->feature_attributes.addNumericAttribute(
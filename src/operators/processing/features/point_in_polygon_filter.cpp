@@ -3,6 +3,7 @@
 #include "operators/operator.h"
 #include "datatypes/pointcollection.h"
 #include "datatypes/polygoncollection.h"
+#include "util/task_executor.h"
 
 #include <string>
 #include <sstream>
@@ -43,6 +44,8 @@ REGISTER_OPERATOR(PointInPolygonFilterOperator, "point_in_polygon_filter");
 
 #ifndef MAPPING_OPERATOR_STUBS
 
+static const size_t POINTS_PER_TASK = 4096;
+
 std::unique_ptr<PointCollection> PointInPolygonFilterOperator::getPointCollection(const QueryRectangle &rect, const QueryTools &tools) {
 	auto points = getPointCollectionFromSource(0, rect, tools, FeatureCollectionQM::SINGLE_ELEMENT_FEATURES);
 	auto multiPolygons = getPolygonCollectionFromSource(0, rect, tools, FeatureCollectionQM::ANY_FEATURE);
@@ -50,13 +53,14 @@ std::unique_ptr<PointCollection> PointInPolygonFilterOperator::getPointCollectio
 	if(!points->hasTime() && !multiPolygons->hasTime()) {
 		//filter only based on geometry
 		auto tester = multiPolygons->getPointInCollectionBulkTester();
+		auto contained = tester.pointsInCollection(points->coordinates);
 
 		size_t points_count = points->getFeatureCount();
 		std::vector<bool> keep(points_count, false);
 
-		for(auto feature : *points){
-			for(auto& coordinate : feature){
-				if(tester.pointInCollection(coordinate)){
+		for(size_t feature = 0; feature < points_count; ++feature){
+			for(size_t i = points->start_feature[feature]; i < points->start_feature[feature + 1]; ++i){
+				if(contained[i]){
 					keep[feature] = true;
 					break;
 				}
@@ -87,11 +91,24 @@ std::unique_ptr<PointCollection> PointInPolygonFilterOperator::filterWithTime(co
 	auto textualAttributes = points.feature_attributes.getTextualKeys();
 	auto numericAttributes = points.feature_attributes.getNumericKeys();
 
+	//TODO: for multi-points: gather polygons for all point. But have to clarify semantics first.
+	//the containing polygons are computed concurrently, the new points are added in order afterwards
+	size_t points_count = points.getFeatureCount();
+	std::vector<std::vector<uint32_t>> containing(points_count);
+	std::vector<TaskFuture<void>> futures;
+	for(size_t start = 0; start < points_count; start += POINTS_PER_TASK){
+		size_t end = std::min(points_count, start + POINTS_PER_TASK);
+		futures.push_back(TaskExecutor::get_instance().submit([&points, &tester, &containing, start, end] {
+			for(size_t feature = start; feature < end; ++feature)
+				containing[feature] = tester.polygonsContainingPoint(points.coordinates[points.start_feature[feature]]);
+		}));
+	}
+	for(auto &future : futures)
+		future.get();
+
 	for(auto feature : points){
 		std::vector<TimeInterval> intervals;
-
-		//TODO: for multi-points: gather polygons for all point. But have to clarify semantics first.
-		auto polygons = tester.polygonsContainingPoint(*feature.begin());
+		auto &polygons = containing[feature];
 
 		//gather all time intervals in which feature intersects with a polygon
 		for(uint32_t polygon : polygons){
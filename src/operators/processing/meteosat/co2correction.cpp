@@ -50,8 +50,9 @@ std::unique_ptr<GenericRaster> MeteosatCo2CorrectionOperator::getRaster(const Qu
 	RasterOpenCL::init();
 	auto raster_bt039 = getRasterFromSource(0, rect, tools, RasterQM::LOOSE);
 	QueryRectangle exact_rect(*raster_bt039);
-	auto raster_bt108 = getRasterFromSource(1, exact_rect, tools, RasterQM::EXACT);
-	auto raster_bt134 = getRasterFromSource(2, exact_rect, tools, RasterQM::EXACT);
+	auto futures = getRastersFromSources(1, 2, exact_rect, tools, RasterQM::EXACT);
+	auto raster_bt108 = futures[0].get();
+	auto raster_bt134 = futures[1].get();
 
 	Profiler::Profiler p("CL_MSATCO2CORRECTION_OPERATOR");
 	raster_bt039->setRepresentation(GenericRaster::OPENCL);
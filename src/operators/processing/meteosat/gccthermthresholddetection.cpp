@@ -261,8 +261,9 @@ double MeteosatGccThermThresholdDetectionOperator::findGccThermThreshold(Histogr
 
 std::unique_ptr<GenericRaster> MeteosatGccThermThresholdDetectionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
 	//get the input rasters
-	auto solar_zenith_angle_raster = getRasterFromSource(0, rect, tools);
-	auto bt108_minus_bt039_raster = getRasterFromSource(1, rect, tools);
+	auto futures = getRastersFromSources(0, 2, rect, tools);
+	auto solar_zenith_angle_raster = futures[0].get();
+	auto bt108_minus_bt039_raster = futures[1].get();
 
 	// TODO: verify units of the source rasters
 	if (!bt108_minus_bt039_raster->dd.unit.hasMinMax())
@@ -331,8 +332,9 @@ std::unique_ptr<GenericRaster> MeteosatGccThermThresholdDetectionOperator::getRa
 
 std::unique_ptr<GenericPlot> MeteosatGccThermThresholdDetectionOperator::getPlot(const QueryRectangle &rect, const QueryTools &tools) {
 	//get the input rasters
-	auto solar_zenith_angle_raster = getRasterFromSource(0, rect, tools);
-	auto bt108_minus_bt039_raster = getRasterFromSource(1, rect, tools);
+	auto futures = getRastersFromSources(0, 2, rect, tools);
+	auto solar_zenith_angle_raster = futures[0].get();
+	auto bt108_minus_bt039_raster = futures[1].get();
 
 	// TODO: verify units of the source rasters
 	if (!bt108_minus_bt039_raster->dd.unit.hasMinMax())
@@ -3,8 +3,12 @@
 #include "raster/opencl.h"
 #include "operators/operator.h"
 #include "util/formula.h"
+#include "util/formula_program.h"
+#include "util/task_executor.h"
 
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <sstream>
@@ -76,8 +80,120 @@ void ExpressionOperator::writeSemanticParameters(std::ostringstream& stream) {
 #ifndef MAPPING_OPERATOR_STUBS
 
 #ifdef MAPPING_NO_OPENCL
+/*
+ * Without OpenCL, the expression is compiled into a FormulaProgram and evaluated on the cpu.
+ * The raster is split into blocks of rows, which are processed concurrently by the TaskExecutor.
+ */
+template<typename T>
+struct ExpressionLoadValues {
+	static void execute(Raster2D<T> *raster, double *values, uint8_t *nodata, size_t offset, size_t count) {
+		const T *data = raster->data + offset;
+		for (size_t i = 0; i < count; i++) {
+			T value = data[i];
+			if (raster->dd.is_no_data(value))
+				nodata[i] = 1;
+			values[i] = (double) value;
+		}
+	}
+};
+
+template<typename T>
+struct ExpressionStoreValues {
+	static void execute(Raster2D<T> *raster, const double *values, const uint8_t *nodata, size_t offset, size_t count) {
+		T *data = raster->data + offset;
+		T no_data = raster->dd.has_no_data ? (T) raster->dd.no_data : 0;
+		double min = raster->dd.getMinByDatatype(), max = raster->dd.getMaxByDatatype();
+		for (size_t i = 0; i < count; i++) {
+			double value = values[i];
+			if (nodata[i] || (RasterTypeInfo<T>::isinteger && std::isnan(value)))
+				data[i] = no_data;
+			else if (RasterTypeInfo<T>::isinteger)
+				data[i] = (T) std::min(max, std::max(min, value));
+			else
+				data[i] = (T) value;
+		}
+	}
+};
+
 std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("ExpressionOperator: cannot be executed without OpenCL support");
+	int rastercount = getRasterSourceCount();
+	if (rastercount < 1 || rastercount > 26)
+		throw OperatorException("ExpressionOperator: need between 1 and 26 input rasters");
+
+	std::vector<std::unique_ptr<GenericRaster> > in_rasters;
+	in_rasters.reserve(rastercount);
+
+	in_rasters.push_back(getRasterFromSource(0, rect, tools, RasterQM::LOOSE));
+	// The first raster determines the data type and sizes
+	GenericRaster *raster_in = in_rasters[0].get();
+	raster_in->setRepresentation(GenericRaster::Representation::CPU);
+
+	// figure out the largest time interval common to all input rasters
+	TemporalReference tref(raster_in->stref);
+
+	QueryRectangle exact_rect(
+		(SpatialReference &) raster_in->stref,
+		(TemporalReference &) rect, // we need to calculate the temporal intersection on our own, so always query with the same interval.
+		QueryResolution::pixels(raster_in->width,raster_in->height)
+	);
+	auto futures = getRastersFromSources(1, rastercount-1, exact_rect, tools, RasterQM::EXACT);
+	for (int i=1;i<rastercount;i++) {
+		in_rasters.push_back(futures[i-1].get());
+		in_rasters[i]->setRepresentation(GenericRaster::Representation::CPU);
+		tref.intersect(in_rasters[i]->stref);
+		if (in_rasters[i]->width != raster_in->width || in_rasters[i]->height != raster_in->height)
+			throw OperatorException("ExpressionOperator: not all input rasters have the same dimensions");
+	}
+
+	std::vector<FormulaProgram::Type> variable_types;
+	for (auto &raster : in_rasters) {
+		GDALDataType type = raster->dd.datatype;
+		variable_types.push_back((type == GDT_Float32 || type == GDT_Float64) ? FormulaProgram::Type::FLOAT : FormulaProgram::Type::INTEGER);
+	}
+	auto program = FormulaProgram::get(expression, variable_types);
+
+	GDALDataType output_type = this->output_type;
+	if (output_type == GDT_Unknown)
+		output_type = raster_in->dd.datatype;
+
+	DataDescription out_dd(output_type, output_unit);
+	if (raster_in->dd.has_no_data)
+		out_dd.addNoData();
+
+	SpatioTemporalReference out_stref(raster_in->stref, tref);
+	auto raster_out = GenericRaster::create(out_dd, out_stref, raster_in->width, raster_in->height);
+	raster_out->setRepresentation(GenericRaster::Representation::CPU);
+
+	const uint32_t width = raster_in->width, height = raster_in->height;
+	auto evaluateRows = [&](uint32_t y_start, uint32_t y_end) {
+		size_t offset = (size_t) y_start * width;
+		size_t count = (size_t) (y_end - y_start) * width;
+
+		std::vector<double> values(count * rastercount);
+		std::vector<const double *> variables(rastercount);
+		std::vector<uint8_t> nodata(count, 0);
+		for (int i=0;i<rastercount;i++) {
+			variables[i] = &values[i * count];
+			callUnaryOperatorFunc<ExpressionLoadValues>(in_rasters[i].get(), &values[i * count], nodata.data(), offset, count);
+		}
+
+		std::vector<double> result(count);
+		program->evaluate(variables.data(), result.data(), count);
+		callUnaryOperatorFunc<ExpressionStoreValues>(raster_out.get(), result.data(), nodata.data(), offset, count);
+	};
+
+	// about 64k pixels per task
+	const uint32_t rows_per_task = std::max<uint32_t>(1, 65536 / std::max<uint32_t>(1, width));
+	auto &executor = TaskExecutor::get_instance();
+	std::vector<TaskFuture<void>> tasks;
+	for (uint32_t y = 0; y < height; y += rows_per_task) {
+		uint32_t y_end = std::min(height, y + rows_per_task);
+		tasks.push_back(executor.submit([&evaluateRows, y, y_end] { evaluateRows(y, y_end); }));
+	}
+	for (auto &task : tasks)
+		task.get();
+
+	return raster_out;
 }
 #else
 std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
@@ -104,8 +220,9 @@ std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangl
 		(TemporalReference &) rect, // we need to calculate the temporal intersection on our own, so always query with the same interval.
 		QueryResolution::pixels(raster_in->width,raster_in->height)
 	);
+	auto futures = getRastersFromSources(1, rastercount-1, exact_rect, tools, RasterQM::EXACT);
 	for (int i=1;i<rastercount;i++) {
-		in_rasters.push_back(getRasterFromSource(i, exact_rect, tools, RasterQM::EXACT));
+		in_rasters.push_back(futures[i-1].get());
 		in_rasters[i]->setRepresentation(GenericRaster::OPENCL);
 		tref.intersect(in_rasters[i]->stref);
 	}
@@ -42,7 +42,7 @@ std::string ProfilingData::to_string() const {
 /*
  * QueryProfiler class
  */
-QueryProfiler::QueryProfiler() : t_start(std::numeric_limits<double>::infinity()) {
+QueryProfiler::QueryProfiler() : tilecache_hits(0), tilecache_misses(0), t_start(std::numeric_limits<double>::infinity()) {
 }
 
 double QueryProfiler::getTimestamp() {
@@ -91,6 +91,11 @@ void QueryProfiler::addIOCost(size_t bytes) {
 	uncached_io += bytes;
 }
 
+void QueryProfiler::addTileCacheAccesses(size_t hits, size_t misses) {
+	tilecache_hits += hits;
+	tilecache_misses += misses;
+}
+
 QueryProfiler& QueryProfiler::operator +=(const ProfilingData& other) {
 	all_cpu += other.all_cpu;
 	uncached_cpu += other.uncached_cpu;
@@ -104,9 +109,18 @@ QueryProfiler& QueryProfiler::operator +=(const ProfilingData& other) {
 QueryProfiler & QueryProfiler::operator+=(const QueryProfiler &other) {
 	if (other.t_start != std::numeric_limits<double>::infinity())
 		throw OperatorException("QueryProfiler: tried adding a timer that had not been stopped");
+	tilecache_hits += other.tilecache_hits;
+	tilecache_misses += other.tilecache_misses;
 	return operator +=((ProfilingData&)other);
 }
 
+void QueryProfiler::merge(const QueryProfiler &other) {
+	*this += other;
+	self_cpu += other.self_cpu;
+	self_gpu += other.self_gpu;
+	self_io += other.self_io;
+}
+
 void QueryProfiler::cached(const ProfilingData &data) {
 	uncached_cpu -= data.uncached_cpu;
 	uncached_gpu -= data.uncached_gpu;
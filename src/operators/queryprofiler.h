@@ -38,12 +38,19 @@ class QueryProfiler : public ProfilingData {
 		void stopTimer();
 		void addGPUCost(double seconds);
 		void addIOCost(size_t bytes);
+		void addTileCacheAccesses(size_t hits, size_t misses);
 
 
 		QueryProfiler & operator+=( const ProfilingData &other );
 		QueryProfiler & operator+=( const QueryProfiler &other );
 		void addTotalCosts( const ProfilingData &profile );
 		void cached( const ProfilingData &profile );
+		// adds all costs of the given profiler as own costs, e.g. of work done on behalf of this profiler by another thread
+		void merge( const QueryProfiler &other );
+
+		// accesses to the decoded tiles of the RasterDB, including those of all child operators. Not serialized.
+		uint64_t tilecache_hits;
+		uint64_t tilecache_misses;
 
 	private:
 		double t_start;
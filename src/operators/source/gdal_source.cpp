@@ -5,6 +5,7 @@
 #include "util/gdal_timesnap.h"
 
 #include "util/gdal.h"
+#include "util/gdal_dataset_pool.h"
 
 #include "util/gdal_source_datasets.h"
 #include "util/gdal_dataset_importer.h"
@@ -83,10 +84,10 @@ void RasterGDALSourceOperator::writeSemanticParameters(std::ostringstream &strea
 	stream << writer.write(params);
 }
 
-// load the json definition of the dataset, then get the file to be loaded from GDALTimesnap. Finally load the raster.
+// get the parsed definition of the dataset, then get the file to be loaded from GDALTimesnap. Finally load the raster.
 std::unique_ptr<GenericRaster> RasterGDALSourceOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	Json::Value datasetJson = GDALSourceDataSets::getDataSetDescription(sourcename);
-	GDALTimesnap::GDALDataLoadingInfo loadingInfo = GDALTimesnap::getDataLoadingInfo(datasetJson, channel, rect);
+	auto loadingTemplate = GDALSourceDataSets::getDataLoadingTemplate(sourcename, channel);
+	GDALTimesnap::GDALDataLoadingInfo loadingInfo = GDALTimesnap::getDataLoadingInfo(*loadingTemplate, rect);
 	auto raster = loadDataset(loadingInfo, rect.crsId, true, rect);
 	//flip here so the tiff result will not be flipped
 	return raster->flip(false, true);
@@ -211,10 +212,8 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadRaster(GDALDataset
                                     raster->height,  // position and size of the destination buffer
                                     type, 0, 0, nullptr);
 
-        if (res != CE_None) {
-            GDALClose(dataset);
+        if (res != CE_None)
             throw OperatorException("GDAL Source: RasterIO failed");
-        }
 
 
         // check if requested query rectangle exceed the data returned from GDAL
@@ -259,18 +258,16 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadRaster(GDALDataset
         return raster;
     }
 
-	//GDALRasterBand is not to be freed, is owned by GDALDataset that will be closed later
+	//GDALRasterBand is not to be freed, is owned by GDALDataset that is returned to the pool later
 }
 
-//load the GDALDataset from disk
+//load the GDALDataset from disk, or reuse a dataset opened by a previous query
 std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadDataset(const GDALTimesnap::GDALDataLoadingInfo &loadingInfo,
                                                                      CrsId crsId, bool clip, const QueryRectangle &qrect) {
-	
-	GDAL::init();
 
-	auto dataset = (GDALDataset *) GDALOpen(loadingInfo.fileName.c_str(), GA_ReadOnly);
+	auto dataset = GDALDatasetPool::getInstance().checkout(loadingInfo.fileName);
 
-	if (dataset == nullptr)
+	if (dataset.get() == nullptr)
 		throw OperatorException(concat("GDAL Source: Could not open dataset ", loadingInfo.fileName));
 
 	if (crsId != loadingInfo.crsId) {
@@ -280,22 +277,21 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadDataset(const GDALT
 	//read GeoTransform to get origin and scale
 	double adfGeoTransform[6];
 	if( dataset->GetGeoTransform( adfGeoTransform ) != CE_None ) {
-		GDALClose(dataset);
 		throw OperatorException("GDAL Source: No GeoTransform information in raster");
 	}
 
 	int rastercount = dataset->GetRasterCount();
 	if (loadingInfo.channel < 1 || loadingInfo.channel > rastercount) {
-		GDALClose(dataset);
 		throw OperatorException("GDAL Source: rasterid not found");
 	}
 
-	auto raster = loadRaster(dataset, adfGeoTransform[0], adfGeoTransform[3], adfGeoTransform[1],
+	try {
+		return loadRaster(dataset.get(), adfGeoTransform[0], adfGeoTransform[3], adfGeoTransform[1],
                              adfGeoTransform[5], crsId, clip, qrect.x1, qrect.y1, qrect.x2, qrect.y2, qrect, loadingInfo);
-
-	GDALClose(dataset);
-
-	return raster;
+	}
+	catch (...) {
+		// do not reuse a dataset that failed reading
+		dataset.discard();
+		throw;
+	}
 }
-
-
@@ -34,7 +34,7 @@ std::unique_ptr<QueryProcessor::QueryResult> LocalQueryProcessor::process(const
 		}
 
 		if (q.result == Query::ResultType::RASTER)
-			return QueryProcessor::QueryResult::raster( op->getCachedRaster(q.rectangle, tools), q.rectangle, std::move(provenance) );
+			return QueryProcessor::QueryResult::raster( op->getCachedRasterShared(q.rectangle, tools), q.rectangle, std::move(provenance) );
 		else if (q.result == Query::ResultType::POINTS)
 			return QueryProcessor::QueryResult::points( op->getCachedPointCollection(q.rectangle, tools), q.rectangle, std::move(provenance) );
 		else if (q.result == Query::ResultType::LINES)
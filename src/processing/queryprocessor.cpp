@@ -45,7 +45,12 @@ QueryProcessor::QueryResult::QueryResult(Query::ResultType result_type, std::uni
 }
 
 std::unique_ptr<QueryProcessor::QueryResult> QueryProcessor::QueryResult::raster(std::unique_ptr<GenericRaster> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance) {
-	return std::unique_ptr<QueryResult>(new QueryResult(Query::ResultType::RASTER, std::move(result), std::move(provenance), "", boost::none, qrect));
+	return raster(cow_ptr<GenericRaster>(std::move(result)), qrect, std::move(provenance));
+}
+std::unique_ptr<QueryProcessor::QueryResult> QueryProcessor::QueryResult::raster(cow_ptr<GenericRaster> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance) {
+	auto res = std::unique_ptr<QueryResult>(new QueryResult(Query::ResultType::RASTER, nullptr, std::move(provenance), "", boost::none, qrect));
+	res->result_raster = std::move(result);
+	return res;
 }
 std::unique_ptr<QueryProcessor::QueryResult> QueryProcessor::QueryResult::points(std::unique_ptr<PointCollection> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance) {
 	return std::unique_ptr<QueryResult>(new QueryResult(Query::ResultType::POINTS, std::move(result), std::move(provenance), "", boost::none, qrect));
@@ -83,10 +88,17 @@ std::unique_ptr<GenericRaster> QueryProcessor::QueryResult::getRaster(GenericOpe
 	if (result_type != Query::ResultType::RASTER)
 		throw ProcessingException("QueryResult::getRaster(): result is not a raster", MappingExceptionType::PERMANENT);
 
-	auto raster = cast_unique_ptr<GenericRaster>(result);
-	if (query_mode == GenericOperator::RasterQM::EXACT)
-		raster = raster->fitToQueryRectangle(qrect);
-	return raster;
+	if (!result_raster)
+		throw std::runtime_error("QueryResult::getRaster(): raster was already retrieved");
+
+	// fitToQueryRectangle does not modify a shared raster, so it need not be copied first. The result
+	// may be a view of the shared raster; query results are only encoded and dropped, so it is kept.
+	if (query_mode == GenericOperator::RasterQM::EXACT) {
+		auto raster = const_cast<GenericRaster&>(*result_raster).fitToQueryRectangle(qrect);
+		result_raster = cow_ptr<GenericRaster>();
+		return raster;
+	}
+	return result_raster.release();
 }
 
 std::unique_ptr<PointCollection> QueryProcessor::QueryResult::getPointCollection(GenericOperator::FeatureCollectionQM query_mode) {
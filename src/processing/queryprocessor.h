@@ -44,6 +44,7 @@ class QueryProcessor {
 				boost::optional<MappingException> getErrorException();
 
 			static std::unique_ptr<QueryResult> raster(std::unique_ptr<GenericRaster> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance);
+				static std::unique_ptr<QueryResult> raster(cow_ptr<GenericRaster> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance);
 				static std::unique_ptr<QueryResult> points(std::unique_ptr<PointCollection> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance);
 				static std::unique_ptr<QueryResult> lines(std::unique_ptr<LineCollection> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance);
 				static std::unique_ptr<QueryResult> polygons(std::unique_ptr<PolygonCollection> result, const QueryRectangle &qrect, std::unique_ptr<ProvenanceCollection> provenance);
@@ -53,6 +54,8 @@ class QueryProcessor {
 				QueryResult(Query::ResultType result_type, std::unique_ptr<SpatioTemporalResult> result, std::unique_ptr<ProvenanceCollection> provenance, const std::string &result_plot, boost::optional<MappingException> exception, const QueryRectangle &qrect);
 				Query::ResultType result_type;
 				std::unique_ptr<SpatioTemporalResult> result;
+				// rasters are kept separately, because they may be shared with the cache
+				cow_ptr<GenericRaster> result_raster;
 				std::unique_ptr<ProvenanceCollection> provenance;
 				std::string result_plot;
 				QueryRectangle qrect;
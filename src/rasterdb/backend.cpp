@@ -59,6 +59,10 @@ void RasterDBBackend::linkRaster(int channelid, double time_of_reference, double
 	throw std::runtime_error("RasterDBBackend::linkRaster() not implemented in this backend");
 }
 
+void RasterDBBackend::rewriteTiles(const TileRewriter &rewrite) {
+	throw std::runtime_error("RasterDBBackend::rewriteTiles() not implemented in this backend");
+}
+
 
 
 // RasterDB registration
@@ -6,6 +6,8 @@
 #include "util/configuration.h"
 
 #include <stdint.h>
+#include <functional>
+#include <memory>
 #include <vector>
 
 class BinaryReadBuffer;
@@ -44,6 +46,12 @@ class RasterDBBackend {
 				double time_end;
 		};
 
+		/*
+		 * Called by rewriteTiles() with the current data of a tile. Returns the new data and updates
+		 * the compression accordingly, or returns nullptr to keep the tile unchanged.
+		 */
+		using TileRewriter = std::function<std::unique_ptr<ByteBuffer>(const TileDescription &tile, ByteBuffer &data, std::string &compression)>;
+
 		static std::unique_ptr<RasterDBBackend> create(const std::string &backend, const std::string &location, const ConfigurationTable& params);
 
 		virtual ~RasterDBBackend() {};
@@ -56,13 +64,16 @@ class RasterDBBackend {
 		virtual rasterid_t createRaster(int channel, double time_start, double time_end, const AttributeMaps &global_attributes);
 		virtual void writeTile(rasterid_t rasterid, ByteBuffer &buffer, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom, const std::string &compression);
 		virtual void linkRaster(int channelid, double time_of_reference, double time_start, double time_end);
+		virtual bool hasTile(rasterid_t rasterid, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom) = 0;
+		virtual void rewriteTiles(const TileRewriter &rewrite);
 
 		virtual std::string readJSON() = 0;
+
+		// The following methods are used by queries and may be called concurrently by multiple threads.
 		virtual RasterDescription getClosestRaster(int channelid, double t1, double t2) = 0;
 		virtual void readAttributes(rasterid_t rasterid, AttributeMaps &global_attributes) = 0;
 		virtual int getBestZoom(rasterid_t rasterid, int desiredzoom) = 0;
 		virtual const std::vector<TileDescription> enumerateTiles(int channelid, rasterid_t rasterid, int x1, int y1, int x2, int y2, int zoom = 0) = 0;
-		virtual bool hasTile(rasterid_t rasterid, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom) = 0;
 		virtual std::unique_ptr<ByteBuffer> readTile(const TileDescription &tiledesc) = 0;
 
 		bool isOpen() { return is_opened; }
@@ -7,8 +7,15 @@
 #include <sys/types.h> // the next three are for posix open()
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h> // pread()
+#include <errno.h>
 
+#include <algorithm>
+#include <map>
 #include <string>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include <iostream>
 #include <fstream>
@@ -36,22 +43,102 @@ class LocalRasterDBBackend : public RasterDBBackend {
 		virtual const std::vector<TileDescription> enumerateTiles(int channelid, rasterid_t rasterid, int x1, int y1, int x2, int y2, int zoom = 0);
 		virtual bool hasTile(rasterid_t rasterid, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom);
 		virtual std::unique_ptr<ByteBuffer> readTile(const TileDescription &tiledesc);
+		virtual void rewriteTiles(const TileRewriter &rewrite);
 
 	private:
+		/*
+		 * A read-only connection to the .db file with its prepared statements.
+		 * Connections are pooled, each one is used by a single thread at a time,
+		 * so concurrent queries do not contend for one sqlite handle.
+		 */
+		class ReadConnection {
+			public:
+				enum Statement {
+					CLOSEST_RASTER,
+					ATTRIBUTES,
+					BEST_ZOOM,
+					TILES
+				};
+
+				ReadConnection(const std::string &filename);
+				SQLite::SQLiteStatement &get(Statement statement) { return statements[statement]; }
+				// ends all running statements, so no read transaction is kept open while idle
+				void reset();
+
+			private:
+				SQLite db;
+				std::vector<SQLite::SQLiteStatement> statements;
+		};
+
+		/*
+		 * Borrows a connection from the pool and returns it when going out of scope
+		 */
+		class ReadConnectionGuard {
+			public:
+				ReadConnectionGuard(LocalRasterDBBackend &backend);
+				~ReadConnectionGuard();
+				SQLite::SQLiteStatement &get(ReadConnection::Statement statement) { return connection->get(statement); }
+			private:
+				LocalRasterDBBackend &backend;
+				std::unique_ptr<ReadConnection> connection;
+		};
+
 		void init();
 		void cleanup();
+		std::string getDataFilename(int fileid);
+		int getDataFile(int fileid);
+		void closeDataFiles();
 
 		int lockedfile;
 		std::string location;
 		std::string sourcename;
+		std::string basepath;
 		std::string filename_json;
-		std::string filename_data;
 		std::string filename_db;
 		std::string json;
 		SQLite db;
+
+		std::mutex read_mutex;
+		std::vector<std::unique_ptr<ReadConnection>> read_connections;
+		// open descriptors of the data files, by file number
+		std::unordered_map<int, int> datafiles;
 };
 
 
+LocalRasterDBBackend::ReadConnection::ReadConnection(const std::string &filename) {
+	db.open(filename.c_str(), true);
+	// in the order of the Statement enum
+	statements.push_back(db.prepare("SELECT id, time_start, time_end FROM rasters WHERE channel = ? AND time_start <= ? AND time_end >= ? ORDER BY time_start DESC limit 1"));
+	statements.push_back(db.prepare("SELECT isstring, key, value FROM attributes WHERE rasterid = ?"));
+	statements.push_back(db.prepare("SELECT MAX(zoom) FROM tiles WHERE rasterid = ? AND zoom <= ?"));
+	statements.push_back(db.prepare("SELECT id,x1,y1,z1,x2,y2,z2,filenr,fileoffset,filebytes,compression FROM tiles"
+		" WHERE rasterid = ? AND zoom = ? AND x1 < ? AND y1 < ? AND x2 > ? AND y2 > ? ORDER BY filenr ASC, fileoffset ASC"));
+}
+
+void LocalRasterDBBackend::ReadConnection::reset() {
+	for (auto &stmt : statements)
+		stmt.reset();
+}
+
+LocalRasterDBBackend::ReadConnectionGuard::ReadConnectionGuard(LocalRasterDBBackend &backend) : backend(backend) {
+	{
+		std::lock_guard<std::mutex> guard(backend.read_mutex);
+		if (!backend.read_connections.empty()) {
+			connection = std::move(backend.read_connections.back());
+			backend.read_connections.pop_back();
+		}
+	}
+	if (!connection)
+		connection = std::make_unique<ReadConnection>(backend.filename_db);
+}
+
+LocalRasterDBBackend::ReadConnectionGuard::~ReadConnectionGuard() {
+	connection->reset();
+	std::lock_guard<std::mutex> guard(backend.read_mutex);
+	backend.read_connections.push_back(std::move(connection));
+}
+
+
 LocalRasterDBBackend::LocalRasterDBBackend(const std::string &location, const ConfigurationTable& params) : lockedfile(-1), location(location) {
 }
 
@@ -105,10 +192,9 @@ void LocalRasterDBBackend::open(const std::string &_sourcename, bool writeable)
 	sourcename = _sourcename;
 	is_writeable = writeable;
 
-	std::string basepath = location + sourcename;
+	basepath = location + sourcename;
 
 	filename_json = basepath + ".json";
-	filename_data = basepath + ".dat";
 	filename_db = basepath + ".db";
 
 	/*
@@ -186,6 +272,8 @@ void LocalRasterDBBackend::open(const std::string &_sourcename, bool writeable)
 }
 
 void LocalRasterDBBackend::cleanup() {
+	read_connections.clear();
+	closeDataFiles();
 	if (lockedfile != -1) {
 		close(lockedfile); // also removes the lock acquired by flock()
 		lockedfile = -1;
@@ -257,10 +345,14 @@ void LocalRasterDBBackend::writeTile(rasterid_t rasterid, ByteBuffer &buffer, ui
 
 	int zoomfactor = 1 << zoom;
 
-	// Step 1: write data to disk
-	size_t filenr = 0;
+	// Step 1: write data to disk, appending to the newest data file
+	int filenr = 0;
+	auto stmt_filenr = db.prepare("SELECT MAX(filenr) FROM tiles");
+	if (stmt_filenr.next())
+		filenr = stmt_filenr.getInt(0);
+	stmt_filenr.finalize();
 
-	FILE *f = fopen(filename_data.c_str(), "a+b");
+	FILE *f = fopen(getDataFilename(filenr).c_str(), "a+b");
 	if (!f)
 		throw SourceException("Could not open data file");
 
@@ -340,7 +432,8 @@ RasterDBBackend::RasterDescription LocalRasterDBBackend::getClosestRaster(int ch
 		throw ArgumentException("Cannot call getClosestRaster() before open() on a RasterDBBackend");
 
 	// find a raster that's valid during the given timestamp
-	auto stmt = db.prepare("SELECT id, time_start, time_end FROM rasters WHERE channel = ? AND time_start <= ? AND time_end >= ? ORDER BY time_start DESC limit 1");
+	ReadConnectionGuard connection(*this);
+	auto &stmt = connection.get(ReadConnection::CLOSEST_RASTER);
 	stmt.bind(1, channelid);
 	stmt.bind(2, t1);
 	stmt.bind(3, t2);
@@ -350,7 +443,6 @@ RasterDBBackend::RasterDescription LocalRasterDBBackend::getClosestRaster(int ch
 	auto rasterid = stmt.getInt64(0);
 	double time_start = stmt.getDouble(1);
 	double time_end = stmt.getDouble(2);
-	stmt.finalize();
 	return RasterDescription{rasterid, time_start, time_end};
 }
 
@@ -358,7 +450,8 @@ void LocalRasterDBBackend::readAttributes(rasterid_t rasterid, AttributeMaps &at
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call readAttributes() before open() on a RasterDBBackend");
 
-	auto stmt_md = db.prepare("SELECT isstring, key, value FROM attributes WHERE rasterid = ?");
+	ReadConnectionGuard connection(*this);
+	auto &stmt_md = connection.get(ReadConnection::ATTRIBUTES);
 	stmt_md.bind(1, rasterid);
 	while (stmt_md.next()) {
 		int isstring = stmt_md.getInt(0);
@@ -377,14 +470,14 @@ int LocalRasterDBBackend::getBestZoom(rasterid_t rasterid, int desiredzoom) {
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call getBestZoom() before open() on a RasterDBBackend");
 
-	auto stmt_z = db.prepare("SELECT MAX(zoom) FROM tiles WHERE rasterid = ? AND zoom <= ?");
+	ReadConnectionGuard connection(*this);
+	auto &stmt_z = connection.get(ReadConnection::BEST_ZOOM);
 	stmt_z.bind(1, rasterid);
 	stmt_z.bind(2, desiredzoom);
 
 	int max_zoom = -1;
 	if (stmt_z.next())
 		max_zoom = stmt_z.getInt(0);
-	stmt_z.finalize();
 
 	if (max_zoom < 0)
 		throw SourceException("No zoom level found for the given channel and timestamp");
@@ -399,8 +492,8 @@ const std::vector<RasterDBBackend::TileDescription> LocalRasterDBBackend::enumer
 	std::vector<TileDescription> result;
 
 	// find all overlapping rasters in DB
-	auto stmt = db.prepare("SELECT id,x1,y1,z1,x2,y2,z2,filenr,fileoffset,filebytes,compression FROM tiles"
-		" WHERE rasterid = ? AND zoom = ? AND x1 < ? AND y1 < ? AND x2 > ? AND y2 > ? ORDER BY filenr ASC, fileoffset ASC");
+	ReadConnectionGuard connection(*this);
+	auto &stmt = connection.get(ReadConnection::TILES);
 
 	stmt.bind(1, rasterid);
 	stmt.bind(2, zoom);
@@ -430,7 +523,6 @@ const std::vector<RasterDBBackend::TileDescription> LocalRasterDBBackend::enumer
 		result.push_back(TileDescription{tileid, channelid, fileid, fileoffset, filebytes, r_x1, r_y1, 0, tile_width, tile_height, tile_depth, method});
 	}
 
-	stmt.finalize();
 	return result;
 }
 
@@ -459,45 +551,144 @@ bool LocalRasterDBBackend::hasTile(rasterid_t rasterid, uint32_t width, uint32_t
 	return result;
 }
 
-std::unique_ptr<ByteBuffer> LocalRasterDBBackend::readTile(const TileDescription &tiledesc) {
-	if (!this->is_opened)
-		throw ArgumentException("Cannot call readTile() before open() on a RasterDBBackend");
+std::string LocalRasterDBBackend::getDataFilename(int fileid) {
+	// file 0 has no number for compatibility with sources created before there were multiple files
+	if (fileid == 0)
+		return basepath + ".dat";
+	return concat(basepath, ".", fileid, ".dat");
+}
+
+int LocalRasterDBBackend::getDataFile(int fileid) {
+	// Data files are only created by imports, so they are opened on first use.
+	std::lock_guard<std::mutex> guard(read_mutex);
+	auto it = datafiles.find(fileid);
+	if (it != datafiles.end())
+		return it->second;
 
-#define USE_POSIX_IO true
-#if USE_POSIX_IO
-	int f = ::open(filename_data.c_str(), O_RDONLY | O_CLOEXEC); // | O_NOATIME
+	int f = ::open(getDataFilename(fileid).c_str(), O_RDONLY | O_CLOEXEC); // | O_NOATIME
 	if (f < 0)
 		throw SourceException("Could not open data file");
+	datafiles[fileid] = f;
+	return f;
+}
+
+void LocalRasterDBBackend::closeDataFiles() {
+	std::lock_guard<std::mutex> guard(read_mutex);
+	for (auto &datafile : datafiles)
+		close(datafile.second);
+	datafiles.clear();
+}
+
+std::unique_ptr<ByteBuffer> LocalRasterDBBackend::readTile(const TileDescription &tiledesc) {
+	if (!this->is_opened)
+		throw ArgumentException("Cannot call readTile() before open() on a RasterDBBackend");
 
+	// pread() does not modify the file offset, so all threads can share one descriptor
+	int f = getDataFile(tiledesc.fileid);
 	auto buffer = std::make_unique<ByteBuffer>(tiledesc.size);
-	if (lseek(f, (off_t) tiledesc.offset, SEEK_SET) != (off_t) tiledesc.offset) {
-		close(f);
-		throw SourceException("seek failed");
+	size_t bytes_read = 0;
+	while (bytes_read < tiledesc.size) {
+		ssize_t r = pread(f, buffer->data + bytes_read, tiledesc.size - bytes_read, (off_t) (tiledesc.offset + bytes_read));
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			throw SourceException("read failed");
+		bytes_read += r;
 	}
+	return buffer;
+}
 
-	if (read(f, buffer->data, tiledesc.size) != (ssize_t) tiledesc.size) {
-		close(f);
-		throw SourceException("read failed");
+/*
+ * All tiles are written to a new data file. The tiles are switched to their new location in a single
+ * transaction, so the source stays consistent if the process is interrupted. Afterwards, the old data files are removed.
+ * Tiles shared by linked rasters are only stored once.
+ */
+void LocalRasterDBBackend::rewriteTiles(const TileRewriter &rewrite) {
+	if (!this->is_opened || !this->is_writeable)
+		throw ArgumentException("Cannot call rewriteTiles() on a RasterDBBackend not opened for writing");
+
+	std::vector<TileDescription> tiles;
+	// tiles without a raster are moved as well, with channel -1
+	auto stmt = db.prepare("SELECT t.id, COALESCE(r.channel, -1), t.filenr, t.fileoffset, t.filebytes, t.x1, t.y1, t.x2, t.y2, t.zoom, t.compression"
+		" FROM tiles t LEFT JOIN rasters r ON t.rasterid = r.id ORDER BY t.filenr ASC, t.fileoffset ASC");
+	while (stmt.next()) {
+		int zoom = stmt.getInt(9);
+		uint32_t x1 = stmt.getInt(5), y1 = stmt.getInt(6), x2 = stmt.getInt(7), y2 = stmt.getInt(8);
+		tiles.push_back(TileDescription{stmt.getInt64(0), stmt.getInt(1), stmt.getInt(2), (size_t) stmt.getInt64(3), (size_t) stmt.getInt64(4),
+			x1, y1, 0, (x2-x1) >> zoom, (y2-y1) >> zoom, 0, stmt.getString(10)});
 	}
-	close(f);
-#else
-	FILE *f = fopen(filename_data.c_str(), "rb");
-	if (!f)
-		throw SourceException("Could not open data file");
+	stmt.finalize();
 
-	if (fseek(f, offset, SEEK_SET) != 0) {
-		fclose(f);
-		throw SourceException("seek failed");
+	std::vector<int> old_files;
+	for (auto &tile : tiles) {
+		if (std::find(old_files.begin(), old_files.end(), tile.fileid) == old_files.end())
+			old_files.push_back(tile.fileid);
 	}
+	int new_file = old_files.empty() ? 1 : *std::max_element(old_files.begin(), old_files.end()) + 1;
+	auto new_filename = getDataFilename(new_file);
 
-	auto buffer = std::make_unique<ByteBuffer>(tiledesc.size);
-	if (fread(buffer->data, sizeof(unsigned char), tiledesc.size, f) != tiledesc.size) {
+	FILE *f = fopen(new_filename.c_str(), "wb");
+	if (!f)
+		throw SourceException("Could not create data file");
+
+	struct Location {
+		size_t offset;
+		size_t size;
+		std::string compression;
+	};
+	std::map<std::pair<int, size_t>, Location> rewritten;
+	size_t fileoffset = 0;
+	try {
+		for (auto &tile : tiles) {
+			auto key = std::make_pair(tile.fileid, tile.offset);
+			if (rewritten.count(key) > 0)
+				continue;
+
+			auto data = readTile(tile);
+			std::string compression = tile.compression;
+			auto new_data = rewrite(tile, *data, compression);
+			ByteBuffer &out = new_data ? *new_data : *data;
+
+			if (fwrite(out.data, sizeof(unsigned char), out.size, f) != out.size)
+				throw SourceException("writing failed, disk full?");
+			rewritten[key] = Location{fileoffset, out.size, compression};
+			fileoffset += out.size;
+		}
+		if (fflush(f) != 0 || fsync(fileno(f)) != 0)
+			throw SourceException("writing failed, disk full?");
 		fclose(f);
-		throw SourceException("read failed");
+		f = nullptr;
+
+		db.exec("BEGIN TRANSACTION");
+		auto stmt_update = db.prepare("UPDATE tiles SET filenr = ?, fileoffset = ?, filebytes = ?, compression = ? WHERE id = ?");
+		for (auto &tile : tiles) {
+			auto &location = rewritten.at(std::make_pair(tile.fileid, tile.offset));
+			stmt_update.bind(1, new_file);
+			stmt_update.bind(2, (int64_t) location.offset);
+			stmt_update.bind(3, (int64_t) location.size);
+			stmt_update.bind(4, location.compression);
+			stmt_update.bind(5, tile.tileid);
+			stmt_update.exec();
+		}
+		stmt_update.finalize();
+		db.exec("COMMIT");
 	}
-	fclose(f);
-#endif
-	return buffer;
+	catch (...) {
+		if (f)
+			fclose(f);
+		try {
+			db.exec("ROLLBACK");
+		}
+		catch (const SQLiteException &) {
+			// no transaction was started
+		}
+		unlink(new_filename.c_str());
+		throw;
+	}
+
+	closeDataFiles();
+	for (auto fileid : old_files)
+		unlink(getDataFilename(fileid).c_str());
 }
 
 
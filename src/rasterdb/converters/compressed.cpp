@@ -0,0 +1,239 @@
+#include "rasterdb/converters/converter.h"
+#include "util/configuration.h"
+
+#include <cstring>
+#include <memory>
+#include <lz4.h>
+#include <zstd.h>
+
+
+/**
+ * PredictingConverter: base class for converters compressing the raw buffer with a fast codec.
+ *
+ * Before compression, an optional predictor rearranges the pixels to make them more compressible:
+ * - DELTA stores each pixel as the difference to its left neighbour. Differences are computed on the
+ *   bit pattern of the pixels (modulo 2^n), so they are lossless for integer and float rasters alike.
+ * - SHUFFLE groups the n-th bytes of all pixels together, so similar bytes are stored next to each other.
+ */
+class PredictingConverter : public RasterConverter {
+	public:
+		enum class Predictor {
+			NONE,
+			DELTA,
+			SHUFFLE
+		};
+
+		PredictingConverter(Predictor predictor);
+		virtual std::unique_ptr<ByteBuffer> encode(GenericRaster *raster);
+		virtual std::unique_ptr<GenericRaster> decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth);
+
+	protected:
+		virtual size_t compressBound(size_t size) = 0;
+		// returns the compressed size
+		virtual size_t compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) = 0;
+		virtual void decompress(const char *src, size_t src_size, char *dst, size_t dst_size) = 0;
+
+	private:
+		Predictor predictor;
+};
+
+
+template<typename T>
+static void deltaEncode(T *data, size_t width, size_t rows) {
+	for (size_t y = 0; y < rows; y++) {
+		T *row = data + y * width;
+		for (size_t x = width - 1; x > 0; x--)
+			row[x] = (T) (row[x] - row[x-1]);
+	}
+}
+
+template<typename T>
+static void deltaDecode(T *data, size_t width, size_t rows) {
+	for (size_t y = 0; y < rows; y++) {
+		T *row = data + y * width;
+		for (size_t x = 1; x < width; x++)
+			row[x] = (T) (row[x] + row[x-1]);
+	}
+}
+
+static void applyDelta(char *data, size_t size, int bpp, uint32_t width, bool encode) {
+	if (width == 0 || size == 0)
+		return;
+	size_t rows = size / ((size_t) bpp * width);
+	switch (bpp) {
+		case 1:
+			encode ? deltaEncode((uint8_t *) data, width, rows) : deltaDecode((uint8_t *) data, width, rows);
+			break;
+		case 2:
+			encode ? deltaEncode((uint16_t *) data, width, rows) : deltaDecode((uint16_t *) data, width, rows);
+			break;
+		case 4:
+			encode ? deltaEncode((uint32_t *) data, width, rows) : deltaDecode((uint32_t *) data, width, rows);
+			break;
+		case 8:
+			encode ? deltaEncode((uint64_t *) data, width, rows) : deltaDecode((uint64_t *) data, width, rows);
+			break;
+		default:
+			throw ConverterException(concat("Cannot apply delta predictor to pixels of ", bpp, " bytes"));
+	}
+}
+
+static void shuffle(const char *src, char *dst, size_t size, int bpp) {
+	size_t count = size / bpp;
+	for (int b = 0; b < bpp; b++) {
+		char *out = dst + b * count;
+		for (size_t i = 0; i < count; i++)
+			out[i] = src[i * bpp + b];
+	}
+}
+
+static void unshuffle(const char *src, char *dst, size_t size, int bpp) {
+	size_t count = size / bpp;
+	for (int b = 0; b < bpp; b++) {
+		const char *in = src + b * count;
+		for (size_t i = 0; i < count; i++)
+			dst[i * bpp + b] = in[i];
+	}
+}
+
+
+PredictingConverter::PredictingConverter(Predictor predictor) : predictor(predictor) {
+}
+
+std::unique_ptr<ByteBuffer> PredictingConverter::encode(GenericRaster *raster) {
+	size_t raw_size = raster->getDataSize();
+	const char *raw = (const char *) raster->getData();
+	int bpp = raster->getBPP();
+
+	std::unique_ptr<char[]> predicted;
+	if (predictor == Predictor::DELTA) {
+		predicted.reset(new char[raw_size]);
+		memcpy(predicted.get(), raw, raw_size);
+		applyDelta(predicted.get(), raw_size, bpp, raster->width, true);
+		raw = predicted.get();
+	}
+	else if (predictor == Predictor::SHUFFLE && bpp > 1) {
+		predicted.reset(new char[raw_size]);
+		shuffle(raw, predicted.get(), raw_size, bpp);
+		raw = predicted.get();
+	}
+
+	size_t capacity = compressBound(raw_size);
+	std::unique_ptr<char[]> compressed(new char[capacity]);
+	size_t compressed_size = compress(raw, raw_size, compressed.get(), capacity);
+
+	return std::make_unique<ByteBuffer>(compressed.release(), compressed_size);
+}
+
+std::unique_ptr<GenericRaster> PredictingConverter::decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth) {
+	auto raster = GenericRaster::create(datadescription, stref, width, height, depth);
+
+	char *data = (char *) raster->getDataForWriting();
+	size_t size = raster->getDataSize();
+	int bpp = raster->getBPP();
+
+	if (predictor == Predictor::SHUFFLE && bpp > 1) {
+		std::unique_ptr<char[]> shuffled(new char[size]);
+		decompress(buffer.data, buffer.size, shuffled.get(), size);
+		unshuffle(shuffled.get(), data, size, bpp);
+	}
+	else {
+		decompress(buffer.data, buffer.size, data, size);
+		if (predictor == Predictor::DELTA)
+			applyDelta(data, size, bpp, width, false);
+	}
+
+	return raster;
+}
+
+
+
+/**
+ * LZ4Converter: raw buffer, compressed with LZ4 for fast decompression
+ */
+class LZ4Converter : public PredictingConverter {
+	public:
+		LZ4Converter(Predictor predictor = Predictor::NONE) : PredictingConverter(predictor) {}
+	protected:
+		virtual size_t compressBound(size_t size);
+		virtual size_t compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+		virtual void decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+};
+REGISTER_RASTERCONVERTER(LZ4Converter, "LZ4");
+
+class LZ4DeltaConverter : public LZ4Converter {
+	public:
+		LZ4DeltaConverter() : LZ4Converter(Predictor::DELTA) {}
+};
+REGISTER_RASTERCONVERTER(LZ4DeltaConverter, "LZ4_DELTA");
+
+class LZ4ShuffleConverter : public LZ4Converter {
+	public:
+		LZ4ShuffleConverter() : LZ4Converter(Predictor::SHUFFLE) {}
+};
+REGISTER_RASTERCONVERTER(LZ4ShuffleConverter, "LZ4_SHUFFLE");
+
+size_t LZ4Converter::compressBound(size_t size) {
+	if (size > LZ4_MAX_INPUT_SIZE)
+		throw ConverterException("Raster too large for LZ4 compression");
+	return LZ4_compressBound((int) size);
+}
+
+size_t LZ4Converter::compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+	int res = LZ4_compress_default(src, dst, (int) src_size, (int) dst_capacity);
+	if (res <= 0 && src_size > 0)
+		throw ConverterException("Error on LZ4 compress");
+	return res;
+}
+
+void LZ4Converter::decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+	int res = LZ4_decompress_safe(src, dst, (int) src_size, (int) dst_size);
+	if (res < 0 || (size_t) res != dst_size)
+		throw SourceException("Error on LZ4 decompress");
+}
+
+
+
+/**
+ * ZstdConverter: raw buffer, compressed with zstd.
+ * The compression level is taken from the setting "rasterdb.compression.zstd_level".
+ */
+class ZstdConverter : public PredictingConverter {
+	public:
+		ZstdConverter(Predictor predictor = Predictor::NONE) : PredictingConverter(predictor) {}
+	protected:
+		virtual size_t compressBound(size_t size);
+		virtual size_t compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+		virtual void decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+};
+REGISTER_RASTERCONVERTER(ZstdConverter, "ZSTD");
+
+class ZstdDeltaConverter : public ZstdConverter {
+	public:
+		ZstdDeltaConverter() : ZstdConverter(Predictor::DELTA) {}
+};
+REGISTER_RASTERCONVERTER(ZstdDeltaConverter, "ZSTD_DELTA");
+
+class ZstdShuffleConverter : public ZstdConverter {
+	public:
+		ZstdShuffleConverter() : ZstdConverter(Predictor::SHUFFLE) {}
+};
+REGISTER_RASTERCONVERTER(ZstdShuffleConverter, "ZSTD_SHUFFLE");
+
+size_t ZstdConverter::compressBound(size_t size) {
+	return ZSTD_compressBound(size);
+}
+
+size_t ZstdConverter::compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+	int level = Configuration::get<int>("rasterdb.compression.zstd_level", 9);
+	size_t res = ZSTD_compress(dst, dst_capacity, src, src_size, level);
+	if (ZSTD_isError(res))
+		throw ConverterException(concat("Error on zstd compress: ", ZSTD_getErrorName(res)));
+	return res;
+}
+
+void ZstdConverter::decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+	size_t res = ZSTD_decompress(dst, dst_size, src, src_size);
+	if (ZSTD_isError(res) || res != dst_size)
+		throw SourceException("Error on zstd decompress");
+}
@@ -2,6 +2,7 @@
 #include "datatypes/raster/raster_priv.h"
 #include "rasterdb/converters/converter.h"
 
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 
@@ -42,3 +43,12 @@ std::unique_ptr<RasterConverter> RasterConverter::getConverter(const std::string
 	auto constructor = map->at(method);
 	return constructor();
 }
+
+std::vector<std::string> RasterConverter::getConverterNames() {
+	auto map = getRegisteredConstructorsMap();
+	std::vector<std::string> names;
+	for (auto &entry : *map)
+		names.push_back(entry.first);
+	std::sort(names.begin(), names.end());
+	return names;
+}
@@ -3,6 +3,9 @@
 
 #include "datatypes/raster.h"
 
+#include <string>
+#include <vector>
+
 
 class ByteBuffer {
 	public:
@@ -27,6 +30,7 @@ class RasterConverter {
 		static std::unique_ptr<GenericRaster> direct_decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth, const std::string &method);
 
 		static std::unique_ptr<RasterConverter> getConverter(const std::string &method);
+		static std::vector<std::string> getConverterNames();
 
 		virtual std::unique_ptr<ByteBuffer> encode(GenericRaster *raster) = 0;
 		virtual std::unique_ptr<GenericRaster> decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth) = 0;
@@ -3,6 +3,7 @@
 #include "datatypes/raster/typejuggling.h"
 #include "rasterdb/rasterdb.h"
 #include "rasterdb/backend.h"
+#include "rasterdb/tilecache.h"
 #include "converters/converter.h"
 #include "util/sqlite.h"
 #include "util/configuration.h"
@@ -160,7 +161,7 @@ std::unique_ptr<RasterDBBackend> instantiate_backend() {
 
 
 RasterDB::RasterDB(const char *sourcename, bool writeable)
-	: writeable(writeable), crs(nullptr), channelcount(0), channels(nullptr) {
+	: sourcename(sourcename), writeable(writeable), crs(nullptr), channelcount(0), channels(nullptr) {
 	try {
 		backend = instantiate_backend();
 		backend->open(sourcename, writeable);
@@ -295,7 +296,7 @@ void RasterDB::import(const char *filename, int sourcechannel, int channelid, do
 	if (!isWriteable())
 		throw SourceException("Cannot import into a source opened as read-only");
 
-	std::lock_guard<std::mutex> guard(mutex);
+	std::lock_guard<std::shared_timed_mutex> guard(mutex);
 
 	bool raster_flipx, raster_flipy;
 	auto raster = GenericRaster::fromGDAL(filename, sourcechannel, raster_flipx, raster_flipy, crs->crsId);
@@ -391,6 +392,8 @@ void RasterDB::import(GenericRaster *raster, int channelid, double time_start, d
 			}
 		}
 	}
+	// a recreated source may place new tiles where the tiles of its predecessor were
+	RasterDBTileCache::getInstance().invalidate(sourcename);
 }
 
 
@@ -398,11 +401,39 @@ void RasterDB::linkRaster(int channelid, double time_of_reference, double time_s
 	if (!isWriteable())
 		throw SourceException("Cannot link rasters in a source opened as read-only");
 
-	std::lock_guard<std::mutex> guard(mutex);
+	std::lock_guard<std::shared_timed_mutex> guard(mutex);
 	backend->linkRaster(channelid, time_of_reference, time_start, time_end);
 }
 
 
+void RasterDB::recompress(const std::string &compression) {
+	if (!isWriteable())
+		throw SourceException("Cannot recompress a source opened as read-only");
+
+	// fail early on unknown methods
+	RasterConverter::getConverter(compression);
+
+	std::lock_guard<std::shared_timed_mutex> guard(mutex);
+	size_t tiles = 0, bytes_before = 0, bytes_after = 0;
+	backend->rewriteTiles([&] (const RasterDBBackend::TileDescription &tile, ByteBuffer &data, std::string &tile_compression) -> std::unique_ptr<ByteBuffer> {
+		tiles++;
+		bytes_before += data.size;
+		if (tile_compression == compression || tile.channelid < 0 || tile.channelid >= channelcount) {
+			bytes_after += data.size;
+			return nullptr;
+		}
+
+		auto raster = RasterConverter::direct_decode(data, channels[tile.channelid]->dd, SpatioTemporalReference::unreferenced(), tile.width, tile.height, tile.depth, tile.compression);
+		auto buffer = RasterConverter::direct_encode(raster.get(), compression);
+		tile_compression = compression;
+		bytes_after += buffer->size;
+		return buffer;
+	});
+	RasterDBTileCache::getInstance().invalidate(sourcename);
+	printf("recompressed %lu tiles to %s, size: %lu -> %lu\n", tiles, compression.c_str(), bytes_before, bytes_after);
+}
+
+
 template<typename T1, typename T2>
 struct raster_transformed_blit {
 	static void execute(Raster2D<T1> *raster_dest, Raster2D<T2> *raster_src, int destx, int desty, int destz, double offset, double scale) {
@@ -427,16 +458,21 @@ struct raster_transformed_blit {
 };
 
 
-static void transformedBlit(GenericRaster *dest, GenericRaster *src, int destx, int desty, int destz, double offset, double scale) {
+static void transformedBlit(GenericRaster *dest, const GenericRaster *src, int destx, int desty, int destz, double offset, double scale) {
 	if (src->getRepresentation() != GenericRaster::Representation::CPU || dest->getRepresentation() != GenericRaster::Representation::CPU)
 		throw MetadataException("transformedBlit from raster that's not in a CPU buffer");
 
-	callBinaryOperatorFunc<raster_transformed_blit>(dest, src, destx, desty, destz, offset, scale);
+	// the source is only read
+	callBinaryOperatorFunc<raster_transformed_blit>(dest, const_cast<GenericRaster *>(src), destx, desty, destz, offset, scale);
 }
 
-std::unique_ptr<GenericRaster> RasterDB::load(int channelid, const TemporalReference &t, int x1, int y1, int x2, int y2, int zoom, bool transform, size_t *io_cost) {
+std::unique_ptr<GenericRaster> RasterDB::load(int channelid, const TemporalReference &t, int x1, int y1, int x2, int y2, int zoom, bool transform, size_t *io_cost, size_t *tiles_cached, size_t *tiles_loaded) {
 	if (io_cost)
 		*io_cost = 0;
+	if (tiles_cached)
+		*tiles_cached = 0;
+	if (tiles_loaded)
+		*tiles_loaded = 0;
 
 	if (channelid < 0 || channelid >= channelcount)
 		throw SourceException("RasterDB::load: unknown channel");
@@ -497,19 +533,32 @@ std::unique_ptr<GenericRaster> RasterDB::load(int channelid, const TemporalRefer
 	//if (tiles.size() <= 0)
 	//	throw SourceException("RasterDB::load(): No matching tiles found in DB");
 
+	// Decoded tiles are shared with the tile cache, so they must not be modified.
+	auto &tilecache = RasterDBTileCache::getInstance();
 	for (auto &tile : tiles) {
-		auto tile_buffer = backend->readTile(tile);
-
-		auto tile_raster = RasterConverter::direct_decode(*tile_buffer, channels[channelid]->dd, SpatioTemporalReference::unreferenced(), tile.width, tile.height, tile.depth, tile.compression);
-		if (io_cost)
-			*io_cost += tile.size;
+		RasterDBTileCache::Key key(sourcename, tile.fileid, tile.offset);
+		std::shared_ptr<const GenericRaster> tile_raster = tilecache.get(key);
+		if (tile_raster) {
+			if (tiles_cached)
+				(*tiles_cached)++;
+		}
+		else {
+			auto tile_buffer = backend->readTile(tile);
+			tile_raster = RasterConverter::direct_decode(*tile_buffer, channels[channelid]->dd, SpatioTemporalReference::unreferenced(), tile.width, tile.height, tile.depth, tile.compression);
+			tilecache.put(key, tile_raster);
+			if (io_cost)
+				*io_cost += tile.size;
+			if (tiles_loaded)
+				(*tiles_loaded)++;
+		}
 
 		if (loaded_zoom != returned_zoom) {
 			auto new_width = tile_raster->width >> (returned_zoom - loaded_zoom);
 			auto new_height = tile_raster->height >> (returned_zoom - loaded_zoom);
 			if (new_width <= 0 || new_height <= 0)
 				continue;
-			tile_raster = tile_raster->scale(new_width, new_height);
+			// scale() creates a new raster and does not modify tiles already in CPU memory
+			tile_raster = const_cast<GenericRaster &>(*tile_raster).scale(new_width, new_height);
 		}
 
 		int64_t blit_dest_x = ((int64_t) tile.x1-x1) >> returned_zoom;
@@ -554,7 +603,7 @@ std::unique_ptr<GenericRaster> RasterDB::query(const QueryRectangle &rect, Query
 	if (crs->crsId != rect.crsId)
 		throw OperatorException(concat("SourceOperator: wrong crsId requested. Source is ", crs->crsId.to_string(), ", requested ", rect.crsId.to_string()));
 
-	std::lock_guard<std::mutex> guard(mutex);
+	std::shared_lock<std::shared_timed_mutex> guard(mutex);
 
 	// Get all pixel coordinates that need to be returned. The endpoints of the QueryRectangle are inclusive.
 	// floor() returns the index of the pixel containing our boundary points.
@@ -586,9 +635,10 @@ std::unique_ptr<GenericRaster> RasterDB::query(const QueryRectangle &rect, Query
 	pixel_y1 = round_down_to_multiple(pixel_y1, zoomfactor);
 	pixel_y2 = round_down_to_multiple(pixel_y2 - 1, zoomfactor) + zoomfactor;
 
-	size_t io_costs = 0;
-	auto result = load(channelid, (const TemporalReference &) rect, pixel_x1, pixel_y1, pixel_x2, pixel_y2, zoom, transform, &io_costs);
+	size_t io_costs = 0, tiles_cached = 0, tiles_loaded = 0;
+	auto result = load(channelid, (const TemporalReference &) rect, pixel_x1, pixel_y1, pixel_x2, pixel_y2, zoom, transform, &io_costs, &tiles_cached, &tiles_loaded);
 	profiler.addIOCost(io_costs);
+	profiler.addTileCacheAccesses(tiles_cached, tiles_loaded);
 	return result;
 }
 
@@ -5,6 +5,7 @@
 #include <exception>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 
 #include "datatypes/raster.h"
 #include "rasterdb/converters/converter.h"
@@ -98,6 +99,8 @@ class RasterDB {
 	public:
 		void import(const char *filename, int sourcechannel, int channelid, double time_start, double time_end, const std::string &compression); //  = "GZIP"
 		void linkRaster(int channelid, double time_of_reference, double time_start, double time_end);
+		// re-encodes all tiles of this source with the given compression
+		void recompress(const std::string &compression);
 		std::unique_ptr<GenericRaster> query(const QueryRectangle &rect, QueryProfiler &profiler, int channelid, bool transform = true);
 
 		const Provenance *getProvenance() const { return provenance.get(); }
@@ -108,18 +111,20 @@ class RasterDB {
 
 	private:
 		void import(GenericRaster *raster, int channelid, double time_start, double time_end, const std::string &compression); //  = "GZIP"
-		std::unique_ptr<GenericRaster> load(int channelid, const TemporalReference &t, int x1, int y1, int x2, int y2, int zoom = 0, bool transform = true, size_t *io_cost = nullptr);
+		std::unique_ptr<GenericRaster> load(int channelid, const TemporalReference &t, int x1, int y1, int x2, int y2, int zoom = 0, bool transform = true, size_t *io_cost = nullptr, size_t *tiles_cached = nullptr, size_t *tiles_loaded = nullptr);
 
 		void init();
 		void cleanup();
 
+		const std::string sourcename;
 		bool writeable;
 		std::unique_ptr<RasterDBBackend> backend;
 		GDALCRS *crs;
 		int channelcount;
 		RasterDBChannel **channels;
 		std::unique_ptr<Provenance> provenance;
-		std::mutex mutex;
+		// queries share the lock, imports and links hold it exclusively
+		std::shared_timed_mutex mutex;
 };
 
 #endif
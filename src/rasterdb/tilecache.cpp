@@ -0,0 +1,73 @@
+#include "rasterdb/tilecache.h"
+#include "util/configuration.h"
+
+
+RasterDBTileCache &RasterDBTileCache::getInstance() {
+	static RasterDBTileCache instance(Configuration::get<size_t>("rasterdb.tilecache.size", 268435456));
+	return instance;
+}
+
+RasterDBTileCache::RasterDBTileCache(size_t capacity) : capacity(capacity), size(0) {
+}
+
+std::shared_ptr<const GenericRaster> RasterDBTileCache::get(const Key &key) {
+	if (capacity == 0)
+		return nullptr;
+
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = entries.find(key);
+	if (it == entries.end())
+		return nullptr;
+	lru.splice(lru.begin(), lru, it->second);
+	return it->second->tile;
+}
+
+void RasterDBTileCache::put(const Key &key, std::shared_ptr<const GenericRaster> tile) {
+	size_t tile_size = tile->getDataSize();
+	if (tile_size > capacity)
+		return;
+
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = entries.find(key);
+	if (it != entries.end()) {
+		// another query decoded the same tile concurrently
+		lru.splice(lru.begin(), lru, it->second);
+		return;
+	}
+	lru.emplace_front(key, std::move(tile), tile_size);
+	entries.emplace(key, lru.begin());
+	size += tile_size;
+	evict();
+}
+
+void RasterDBTileCache::invalidate(const std::string &source) {
+	std::lock_guard<std::mutex> guard(mutex);
+	for (auto it = lru.begin(); it != lru.end(); ) {
+		if (it->key.source == source) {
+			size -= it->size;
+			entries.erase(it->key);
+			it = lru.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+size_t RasterDBTileCache::getSize() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return size;
+}
+
+size_t RasterDBTileCache::getTileCount() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return lru.size();
+}
+
+void RasterDBTileCache::evict() {
+	while (size > capacity) {
+		auto &last = lru.back();
+		size -= last.size;
+		entries.erase(last.key);
+		lru.pop_back();
+	}
+}
@@ -0,0 +1,89 @@
+#ifndef RASTERDB_TILECACHE_H
+#define RASTERDB_TILECACHE_H
+
+#include "datatypes/raster.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * A bounded LRU cache of decoded RasterDB tiles, shared by all sources of the process.
+ *
+ * Tiles are identified by the name of their source and their location in the source's data files.
+ * A tile is stored exactly once per source and zoom level, so the location also identifies raster and
+ * zoom. Tiles stay cached when a source is closed, so the next query opening it may use them.
+ * Cached tiles are immutable and may be used by several queries at once.
+ */
+class RasterDBTileCache {
+	public:
+		class Key {
+			public:
+				Key(const std::string &source, int fileid, size_t offset) : source(source), fileid(fileid), offset(offset) {}
+				bool operator==(const Key &other) const {
+					return source == other.source && fileid == other.fileid && offset == other.offset;
+				}
+
+				std::string source;
+				int fileid;
+				size_t offset;
+		};
+
+		/**
+		 * @return the process-wide cache. Its capacity in bytes is given by the setting "rasterdb.tilecache.size"
+		 */
+		static RasterDBTileCache &getInstance();
+
+		/**
+		 * @param capacity the maximum size of all cached tiles in bytes; 0 disables the cache
+		 */
+		explicit RasterDBTileCache(size_t capacity);
+		RasterDBTileCache(const RasterDBTileCache &) = delete;
+		RasterDBTileCache &operator=(const RasterDBTileCache &) = delete;
+
+		/**
+		 * @return the cached tile, or nullptr if the tile is not cached
+		 */
+		std::shared_ptr<const GenericRaster> get(const Key &key);
+
+		/**
+		 * Adds a tile, evicting the least recently used tiles if the capacity is exceeded.
+		 * Tiles larger than the capacity are not cached.
+		 */
+		void put(const Key &key, std::shared_ptr<const GenericRaster> tile);
+
+		/**
+		 * Removes all tiles of the given source
+		 */
+		void invalidate(const std::string &source);
+
+		size_t getCapacity() const { return capacity; }
+		size_t getSize();
+		size_t getTileCount();
+
+	private:
+		struct KeyHash {
+			size_t operator()(const Key &key) const {
+				return std::hash<std::string>()(key.source) ^ (std::hash<size_t>()(key.offset) * 31 + key.fileid);
+			}
+		};
+		struct Entry {
+			Entry(const Key &key, std::shared_ptr<const GenericRaster> tile, size_t size) : key(key), tile(std::move(tile)), size(size) {}
+			Key key;
+			std::shared_ptr<const GenericRaster> tile;
+			size_t size;
+		};
+
+		void evict();
+
+		const size_t capacity;
+		size_t size;
+		std::mutex mutex;
+		// most recently used first
+		std::list<Entry> lru;
+		std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <unistd.h>
 #include "util/base64.h"
 #include <Poco/URI.h>
 #include <Poco/Net/MultipartReader.h>
@@ -116,6 +117,34 @@ void parseGetData(Parameters &params) {
 	parseQuery(query_string, params);
 }
 
+/**
+ * Parses the HTTP headers from CGI variables, e.g. HTTP_IF_NONE_MATCH becomes if-none-match
+ */
+static void parseHeaderVariables(Parameters &headers, char **envp) {
+	for (char **var = envp; *var != nullptr; var++) {
+		const char *separator = strchr(*var, '=');
+		if (separator == nullptr || strncmp(*var, "HTTP_", 5) != 0)
+			continue;
+		std::string name(*var + 5, separator - *var - 5);
+		std::transform(name.begin(), name.end(), name.begin(), [](char c) { return c == '_' ? '-' : ::tolower(c); });
+		headers.insert(std::make_pair(name, std::string(separator + 1)));
+	}
+}
+
+/**
+ * Parses the headers of a HTTP request
+ */
+void parseRequestHeaders(Parameters &headers) {
+	parseHeaderVariables(headers, environ);
+}
+
+/**
+ * Parses the headers of a HTTP request FCGI
+ */
+void parseRequestHeaders(Parameters &headers, FCGX_Request &request) {
+	parseHeaderVariables(headers, request.envp);
+}
+
 /**
  * Parses POST data from a HTTP request FCGI
  */
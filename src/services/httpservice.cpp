@@ -12,7 +12,7 @@
 
 
 // The magic of type registration, see REGISTER_SERVICE in httpservice.h
-typedef std::unique_ptr<HTTPService> (*ServiceConstructor)(const Parameters& params, HTTPService::HTTPResponseStream& response, std::ostream &error);
+typedef std::unique_ptr<HTTPService> (*ServiceConstructor)(const Parameters& params, const Parameters &headers, HTTPService::HTTPResponseStream& response, std::ostream &error);
 
 static std::unordered_map< std::string, ServiceConstructor > *getRegisteredConstructorsMap() {
 	static std::unordered_map< std::string, ServiceConstructor > registered_constructors;
@@ -25,7 +25,7 @@ HTTPServiceRegistration::HTTPServiceRegistration(const char *name, ServiceConstr
 }
 
 
-std::unique_ptr<HTTPService> HTTPService::getRegisteredService(const std::string &name, const Parameters& params, HTTPResponseStream& response, std::ostream &error) {
+std::unique_ptr<HTTPService> HTTPService::getRegisteredService(const std::string &name, const Parameters& params, const Parameters &headers, HTTPResponseStream& response, std::ostream &error) {
 	auto map = getRegisteredConstructorsMap();
 	auto it = map->find(name);
 	if (it == map->end())
@@ -33,12 +33,12 @@ std::unique_ptr<HTTPService> HTTPService::getRegisteredService(const std::string
 
 	auto constructor = it->second;
 
-	auto ptr = constructor(params, response, error);
+	auto ptr = constructor(params, headers, response, error);
 	return ptr;
 }
 
-HTTPService::HTTPService(const Parameters& params, HTTPResponseStream& response, std::ostream &error)
-	: params(params), response(response), error(error) {
+HTTPService::HTTPService(const Parameters& params, const Parameters &headers, HTTPResponseStream& response, std::ostream &error)
+	: params(params), headers(headers), response(response), error(error) {
 }
 
 void HTTPService::run(std::streambuf *in, std::streambuf *out, std::streambuf *err) {
@@ -53,9 +53,11 @@ void HTTPService::run(std::streambuf *in, std::streambuf *out, std::streambuf *e
 		Parameters params;
 		parseGetData(params);
 		parsePostData(params, input);
+		Parameters headers;
+		parseRequestHeaders(headers);
 
 		auto servicename = params.get("service");
-		auto service = HTTPService::getRegisteredService(servicename, params, response, error);
+		auto service = HTTPService::getRegisteredService(servicename, params, headers, response, error);
 
 		service->run();
 	}
@@ -89,9 +91,11 @@ void HTTPService::run(std::streambuf *in, std::streambuf *out, std::streambuf *e
 		Parameters params;
 		parseGetData(params, request);
 		parsePostData(params, input, request);
+		Parameters headers;
+		parseRequestHeaders(headers, request);
 
 		auto servicename = params.get("service");
-		auto service = HTTPService::getRegisteredService(servicename, params, response, error);
+		auto service = HTTPService::getRegisteredService(servicename, params, headers, response, error);
 
 		service->run();
 	}
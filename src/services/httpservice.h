@@ -72,13 +72,13 @@ class HTTPService {
 				bool headers_sent;
 		};
 
-		HTTPService(const Parameters& params, HTTPResponseStream& response, std::ostream &error);
+		HTTPService(const Parameters& params, const Parameters &headers, HTTPResponseStream& response, std::ostream &error);
 	protected:
 		HTTPService(const HTTPService &other) = delete;
 		HTTPService &operator=(const HTTPService &other) = delete;
 
 		virtual void run() = 0;
-		static std::unique_ptr<HTTPService> getRegisteredService(const std::string &name,const Parameters &params, HTTPResponseStream &response, std::ostream &error);
+		static std::unique_ptr<HTTPService> getRegisteredService(const std::string &name,const Parameters &params, const Parameters &headers, HTTPResponseStream &response, std::ostream &error);
 
 		/**
 		 * Process the given query and validate the permissions of the user
@@ -102,6 +102,8 @@ class HTTPService {
 		static bool clearExceptionJsonFromConfidential(Json::Value &exceptionJson);
 
 		const Parameters &params;
+		// the request headers, with lower case names
+		const Parameters &headers;
 		HTTPResponseStream &response;
 		std::ostream &error;
 	public:
@@ -116,10 +118,10 @@ class HTTPService {
 
 class HTTPServiceRegistration {
 	public:
-		HTTPServiceRegistration(const char *name, std::unique_ptr<HTTPService> (*constructor)(const Parameters &params, HTTPService::HTTPResponseStream &response, std::ostream &error));
+		HTTPServiceRegistration(const char *name, std::unique_ptr<HTTPService> (*constructor)(const Parameters &params, const Parameters &headers, HTTPService::HTTPResponseStream &response, std::ostream &error));
 };
 
-#define REGISTER_HTTP_SERVICE(classname, name) static std::unique_ptr<HTTPService> create##classname(const Parameters &params, HTTPService::HTTPResponseStream &response, std::ostream &error) { return std::make_unique<classname>(params, response, error); } static HTTPServiceRegistration register_##classname(name, create##classname)
+#define REGISTER_HTTP_SERVICE(classname, name) static std::unique_ptr<HTTPService> create##classname(const Parameters &params, const Parameters &headers, HTTPService::HTTPResponseStream &response, std::ostream &error) { return std::make_unique<classname>(params, headers, response, error); } static HTTPServiceRegistration register_##classname(name, create##classname)
 
 
 #endif
@@ -133,14 +133,31 @@ SpatialReference OGCService::parseBBOX(const std::string bbox_str, CrsId crsId,
 
 
 
-void OGCService::outputImage(GenericRaster &raster, bool flipx, bool flipy, const Colorizer &colorizer, Raster2D<uint8_t> *overlay) {
-		if (!response.hasSentHeaders()) {
+void OGCService::outputImage(GenericRaster &raster, bool flipx, bool flipy, const Colorizer &colorizer, Raster2D<uint8_t> *overlay,
+		const std::string &format, int level, uint32_t background) {
+	if (format != "image/png" && format != "image/jpeg" && format != "image/webp")
+		throw ArgumentException(concat("Unsupported image format: ", format));
+
+	if (!response.hasSentHeaders()) {
 		response.sendDebugHeader();
-		response.sendContentType("image/png");
+		response.sendContentType(format);
 		response.finishHeaders();
 	}
 
-	raster.toPNG(response, colorizer, flipx, flipy, overlay); //"/tmp/xyz.tmp.png");
+	// the encoders write directly into the response
+	writeImage(response, raster, flipx, flipy, colorizer, overlay, format, level, background);
+}
+
+void OGCService::writeImage(std::ostream &output, GenericRaster &raster, bool flipx, bool flipy, const Colorizer &colorizer, Raster2D<uint8_t> *overlay,
+		const std::string &format, int level, uint32_t background) {
+	if (format == "image/jpeg")
+		raster.toJPEG(output, colorizer, flipx, flipy, level, background);
+	else if (format == "image/webp")
+		raster.toWebP(output, colorizer, flipx, flipy, level);
+	else if (format == "image/png")
+		raster.toPNG(output, colorizer, flipx, flipy, overlay, level); //"/tmp/xyz.tmp.png");
+	else
+		throw ArgumentException(concat("Unsupported image format: ", format));
 }
 
 void OGCService::outputSimpleFeatureCollectionGeoJSON(SimpleFeatureCollection *collection, bool displayMetadata) {
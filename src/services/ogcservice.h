@@ -19,7 +19,12 @@ class OGCService : public HTTPService {
 		TemporalReference parseTime(const Parameters &params) const;
 		SpatialReference parseBBOX(const std::string bbox_str, CrsId crsId = CrsId::from_epsg_code(3857), bool allow_infinite = false);
 
-		void outputImage(GenericRaster &raster, bool flipx, bool flipy, const Colorizer &colorizer, Raster2D<uint8_t> *overlay = nullptr);
+		// format is image/png, image/jpeg or image/webp. level is the zlib level of PNGs and the quality of JPEGs and WebPs, -1 for the default
+		void outputImage(GenericRaster &raster, bool flipx, bool flipy, const Colorizer &colorizer, Raster2D<uint8_t> *overlay = nullptr,
+				const std::string &format = "image/png", int level = -1, uint32_t background = 0xffffffff);
+		// encodes the image like outputImage, but into the given stream
+		static void writeImage(std::ostream &output, GenericRaster &raster, bool flipx, bool flipy, const Colorizer &colorizer, Raster2D<uint8_t> *overlay,
+				const std::string &format, int level, uint32_t background);
 		void outputSimpleFeatureCollectionGeoJSON(SimpleFeatureCollection *collection, bool displayMetadata = false);
 		void outputSimpleFeatureCollectionCSV(SimpleFeatureCollection *collection);
 		void outputSimpleFeatureCollectionARFF(SimpleFeatureCollection* collection);
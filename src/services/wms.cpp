@@ -1,12 +1,21 @@
 
 #include "services/ogcservice.h"
+#include "services/wms_tilecache.h"
 #include "processing/queryprocessor.h"
+#include "operators/operator.h"
 #include "datatypes/raster.h"
 #include "datatypes/raster/raster_priv.h"
 #include "datatypes/plot.h"
 #include "datatypes/colorizer.h"
 #include "util/configuration.h"
 #include "util/log.h"
+#include "util/task_executor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <thread>
 
 
 /**
@@ -20,10 +29,58 @@ class WMSService : public OGCService {
 		virtual void run();
 
         std::unique_ptr<Colorizer> createColorizer(GenericRaster &raster, std::string colors);
+
+		/**
+		 * Computes the metatile of wms.metatile.columns x wms.metatile.rows tiles containing the requested
+		 * tile with a single query, sends the requested tile and puts all tiles into the tile cache.
+		 * The other tiles are encoded in the background, after the response was sent.
+		 * @return false if metatiling is disabled, the request is not aligned to the tile grid or the
+		 *   metatile could not be computed; nothing was sent then
+		 */
+		bool outputMetatile(const std::string &semantic_id, const QueryRectangle &qrect, UserDB::User &user, const std::string &colors,
+				const std::string &format, int level, color_t background);
 };
 REGISTER_HTTP_SERVICE(WMSService, "WMS");
 
 
+/*
+ * Parses the WMS BGCOLOR parameter, given as 0xRRGGBB
+ */
+static color_t parseBackgroundColor(const std::string &bgcolor) {
+	if (bgcolor.length() != 8 || (bgcolor.compare(0, 2, "0x") != 0 && bgcolor.compare(0, 2, "0X") != 0)
+			|| bgcolor.find_first_not_of("0123456789abcdefABCDEF", 2) != std::string::npos)
+		throw ArgumentException(concat("Invalid bgcolor: ", bgcolor));
+	uint32_t rgb = std::stoul(bgcolor.substr(2), nullptr, 16);
+	return color_from_rgba((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
+}
+
+/*
+ * Identifies an encoded tile by everything the image depends on. The flips are implied by the bbox.
+ * The bbox is compared in thousandths of a pixel, so tiles computed as part of a metatile match
+ * the bboxes clients send for them, despite rounding errors.
+ */
+static std::string tileFingerprint(const std::string &semantic_id, const QueryRectangle &qrect, const std::string &colors,
+		const std::string &format, int level, color_t background) {
+	double pixel_x = (qrect.x2 - qrect.x1) / qrect.xres;
+	double pixel_y = (qrect.y2 - qrect.y1) / qrect.yres;
+	std::ostringstream fingerprint;
+	fingerprint.precision(12);
+	fingerprint << semantic_id << '\n'
+		<< qrect.crsId.to_string() << ' ' << pixel_x << ' ' << pixel_y << ' '
+		<< std::llround(qrect.x1 / pixel_x * 1000) << ' ' << std::llround(qrect.y1 / pixel_y * 1000) << '\n'
+		<< qrect.timetype << ' ' << std::setprecision(17) << qrect.t1 << ' ' << qrect.t2 << '\n'
+		<< qrect.xres << 'x' << qrect.yres << '\n'
+		<< colors << '\n'
+		<< format << ' ' << level << ' ' << background;
+	return fingerprint.str();
+}
+
+static bool hasPermissions(UserDB::User &user, const std::vector<std::string> &identifiers) {
+	return std::all_of(identifiers.begin(), identifiers.end(),
+			[&](const std::string &identifier) { return identifier == "" || user.hasPermission(identifier); });
+}
+
+
 void WMSService::run() {
 	auto session = UserDB::loadSession(params.get("sessiontoken"));
 	auto user = session->getUser();
@@ -62,6 +119,20 @@ void WMSService::run() {
 			SpatialReference sref = parseBBOX(params.get("bbox"), query_crsId, false);
 			auto colors = params.get("colors", "");
 			auto format = params.get("format", "image/png");
+			// JPEG and WebP are lossy, but much smaller for imagery. All other formats (e.g. image/png8) are written as palette PNG
+			int level;
+			if (format == "image/jpeg")
+				level = params.getInt("quality", Configuration::get<int>("wms.jpeg.quality", -1));
+			else if (format == "image/webp")
+				level = params.getInt("quality", Configuration::get<int>("wms.webp.quality", -1));
+			else {
+				format = "image/png";
+				// zlib level of the PNG: 0 is fastest, 9 smallest
+				level = params.getInt("compression", Configuration::get<int>("wms.png.compression", -1));
+			}
+			// JPEGs have no transparency, so transparent pixels get the background color. The other
+			// formats keep the transparency and ignore BGCOLOR, so it does not split their cached tiles.
+			color_t background = parseBackgroundColor(format == "image/jpeg" ? params.get("bgcolor", "0xFFFFFF") : "0xFFFFFF");
 
 			bool flipx, flipy;
 			QueryRectangle qrect(
@@ -71,9 +142,25 @@ void WMSService::run() {
 			);
 
 
+			// the debug overlay shows the log of this request, so those tiles are never cached
+			auto &tilecache = WMSTileCache::getInstance();
+			std::string semantic_id, fingerprint;
+			if (tilecache.getCapacity() > 0 && !debug) {
+				semantic_id = GenericOperator::fromJSON(params.get("layers"))->getSemanticId();
+				fingerprint = tileFingerprint(semantic_id, qrect, colors, format, level, background);
+				auto tile = tilecache.get(fingerprint);
+				if (tile && hasPermissions(user, tile->identifiers)) {
+					tile->send(response, headers);
+					return;
+				}
+				// neighboring tiles are usually requested right after this one
+				if (outputMetatile(semantic_id, qrect, user, colors, format, level, background))
+					return;
+			}
+
 			Query query(params.get("layers"), Query::ResultType::RASTER, qrect);
-			auto result_raster = processQuery(query, user)
-				->getRaster(GenericOperator::RasterQM::EXACT);
+			auto result = processQuery(query, user);
+			auto result_raster = result->getRaster(GenericOperator::RasterQM::EXACT);
 
 			double bbox[4] = {sref.x1, sref.y1, sref.x2, sref.y2};
 			flipx = (bbox[2] > bbox[0]) != (result_raster->pixel_scale_x > 0);
@@ -119,7 +206,16 @@ void WMSService::run() {
 				}
 			}
 
-			outputImage(*result_raster, flipx, flipy, *createColorizer(*result_raster, colors), overlay.get());
+			if (fingerprint.empty()) {
+				outputImage(*result_raster, flipx, flipy, *createColorizer(*result_raster, colors), overlay.get(), format, level, background);
+			}
+			else {
+				std::ostringstream encoded;
+				writeImage(encoded, *result_raster, flipx, flipy, *createColorizer(*result_raster, colors), nullptr, format, level, background);
+				auto tile = std::make_shared<const WMSTileCache::Tile>(format, encoded.str(), result->getProvenance().getLocalIdentifiers());
+				tilecache.put(fingerprint, tile);
+				tile->send(response, headers);
+			}
 		}  catch (const MappingException &e) {
 			// Alright, something went wrong.
 			// We're still in a WMS request though, so do our best to output an image with a clear error message.
@@ -230,3 +326,88 @@ std::unique_ptr<Colorizer> WMSService::createColorizer(GenericRaster& raster, st
     }
     return colorizer;
 }
+
+bool WMSService::outputMetatile(const std::string &semantic_id, const QueryRectangle &qrect, UserDB::User &user, const std::string &colors,
+		const std::string &format, int level, color_t background) {
+	std::shared_ptr<const WMSMetatile> metatile = WMSMetatile::forTile(qrect, SpatialReference::extent(qrect.crsId),
+		Configuration::get<int>("wms.metatile.columns", 1), Configuration::get<int>("wms.metatile.rows", 1),
+		Configuration::get<int>("wms.metatile.buffer", 0));
+	if (!metatile)
+		return false;
+
+	// Concurrent requests for tiles of the same metatile wait for the first one to compute it
+	auto &tilecache = WMSTileCache::getInstance();
+	std::shared_ptr<WMSTileCache::Computation> computation = tilecache.beginComputation(
+		tileFingerprint(semantic_id, metatile->qrect, colors, format, level, background));
+	if (!computation) {
+		auto tile = tilecache.get(tileFingerprint(semantic_id, qrect, colors, format, level, background));
+		if (!tile || !hasPermissions(user, tile->identifiers))
+			return false;
+		tile->send(response, headers);
+		return true;
+	}
+
+	// If the metatile cannot be computed as requested, the caller falls back to computing the single tile
+	std::unique_ptr<QueryProcessor::QueryResult> result;
+	std::shared_ptr<GenericRaster> raster;
+	try {
+		Query query(params.get("layers"), Query::ResultType::RASTER, metatile->qrect);
+		result = processQuery(query, user);
+		raster = result->getRaster(GenericOperator::RasterQM::EXACT);
+	} catch (const std::exception &e) {
+		Log::info("WMS: could not compute the metatile, computing the tile only: %s", e.what());
+		return false;
+	}
+	if (raster->width != metatile->qrect.xres || raster->height != metatile->qrect.yres) {
+		Log::info("WMS: the metatile has %ux%u instead of %ux%u pixels, computing the tile only", raster->width, raster->height, metatile->qrect.xres, metatile->qrect.yres);
+		return false;
+	}
+	// the tiles are cut concurrently, so the raster must not be moved between representations then.
+	// A view can stay as it is, the tiles are views of the same buffer.
+	if (raster->getRepresentation() == GenericRaster::Representation::OPENCL)
+		raster->setRepresentation(GenericRaster::Representation::CPU);
+
+	auto identifiers = result->getProvenance().getLocalIdentifiers();
+	std::shared_ptr<const Colorizer> colorizer = createColorizer(*raster, colors);
+
+	// Slices and encodes the tile at the given position of the metatile and caches it.
+	// Everything is captured by value, as the siblings are encoded after this request finished.
+	auto encodeTile = [=](int64_t x, int64_t y) {
+		SpatialReference sref = metatile->getTile(x, y);
+		double px1 = (sref.x1 - raster->stref.x1) / raster->pixel_scale_x, px2 = (sref.x2 - raster->stref.x1) / raster->pixel_scale_x;
+		double py1 = (sref.y1 - raster->stref.y1) / raster->pixel_scale_y, py2 = (sref.y2 - raster->stref.y1) / raster->pixel_scale_y;
+		auto tile_raster = raster->cut(std::llround(std::min(px1, px2)), std::llround(std::min(py1, py2)), 0, qrect.xres, qrect.yres, 0);
+		bool flipx = (sref.x2 > sref.x1) != (tile_raster->pixel_scale_x > 0);
+		bool flipy = (sref.y2 > sref.y1) == (tile_raster->pixel_scale_y > 0);
+
+		std::ostringstream encoded;
+		writeImage(encoded, *tile_raster, flipx, flipy, *colorizer, nullptr, format, level, background);
+		auto tile = std::make_shared<const WMSTileCache::Tile>(format, encoded.str(), identifiers);
+		QueryRectangle tile_qrect(sref, qrect, qrect);
+		WMSTileCache::getInstance().put(tileFingerprint(semantic_id, tile_qrect, colors, format, level, background), tile);
+		return tile;
+	};
+
+	encodeTile(metatile->tile_x, metatile->tile_y)->send(response, headers);
+
+	// The response does not wait for the siblings. They are only cached, so their errors do not affect
+	// this request. Requests for them wait until the computation is released after the last one.
+	std::thread([encodeTile, metatile, computation]() {
+		auto &executor = TaskExecutor::get_instance();
+		std::vector<TaskFuture<std::shared_ptr<const WMSTileCache::Tile>>> siblings;
+		for (int64_t y = metatile->begin_y; y < metatile->end_y; y++) {
+			for (int64_t x = metatile->begin_x; x < metatile->end_x; x++) {
+				if (x != metatile->tile_x || y != metatile->tile_y)
+					siblings.push_back(executor.submit([&encodeTile, x, y]() { return encodeTile(x, y); }));
+			}
+		}
+		for (auto &sibling : siblings) {
+			try {
+				sibling.get();
+			} catch (const std::exception &e) {
+				Log::warn("WMS: could not encode a tile of the metatile: %s", e.what());
+			}
+		}
+	}).detach();
+	return true;
+}
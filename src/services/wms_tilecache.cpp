@@ -0,0 +1,195 @@
+#include "services/wms_tilecache.h"
+#include "util/configuration.h"
+#include "util/sha1.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+static std::string computeETag(const std::string &data) {
+	SHA1 sha1;
+	sha1.addBytes(data);
+	return "\"" + sha1.digest().asHex() + "\"";
+}
+
+WMSTileCache::Tile::Tile(std::string content_type, std::string data, std::vector<std::string> identifiers)
+	: content_type(std::move(content_type)), data(std::move(data)), etag(computeETag(this->data)), identifiers(std::move(identifiers)) {
+}
+
+bool WMSTileCache::Tile::matches(const std::string &if_none_match) const {
+	size_t pos = 0;
+	while (pos <= if_none_match.size()) {
+		size_t end = std::min(if_none_match.find(',', pos), if_none_match.size());
+		size_t first = if_none_match.find_first_not_of(" \t", pos);
+		size_t last = if_none_match.find_last_not_of(" \t", end - 1);
+		if (first < end && last != std::string::npos && last >= first) {
+			std::string tag = if_none_match.substr(first, last - first + 1);
+			// If-None-Match uses the weak comparison, so W/ is ignored
+			if (tag.compare(0, 2, "W/") == 0)
+				tag = tag.substr(2);
+			if (tag == "*" || tag == etag)
+				return true;
+		}
+		pos = end + 1;
+	}
+	return false;
+}
+
+void WMSTileCache::Tile::send(HTTPService::HTTPResponseStream &response, const Parameters &headers) const {
+	bool not_modified = headers.hasParam("if-none-match") && matches(headers.get("if-none-match"));
+
+	if (not_modified)
+		response.sendHeader("Status", "304 Not Modified");
+	response.sendDebugHeader();
+	response.sendHeader("ETag", etag);
+	if (!not_modified)
+		response.sendContentType(content_type);
+	response.finishHeaders();
+	if (!not_modified)
+		response.write(data.data(), data.size());
+}
+
+
+WMSTileCache &WMSTileCache::getInstance() {
+	static WMSTileCache instance(Configuration::get<size_t>("wms.tilecache.size", 0));
+	return instance;
+}
+
+WMSTileCache::WMSTileCache(size_t capacity) : capacity(capacity), size(0) {
+}
+
+std::shared_ptr<const WMSTileCache::Tile> WMSTileCache::get(const std::string &fingerprint) {
+	if (capacity == 0)
+		return nullptr;
+
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = entries.find(fingerprint);
+	if (it == entries.end())
+		return nullptr;
+	lru.splice(lru.begin(), lru, it->second);
+	return it->second->tile;
+}
+
+void WMSTileCache::put(const std::string &fingerprint, std::shared_ptr<const Tile> tile) {
+	size_t tile_size = tile->data.size() + fingerprint.size();
+	if (tile_size > capacity)
+		return;
+
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = entries.find(fingerprint);
+	if (it != entries.end()) {
+		size -= it->second->size;
+		lru.erase(it->second);
+		entries.erase(it);
+	}
+	lru.emplace_front(fingerprint, std::move(tile), tile_size);
+	entries.emplace(fingerprint, lru.begin());
+	size += tile_size;
+	evict();
+}
+
+size_t WMSTileCache::getSize() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return size;
+}
+
+size_t WMSTileCache::getTileCount() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return lru.size();
+}
+
+void WMSTileCache::evict() {
+	while (size > capacity) {
+		auto &last = lru.back();
+		size -= last.size;
+		entries.erase(last.fingerprint);
+		lru.pop_back();
+	}
+}
+
+std::unique_ptr<WMSTileCache::Computation> WMSTileCache::beginComputation(const std::string &fingerprint) {
+	std::unique_lock<std::mutex> guard(mutex);
+	if (computing.insert(fingerprint).second)
+		return std::make_unique<Computation>(*this, fingerprint);
+
+	computed.wait(guard, [this, &fingerprint]() { return computing.count(fingerprint) == 0; });
+	return nullptr;
+}
+
+WMSTileCache::Computation::~Computation() {
+	std::lock_guard<std::mutex> guard(cache.mutex);
+	cache.computing.erase(fingerprint);
+	cache.computed.notify_all();
+}
+
+
+/*
+ * The tiles of one axis of a metatile that lie inside the extent, and the pixels of the buffer that fit
+ * before and after them
+ */
+struct TileRange {
+	int64_t begin, end, buffer_before, buffer_after;
+};
+
+static TileRange clampToExtent(double meta_start, double tile_size, double pixel_size, int64_t tiles, int buffer, double extent_start, double extent_end) {
+	TileRange range;
+	range.begin = std::max<int64_t>(0, std::ceil((extent_start - meta_start) / tile_size - 1e-3));
+	range.end = std::min<int64_t>(tiles, std::floor((extent_end - meta_start) / tile_size + 1e-3));
+	range.buffer_before = std::max<int64_t>(0, std::min<int64_t>(buffer, std::floor((meta_start + range.begin * tile_size - extent_start) / pixel_size + 1e-3)));
+	range.buffer_after = std::max<int64_t>(0, std::min<int64_t>(buffer, std::floor((extent_end - meta_start - range.end * tile_size) / pixel_size + 1e-3)));
+	return range;
+}
+
+std::unique_ptr<WMSMetatile> WMSMetatile::forTile(const QueryRectangle &tile, const SpatialReference &extent, int columns, int rows, int buffer) {
+	buffer = std::max(0, buffer);
+	if (columns < 1 || rows < 1 || columns * rows == 1)
+		return nullptr;
+	if (!std::isfinite(extent.x1) || !std::isfinite(extent.y1) || !std::isfinite(extent.x2) || !std::isfinite(extent.y2))
+		return nullptr;
+
+	// The tile grid starts at the lower left corner of the CRS' extent
+	double tile_width = tile.x2 - tile.x1, tile_height = tile.y2 - tile.y1;
+	double grid_x = (tile.x1 - extent.x1) / tile_width, grid_y = (tile.y1 - extent.y1) / tile_height;
+	if (std::abs(grid_x - std::round(grid_x)) > 1e-3 || std::abs(grid_y - std::round(grid_y)) > 1e-3)
+		return nullptr;
+
+	// The position of the requested tile inside its metatile
+	int64_t tile_x = ((std::llround(grid_x) % columns) + columns) % columns;
+	int64_t tile_y = ((std::llround(grid_y) % rows) + rows) % rows;
+
+	double pixel_x = tile_width / tile.xres, pixel_y = tile_height / tile.yres;
+	double meta_x1 = tile.x1 - tile_x * tile_width, meta_y1 = tile.y1 - tile_y * tile_height;
+	TileRange xs = clampToExtent(meta_x1, tile_width, pixel_x, columns, buffer, extent.x1, extent.x2);
+	TileRange ys = clampToExtent(meta_y1, tile_height, pixel_y, rows, buffer, extent.y1, extent.y2);
+	if (tile_x < xs.begin || tile_x >= xs.end || tile_y < ys.begin || tile_y >= ys.end)
+		return nullptr;
+	if ((xs.end - xs.begin) * (ys.end - ys.begin) == 1)
+		return nullptr;
+
+	QueryRectangle qrect(
+		SpatialReference(tile.crsId,
+			meta_x1 + xs.begin * tile_width - xs.buffer_before * pixel_x,
+			meta_y1 + ys.begin * tile_height - ys.buffer_before * pixel_y,
+			meta_x1 + xs.end * tile_width + xs.buffer_after * pixel_x,
+			meta_y1 + ys.end * tile_height + ys.buffer_after * pixel_y),
+		tile,
+		QueryResolution::pixels(
+			(xs.end - xs.begin) * tile.xres + xs.buffer_before + xs.buffer_after,
+			(ys.end - ys.begin) * tile.yres + ys.buffer_before + ys.buffer_after)
+	);
+	return std::unique_ptr<WMSMetatile>(new WMSMetatile(qrect, tile, tile_x, tile_y, xs.begin, xs.end, ys.begin, ys.end));
+}
+
+WMSMetatile::WMSMetatile(const QueryRectangle &qrect, const QueryRectangle &tile, int64_t tile_x, int64_t tile_y, int64_t begin_x, int64_t end_x, int64_t begin_y, int64_t end_y)
+	: qrect(qrect), tile_x(tile_x), tile_y(tile_y), begin_x(begin_x), end_x(end_x), begin_y(begin_y), end_y(end_y), tile(tile) {
+}
+
+SpatialReference WMSMetatile::getTile(int64_t x, int64_t y) const {
+	// the requested tile keeps its exact bbox, so its fingerprint matches the request's
+	if (x == tile_x && y == tile_y)
+		return tile;
+	double tile_width = tile.x2 - tile.x1, tile_height = tile.y2 - tile.y1;
+	return SpatialReference(tile.crsId,
+		tile.x1 + (x - tile_x) * tile_width, tile.y1 + (y - tile_y) * tile_height,
+		tile.x1 + (x - tile_x + 1) * tile_width, tile.y1 + (y - tile_y + 1) * tile_height);
+}
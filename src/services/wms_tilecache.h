@@ -0,0 +1,156 @@
+#ifndef SERVICES_WMS_TILECACHE_H
+#define SERVICES_WMS_TILECACHE_H
+
+#include "operators/queryrectangle.h"
+#include "services/httpservice.h"
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*
+ * A bounded LRU cache of encoded WMS tiles, shared by all requests of the process.
+ *
+ * Tiles are identified by a fingerprint of everything that determines the encoded image:
+ * the operator's semantic id, the query rectangle and the output options. A cached tile can be
+ * sent without running the query or encoding the image again.
+ */
+class WMSTileCache {
+	public:
+		class Tile {
+			public:
+				Tile(std::string content_type, std::string data, std::vector<std::string> identifiers);
+
+				/**
+				 * @param if_none_match the value of an If-None-Match header: *, or a comma separated list
+				 *   of strong or weak (W/) ETags
+				 * @return whether the header matches this tile's ETag
+				 */
+				bool matches(const std::string &if_none_match) const;
+
+				/**
+				 * Sends this tile, or 304 Not Modified if the If-None-Match header of the request matches it
+				 * @param headers the request headers, with lower case names
+				 */
+				void send(HTTPService::HTTPResponseStream &response, const Parameters &headers) const;
+
+				const std::string content_type;
+				const std::string data;
+				// the quoted SHA1 of the data, for use as HTTP ETag
+				const std::string etag;
+				// the provenance identifiers a user needs permissions for
+				const std::vector<std::string> identifiers;
+		};
+
+		/**
+		 * @return the process-wide cache. Its capacity in bytes is given by the setting "wms.tilecache.size"
+		 */
+		static WMSTileCache &getInstance();
+
+		/**
+		 * @param capacity the maximum size of all cached tiles in bytes; 0 disables the cache
+		 */
+		explicit WMSTileCache(size_t capacity);
+		WMSTileCache(const WMSTileCache &) = delete;
+		WMSTileCache &operator=(const WMSTileCache &) = delete;
+
+		/**
+		 * @return the cached tile, or nullptr if the tile is not cached
+		 */
+		std::shared_ptr<const Tile> get(const std::string &fingerprint);
+
+		/**
+		 * Adds a tile, replacing a previous tile with the same fingerprint and evicting the least
+		 * recently used tiles if the capacity is exceeded. Tiles larger than the capacity are not cached.
+		 */
+		void put(const std::string &fingerprint, std::shared_ptr<const Tile> tile);
+
+		/*
+		 * Marks tiles as being computed while it exists, see beginComputation()
+		 */
+		class Computation {
+			public:
+				Computation(WMSTileCache &cache, std::string fingerprint) : cache(cache), fingerprint(std::move(fingerprint)) {}
+				~Computation();
+				Computation(const Computation &) = delete;
+				Computation &operator=(const Computation &) = delete;
+			private:
+				WMSTileCache &cache;
+				const std::string fingerprint;
+		};
+
+		/**
+		 * Marks the tiles identified by the given fingerprint, e.g. those of a metatile, as being
+		 * computed, so concurrent requests for them wait instead of computing them again.
+		 * If another request is already computing them, blocks until it finished.
+		 * @return the mark, which must be kept until the tiles are put into the cache, or nullptr
+		 *   if this call waited for another request
+		 */
+		std::unique_ptr<Computation> beginComputation(const std::string &fingerprint);
+
+		size_t getCapacity() const { return capacity; }
+		size_t getSize();
+		size_t getTileCount();
+
+	private:
+		struct Entry {
+			Entry(const std::string &fingerprint, std::shared_ptr<const Tile> tile, size_t size) : fingerprint(fingerprint), tile(std::move(tile)), size(size) {}
+			std::string fingerprint;
+			std::shared_ptr<const Tile> tile;
+			size_t size;
+		};
+
+		void evict();
+
+		const size_t capacity;
+		size_t size;
+		std::mutex mutex;
+		// most recently used first
+		std::list<Entry> lru;
+		std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+		// fingerprints of the running computations
+		std::unordered_set<std::string> computing;
+		std::condition_variable computed;
+};
+
+
+/*
+ * The metatile containing a WMS tile: a block of columns x rows tiles of the tile grid of the CRS,
+ * which starts at the lower left corner of the CRS' extent. The block is clamped to the extent, so
+ * only whole tiles inside of it are computed, surrounded by as many pixels of the buffer as fit into it.
+ */
+class WMSMetatile {
+	public:
+		/**
+		 * @param tile the requested tile
+		 * @param extent the extent of the tile's CRS
+		 * @param buffer the number of pixels computed around the tiles, e.g. for labels crossing tile borders
+		 * @return the metatile, or nullptr if the tile is not aligned to the tile grid, not inside the
+		 *   extent or the metatile would consist of the tile only
+		 */
+		static std::unique_ptr<WMSMetatile> forTile(const QueryRectangle &tile, const SpatialReference &extent, int columns, int rows, int buffer);
+
+		/**
+		 * @return the bbox of the tile at the given position of the metatile
+		 */
+		SpatialReference getTile(int64_t x, int64_t y) const;
+
+		// the query of all tiles of the metatile and the buffer around them
+		const QueryRectangle qrect;
+		// the position of the requested tile
+		const int64_t tile_x, tile_y;
+		// the positions of the tiles inside the extent are [begin_x, end_x) x [begin_y, end_y)
+		const int64_t begin_x, end_x, begin_y, end_y;
+
+	private:
+		WMSMetatile(const QueryRectangle &qrect, const QueryRectangle &tile, int64_t tile_x, int64_t tile_y, int64_t begin_x, int64_t end_x, int64_t begin_y, int64_t end_y);
+
+		const QueryRectangle tile;
+};
+
+#endif
@@ -150,6 +150,14 @@ BinaryStream BinaryStream::makePipe() {
 	return BinaryStream(fds[0], fds[1]);
 }
 
+BinaryStream BinaryStream::createFile(const char *path) {
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+	if (fd < 0)
+		throw NetworkException(concat("BinaryStream: unable to open(", path, "): ", strerror(errno)));
+
+	return BinaryStream(fd, fd);
+}
+
 
 /*
  * BinaryStream
@@ -383,6 +391,18 @@ BinaryReadBuffer::BinaryReadBuffer() {
 	status = Status::READING_SIZE;
 	prepareBuffer(sizeof(size_t));
 }
+BinaryReadBuffer::BinaryReadBuffer(const char *data, size_t len) {
+	size_t header = 0;
+	if (len >= sizeof(size_t))
+		memcpy(&header, data, sizeof(size_t));
+	if (header != len)
+		throw NetworkException(concat("BinaryReadBuffer: packet of ", len, " bytes has an invalid size header"));
+
+	buffer.assign(data + sizeof(size_t), data + len);
+	size_total = len - sizeof(size_t);
+	size_read = 0;
+	status = Status::FINISHED;
+}
 BinaryReadBuffer::~BinaryReadBuffer() {
 
 }
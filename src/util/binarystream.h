@@ -60,6 +60,11 @@ class BinaryStream {
 		static BinaryStream connectTCP(const char *hostname, int port, bool no_delay = true);
 		static BinaryStream fromAcceptedSocket(int socket, bool no_delay = true);
 		static BinaryStream makePipe();
+		/*
+		 * Creates (or truncates) a file, opened for reading and appending.
+		 * Writes always go to the end of the file, the read fd may be used for mmap().
+		 */
+		static BinaryStream createFile(const char *path);
 
 		/*
 		 * A stream can be either blocking or nonblocking.
@@ -332,6 +337,11 @@ class BinaryReadBuffer {
 		};
 	public:
 		BinaryReadBuffer();
+		/*
+		 * Creates a filled buffer from a complete packet as written by a BinaryWriteBuffer,
+		 * e.g. from a memory-mapped file. The data is copied.
+		 */
+		BinaryReadBuffer(const char *data, size_t len);
 		~BinaryReadBuffer();
 
 		/*
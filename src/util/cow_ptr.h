@@ -0,0 +1,85 @@
+#ifndef UTIL_COW_PTR_H
+#define UTIL_COW_PTR_H
+
+#include <memory>
+
+/**
+ * A copy-on-write pointer to a result-object.
+ *
+ * The pointee is either owned exclusively or shared read-only with others (e.g. a cache).
+ * Read access is always possible without copying. A copy (via the pointee's clone())
+ * is only created, when a shared object is about to be modified or released.
+ *
+ * Shared objects must be safe for concurrent reads, including clone(). For rasters
+ * this means they must be in CPU representation before being shared.
+ */
+template<typename T>
+class cow_ptr {
+	public:
+		cow_ptr() = default;
+		explicit cow_ptr(std::unique_ptr<T> owned) : owned(std::move(owned)) {}
+		explicit cow_ptr(std::shared_ptr<const T> shared) : shared(std::move(shared)) {}
+
+		cow_ptr(const cow_ptr &) = delete;
+		cow_ptr &operator=(const cow_ptr &) = delete;
+		cow_ptr(cow_ptr &&) = default;
+		cow_ptr &operator=(cow_ptr &&) = default;
+
+		const T *get() const { return owned ? owned.get() : shared.get(); }
+		const T &operator*() const { return *get(); }
+		const T *operator->() const { return get(); }
+		explicit operator bool() const { return get() != nullptr; }
+
+		/**
+		 * @return whether the pointee is shared with others and thus read-only
+		 */
+		bool is_shared() const { return !owned && shared; }
+
+		/**
+		 * Grants write access to the pointee. If it is shared, a private copy is created first.
+		 * @return the exclusively owned object
+		 */
+		T &mutate() {
+			if (is_shared()) {
+				owned = copy();
+				shared.reset();
+			}
+			return *owned;
+		}
+
+		/**
+		 * Releases the object to the caller. If it is shared, a private copy is returned.
+		 * @return an exclusively owned object
+		 */
+		std::unique_ptr<T> release() {
+			std::unique_ptr<T> result;
+			if (is_shared())
+				result = copy();
+			else
+				result = std::move(owned);
+			shared.reset();
+			return result;
+		}
+
+		/**
+		 * Turns an exclusively owned object into a shared, read-only one without copying.
+		 * @return the shared object
+		 */
+		std::shared_ptr<const T> share() {
+			if (owned)
+				shared = std::shared_ptr<const T>(owned.release());
+			return shared;
+		}
+
+	private:
+		std::unique_ptr<T> copy() const {
+			// some clone() implementations are not const (e.g. GenericRaster, which may
+			// switch its representation), but are safe on shared objects as stated above
+			return const_cast<T&>(*shared).clone();
+		}
+
+		std::unique_ptr<T> owned;
+		std::shared_ptr<const T> shared;
+};
+
+#endif
@@ -0,0 +1,412 @@
+#include "util/formula_program.h"
+#include "util/concat.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+
+/*
+ * Recursive descent parser emitting the bytecode while parsing.
+ * Operator precedence and associativity follow C.
+ */
+class FormulaProgram::Parser {
+	public:
+		Parser(FormulaProgram &program, const std::string &formula, const std::vector<Type> &variable_types)
+			: program(program), formula(formula), variable_types(variable_types), pos(0) {}
+
+		void parse() {
+			Operand result = parseExpression();
+			skipWhitespace();
+			if (pos != formula.size())
+				throw Formula::parse_error(concat("Unexpected '", formula.substr(pos, 1), "' at position ", pos));
+			program.result_register = result.reg;
+			program.result_type = result.type;
+		}
+
+	private:
+		struct Operand {
+			uint32_t reg;
+			Type type;
+		};
+
+		struct Function {
+			size_t arguments;
+			OpCode op;
+		};
+
+		Operand emit(OpCode op, Type type, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, double value = 0) {
+			uint32_t dst = program.register_count++;
+			program.code.push_back(Instruction{op, dst, a, b, c, value});
+			return Operand{dst, type};
+		}
+
+		static Type promote(const Operand &a, const Operand &b) {
+			return (a.type == Type::INTEGER && b.type == Type::INTEGER) ? Type::INTEGER : Type::FLOAT;
+		}
+
+		void skipWhitespace() {
+			while (pos < formula.size() && isspace((unsigned char) formula[pos]))
+				pos++;
+		}
+
+		// Consumes the given token, if it is next
+		bool accept(const char *token) {
+			skipWhitespace();
+			size_t len = strlen(token);
+			if (formula.compare(pos, len, token) != 0)
+				return false;
+			// do not mistake the start of a longer operator, e.g. "<" in "<="
+			if (len == 1 && pos + 1 < formula.size() && formula[pos+1] == '=' && strchr("<>=!", token[0]))
+				return false;
+			pos += len;
+			return true;
+		}
+
+		void expect(const char *token) {
+			if (!accept(token))
+				throw Formula::parse_error(concat("Expected '", token, "' at position ", pos));
+		}
+
+		Operand parseExpression() {
+			Operand condition = parseLogicalOr();
+			if (!accept("?"))
+				return condition;
+			Operand a = parseExpression();
+			expect(":");
+			Operand b = parseExpression();
+			return emit(OpCode::SELECT, promote(a, b), condition.reg, a.reg, b.reg);
+		}
+
+		Operand parseLogicalOr() {
+			Operand left = parseLogicalAnd();
+			while (accept("||")) {
+				Operand right = parseLogicalAnd();
+				left = emit(OpCode::OR, Type::INTEGER, left.reg, right.reg);
+			}
+			return left;
+		}
+
+		Operand parseLogicalAnd() {
+			Operand left = parseEquality();
+			while (accept("&&")) {
+				Operand right = parseEquality();
+				left = emit(OpCode::AND, Type::INTEGER, left.reg, right.reg);
+			}
+			return left;
+		}
+
+		Operand parseEquality() {
+			Operand left = parseRelational();
+			while (true) {
+				OpCode op;
+				if (accept("=="))
+					op = OpCode::EQ;
+				else if (accept("!="))
+					op = OpCode::NE;
+				else
+					return left;
+				Operand right = parseRelational();
+				left = emit(op, Type::INTEGER, left.reg, right.reg);
+			}
+		}
+
+		Operand parseRelational() {
+			Operand left = parseAdditive();
+			while (true) {
+				OpCode op;
+				if (accept("<="))
+					op = OpCode::LE;
+				else if (accept(">="))
+					op = OpCode::GE;
+				else if (accept("<"))
+					op = OpCode::LT;
+				else if (accept(">"))
+					op = OpCode::GT;
+				else
+					return left;
+				Operand right = parseAdditive();
+				left = emit(op, Type::INTEGER, left.reg, right.reg);
+			}
+		}
+
+		Operand parseAdditive() {
+			Operand left = parseMultiplicative();
+			while (true) {
+				OpCode op;
+				if (accept("+"))
+					op = OpCode::ADD;
+				else if (accept("-"))
+					op = OpCode::SUB;
+				else
+					return left;
+				Operand right = parseMultiplicative();
+				left = emit(op, promote(left, right), left.reg, right.reg);
+			}
+		}
+
+		Operand parseMultiplicative() {
+			Operand left = parseUnary();
+			while (true) {
+				OpCode op;
+				if (accept("*"))
+					op = OpCode::MUL;
+				else if (accept("/"))
+					op = OpCode::DIV;
+				else
+					return left;
+				Operand right = parseUnary();
+				Type type = promote(left, right);
+				if (op == OpCode::DIV && type == Type::INTEGER)
+					op = OpCode::IDIV;
+				left = emit(op, type, left.reg, right.reg);
+			}
+		}
+
+		Operand parseUnary() {
+			if (accept("-")) {
+				Operand operand = parseUnary();
+				return emit(OpCode::NEG, operand.type, operand.reg);
+			}
+			if (accept("+"))
+				return parseUnary();
+			if (accept("!")) {
+				Operand operand = parseUnary();
+				return emit(OpCode::NOT, Type::INTEGER, operand.reg);
+			}
+			return parsePrimary();
+		}
+
+		Operand parsePrimary() {
+			skipWhitespace();
+			if (pos >= formula.size())
+				throw Formula::parse_error("Unexpected end of formula");
+
+			if (accept("(")) {
+				Operand result = parseExpression();
+				expect(")");
+				return result;
+			}
+
+			char c = formula[pos];
+			if (isdigit((unsigned char) c) || c == '.')
+				return parseNumber();
+			if (isalpha((unsigned char) c) || c == '_')
+				return parseIdentifier();
+
+			throw Formula::parse_error(concat("Unexpected '", c, "' at position ", pos));
+		}
+
+		Operand parseNumber() {
+			const char *start = formula.c_str() + pos;
+			char *end = nullptr;
+			double value = strtod(start, &end);
+			if (end == start)
+				throw Formula::parse_error(concat("Invalid number at position ", pos));
+
+			std::string literal(start, end - start);
+			if (literal.find_first_of("xX") != std::string::npos)
+				throw Formula::parse_error(concat("Hexadecimal numbers are not supported at position ", pos));
+			pos += end - start;
+			bool is_float = literal.find_first_of(".eE") != std::string::npos;
+			// float suffix as in 2.5f
+			if (pos < formula.size() && (formula[pos] == 'f' || formula[pos] == 'F')) {
+				is_float = true;
+				pos++;
+			}
+			return emit(OpCode::CONST, is_float ? Type::FLOAT : Type::INTEGER, 0, 0, 0, value);
+		}
+
+		Operand parseIdentifier() {
+			size_t start = pos;
+			while (pos < formula.size() && (isalnum((unsigned char) formula[pos]) || formula[pos] == '_'))
+				pos++;
+			std::string name = formula.substr(start, pos - start);
+
+			if (name.size() == 1 && name[0] >= 'A' && name[0] <= 'Z') {
+				size_t idx = name[0] - 'A';
+				if (idx >= variable_types.size())
+					throw Formula::parse_error(concat("Unknown variable ", name));
+				return Operand{(uint32_t) idx, variable_types[idx]};
+			}
+
+			auto it = functions().find(name);
+			if (it == functions().end())
+				throw Formula::parse_error(concat("Unknown function ", name));
+			const Function &function = it->second;
+
+			expect("(");
+			std::vector<Operand> args;
+			if (!accept(")")) {
+				do {
+					args.push_back(parseExpression());
+				} while (accept(","));
+				expect(")");
+			}
+			if (args.size() != function.arguments)
+				throw Formula::parse_error(concat("Function ", name, " expects ", function.arguments, " arguments"));
+
+			return emit(function.op, Type::FLOAT, args[0].reg, args.size() > 1 ? args[1].reg : 0);
+		}
+
+		// The functions of Formula::addCLFunctions()
+		static const std::unordered_map<std::string, Function> &functions() {
+			static const std::unordered_map<std::string, Function> functions {
+				{"sin", {1, OpCode::SIN}},
+				{"asin", {1, OpCode::ASIN}},
+				{"cos", {1, OpCode::COS}},
+				{"acos", {1, OpCode::ACOS}},
+				{"tan", {1, OpCode::TAN}},
+				{"atan", {1, OpCode::ATAN}},
+				{"mod", {2, OpCode::FMOD}},
+				{"fmod", {2, OpCode::FMOD}},
+				{"remainder", {2, OpCode::REMAINDER}},
+				{"ceil", {1, OpCode::CEIL}},
+				{"floor", {1, OpCode::FLOOR}},
+				{"round", {1, OpCode::ROUND}},
+				{"trunc", {1, OpCode::TRUNC}},
+				{"abs", {1, OpCode::FABS}},
+				{"fabs", {1, OpCode::FABS}},
+				{"fract", {1, OpCode::FRACT}},
+				{"pow", {2, OpCode::POW}},
+				{"sqrt", {1, OpCode::SQRT}},
+				{"exp", {1, OpCode::EXP}},
+				{"exp2", {1, OpCode::EXP2}},
+				{"exp10", {1, OpCode::EXP10}},
+				{"log", {1, OpCode::LOG}},
+				{"log2", {1, OpCode::LOG2}},
+				{"log10", {1, OpCode::LOG10}}
+			};
+			return functions;
+		}
+
+		FormulaProgram &program;
+		const std::string &formula;
+		const std::vector<Type> &variable_types;
+		size_t pos;
+};
+
+
+const size_t FormulaProgram::BLOCK_SIZE;
+
+FormulaProgram::FormulaProgram(const std::string &formula, const std::vector<Type> &variable_types)
+	: variable_count(variable_types.size()), register_count(variable_types.size()), result_register(0), result_type(Type::FLOAT) {
+	Parser parser(*this, formula, variable_types);
+	parser.parse();
+}
+
+std::shared_ptr<const FormulaProgram> FormulaProgram::get(const std::string &formula, const std::vector<Type> &variable_types) {
+	static const size_t MAX_CACHED_PROGRAMS = 256;
+	static std::unordered_map<std::string, std::shared_ptr<const FormulaProgram>> programs;
+	static std::mutex mtx;
+
+	std::string key = formula;
+	key += '\0';
+	for (auto type : variable_types)
+		key += (type == Type::INTEGER) ? 'i' : 'f';
+
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		auto it = programs.find(key);
+		if (it != programs.end())
+			return it->second;
+	}
+
+	auto program = std::make_shared<const FormulaProgram>(formula, variable_types);
+
+	std::lock_guard<std::mutex> g(mtx);
+	if (programs.size() >= MAX_CACHED_PROGRAMS)
+		programs.clear();
+	programs.emplace(key, program);
+	return program;
+}
+
+
+template<typename F>
+static inline void unaryLoop(double *dst, const double *a, size_t n, F f) {
+	for (size_t i = 0; i < n; i++)
+		dst[i] = f(a[i]);
+}
+
+template<typename F>
+static inline void binaryLoop(double *dst, const double *a, const double *b, size_t n, F f) {
+	for (size_t i = 0; i < n; i++)
+		dst[i] = f(a[i], b[i]);
+}
+
+void FormulaProgram::evaluate(const double * const *variables, double *result, size_t count) const {
+	std::vector<double> temporaries((register_count - variable_count) * BLOCK_SIZE);
+	std::vector<double *> registers(register_count);
+	for (uint32_t r = variable_count; r < register_count; r++)
+		registers[r] = &temporaries[(r - variable_count) * BLOCK_SIZE];
+
+	for (size_t offset = 0; offset < count; offset += BLOCK_SIZE) {
+		size_t n = std::min(BLOCK_SIZE, count - offset);
+		for (uint32_t v = 0; v < variable_count; v++)
+			registers[v] = const_cast<double *>(variables[v] + offset);
+
+		for (const auto &ins : code) {
+			double *d = registers[ins.dst];
+			const double *a = registers[ins.a];
+			const double *b = registers[ins.b];
+			switch (ins.op) {
+				case OpCode::CONST: {
+					double value = ins.value;
+					for (size_t i = 0; i < n; i++)
+						d[i] = value;
+					break;
+				}
+				case OpCode::NEG: unaryLoop(d, a, n, [](double x) { return -x; }); break;
+				case OpCode::NOT: unaryLoop(d, a, n, [](double x) { return x == 0 ? 1.0 : 0.0; }); break;
+				case OpCode::ADD: binaryLoop(d, a, b, n, [](double x, double y) { return x + y; }); break;
+				case OpCode::SUB: binaryLoop(d, a, b, n, [](double x, double y) { return x - y; }); break;
+				case OpCode::MUL: binaryLoop(d, a, b, n, [](double x, double y) { return x * y; }); break;
+				case OpCode::DIV: binaryLoop(d, a, b, n, [](double x, double y) { return x / y; }); break;
+				// integer division by zero is undefined in C, we return 0
+				case OpCode::IDIV: binaryLoop(d, a, b, n, [](double x, double y) { return y == 0 ? 0.0 : std::trunc(x / y); }); break;
+				case OpCode::LT: binaryLoop(d, a, b, n, [](double x, double y) { return x < y ? 1.0 : 0.0; }); break;
+				case OpCode::LE: binaryLoop(d, a, b, n, [](double x, double y) { return x <= y ? 1.0 : 0.0; }); break;
+				case OpCode::GT: binaryLoop(d, a, b, n, [](double x, double y) { return x > y ? 1.0 : 0.0; }); break;
+				case OpCode::GE: binaryLoop(d, a, b, n, [](double x, double y) { return x >= y ? 1.0 : 0.0; }); break;
+				case OpCode::EQ: binaryLoop(d, a, b, n, [](double x, double y) { return x == y ? 1.0 : 0.0; }); break;
+				case OpCode::NE: binaryLoop(d, a, b, n, [](double x, double y) { return x != y ? 1.0 : 0.0; }); break;
+				case OpCode::AND: binaryLoop(d, a, b, n, [](double x, double y) { return (x != 0 && y != 0) ? 1.0 : 0.0; }); break;
+				case OpCode::OR: binaryLoop(d, a, b, n, [](double x, double y) { return (x != 0 || y != 0) ? 1.0 : 0.0; }); break;
+				case OpCode::SELECT: {
+					const double *c = registers[ins.c];
+					for (size_t i = 0; i < n; i++)
+						d[i] = a[i] != 0 ? b[i] : c[i];
+					break;
+				}
+				case OpCode::SIN: unaryLoop(d, a, n, [](double x) { return std::sin(x); }); break;
+				case OpCode::ASIN: unaryLoop(d, a, n, [](double x) { return std::asin(x); }); break;
+				case OpCode::COS: unaryLoop(d, a, n, [](double x) { return std::cos(x); }); break;
+				case OpCode::ACOS: unaryLoop(d, a, n, [](double x) { return std::acos(x); }); break;
+				case OpCode::TAN: unaryLoop(d, a, n, [](double x) { return std::tan(x); }); break;
+				case OpCode::ATAN: unaryLoop(d, a, n, [](double x) { return std::atan(x); }); break;
+				case OpCode::FMOD: binaryLoop(d, a, b, n, [](double x, double y) { return std::fmod(x, y); }); break;
+				case OpCode::REMAINDER: binaryLoop(d, a, b, n, [](double x, double y) { return std::remainder(x, y); }); break;
+				case OpCode::CEIL: unaryLoop(d, a, n, [](double x) { return std::ceil(x); }); break;
+				case OpCode::FLOOR: unaryLoop(d, a, n, [](double x) { return std::floor(x); }); break;
+				case OpCode::ROUND: unaryLoop(d, a, n, [](double x) { return std::round(x); }); break;
+				case OpCode::TRUNC: unaryLoop(d, a, n, [](double x) { return std::trunc(x); }); break;
+				case OpCode::FABS: unaryLoop(d, a, n, [](double x) { return std::fabs(x); }); break;
+				case OpCode::FRACT: unaryLoop(d, a, n, [](double x) { return std::fmin(x - std::floor(x), std::nextafter(1.0, 0.0)); }); break;
+				case OpCode::POW: binaryLoop(d, a, b, n, [](double x, double y) { return std::pow(x, y); }); break;
+				case OpCode::SQRT: unaryLoop(d, a, n, [](double x) { return std::sqrt(x); }); break;
+				case OpCode::EXP: unaryLoop(d, a, n, [](double x) { return std::exp(x); }); break;
+				case OpCode::EXP2: unaryLoop(d, a, n, [](double x) { return std::exp2(x); }); break;
+				case OpCode::EXP10: unaryLoop(d, a, n, [](double x) { return std::pow(10.0, x); }); break;
+				case OpCode::LOG: unaryLoop(d, a, n, [](double x) { return std::log(x); }); break;
+				case OpCode::LOG2: unaryLoop(d, a, n, [](double x) { return std::log2(x); }); break;
+				case OpCode::LOG10: unaryLoop(d, a, n, [](double x) { return std::log10(x); }); break;
+			}
+		}
+
+		memcpy(result + offset, registers[result_register], n * sizeof(double));
+	}
+}
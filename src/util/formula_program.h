@@ -0,0 +1,85 @@
+#ifndef UTIL_FORMULA_PROGRAM_H
+#define UTIL_FORMULA_PROGRAM_H
+
+#include "util/formula.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * A formula compiled into a bytecode, to evaluate it on the cpu instead of inside an opencl kernel.
+ *
+ * Supported is the subset of OpenCL C accepted by the expression operator: numbers, the variables
+ * A, B, C, ..., the arithmetic, comparison and logical operators, the ternary operator and the functions
+ * of Formula::addCLFunctions(). All values are held as doubles, but the program is typed: a division of
+ * two integers truncates like in C.
+ *
+ * Programs evaluate blocks of values. Every instruction is a plain loop over a block,
+ * which allows the compiler to vectorize it.
+ */
+class FormulaProgram {
+	public:
+		enum class Type {
+			INTEGER,
+			FLOAT
+		};
+
+		/**
+		 * Compiles the given formula or returns a previously compiled, identical program
+		 * @param formula the formula
+		 * @param variable_types the types of the variables A, B, ...
+		 * @return the program
+		 */
+		static std::shared_ptr<const FormulaProgram> get(const std::string &formula, const std::vector<Type> &variable_types);
+
+		FormulaProgram(const std::string &formula, const std::vector<Type> &variable_types);
+		FormulaProgram(const FormulaProgram &other) = delete;
+
+		/**
+		 * @return the type of the values computed by this program
+		 */
+		Type getResultType() const { return result_type; }
+
+		/**
+		 * Evaluates the formula for count values.
+		 * @param variables an array holding count values for each variable
+		 * @param result an array receiving the count results
+		 * @param count the number of values
+		 */
+		void evaluate(const double * const *variables, double *result, size_t count) const;
+
+	private:
+		class Parser;
+
+		enum class OpCode : uint8_t {
+			CONST,
+			NEG, NOT,
+			ADD, SUB, MUL, DIV, IDIV,
+			LT, LE, GT, GE, EQ, NE,
+			AND, OR,
+			SELECT,
+			SIN, ASIN, COS, ACOS, TAN, ATAN,
+			FMOD, REMAINDER,
+			CEIL, FLOOR, ROUND, TRUNC, FABS, FRACT,
+			POW, SQRT, EXP, EXP2, EXP10, LOG, LOG2, LOG10
+		};
+
+		// operands and destinations are registers; the first ones hold the variables
+		struct Instruction {
+			OpCode op;
+			uint32_t dst, a, b, c;
+			double value;
+		};
+
+		static const size_t BLOCK_SIZE = 256;
+
+		std::vector<Instruction> code;
+		uint32_t variable_count;
+		uint32_t register_count;
+		uint32_t result_register;
+		Type result_type;
+};
+
+#endif
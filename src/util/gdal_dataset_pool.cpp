@@ -0,0 +1,133 @@
+#include "util/gdal_dataset_pool.h"
+#include "util/gdal.h"
+#include "util/configuration.h"
+
+#include <sys/stat.h>
+
+#include <gdal_priv.h>
+
+
+GDALDatasetPool::Handle::Handle(GDALDatasetPool &pool, const std::string &filename, GDALDataset *dataset, time_t mtime)
+	: pool(&pool), filename(filename), dataset(dataset), mtime(mtime), reusable(true) {
+}
+
+GDALDatasetPool::Handle::Handle(Handle &&other)
+	: pool(other.pool), filename(std::move(other.filename)), dataset(other.dataset), mtime(other.mtime), reusable(other.reusable) {
+	other.dataset = nullptr;
+}
+
+GDALDatasetPool::Handle::~Handle() {
+	if (dataset != nullptr)
+		pool->checkin(filename, dataset, mtime, reusable);
+}
+
+
+GDALDatasetPool &GDALDatasetPool::getInstance() {
+	static GDALDatasetPool instance(
+		Configuration::get<size_t>("gdalsource.pool.max_open", 0),
+		Configuration::get<int>("gdalsource.pool.idle_timeout", 60)
+	);
+	return instance;
+}
+
+GDALDatasetPool::GDALDatasetPool(size_t max_open, int idle_timeout) : max_open(max_open), idle_timeout(idle_timeout), open_count(0) {
+}
+
+GDALDatasetPool::~GDALDatasetPool() {
+	clear();
+}
+
+GDALDatasetPool::Handle GDALDatasetPool::checkout(const std::string &filename) {
+	GDAL::init();
+
+	time_t mtime = getModificationTime(filename);
+	GDALDataset *dataset = nullptr;
+	std::list<IdleDataset> closing;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		collectExpired(time(nullptr), closing);
+
+		for (auto it = idle.begin(); it != idle.end(); ) {
+			if (it->filename != filename) {
+				++it;
+				continue;
+			}
+			auto current = it++;
+			if (current->mtime != mtime) {
+				// the file was replaced, its datasets are outdated
+				open_count--;
+				closing.splice(closing.end(), idle, current);
+				continue;
+			}
+			dataset = current->dataset;
+			idle.erase(current);
+			break;
+		}
+		if (dataset == nullptr)
+			open_count++;
+	}
+	close(closing);
+
+	if (dataset == nullptr) {
+		dataset = (GDALDataset *) GDALOpen(filename.c_str(), GA_ReadOnly);
+		if (dataset == nullptr) {
+			std::lock_guard<std::mutex> guard(mutex);
+			open_count--;
+		}
+	}
+
+	return Handle(*this, filename, dataset, mtime);
+}
+
+void GDALDatasetPool::checkin(const std::string &filename, GDALDataset *dataset, time_t mtime, bool reusable) {
+	std::list<IdleDataset> closing;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		time_t now = time(nullptr);
+		if (reusable && max_open > 0)
+			idle.push_front(IdleDataset{filename, dataset, mtime, now});
+		else {
+			open_count--;
+			closing.push_back(IdleDataset{filename, dataset, mtime, now});
+		}
+		collectExpired(now, closing);
+	}
+	close(closing);
+}
+
+void GDALDatasetPool::collectExpired(time_t now, std::list<IdleDataset> &closing) {
+	// the least recently returned datasets are at the end
+	while (!idle.empty() && (open_count > max_open || idle.back().returned + idle_timeout < now)) {
+		open_count--;
+		closing.splice(closing.end(), idle, std::prev(idle.end()));
+	}
+}
+
+void GDALDatasetPool::close(std::list<IdleDataset> &closing) {
+	for (auto &entry : closing)
+		GDALClose(entry.dataset);
+	closing.clear();
+}
+
+time_t GDALDatasetPool::getModificationTime(const std::string &filename) {
+	// Virtual files like /vsicurl/ cannot be checked; their datasets are only closed after the timeout
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0)
+		return 0;
+	return st.st_mtime;
+}
+
+size_t GDALDatasetPool::getOpenCount() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return open_count;
+}
+
+void GDALDatasetPool::clear() {
+	std::list<IdleDataset> closing;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		open_count -= idle.size();
+		closing.splice(closing.end(), idle);
+	}
+	close(closing);
+}
@@ -0,0 +1,112 @@
+#ifndef UTIL_GDAL_DATASET_POOL_H
+#define UTIL_GDAL_DATASET_POOL_H
+
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+
+class GDALDataset;
+
+/*
+ * A process-wide pool of opened, read-only GDAL datasets.
+ *
+ * Opening a dataset can be more expensive than reading from it, e.g. for GeoTIFFs with large headers
+ * or VRTs. The pool keeps datasets open between queries, together with their block caches.
+ *
+ * GDAL datasets must not be used by several threads at once, so each dataset is checked out exclusively.
+ * Concurrent requests for the same file open additional datasets.
+ *
+ * Idle datasets are closed after a timeout, when their file was modified, or when the number of open
+ * datasets exceeds the limit. The limit is soft: datasets in use are never closed, so it may be exceeded
+ * while more datasets are checked out at once.
+ */
+class GDALDatasetPool {
+	public:
+		/**
+		 * A dataset checked out from the pool. It is returned to the pool when the handle is destroyed.
+		 */
+		class Handle {
+			public:
+				Handle(Handle &&other);
+				~Handle();
+				Handle(const Handle &) = delete;
+				Handle &operator=(const Handle &) = delete;
+				Handle &operator=(Handle &&) = delete;
+
+				GDALDataset *get() const { return dataset; }
+				GDALDataset *operator->() const { return dataset; }
+
+				/**
+				 * Closes the dataset when the handle is destroyed instead of returning it to the pool,
+				 * e.g. after an error left it in an unknown state
+				 */
+				void discard() { reusable = false; }
+
+			private:
+				Handle(GDALDatasetPool &pool, const std::string &filename, GDALDataset *dataset, time_t mtime);
+
+				GDALDatasetPool *pool;
+				std::string filename;
+				GDALDataset *dataset;
+				time_t mtime;
+				bool reusable;
+
+				friend class GDALDatasetPool;
+		};
+
+		/**
+		 * @return the process-wide pool. It is configured by the settings "gdalsource.pool.max_open"
+		 * and "gdalsource.pool.idle_timeout" (in seconds)
+		 */
+		static GDALDatasetPool &getInstance();
+
+		/**
+		 * @param max_open the maximum number of open datasets; 0 disables pooling
+		 * @param idle_timeout the number of seconds after which unused datasets are closed
+		 */
+		GDALDatasetPool(size_t max_open, int idle_timeout);
+		~GDALDatasetPool();
+		GDALDatasetPool(const GDALDatasetPool &) = delete;
+		GDALDatasetPool &operator=(const GDALDatasetPool &) = delete;
+
+		/**
+		 * Opens the given file read-only or reuses an idle dataset of it
+		 * @param filename the file to open
+		 * @return the handle. Like GDALOpen(), it holds a nullptr if the file cannot be opened
+		 */
+		Handle checkout(const std::string &filename);
+
+		/**
+		 * @return the number of datasets currently open, including datasets in use
+		 */
+		size_t getOpenCount();
+
+		/**
+		 * Closes all idle datasets
+		 */
+		void clear();
+
+	private:
+		struct IdleDataset {
+			std::string filename;
+			GDALDataset *dataset;
+			time_t mtime;
+			time_t returned;
+		};
+
+		void checkin(const std::string &filename, GDALDataset *dataset, time_t mtime, bool reusable);
+		// moves idle datasets that should be closed to the given list. The mutex must be held.
+		void collectExpired(time_t now, std::list<IdleDataset> &closing);
+		static void close(std::list<IdleDataset> &closing);
+		static time_t getModificationTime(const std::string &filename);
+
+		const size_t max_open;
+		const int idle_timeout;
+		std::mutex mutex;
+		// most recently returned first
+		std::list<IdleDataset> idle;
+		size_t open_count;
+};
+
+#endif
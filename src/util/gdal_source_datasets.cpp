@@ -1,11 +1,12 @@
 
-#include <fstream>
-#include <json/reader.h>
+#include <map>
+#include <mutex>
 #include <boost/filesystem.hpp>
 
 #include "gdal_source_datasets.h"
 #include "configuration.h"
 #include "exceptions.h"
+#include "json_file_cache.h"
 
 
 const std::string suffix(".json");
@@ -38,22 +39,42 @@ std::vector<std::string> GDALSourceDataSets::getDataSetNames() {
     return dataSetNames;
 }
 
-Json::Value GDALSourceDataSets::getDataSetDescription(const std::string &dataSetName) {
+static JsonFileCache descriptions;
 
+std::shared_ptr<const Json::Value> GDALSourceDataSets::getSharedDataSetDescription(const std::string &dataSetName) {
     boost::filesystem::path file_path(Configuration::get<std::string>("gdalsource.datasets.path"));
     file_path /= (dataSetName + suffix);
 
-    //open file then read json object from it
-    std::ifstream file(file_path.string());
-    if (!file.is_open()) {
-        throw ArgumentException("GDAlSourceDataSets: Data set with given name not found");
-    }
+    return descriptions.get(file_path.string(),
+                            "GDAlSourceDataSets: Data set with given name not found",
+                            "GDALSourceDataSets: invalid json file");
+}
 
-    Json::Reader reader(Json::Features::strictMode());
-    Json::Value root;
-    if (!reader.parse(file, root)) {
-        throw ArgumentException("GDALSourceDataSets: invalid json file");
+Json::Value GDALSourceDataSets::getDataSetDescription(const std::string &dataSetName) {
+    return *getSharedDataSetDescription(dataSetName);
+}
+
+// templates are rebuilt when the description they were parsed from is replaced
+struct CachedLoadingTemplate {
+    std::shared_ptr<const Json::Value> description;
+    std::shared_ptr<const GDALTimesnap::GDALDataLoadingTemplate> loadingTemplate;
+};
+static std::map<std::pair<std::string, int>, CachedLoadingTemplate> loadingTemplates;
+static std::mutex loadingTemplates_mutex;
+
+std::shared_ptr<const GDALTimesnap::GDALDataLoadingTemplate> GDALSourceDataSets::getDataLoadingTemplate(const std::string &dataSetName, int channel) {
+    auto description = getSharedDataSetDescription(dataSetName);
+    auto key = std::make_pair(dataSetName, channel);
+    {
+        std::lock_guard<std::mutex> guard(loadingTemplates_mutex);
+        auto it = loadingTemplates.find(key);
+        if (it != loadingTemplates.end() && it->second.description == description)
+            return it->second.loadingTemplate;
     }
 
-    return root;
+    auto loadingTemplate = std::make_shared<const GDALTimesnap::GDALDataLoadingTemplate>(*description, channel);
+
+    std::lock_guard<std::mutex> guard(loadingTemplates_mutex);
+    loadingTemplates[key] = CachedLoadingTemplate{description, loadingTemplate};
+    return loadingTemplate;
 }
@@ -3,7 +3,9 @@
 #define MAPPING_CORE_GDAL_SOURCE_DATASETS_H
 
 #include "userdb/userdb.h"
+#include "util/gdal_timesnap.h"
 
+#include <memory>
 #include <vector>
 #include <json/value.h>
 
@@ -17,11 +19,22 @@ public:
 
 
     /**
-     * get the data set description of the given data set
+     * get the data set description of the given data set.
+     * Descriptions are parsed once and kept in memory until their file changes.
      * @param dataSetName
      */
     static Json::Value getDataSetDescription(const std::string &dataSetName);
 
+    /**
+     * get the parsed loading parameters of a channel of the given data set
+     * @param dataSetName
+     * @param channel
+     */
+    static std::shared_ptr<const GDALTimesnap::GDALDataLoadingTemplate> getDataLoadingTemplate(const std::string &dataSetName, int channel);
+
+private:
+    static std::shared_ptr<const Json::Value> getSharedDataSetDescription(const std::string &dataSetName);
+
 };
 
 
@@ -103,41 +103,61 @@ ptime GDALTimesnap::snapToInterval(TimeUnit snapUnit, int intervalValue, ptime s
 
 
 
-// calculates the filename for queried time by snapping the wanted time to the 
-// nearest smaller timestamp that exists for the dataset
-// TODO: move general parameter parsing to a more appropriate function
-GDALTimesnap::GDALDataLoadingInfo GDALTimesnap::getDataLoadingInfo(Json::Value datasetJson, int channel, const TemporalReference &tref)
-{
+GDALTimesnap::GDALDataLoadingTemplate::GDALDataLoadingTemplate(const Json::Value &datasetJson, int channel)
+    : intervalUnit(TimeUnit::Month), intervalValue(1), crsId(CrsId::unreferenced()), nodata(NAN), unit(Unit::unknown()) {
     // get parameters
-    Json::Value channelJson = datasetJson["channels"][channel];
+    const Json::Value &channelJson = datasetJson["channels"][channel];
 
-	std::string time_format = channelJson.get("time_format", datasetJson.get("time_format", "")).asString();
+	timeFormat = channelJson.get("time_format", datasetJson.get("time_format", "")).asString();
 	std::string time_start 	= channelJson.get("time_start", datasetJson.get("time_start", "")).asString();
 	std::string time_end 	= channelJson.get("time_end", datasetJson.get("time_end", "")).asString();
 
-    std::string path 	 = channelJson.get("path", datasetJson.get("path", "")).asString();
-    std::string fileName = channelJson.get("file_name", datasetJson.get("file_name", "")).asString();
+    path 	 = channelJson.get("path", datasetJson.get("path", "")).asString();
+    fileName = channelJson.get("file_name", datasetJson.get("file_name", "")).asString();
 
-    channel = channelJson.get("channel", channel).asInt();
+    this->channel = channelJson.get("channel", channel).asInt();
 
     // resolve time
     auto timeParser = TimeParser::create(TimeParser::Format::ISO);
 
-    double time_start_mapping;
-    double time_end_mapping;
+    hasTimeStart = !time_start.empty();
+    timeStart = hasTimeStart ? timeParser->parse(time_start) : 0;
+    hasTimeEnd = !time_end.empty();
+    timeEnd = hasTimeEnd ? timeParser->parse(time_end) : 0;
 
-    if(time_start.empty()) {
-        time_start_mapping = tref.beginning_of_time();
-    } else {
-        time_start_mapping = timeParser->parse(time_start);
+    hasTimeInterval = datasetJson.isMember("time_interval") || channelJson.isMember("time_interval");
+    if (hasTimeInterval) {
+        Json::Value timeInterval = channelJson.get("time_interval", datasetJson.get("time_interval", Json::Value(Json::objectValue)));
+        intervalUnit 	 = GDALTimesnap::createTimeUnit(timeInterval.get("unit", "Month").asString());
+        intervalValue 	 = timeInterval.get("value", 1).asInt();
     }
 
-    if(time_end.empty()) {
-        time_end_mapping = tref.end_of_time();
-    } else {
-        time_end_mapping = timeParser->parse(time_end);
+    // other GDAL parameters
+    if (channelJson.isMember("unit")) {
+        unit = Unit(channelJson["unit"]);
     }
 
+    if (channelJson.isMember("nodata")) {
+        nodata = channelJson["nodata"].asDouble();
+    }
+
+    auto coords = channelJson.get("coords", datasetJson["coords"]);
+    crsId = CrsId::from_srs_string(coords.get("crs", "").asString());
+}
+
+GDALTimesnap::GDALDataLoadingInfo GDALTimesnap::getDataLoadingInfo(Json::Value datasetJson, int channel, const TemporalReference &tref) {
+    return getDataLoadingInfo(GDALDataLoadingTemplate(datasetJson, channel), tref);
+}
+
+// calculates the filename for queried time by snapping the wanted time to the 
+// nearest smaller timestamp that exists for the dataset
+GDALTimesnap::GDALDataLoadingInfo GDALTimesnap::getDataLoadingInfo(const GDALDataLoadingTemplate &loadingTemplate, const TemporalReference &tref)
+{
+    std::string fileName = loadingTemplate.fileName;
+
+    double time_start_mapping = loadingTemplate.hasTimeStart ? loadingTemplate.timeStart : tref.beginning_of_time();
+    double time_end_mapping = loadingTemplate.hasTimeEnd ? loadingTemplate.timeEnd : tref.end_of_time();
+
     double wantedTimeUnix = tref.t1;
 
     //check if requested time is in range of dataset timestamps
@@ -145,10 +165,9 @@ GDALTimesnap::GDALDataLoadingInfo GDALTimesnap::getDataLoadingInfo(Json::Value d
     if(wantedTimeUnix < time_start_mapping || wantedTimeUnix > time_end_mapping)
         throw NoRasterForGivenTimeException("Requested time is not in range of dataset");
 
-    if(datasetJson.isMember("time_interval") || channelJson.isMember("time_interval")) {
-        Json::Value timeInterval = channelJson.get("time_interval", datasetJson.get("time_interval", Json::Value(Json::objectValue)));
-        TimeUnit intervalUnit 	 = GDALTimesnap::createTimeUnit(timeInterval.get("unit", "Month").asString());
-        int intervalValue 		 = timeInterval.get("value", 1).asInt();
+    if(loadingTemplate.hasTimeInterval) {
+        TimeUnit intervalUnit 	 = loadingTemplate.intervalUnit;
+        int intervalValue 		 = loadingTemplate.intervalValue;
 
 
         // doesn't work on older boost versions because seconds precision is limit to 32bit
@@ -193,7 +212,7 @@ GDALTimesnap::GDALDataLoadingInfo GDALTimesnap::getDataLoadingInfo(Json::Value d
         gmtime_r(&snappedTimeT, &snappedTimeTm);
 
         char date[MAX_FILE_NAME_LENGTH] = {0};
-        strftime(date, sizeof(date), time_format.c_str(), &snappedTimeTm);
+        strftime(date, sizeof(date), loadingTemplate.timeFormat.c_str(), &snappedTimeTm);
         std::string snappedTimeString(date);
 
         std::string placeholder = "%%%TIME_STRING%%%";
@@ -203,24 +222,9 @@ GDALTimesnap::GDALDataLoadingInfo GDALTimesnap::getDataLoadingInfo(Json::Value d
     }
 
 
-    // other GDAL parameters
-    Unit unit = Unit::unknown();
-    if (channelJson.isMember("unit")) {
-        unit = Unit(channelJson["unit"]);
-    }
-
-    double nodata = NAN;
-    if (channelJson.isMember("nodata")) {
-        nodata = channelJson["nodata"].asDouble();
-    }
-
-    auto coords = channelJson.get("coords", datasetJson["coords"]);
-    CrsId crsId = CrsId::from_srs_string(coords.get("crs", "").asString());
-
-
-    boost::filesystem::path file_path(path);
+    boost::filesystem::path file_path(loadingTemplate.path);
     file_path /= fileName;
-	return GDALDataLoadingInfo(file_path.string(), channel,
+	return GDALDataLoadingInfo(file_path.string(), loadingTemplate.channel,
                                TemporalReference(TIMETYPE_UNIX, time_start_mapping, time_end_mapping),
-                               crsId, nodata, unit);
+                               loadingTemplate.crsId, loadingTemplate.nodata, loadingTemplate.unit);
 }
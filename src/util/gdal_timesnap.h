@@ -47,8 +47,34 @@ class GDALTimesnap {
             Unit unit;
 		};
 
+		/*
+		 * The parameters of a channel of a dataset, parsed from its json description.
+		 * Everything except the time dependent file name is resolved once, so it can be reused for all queries.
+		 */
+		class GDALDataLoadingTemplate {
+		public:
+			GDALDataLoadingTemplate(const Json::Value &datasetJson, int channel);
+
+			std::string path;
+			std::string fileName;
+			std::string timeFormat;
+			int channel;
+
+			bool hasTimeStart, hasTimeEnd;
+			double timeStart, timeEnd;
+
+			bool hasTimeInterval;
+			TimeUnit intervalUnit;
+			int intervalValue;
+
+			CrsId crsId;
+			double nodata;
+			Unit unit;
+		};
+
         static ptime snapToInterval(TimeUnit unit, int unitValue, ptime startTime, ptime wantedTime);
 
+		static GDALDataLoadingInfo getDataLoadingInfo(const GDALDataLoadingTemplate &loadingTemplate, const TemporalReference &tref);
 		static GDALDataLoadingInfo getDataLoadingInfo(Json::Value datasetJson, int channel, const TemporalReference &tref);
 		
 		static TimeUnit createTimeUnit(std::string value);
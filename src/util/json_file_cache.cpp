@@ -0,0 +1,37 @@
+#include "util/json_file_cache.h"
+#include "util/exceptions.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+
+
+std::shared_ptr<const Json::Value> JsonFileCache::get(const std::string &filename, const std::string &not_found_message, const std::string &invalid_message) {
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0) {
+		std::lock_guard<std::mutex> guard(mutex);
+		entries.erase(filename);
+		throw ArgumentException(not_found_message);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		auto it = entries.find(filename);
+		if (it != entries.end() && it->second.mtime == st.st_mtime && it->second.size == st.st_size)
+			return it->second.content;
+	}
+
+	// Parse without holding the lock. Concurrent readers of a changed file may parse it twice.
+	std::ifstream file(filename);
+	if (!file.is_open())
+		throw ArgumentException(not_found_message);
+
+	Json::Reader reader(Json::Features::strictMode());
+	auto content = std::make_shared<Json::Value>();
+	if (!reader.parse(file, *content))
+		throw ArgumentException(invalid_message);
+
+	std::lock_guard<std::mutex> guard(mutex);
+	entries[filename] = Entry{st.st_mtime, st.st_size, content};
+	return content;
+}
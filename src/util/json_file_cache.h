@@ -0,0 +1,39 @@
+#ifndef UTIL_JSON_FILE_CACHE_H
+#define UTIL_JSON_FILE_CACHE_H
+
+#include <json/json.h>
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Keeps the parsed content of json files in memory.
+ * A file is parsed again as soon as its modification time or size changes.
+ */
+class JsonFileCache {
+	public:
+		/**
+		 * Returns the parsed content of the given file. The content is immutable; it is replaced
+		 * instead of modified when the file changes.
+		 * @param filename the file to read
+		 * @param not_found_message the message of the ArgumentException thrown if the file cannot be opened
+		 * @param invalid_message the message of the ArgumentException thrown if the file is not valid json
+		 * @return the parsed file
+		 */
+		std::shared_ptr<const Json::Value> get(const std::string &filename, const std::string &not_found_message, const std::string &invalid_message);
+
+	private:
+		struct Entry {
+			time_t mtime;
+			off_t size;
+			std::shared_ptr<const Json::Value> content;
+		};
+
+		std::mutex mutex;
+		std::unordered_map<std::string, Entry> entries;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "ogr_source_datasets.h"
 #include "configuration.h"
 #include "ogr_source_util.h"
+#include "json_file_cache.h"
 
 std::vector<std::string> OGRSourceDatasets::getDatasetNames(){
     namespace bf = boost::filesystem;
@@ -137,24 +138,16 @@ Json::Value OGRSourceDatasets::getDatasetListing(const std::string &dataset_name
     return root;
 }
 
+static JsonFileCache descriptions;
+
 Json::Value OGRSourceDatasets::getDatasetDescription(const std::string &name){
     std::string directory = Configuration::get<std::string>("ogrsource.files.path");
     boost::filesystem::path file_path(directory);
     file_path /= name + ".json";
 
-    std::ifstream file(file_path.string());
-    if (!file.is_open()) {
-        throw ArgumentException("OGR Source Datasets: File with given name not found -> " + name);
-    }
-
-    Json::Reader reader(Json::Features::strictMode());
-    Json::Value root;
-    bool success = reader.parse(file, root);
-    if (!success) {
-        throw ArgumentException("OGR Source Datasets: invalid json file: " + name);
-    }
-
-    return root;
+    return *descriptions.get(file_path.string(),
+                             "OGR Source Datasets: File with given name not found -> " + name,
+                             "OGR Source Datasets: invalid json file: " + name);
 }
 
 bool OGRSourceDatasets::hasJsonParameter(Json::Value &layer, Json::Value &dataset, const std::string &key){
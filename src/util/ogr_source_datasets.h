@@ -18,8 +18,9 @@ public:
     static std::vector<std::string> getDatasetNames();
 
     /**
-     * Opens the datasets json file and returns its content as a json object. The content is the basic query
+     * Returns the content of the datasets json file as a json object. The content is the basic query
      * parameters for opening the corresponding vector file with the OGR Source Operator.
+     * The file is parsed once and kept in memory until it changes.
      * @param name: name of the dataset to open.
      * @return json object defining the OGR dataset
      */
@@ -27,6 +27,7 @@ auto RasterizePolygons::get_raster() const -> std::unique_ptr<Raster2D<uint8_t>>
                     this->raster->fitToQueryRectangle(this->rect).release()
             )
     );
+    fitted_raster->setRepresentation(GenericRaster::Representation::CPU);
 
     Unit boolean_unit = Unit::unknown();
     boolean_unit.setMinMax(0, 1); // reserve one value for each polygon in the collection
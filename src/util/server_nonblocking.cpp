@@ -20,13 +20,15 @@
 #include <sys/stat.h>
 // waitpid
 #include <sys/wait.h>
+// epoll
+#include <sys/epoll.h>
 
 
 /*
  * Connection
  */
 NonblockingServer::Connection::Connection(NonblockingServer &server, int fd, int id)
-	: fd(fd), stream(BinaryStream::fromAcceptedSocket(fd,true)), state(State::INITIALIZING), is_closed(false), server(server), id(id) {
+	: fd(fd), stream(BinaryStream::fromAcceptedSocket(fd,true)), state(State::INITIALIZING), is_closed(false), registered_events(0), server(server), id(id) {
 	stream.makeNonBlocking();
 	// the client is supposed to send the first data, so we'll start reading.
 	waitForData();
@@ -60,8 +62,11 @@ void NonblockingServer::Connection::close() {
 		// we must not remove them while another thread may be using the connection.
 		readbuffer.reset(nullptr);
 		writebuffer.reset(nullptr);
+		// unregister before closing, the fd may be reused by another connection right away
+		server.registerFD(*this, 0);
 		stream.close();
 	}
+	server.connectionChanged(*this);
 }
 
 void NonblockingServer::Connection::startWritingData(std::unique_ptr<BinaryWriteBuffer> new_writebuffer) {
@@ -72,8 +77,7 @@ void NonblockingServer::Connection::startWritingData(std::unique_ptr<BinaryWrite
 	writebuffer = std::move(new_writebuffer);
 	auto &server = this->server;
 	state = State::WRITING_DATA;
-	if (old_state != State::PROCESSING_DATA)
-		server.wake();
+	server.connectionChanged(*this);
 }
 
 void NonblockingServer::Connection::enqueueForAsyncProcessing() {
@@ -90,6 +94,7 @@ void NonblockingServer::Connection::goIdle() {
 		throw MustNotHappenException("Connection::goIdle() cannot be called in current state");
 	readbuffer.reset(nullptr);
 	state = State::IDLE;
+	server.connectionChanged(*this);
 }
 
 void NonblockingServer::Connection::forkAndProcess(int timeout_seconds) {
@@ -124,9 +129,8 @@ void NonblockingServer::Connection::forkAndProcess(int timeout_seconds) {
 			// We "steal" the stream from the connection before closing it. The child process can access the stream directly.
 			BinaryStream new_stream = std::move(stream);
 			new_stream.makeBlocking();
-			close();
 
-			// now that we have the only stream we're interested in, let the server close all the connections.
+			// now that we have the only stream we're interested in, let the server close all the connections, including this one.
 			server.cleanupAfterFork();
 
 			Log::info("New child process starting");
@@ -174,7 +178,7 @@ void NonblockingServer::Connection::processDataForked(BinaryStream stream) {
 /*
  * Helper Function
  */
-static void addListeningSockets(int port, std::vector<int> &listensockets) {
+static void addListeningSockets(const char *address, int port, std::vector<int> &listensockets) {
 	int sockets_added = 0;
 
 	int sock;
@@ -183,12 +187,12 @@ static void addListeningSockets(int port, std::vector<int> &listensockets) {
 	memset(&hints, 0, sizeof hints);
 	hints.ai_family = AF_UNSPEC;
 	hints.ai_socktype = SOCK_STREAM;
-	hints.ai_flags = AI_PASSIVE;
+	hints.ai_flags = address == nullptr ? AI_PASSIVE : 0;
 
 	char portstr[16];
 	snprintf(portstr, 16, "%d", port);
 	int rv;
-	if ((rv = getaddrinfo(nullptr, portstr, &hints, &servinfo)) != 0)
+	if ((rv = getaddrinfo(address, portstr, &hints, &servinfo)) != 0)
 		throw NetworkException(concat("getaddrinfo() failed: ", gai_strerror(rv)));
 
 	// loop through all the results and bind to the first we can
@@ -221,7 +225,7 @@ static void addListeningSockets(int port, std::vector<int> &listensockets) {
 	freeaddrinfo(servinfo);
 
 	if (sockets_added == 0)
-		throw NetworkException(concat("failed to bind to any interface on port ", port));
+		throw NetworkException(concat("failed to bind to ", address == nullptr ? "any interface" : address, " on port ", port));
 }
 
 static int getListeningSocket(const std::string &socket_path, int umode) {
@@ -231,7 +235,7 @@ static int getListeningSocket(const std::string &socket_path, int umode) {
 	int sock;
 
 	// create a socket
-	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
 	if (sock < 0)
 		throw NetworkException(concat("socket() failed: ", strerror(errno)));
 
@@ -257,13 +261,88 @@ static int getListeningSocket(const std::string &socket_path, int umode) {
 /*
  * Nonblocking Server
  */
+// epoll tags of the fds which do not belong to a connection. Connections are tagged with their id.
+static const uint64_t EPOLL_TAG_WAKEUP = 0;
+static const uint64_t EPOLL_TAG_LISTEN = 1ull << 32;
+
+static const int EPOLL_MAX_EVENTS = 256;
+
 NonblockingServer::NonblockingServer()
-	: num_workers(0), allow_forking(false), next_connection_id(1), running(false), wakeup_pipe(BinaryStream::makePipe()) {
+	: num_workers(0), allow_forking(false), next_connection_id(1), epoll_fd(-1), running(false), wakeup_pipe(BinaryStream::makePipe()) {
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0)
+		throw PlatformException(concat("epoll_create1() failed: ", strerror(errno)));
+	// a full pipe is readable already, so further wakeups must not block
+	wakeup_pipe.makeNonBlocking();
 }
 
 NonblockingServer::~NonblockingServer() {
 	closeAllListenSockets();
 	stopAllWorkers();
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+}
+
+void NonblockingServer::registerFD(Connection &c, uint32_t events) {
+	uint32_t old_events = c.registered_events;
+	if (old_events == events || epoll_fd < 0)
+		return;
+
+	struct epoll_event ev;
+	ev.events = events;
+	ev.data.u64 = (uint64_t) c.id;
+	int op = old_events == 0 ? EPOLL_CTL_ADD : (events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+	// Removing fails if the fd was already closed, which removes it from the epoll set anyway
+	if (epoll_ctl(epoll_fd, op, c.fd, &ev) < 0 && op != EPOLL_CTL_DEL)
+		throw NetworkException(concat("epoll_ctl() failed: ", strerror(errno)));
+	c.registered_events = events;
+}
+
+void NonblockingServer::connectionChanged(Connection &c) {
+	// After fork(), the child process has no main loop
+	if (epoll_fd < 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(changed_connections_mutex);
+		changed_connections.push_back(c.id);
+	}
+	if (std::this_thread::get_id() != main_loop_thread)
+		wake();
+}
+
+void NonblockingServer::processChangedConnections() {
+	std::vector<int> changed;
+	{
+		std::lock_guard<std::mutex> lock(changed_connections_mutex);
+		changed.swap(changed_connections);
+	}
+
+	std::lock_guard<std::recursive_mutex> connections_lock(connections_mutex);
+	for (auto id : changed) {
+		auto it = connections.find(id);
+		if (it != connections.end())
+			updateConnection(it);
+	}
+}
+
+void NonblockingServer::updateConnection(std::map<int, std::unique_ptr<Connection>>::iterator it) {
+	auto &c = *it->second;
+	Connection::State state = c.state;
+	if (c.is_closed) {
+		if (state != Connection::State::PROCESSING_DATA_ASYNC) {
+			auto id = c.id;
+			connections.erase(it);
+			Log::info("%d: closing, %lu clients remain", id, connections.size());
+		}
+		return;
+	}
+
+	uint32_t events = 0;
+	if (state == Connection::State::WRITING_DATA)
+		events = EPOLLOUT;
+	else if (state == Connection::State::READING_DATA)
+		events = EPOLLIN;
+	registerFD(c, events);
 }
 
 void NonblockingServer::readNB(Connection &c) {
@@ -320,6 +399,8 @@ void NonblockingServer::enqueueTask(Connection *connection) {
 		throw;
 	}
 	connection->state = Connection::State::PROCESSING_DATA_ASYNC;
+	// the worker takes over the fd
+	registerFD(*connection, 0);
 	lock.unlock();
 	job_queue_cond.notify_one();
 }
@@ -339,6 +420,7 @@ NonblockingServer::Connection *NonblockingServer::popTask() {
 			// it's possible that the connection had a problem somewhere..
 			// We don't want to spend work on it, but we need to pass ownership back to the main thread so it can be reaped.
 			connection->state = Connection::State::IDLE;
+			connectionChanged(*connection);
 			continue;
 		}
 		if (connection->state != Connection::State::PROCESSING_DATA_ASYNC)
@@ -352,10 +434,9 @@ NonblockingServer::Connection *NonblockingServer::popTask() {
 
 NonblockingServer::Connection *NonblockingServer::getIdleConnectionById(int id) {
 	std::lock_guard<std::recursive_mutex> connections_lock(connections_mutex);
-	for (auto &c : connections) {
-		if (c->id == id && c->state == Connection::State::IDLE && !c->is_closed)
-			return c.get();
-	}
+	auto it = connections.find(id);
+	if (it != connections.end() && it->second->state == Connection::State::IDLE && !it->second->is_closed)
+		return it->second.get();
 	throw ArgumentException("No idle connection with the given ID found");
 }
 
@@ -377,7 +458,14 @@ void NonblockingServer::listen(int portnr) {
 	if (running)
 		throw MustNotHappenException("NonblockingServer: do not call listen() after start()");
 
-	addListeningSockets(portnr, listensockets_inet);
+	addListeningSockets(nullptr, portnr, listensockets_inet);
+}
+
+void NonblockingServer::listen(int portnr, const std::string &address) {
+	if (running)
+		throw MustNotHappenException("NonblockingServer: do not call listen() after start()");
+
+	addListeningSockets(address.c_str(), portnr, listensockets_inet);
 }
 
 void NonblockingServer::listen(const std::string &socket_path, int umode) {
@@ -481,24 +569,6 @@ void NonblockingServer::reapAllChildProcesses(bool force_timeout) {
 }
 
 
-class FDSet {
-	public:
-		FDSet() {
-			FD_ZERO(&fds);
-			maxfd = 0;
-		}
-		void set(int fd) {
-			FD_SET(fd, &fds);
-			maxfd = std::max(maxfd, fd);
-		}
-		bool isset(int fd) {
-			return FD_ISSET(fd, &fds);
-		}
-		int maxfd;
-		fd_set fds;
-};
-
-
 void NonblockingServer::start() {
 	if (listensockets_inet.empty() && listensockets_unix.empty())
 		throw ArgumentException("NonblockingServer: call listen() before start()");
@@ -506,55 +576,36 @@ void NonblockingServer::start() {
 	if (!running.compare_exchange_strong(expected, true))
 		throw ArgumentException("NonblockingServer: already running");
 
+	main_loop_thread = std::this_thread::get_id();
+
+	auto addFD = [this](int fd, uint64_t tag) {
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = tag;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+			throw NetworkException(concat("epoll_ctl() failed: ", strerror(errno)));
+	};
+	addFD(wakeup_pipe.getReadFD(), EPOLL_TAG_WAKEUP);
+	for (auto sock : listensockets_inet)
+		addFD(sock, EPOLL_TAG_LISTEN | (uint32_t) sock);
+	for (auto sock : listensockets_unix)
+		addFD(sock, EPOLL_TAG_LISTEN | (uint32_t) sock);
+
 	for (int i=0;i<num_workers;i++)
 		workers.emplace_back(&NonblockingServer::worker_thread, this);
 
+	struct epoll_event events[EPOLL_MAX_EVENTS];
 	while (true) {
 		reapAllChildProcesses();
+		processChangedConnections();
 
-		struct timeval tv{60,0};
-		FDSet readfds;
-		FDSet writefds;
-
-		std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
-		auto it = connections.begin();
-		while (it != connections.end()) {
-			auto &c = *it;
-			int fd = c->fd;
-			Connection::State state = c->state;
-			if (c->is_closed) {
-				if (state != Connection::State::PROCESSING_DATA_ASYNC) {
-					auto id = c->id;
-					it = connections.erase(it);
-					Log::info("%d: closing, %lu clients remain", id, connections.size());
-					continue; // avoid the ++it
-				}
-			}
-			else {
-				if (state == Connection::State::WRITING_DATA)
-					writefds.set(fd);
-				else if (state == Connection::State::READING_DATA)
-					readfds.set(fd);
-			}
-			++it;
-		}
-		connections_lock.unlock();
-
-		readfds.set(wakeup_pipe.getReadFD());
-
-		for (auto sock : listensockets_inet)
-			readfds.set(sock);
-
-		for (auto sock : listensockets_unix)
-			readfds.set(sock);
-
-		auto res = select(std::max(readfds.maxfd, writefds.maxfd)+1, &readfds.fds, &writefds.fds, nullptr, &tv);
+		auto res = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, 60000);
 		if (res == 0) // timeout
 			continue;
 		if (res < 0) {
 			if (errno == EINTR) // interrupted by signal
 				continue;
-			throw NetworkException(concat("select() call failed: ", strerror(errno)));
+			throw NetworkException(concat("epoll_wait() call failed: ", strerror(errno)));
 		}
 
 		if (!running) {
@@ -562,38 +613,31 @@ void NonblockingServer::start() {
 			break;
 		}
 
-		if (readfds.isset(wakeup_pipe.getReadFD())) {
-			// we have been woken, now we need to read any outstanding data or the pipe will remain readable
-			char buf[1024];
-			read(wakeup_pipe.getReadFD(), buf, 1024);
-		}
-
-		connections_lock.lock();
-		for (auto &c : connections) {
-			Connection::State state = c->state;
-			if (state == Connection::State::WRITING_DATA && writefds.isset(c->fd)) {
-				writeNB(*c);
-			}
-			else if (state == Connection::State::READING_DATA && readfds.isset(c->fd)) {
-				readNB(*c);
+		std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
+		for (int i=0;i<res;i++) {
+			uint64_t tag = events[i].data.u64;
+			if (tag == EPOLL_TAG_WAKEUP) {
+				// we have been woken, now we need to read any outstanding data or the pipe will remain readable
+				char buf[1024];
+				read(wakeup_pipe.getReadFD(), buf, 1024);
 			}
-		}
-		connections_lock.unlock();
-
-		for (int sock : listensockets_inet) {
-			if (readfds.isset(sock)) {
-				struct sockaddr_storage remote_addr; // for AF_INET
-				socklen_t sin_size = sizeof(remote_addr);
-				int new_fd = accept(sock, (struct sockaddr *) &remote_addr, &sin_size);
-				addNewConnectionFromAcceptedFD(new_fd);
+			else if (tag & EPOLL_TAG_LISTEN) {
+				acceptAll((int) (uint32_t) tag);
 			}
-		}
-		for (int sock : listensockets_unix) {
-			if (readfds.isset(sock)) {
-				struct sockaddr_un remote_addr; // for AF_UNIX
-				socklen_t sin_size = sizeof(remote_addr);
-				int new_fd = accept(sock, (struct sockaddr *) &remote_addr, &sin_size);
-				addNewConnectionFromAcceptedFD(new_fd);
+			else {
+				// Events of connections removed in this iteration are skipped
+				auto it = connections.find((int) tag);
+				if (it == connections.end())
+					continue;
+				auto &c = *it->second;
+				// Errors and hangups are reported by the next read or write
+				uint32_t revents = events[i].events;
+				Connection::State state = c.state;
+				if (state == Connection::State::WRITING_DATA && (revents & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+					writeNB(c);
+				else if (state == Connection::State::READING_DATA && (revents & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+					readNB(c);
+				updateConnection(it);
 			}
 		}
 	}
@@ -602,6 +646,18 @@ void NonblockingServer::start() {
 	reapAllChildProcesses(true);
 }
 
+void NonblockingServer::acceptAll(int sock) {
+	// The listen sockets are non-blocking, so all pending connections are accepted at once
+	while (true) {
+		struct sockaddr_storage remote_addr; // large enough for AF_INET, AF_INET6 and AF_UNIX
+		socklen_t sin_size = sizeof(remote_addr);
+		int new_fd = accept(sock, (struct sockaddr *) &remote_addr, &sin_size);
+		if (new_fd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return;
+		addNewConnectionFromAcceptedFD(new_fd);
+	}
+}
+
 
 void NonblockingServer::addNewConnectionFromAcceptedFD(int fd) {
 	// this method is called with the return value from accept().
@@ -616,7 +672,9 @@ void NonblockingServer::addNewConnectionFromAcceptedFD(int fd) {
 	}
 
 	std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
-	connections.push_back( createConnection(fd, next_connection_id++) );
+	int id = next_connection_id++;
+	auto it = connections.emplace(id, createConnection(fd, id)).first;
+	updateConnection(it);
 }
 
 
@@ -631,7 +689,7 @@ void NonblockingServer::stopAllWorkers() {
 }
 
 void NonblockingServer::wake() {
-	// if the loop is currently in a select() phase, this write will wake it up.
+	// if the loop is currently waiting in epoll_wait(), this write will wake it up.
 	char c = 0;
 	write(wakeup_pipe.getWriteFD(), &c, 1);
 }
@@ -646,11 +704,15 @@ void NonblockingServer::cleanupAfterFork() {
 	// this is run on the client process. The main loop doesn't run any more.
 	running = false;
 
+	// The epoll instance is shared with the parent process, it must not be modified by the child.
+	close(epoll_fd);
+	epoll_fd = -1;
+
 	// Worker threads don't persist after fork(), so we don't need to clean up any.
 
 	// It closes all fds that aren't required by the client any more.
 	closeAllListenSockets();
 	for (auto &connection : connections) {
-		connection->close();
+		connection.second->close();
 	}
 }
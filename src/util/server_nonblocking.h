@@ -18,7 +18,10 @@
 /*
  * A server based on non-blocking network IO.
  *
- * TODO: allow multiple listen sockets (ipv4, ipv6, af_unix, multiple interfaces, ...)
+ * The server may listen on any number of sockets (ipv4, ipv6, af_unix, multiple interfaces, ...).
+ * Sockets are monitored with epoll. A connection is registered while it is reading or writing data,
+ * so each iteration of the main loop only costs time for the connections which are ready or changed
+ * their state, no matter how many idle connections are open.
  */
 class NonblockingServer {
 	public:
@@ -59,6 +62,8 @@ class NonblockingServer {
 				};
 				std::atomic<State> state;
 				std::atomic<bool> is_closed;
+				// the epoll events the fd is registered for, 0 if it is not registered
+				std::atomic<uint32_t> registered_events;
 
 				// The following methods all model state changes. Private methods are called by the Server, protected by the Connection.
 				void startProcessing();
@@ -78,9 +83,14 @@ class NonblockingServer {
 		NonblockingServer();
 		virtual ~NonblockingServer();
 		/*
-		 * Sets up a TCP listening socket, but does not accept any connections yet.
+		 * Sets up TCP listening sockets on all interfaces, but does not accept any connections yet.
 		 */
 		void listen(int portnr);
+		/*
+		 * Sets up TCP listening sockets on the given address (a hostname or numeric ipv4/ipv6 address),
+		 * but does not accept any connections yet.
+		 */
+		void listen(int portnr, const std::string &address);
 		/*
 		 * Sets up an AF_UNIX listening socket, but does not accept any connections yet.
 		 */
@@ -113,7 +123,7 @@ class NonblockingServer {
 		 */
 		Connection *getIdleConnectionById(int id);
 		/*
-		 * Wake the server up, interrupting a select() call. Used to notify the server about
+		 * Wake the server up, interrupting an epoll_wait() call. Used to notify the server about
 		 * changes in the connections or about stopping.
 		 */
 		void wake();
@@ -150,13 +160,29 @@ class NonblockingServer {
 		std::vector<int> listensockets_inet;
 		std::vector<int> listensockets_unix;
 		void closeAllListenSockets();
+		void acceptAll(int sock);
 
 		// Connections
 		std::recursive_mutex connections_mutex;
 		int next_connection_id;
-		std::vector<std::unique_ptr<Connection>> connections;
+		std::map<int, std::unique_ptr<Connection>> connections;
 		void addNewConnectionFromAcceptedFD(int fd);
 
+		// Connections whose state was changed outside of the main loop, by id
+		std::mutex changed_connections_mutex;
+		std::vector<int> changed_connections;
+		// Called on every state change which may require a different registration
+		void connectionChanged(Connection &connection);
+		// Registers the connection for the events required by its state, or removes it if it was closed.
+		// Must be called by the main loop while holding the connections_mutex.
+		void updateConnection(std::map<int, std::unique_ptr<Connection>>::iterator it);
+		void processChangedConnections();
+		void registerFD(Connection &connection, uint32_t events);
+
+		// epoll
+		int epoll_fd;
+		std::thread::id main_loop_thread;
+
 		// Status
 		std::atomic<bool> running;
 		BinaryStream wakeup_pipe;
@@ -151,6 +151,14 @@ const char *SQLite::SQLiteStatement::getString(int column) {
 }
 
 
+void SQLite::SQLiteStatement::reset() {
+	if (stmt) {
+		// sqlite3_reset() repeats the error of the last step, which has already been reported
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+	}
+}
+
 void SQLite::SQLiteStatement::finalize() {
 	if (stmt) {
 		sqlite3_finalize(stmt);
@@ -11,7 +11,7 @@ class sqlite3_stmt;
  * SQLite wrapper
  */
 class SQLite {
-	private:
+	public:
 		class SQLiteStatement {
 			public:
 				SQLiteStatement(sqlite3 *db, const char *query);
@@ -38,12 +38,15 @@ class SQLite {
 				double getDouble(int column);
 				const char *getString(int column);
 
+				// reset the statement and its bindings, so it can be executed again
+				void reset();
+
 				// cleanup for re-use
 				void finalize();
 			private:
 				sqlite3_stmt *stmt;
 		};
-	public:
+
 		SQLite();
 		~SQLite();
 		void open(const char *filename, bool readonly = false);
@@ -0,0 +1,112 @@
+#include "util/task_executor.h"
+#include "util/configuration.h"
+#include "util/log.h"
+
+// The executor and queue the current thread works on, if it is a worker
+static thread_local TaskExecutor *current_executor = nullptr;
+static thread_local size_t current_worker = 0;
+
+static std::unique_ptr<TaskExecutor> instance;
+static std::mutex instance_mtx;
+
+TaskExecutor& TaskExecutor::get_instance() {
+	std::lock_guard<std::mutex> g(instance_mtx);
+	if (!instance)
+		instance.reset(new TaskExecutor(Configuration::get<int>("operators.executor.threads", 0)));
+	return *instance;
+}
+
+void TaskExecutor::init(int num_threads) {
+	std::lock_guard<std::mutex> g(instance_mtx);
+	instance.reset(new TaskExecutor(num_threads));
+}
+
+TaskExecutor::TaskExecutor(int num_threads) : next_queue(0), pending(0), stopped(false) {
+	if (num_threads < 0)
+		throw ArgumentException("TaskExecutor: number of threads must not be negative");
+
+	Log::debug("Starting task executor with %d threads", num_threads);
+	for (int i = 0; i < num_threads; i++)
+		queues.push_back(std::make_unique<Queue>());
+	for (int i = 0; i < num_threads; i++)
+		workers.push_back(std::thread(&TaskExecutor::run_worker, this, i));
+}
+
+TaskExecutor::~TaskExecutor() {
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		stopped = true;
+	}
+	cond.notify_all();
+	for (auto &w : workers)
+		w.join();
+	// Tasks still queued are run by the threads waiting for them
+}
+
+void TaskExecutor::schedule(std::shared_ptr<Task> task) {
+	if (workers.empty())
+		return;
+
+	size_t idx;
+	if (current_executor == this)
+		idx = current_worker;
+	else
+		idx = next_queue++ % queues.size();
+
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		std::lock_guard<std::mutex> g2(queues[idx]->mtx);
+		queues[idx]->tasks.push_back(std::move(task));
+		pending++;
+	}
+	cond.notify_one();
+}
+
+std::shared_ptr<Task> TaskExecutor::next_task(size_t worker) {
+	std::shared_ptr<Task> result;
+
+	// Newest task from the own queue
+	{
+		Queue &own = *queues[worker];
+		std::lock_guard<std::mutex> g(own.mtx);
+		if (!own.tasks.empty()) {
+			result = std::move(own.tasks.back());
+			own.tasks.pop_back();
+		}
+	}
+
+	// Steal the oldest task of another worker
+	for (size_t i = 1; !result && i < queues.size(); i++) {
+		Queue &other = *queues[(worker + i) % queues.size()];
+		std::lock_guard<std::mutex> g(other.mtx);
+		if (!other.tasks.empty()) {
+			result = std::move(other.tasks.front());
+			other.tasks.pop_front();
+		}
+	}
+
+	if (result) {
+		std::lock_guard<std::mutex> g(mtx);
+		pending--;
+	}
+	return result;
+}
+
+void TaskExecutor::run_worker(size_t worker) {
+	current_executor = this;
+	current_worker = worker;
+
+	while (true) {
+		auto task = next_task(worker);
+		if (task) {
+			// Exceptions are stored in the task's future
+			task->try_run();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> l(mtx);
+		cond.wait(l, [this] { return stopped || pending > 0; });
+		if (stopped)
+			return;
+	}
+}
@@ -0,0 +1,172 @@
+#ifndef UTIL_TASK_EXECUTOR_H
+#define UTIL_TASK_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A unit of work scheduled on the TaskExecutor.
+ * A task is run exactly once, either by a worker or by the thread waiting for its result.
+ */
+class Task {
+	public:
+		virtual ~Task() = default;
+
+		/**
+		 * Runs the task, unless it was already claimed by another thread
+		 * @return whether the task was run by this call
+		 */
+		bool try_run() {
+			if (claimed.exchange(true))
+				return false;
+			run();
+			return true;
+		}
+
+		/**
+		 * Prevents the task from being run, unless it was already claimed by another thread
+		 * @return whether the task was cancelled by this call
+		 */
+		bool cancel() {
+			return !claimed.exchange(true);
+		}
+
+	protected:
+		virtual void run() = 0;
+
+	private:
+		std::atomic<bool> claimed{false};
+};
+
+template<typename T>
+class TypedTask : public Task {
+	public:
+		explicit TypedTask(std::packaged_task<T()> task) : task(std::move(task)) {}
+		std::future<T> get_future() { return task.get_future(); }
+
+	protected:
+		void run() { task(); }
+
+	private:
+		std::packaged_task<T()> task;
+};
+
+/**
+ * The result of a task submitted to the TaskExecutor.
+ *
+ * If no worker has started the task when get() is called, the calling thread runs it itself.
+ * This way, tasks may wait for the results of other tasks without ever blocking all workers.
+ *
+ * If the future is destroyed without retrieving the result, a task not yet started is cancelled,
+ * a running task is waited for. Hence, data referenced by the task may be freed afterwards.
+ */
+template<typename T>
+class TaskFuture {
+	public:
+		TaskFuture() = default;
+		TaskFuture(std::shared_ptr<TypedTask<T>> task) : task(task), future(task->get_future()) {}
+		TaskFuture(TaskFuture &&) = default;
+
+		~TaskFuture() {
+			if (task && !task->cancel())
+				future.wait();
+		}
+
+		/**
+		 * Waits for the task to finish. Exceptions thrown by the task are rethrown.
+		 * @return the result of the task
+		 */
+		T get() {
+			if (task) {
+				task->try_run();
+				task.reset();
+			}
+			return future.get();
+		}
+
+		bool valid() const { return future.valid(); }
+
+	private:
+		std::shared_ptr<TypedTask<T>> task;
+		std::future<T> future;
+};
+
+/**
+ * A fixed-size pool of worker threads executing tasks concurrently.
+ *
+ * Tasks run on arbitrary threads, so thread-local state of the submitting thread is not available
+ * to them. Tasks needing it must capture it on submission, e.g. the node cache's WorkerContext
+ * with a DelegationGuard::Origin.
+ *
+ * Each worker owns a queue. Tasks submitted by a worker are put in its own queue and processed
+ * in LIFO order, tasks from other threads are distributed round-robin. Idle workers steal the
+ * oldest tasks from the queues of the others.
+ *
+ * An executor without threads is valid; all tasks are then run by the threads requesting their results.
+ */
+class TaskExecutor {
+	public:
+		/**
+		 * @return the process-wide executor. It is created on first use, with the number of threads
+		 * given by the setting "operators.executor.threads"
+		 */
+		static TaskExecutor& get_instance();
+
+		/**
+		 * Replaces the process-wide executor with one using the given number of threads
+		 * @param num_threads the number of worker threads
+		 */
+		static void init(int num_threads);
+
+		explicit TaskExecutor(int num_threads);
+		~TaskExecutor();
+
+		TaskExecutor(const TaskExecutor&) = delete;
+		TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+		/**
+		 * Schedules the given function for execution
+		 * @param function the function to execute
+		 * @return the future result of the function
+		 */
+		template<typename F>
+		TaskFuture<typename std::result_of<F()>::type> submit(F &&function) {
+			typedef typename std::result_of<F()>::type R;
+			auto task = std::make_shared<TypedTask<R>>(std::packaged_task<R()>(std::forward<F>(function)));
+			schedule(task);
+			return TaskFuture<R>(task);
+		}
+
+		/**
+		 * @return the number of worker threads
+		 */
+		int get_num_threads() const { return workers.size(); }
+
+	private:
+		struct Queue {
+			std::mutex mtx;
+			std::deque<std::shared_ptr<Task>> tasks;
+		};
+
+		void schedule(std::shared_ptr<Task> task);
+		std::shared_ptr<Task> next_task(size_t worker);
+		void run_worker(size_t worker);
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+		std::atomic<size_t> next_queue;
+
+		std::mutex mtx;
+		std::condition_variable cond;
+		size_t pending;
+		bool stopped;
+};
+
+#endif
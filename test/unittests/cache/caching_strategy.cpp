@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "cache/priv/caching_strategy.h"
+#include "cache/node/manager/local_replacement.h"
+
+#include <unordered_set>
+
+
+static CacheCube createCube(double x) {
+	SpatioTemporalReference stref(SpatialReference(CrsId::from_epsg_code(4326), x, 0, x + 1, 1), TemporalReference::unreferenced());
+	return CacheCube(stref);
+}
+
+static CacheEntry createEntry(double x, double cpu) {
+	ProfilingData profile;
+	profile.uncached_cpu = cpu;
+	return CacheEntry(createCube(x), 100, profile);
+}
+
+TEST(TinyLFUStrategy, estimate) {
+	TinyLFUStrategy strategy(1024);
+	for (int i = 0; i < 3; i++)
+		strategy.record_access("a", createCube(0));
+	strategy.record_access("a", createCube(1));
+
+	EXPECT_EQ(3, strategy.estimate("a", createCube(0)));
+	EXPECT_EQ(1, strategy.estimate("a", createCube(1)));
+	EXPECT_EQ(0, strategy.estimate("b", createCube(0)));
+
+	// Counters saturate
+	for (int i = 0; i < 100; i++)
+		strategy.record_access("a", createCube(0));
+	EXPECT_EQ(15, strategy.estimate("a", createCube(0)));
+}
+
+TEST(TinyLFUStrategy, aging) {
+	TinyLFUStrategy strategy(16);
+	for (int i = 0; i < 8; i++)
+		strategy.record_access("a", createCube(0));
+	EXPECT_EQ(8, strategy.estimate("a", createCube(0)));
+
+	// Counters only shrink when they are halved after 10 * width requests
+	int scanned = 0;
+	while (strategy.estimate("a", createCube(0)) >= 8 && scanned < 1000)
+		strategy.record_access("scan", createCube(10 + scanned++));
+	EXPECT_GE(scanned, 160 - 8);
+	EXPECT_LT(scanned, 1000);
+}
+
+TEST(TinyLFUStrategy, admit) {
+	TinyLFUStrategy strategy(1024);
+	auto hot = createEntry(0, 1);
+	auto cold = createEntry(1, 1);
+	auto expensive = createEntry(2, 10);
+
+	for (int i = 0; i < 3; i++)
+		strategy.record_access("a", hot.bounds);
+	strategy.record_access("a", cold.bounds);
+	strategy.record_access("a", expensive.bounds);
+
+	EXPECT_FALSE(strategy.admit("a", cold, "a", hot));
+	EXPECT_TRUE(strategy.admit("a", hot, "a", cold));
+	EXPECT_TRUE(strategy.admit("a", expensive, "a", hot));
+
+	// Other strategies admit everything
+	EXPECT_TRUE(CachingStrategy::by_name("always")->admit("a", cold, "a", hot));
+	EXPECT_TRUE(dynamic_cast<TinyLFUStrategy*>(CachingStrategy::by_name("tinylfu").get()) != nullptr);
+}
+
+/**
+ * Replays the given trace on a cache holding capacity entries, evicting in LRU order
+ * and asking the strategy whether a missed entry should replace the LRU victim.
+ * Returns the hit rate.
+ */
+static double replay(const CachingStrategy &strategy, const std::vector<int> &trace, size_t capacity) {
+	LocalLRU lru;
+	std::unordered_set<uint64_t> cached;
+	size_t hits = 0;
+	for (int x : trace) {
+		uint64_t id = x;
+		auto entry = createEntry(x, 1);
+		strategy.record_access("a", entry.bounds);
+		if (cached.count(id) > 0) {
+			lru.accessed(id);
+			hits++;
+			continue;
+		}
+		if (cached.size() >= capacity) {
+			auto &victim = lru.peek_victim();
+			if (!strategy.admit("a", entry, victim.semantic_id, victim))
+				continue;
+			cached.erase(lru.pop_victim().entry_id);
+		}
+		lru.inserted(LocalRef(NodeCacheKey("a", id), entry));
+		cached.insert(id);
+	}
+	return static_cast<double>(hits) / trace.size();
+}
+
+TEST(TinyLFUStrategy, beatsLRUOnSkewedTrace) {
+	// A small hot set requested over and over, interleaved with scans of
+	// one-off entries that are larger than the cache.
+	std::vector<int> trace;
+	int next_scan = 1000;
+	for (int round = 0; round < 50; round++) {
+		for (int hot = 0; hot < 10; hot++)
+			for (int i = 0; i <= (10 - hot) / 4; i++)
+				trace.push_back(hot);
+		for (int i = 0; i < 20; i++)
+			trace.push_back(next_scan++);
+	}
+
+	double lru = replay(*CachingStrategy::by_name("always"), trace, 15);
+	double tinylfu = replay(TinyLFUStrategy(1024), trace, 15);
+
+	// Every scan flushes the hot set out of a plain LRU cache
+	EXPECT_GT(tinylfu, lru + 0.2);
+	EXPECT_GT(tinylfu, 0.4);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include "cache/priv/connection_pool.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+/**
+ * Answers every request with the received number + 1. Accepts the given number of
+ * connections, each of them is closed after the given number of requests.
+ * If drop_next is set, one more request is read and left unanswered before closing.
+ */
+class IncrementServer {
+public:
+	IncrementServer(int connections, int requests_per_connection, bool drop_next = false) : port(0), received(0), closed(0) {
+		listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr));
+		listen(listen_fd, 10);
+		socklen_t len = sizeof(addr);
+		getsockname(listen_fd, (struct sockaddr *) &addr, &len);
+		port = ntohs(addr.sin_port);
+
+		thread = std::thread([this, connections, requests_per_connection, drop_next]() {
+			for (int c = 0; c < connections; c++) {
+				{
+					BinaryStream stream = BinaryStream::fromAcceptedSocket(accept(listen_fd, nullptr, nullptr));
+					BinaryReadBuffer handshake;
+					stream.read(handshake);
+					for (int r = 0; r < requests_per_connection; r++) {
+						BinaryReadBuffer request;
+						if (stream.read(request, true))
+							break;
+						received++;
+						BinaryWriteBuffer response;
+						response << (request.read<uint32_t>() + 1);
+						stream.write(response);
+					}
+					BinaryReadBuffer request;
+					if (drop_next && !stream.read(request, true))
+						received++;
+				}
+				std::lock_guard<std::mutex> g(mtx);
+				closed++;
+				cv.notify_all();
+			}
+		});
+	}
+	~IncrementServer() {
+		thread.join();
+		close(listen_fd);
+	}
+	/**
+	 * Blocks until the server closed the given number of connections
+	 */
+	void wait_for_closed(int connections) {
+		std::unique_lock<std::mutex> g(mtx);
+		cv.wait(g, [this, connections]() { return closed >= connections; });
+	}
+	int port;
+	std::atomic<int> received;
+private:
+	int listen_fd;
+	int closed;
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::thread thread;
+};
+
+TEST(BlockingConnectionPool, reusesConnections) {
+	IncrementServer server(1, 5);
+	BlockingConnectionPool pool(0x12345678, 4, 60);
+
+	for (uint32_t i = 0; i < 5; i++)
+		EXPECT_EQ(i + 1, pool.write_and_read("127.0.0.1", server.port, i)->read<uint32_t>());
+
+	auto stats = pool.get_stats();
+	EXPECT_EQ(1, stats.created);
+	EXPECT_EQ(4, stats.reused);
+	EXPECT_EQ(0, stats.reconnects);
+	EXPECT_EQ(1, pool.get_idle_count());
+}
+
+TEST(BlockingConnectionPool, reconnectsClosedConnections) {
+	// the server closes every connection after two requests
+	IncrementServer server(2, 2);
+	BlockingConnectionPool pool(0x12345678, 4, 60);
+
+	EXPECT_EQ(1, pool.write_and_read("127.0.0.1", server.port, (uint32_t) 0)->read<uint32_t>());
+	EXPECT_EQ(2, pool.write_and_read("127.0.0.1", server.port, (uint32_t) 1)->read<uint32_t>());
+	server.wait_for_closed(1);
+	EXPECT_EQ(3, pool.write_and_read("127.0.0.1", server.port, (uint32_t) 2)->read<uint32_t>());
+
+	auto stats = pool.get_stats();
+	EXPECT_EQ(2, stats.created);
+	EXPECT_EQ(1, stats.reused);
+	EXPECT_EQ(1, stats.reconnects);
+}
+
+TEST(BlockingConnectionPool, limitsIdleConnections) {
+	IncrementServer server(1, 1);
+	BlockingConnectionPool pool(0x12345678, 0, 60);
+
+	EXPECT_EQ(1, pool.write_and_read("127.0.0.1", server.port, (uint32_t) 0)->read<uint32_t>());
+	EXPECT_EQ(0, pool.get_idle_count());
+}
+
+TEST(BlockingConnectionPool, doesNotRepeatRequestsOnce) {
+	// the server drops the second request without answering it
+	IncrementServer server(1, 1, true);
+	BlockingConnectionPool pool(0x12345678, 4, 60);
+
+	EXPECT_EQ(1, pool.write_and_read_once("127.0.0.1", server.port, (uint32_t) 0)->read<uint32_t>());
+	EXPECT_THROW(pool.write_and_read_once("127.0.0.1", server.port, (uint32_t) 1), NetworkException);
+	server.wait_for_closed(1);
+	EXPECT_EQ(2, server.received);
+
+	auto stats = pool.get_stats();
+	EXPECT_EQ(1, stats.created);
+	EXPECT_EQ(0, stats.reused);
+	EXPECT_EQ(1, stats.reconnects);
+	EXPECT_EQ(0, pool.get_idle_count());
+}
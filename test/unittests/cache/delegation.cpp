@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "cache/node/node_manager.h"
+#include "util/task_executor.h"
+
+#include <future>
+#include <thread>
+
+
+TEST(DelegationGuard, threadContinuesAtPuzzleDepth) {
+	WorkerContext worker;
+	PuzzleGuard pg(worker);
+	DelegationGuard::Origin origin(worker);
+
+	int depth = -1, restored = -1;
+	std::thread helper([&]() {
+		WorkerContext ctx;
+		{
+			DelegationGuard guard(ctx, origin);
+			depth = ctx.get_puzzle_depth();
+		}
+		restored = ctx.get_puzzle_depth();
+	});
+	helper.join();
+
+	EXPECT_EQ(1, depth);
+	EXPECT_EQ(0, restored);
+	EXPECT_EQ(1, worker.get_puzzle_depth());
+}
+
+TEST(DelegationGuard, workerMayDelegateToItself) {
+	WorkerContext worker;
+	DelegationGuard::Origin origin(worker);
+	{
+		PuzzleGuard pg(worker);
+		DelegationGuard guard(worker, origin);
+		EXPECT_EQ(0, worker.get_puzzle_depth());
+	}
+	EXPECT_EQ(0, worker.get_puzzle_depth());
+	EXPECT_THROW(worker.get_index_connection(), IllegalStateException);
+}
+
+TEST(DelegationGuard, executorTasksActForTheSubmitter) {
+	TaskExecutor executor(1);
+	auto &worker = NodeCacheManager::get_worker_context();
+	PuzzleGuard pg(worker);
+
+	// The task signals when it started, so it is run by the executor's thread and not by get()
+	std::promise<void> started;
+	auto started_future = started.get_future();
+	DelegationGuard::Origin origin(worker);
+	auto depths = executor.submit([origin, &started]() {
+		started.set_value();
+		int own = NodeCacheManager::get_worker_context().get_puzzle_depth();
+		DelegationGuard guard(NodeCacheManager::get_worker_context(), origin);
+		return std::make_pair(own, NodeCacheManager::get_worker_context().get_puzzle_depth());
+	});
+	started_future.wait();
+
+	auto result = depths.get();
+	EXPECT_EQ(0, result.first);
+	EXPECT_EQ(1, result.second);
+	EXPECT_EQ(1, worker.get_puzzle_depth());
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "cache/index/index_cache.h"
+#include "datatypes/raster.h"
+#include "datatypes/raster/raster_priv.h"
+
+static SpatioTemporalReference createStref(double x1, double y1, double x2, double y2) {
+	return SpatioTemporalReference(
+		SpatialReference(CrsId::from_epsg_code(4326), x1, y1, x2, y2),
+		TemporalReference(TIMETYPE_UNIX, 0, 10)
+	);
+}
+
+// A raster of 100x100 pixels on [0,100]x[0,100] and queries on the same area with the given number of pixels
+static CacheEntry createEntry() {
+	return CacheEntry(CacheCube(GridSpatioTemporalResult(createStref(0, 0, 100, 100), 100, 100)), 10000, ProfilingData());
+}
+
+static QueryRectangle createQuery(uint32_t pixels) {
+	auto stref = createStref(0, 0, 100, 100);
+	return QueryRectangle(stref, TemporalReference(TIMETYPE_UNIX, 1, 2), QueryResolution::pixels(pixels, pixels));
+}
+
+TEST(Downsampling, disabledByDefault) {
+	IndexCache cache(CacheType::RASTER);
+	cache.put("sem", 1, 1, createEntry());
+
+	auto res = cache.query("sem", createQuery(100));
+	EXPECT_EQ(1, res.items.size());
+	EXPECT_FALSE(res.downsampled);
+
+	EXPECT_FALSE(cache.query("sem", createQuery(50)).has_hit());
+}
+
+TEST(Downsampling, finerEntriesWithinFactor) {
+	IndexCache cache(CacheType::RASTER);
+	cache.set_max_downsampling(2);
+	cache.put("sem", 1, 1, createEntry());
+
+	auto res = cache.query("sem", createQuery(50));
+	ASSERT_EQ(1, res.items.size());
+	EXPECT_FALSE(res.has_remainder());
+	EXPECT_TRUE(res.downsampled);
+	// The expected result has the requested resolution
+	EXPECT_EQ(50, res.covered.xres);
+	EXPECT_EQ(50, res.covered.yres);
+
+	// Too coarse or finer than cached
+	EXPECT_FALSE(cache.query("sem", createQuery(40)).has_hit());
+	EXPECT_FALSE(cache.query("sem", createQuery(200)).has_hit());
+}
+
+TEST(Downsampling, matchingEntriesPreferred) {
+	IndexCache cache(CacheType::RASTER);
+	cache.set_max_downsampling(2);
+	cache.put("sem", 1, 1, createEntry());
+	cache.put("sem", 1, 2, CacheEntry(CacheCube(GridSpatioTemporalResult(createStref(0, 0, 100, 100), 50, 50)), 2500, ProfilingData()));
+
+	auto res = cache.query("sem", createQuery(50));
+	ASSERT_EQ(1, res.items.size());
+	EXPECT_EQ(2, res.items.front()->get_entry_id());
+	EXPECT_FALSE(res.downsampled);
+}
+
+TEST(Downsampling, averageIgnoresNoData) {
+	DataDescription dd(GDT_Float32, Unit::unknown(), true, -1);
+	auto raster = GenericRaster::create(dd, createStref(0, 0, 4, 4), 4, 4);
+	auto r = (Raster2D<float> *) raster.get();
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 4; x++)
+			r->set(x, y, y * 4 + x);
+	r->set(0, 0, -1);
+	r->set(2, 2, -1); r->set(3, 2, -1); r->set(2, 3, -1); r->set(3, 3, -1);
+
+	QueryRectangle qrect(createStref(0, 0, 4, 4), createStref(0, 0, 4, 4), QueryResolution::pixels(2, 2));
+	auto result = raster->downsample(qrect);
+	auto out = (Raster2D<float> *) result.get();
+
+	ASSERT_EQ(2, out->width);
+	ASSERT_EQ(2, out->height);
+	EXPECT_FLOAT_EQ((1 + 4 + 5) / 3.0, out->get(0, 0));
+	EXPECT_FLOAT_EQ((2 + 3 + 6 + 7) / 4.0, out->get(1, 0));
+	EXPECT_FLOAT_EQ((8 + 9 + 12 + 13) / 4.0, out->get(0, 1));
+	EXPECT_FLOAT_EQ(-1, out->get(1, 1));
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "cache/priv/inflight.h"
+
+#include <atomic>
+#include <thread>
+
+
+static QueryRectangle createRect(double x1, double x2, uint32_t xres) {
+	return QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), x1, 0, x2, 10),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::pixels(xres, 100)
+	);
+}
+
+TEST(InFlightRegistry, followerWaitsForLeader) {
+	InFlightRegistry registry;
+	auto lease = registry.begin("op", createRect(0, 10, 100));
+	ASSERT_NE(nullptr, lease);
+	EXPECT_EQ(1, registry.get_running());
+
+	std::atomic<bool> released(false), waited(false);
+	std::thread follower([&]() {
+		// covered by the leader's query
+		auto follower_lease = registry.begin("op", createRect(0, 5, 50));
+		waited = follower_lease == nullptr && released;
+	});
+	// release the lease only after the follower started waiting for it
+	while ( registry.get_waiting() != 1 )
+		std::this_thread::yield();
+	released = true;
+	lease.reset();
+	follower.join();
+
+	EXPECT_TRUE(waited);
+	EXPECT_EQ(0, registry.get_running());
+}
+
+TEST(InFlightRegistry, unrelatedQueriesRunConcurrently) {
+	InFlightRegistry registry;
+	auto lease = registry.begin("op", createRect(0, 10, 100));
+
+	std::thread other([&]() {
+		// other semantic id, partial overlap, other resolution
+		EXPECT_NE(nullptr, registry.begin("other", createRect(0, 10, 100)));
+		EXPECT_NE(nullptr, registry.begin("op", createRect(5, 15, 100)));
+		EXPECT_NE(nullptr, registry.begin("op", createRect(0, 10, 200)));
+	});
+	other.join();
+	EXPECT_EQ(1, registry.get_running());
+}
+
+TEST(InFlightRegistry, leaderDoesNotWaitForItself) {
+	InFlightRegistry registry;
+	auto lease = registry.begin("op", createRect(0, 10, 100));
+	auto nested = registry.begin("op", createRect(0, 10, 100));
+	EXPECT_NE(nullptr, nested);
+	EXPECT_EQ(1, registry.get_running());
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "cache/node/manager/local_manager.h"
+#include "datatypes/pointcollection.h"
+#include "operators/operator.h"
+#include "util/exceptions.h"
+#include "util/sizeutil.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+// A source without parameters, only used for its semantic id
+class SpillTestSource : public GenericOperator {
+	public:
+		SpillTestSource(int sourcecounts[], GenericOperator *sources[], Json::Value &params) : GenericOperator(sourcecounts, sources) {
+			(void) params;
+			assumeSources(0);
+		}
+};
+REGISTER_OPERATOR(SpillTestSource, "spill_test_source");
+
+static QueryRectangle createQuery(double x) {
+	return QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), x, 0, x + 10, 10),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::none()
+	);
+}
+
+static std::unique_ptr<PointCollection> createPoints(double x) {
+	auto points = std::make_unique<PointCollection>(SpatioTemporalReference(createQuery(x)));
+	for (int i = 0; i < 100; i++)
+		points->addSinglePointFeature(Coordinate(x + i / 10.0, i / 10.0));
+	return points;
+}
+
+class LocalCacheSpillTest : public ::testing::Test {
+protected:
+	void SetUp() {
+		char tmpl[] = "/tmp/local_spill_test_XXXXXX";
+		ASSERT_NE(nullptr, mkdtemp(tmpl));
+		directory = tmpl;
+
+		// Room for a single collection
+		size_t size = SizeUtil::get_byte_size(*createPoints(0)) + sizeof(NodeCacheEntry<PointCollection>);
+		manager = std::make_unique<LocalCacheManager>("always", "lru", 0, size * 3 / 2, 0, 0, 0, 0);
+		auto store = std::make_unique<SpillStore>(directory, "points", 1024 * 1024, std::make_unique<LocalLRU>());
+		spill = store.get();
+		cache().enable_spill(std::move(store), 0);
+		op = GenericOperator::fromJSON("{\"type\": \"spill_test_source\"}");
+	}
+	void TearDown() {
+		manager.reset();
+		rmdir(directory.c_str());
+	}
+	LocalCacheWrapper<PointCollection> &cache() {
+		return static_cast<LocalCacheWrapper<PointCollection>&>(manager->get_point_cache());
+	}
+	std::string directory;
+	std::unique_ptr<LocalCacheManager> manager;
+	std::unique_ptr<GenericOperator> op;
+	SpillStore *spill;
+};
+
+TEST_F(LocalCacheSpillTest, faultsInSpilledEntries) {
+	QueryProfiler profiler;
+	// The second put evicts the first entry to disk
+	EXPECT_TRUE(cache().put(op->getSemanticId(), createPoints(0), createQuery(0), profiler));
+	EXPECT_TRUE(cache().put(op->getSemanticId(), createPoints(20), createQuery(20), profiler));
+	EXPECT_GT(spill->get_current_size(), 0);
+	cache().get_and_reset_query_stats();
+
+	auto result = cache().query(*op, createQuery(0), profiler);
+	EXPECT_EQ(100, result->getFeatureCount());
+	EXPECT_EQ(createPoints(0)->coordinates[99].x, result->coordinates[99].x);
+
+	auto stats = cache().get_and_reset_query_stats();
+	EXPECT_EQ(1, stats.cold_hits);
+	EXPECT_EQ(1, stats.single_local_hits);
+	EXPECT_EQ(0, stats.misses);
+
+	// Faulting in evicted the second entry, which can be read back as well
+	result = cache().query(*op, createQuery(20), profiler);
+	EXPECT_EQ(createPoints(20)->coordinates[99].x, result->coordinates[99].x);
+	EXPECT_EQ(1, cache().get_and_reset_query_stats().cold_hits);
+}
+
+TEST_F(LocalCacheSpillTest, failedFaultInIsAMiss) {
+	QueryProfiler profiler;
+	EXPECT_TRUE(cache().put(op->getSemanticId(), createPoints(0), createQuery(0), profiler));
+	EXPECT_TRUE(cache().put(op->getSemanticId(), createPoints(20), createQuery(20), profiler));
+	cache().get_and_reset_query_stats();
+
+	// The record of the first entry is lost, while the entry is still cold
+	spill->remove(1);
+	EXPECT_THROW(cache().query(*op, createQuery(0), profiler), NoSuchElementException);
+
+	auto stats = cache().get_and_reset_query_stats();
+	EXPECT_EQ(0, stats.cold_hits);
+	EXPECT_EQ(1, stats.misses);
+}
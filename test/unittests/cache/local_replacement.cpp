@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "cache/node/manager/local_replacement.h"
+#include "util/exceptions.h"
+
+
+static LocalRef createRef(uint64_t entry_id, uint64_t size, double cpu = 0) {
+	ProfilingData profile;
+	profile.uncached_cpu = cpu;
+	return LocalRef(NodeCacheKey("sem", entry_id), CacheEntry(CacheCube(SpatioTemporalReference::unreferenced()), size, profile));
+}
+
+static std::vector<uint64_t> popAll(LocalReplacementPolicy &policy) {
+	std::vector<uint64_t> result;
+	while (!policy.empty())
+		result.push_back(policy.pop_victim().entry_id);
+	return result;
+}
+
+TEST(LocalReplacement, lru) {
+	LocalLRU lru;
+	lru.inserted(createRef(1, 10));
+	lru.inserted(createRef(2, 10));
+	lru.inserted(createRef(3, 10));
+	lru.accessed(1);
+	lru.accessed(42);
+
+	EXPECT_EQ(std::vector<uint64_t>({2, 3, 1}), popAll(lru));
+}
+
+TEST(LocalReplacement, costLRU) {
+	LocalCostLRU gdsf;
+	// costs per byte: 1 -> 1, 2 -> 0.1, 3 -> 0.5
+	gdsf.inserted(createRef(1, 10, 10));
+	gdsf.inserted(createRef(2, 10, 1));
+	gdsf.inserted(createRef(3, 10, 5));
+
+	EXPECT_EQ(2, gdsf.pop_victim().entry_id);
+
+	// Hits on 3 make it more valuable than 1, the new entry 4 starts at the inflated priority
+	gdsf.accessed(3);
+	gdsf.accessed(3);
+	gdsf.inserted(createRef(4, 10, 5));
+
+	EXPECT_EQ(std::vector<uint64_t>({4, 1, 3}), popAll(gdsf));
+}
+
+TEST(LocalReplacement, clock) {
+	LocalClock clock;
+	clock.inserted(createRef(1, 10));
+	clock.inserted(createRef(2, 10));
+	clock.inserted(createRef(3, 10));
+	clock.accessed(1);
+	clock.accessed(2);
+
+	EXPECT_EQ(3, clock.pop_victim().entry_id);
+	// The hand cleared the flags of 1 and 2, the new entry is inspected last
+	clock.inserted(createRef(4, 10));
+	clock.accessed(4);
+	EXPECT_EQ(std::vector<uint64_t>({1, 2, 4}), popAll(clock));
+}
+
+TEST(LocalReplacement, byName) {
+	EXPECT_NE(nullptr, dynamic_cast<LocalLRU*>(LocalReplacementPolicy::by_name("LRU").get()));
+	EXPECT_NE(nullptr, dynamic_cast<LocalCostLRU*>(LocalReplacementPolicy::by_name("costlru").get()));
+	EXPECT_NE(nullptr, dynamic_cast<LocalClock*>(LocalReplacementPolicy::by_name("clock").get()));
+	EXPECT_THROW(LocalReplacementPolicy::by_name("fifo"), ArgumentException);
+}
+
+TEST(LocalReplacement, peekVictim) {
+	LocalLRU lru;
+	LocalCostLRU gdsf;
+	LocalClock clock;
+	for (LocalReplacementPolicy *policy : std::vector<LocalReplacementPolicy*>{&lru, &gdsf, &clock}) {
+		policy->inserted(createRef(1, 10, 1));
+		policy->inserted(createRef(2, 10, 2));
+		policy->accessed(1);
+		policy->accessed(2);
+		while (!policy->empty()) {
+			uint64_t next = policy->peek_victim().entry_id;
+			EXPECT_EQ(next, policy->pop_victim().entry_id);
+		}
+	}
+}
+
+TEST(LocalReplacement, removed) {
+	LocalLRU lru;
+	LocalCostLRU gdsf;
+	LocalClock clock;
+	for (LocalReplacementPolicy *policy : std::vector<LocalReplacementPolicy*>{&lru, &gdsf, &clock}) {
+		policy->inserted(createRef(1, 10, 1));
+		policy->inserted(createRef(2, 10, 2));
+		policy->inserted(createRef(3, 10, 3));
+		policy->removed(2);
+		policy->removed(42);
+		EXPECT_EQ(std::vector<uint64_t>({1, 3}), popAll(*policy));
+	}
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "cache/index/lookup_pool.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+static QueryRectangle createRect(double x1, double x2) {
+	return QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), x1, 0, x2, 10),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::pixels(100, 100)
+	);
+}
+
+static CacheEntry createEntry(const QueryRectangle &rect) {
+	CacheCube cube(SpatioTemporalReference(rect, rect));
+	cube.resolution_info.restype = QueryResolution::Type::PIXELS;
+	cube.resolution_info.pixel_scale_x = Interval(0.1, 0.1);
+	cube.resolution_info.pixel_scale_y = Interval(0.1, 0.1);
+	cube.resolution_info.actual_pixel_scale_x = 0.1;
+	cube.resolution_info.actual_pixel_scale_y = 0.1;
+	return CacheEntry(cube, 100 * 100, ProfilingData());
+}
+
+TEST(IndexLookupPool, callbacksRunInProcessFinished) {
+	IndexConfig config;
+	config.reorg_strategy = "capacity";
+	config.relevance_function = "lru";
+	IndexCacheManager caches(config);
+	caches.get_cache(CacheType::RASTER).put("op", 1, 1, createEntry(createRect(0, 10)));
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	size_t notified = 0;
+	IndexLookupPool pool(caches, 2, [&]() {
+		std::lock_guard<std::mutex> g(mtx);
+		notified++;
+		cv.notify_all();
+	});
+	ASSERT_TRUE(pool.is_concurrent());
+
+	const size_t num_lookups = 20;
+	const auto event_loop = std::this_thread::get_id();
+	bool processing = false;
+	size_t invoked = 0, invoked_elsewhere = 0, hits = 0;
+	for (size_t i = 0; i < num_lookups; i++) {
+		// every second lookup hits the cached entry
+		auto query = (i % 2 == 0) ? createRect(0, 10) : createRect(20, 30);
+		pool.submit(CacheType::RASTER, "op", query, [&](const IndexLookupPool::Result &res) {
+			if (!processing || std::this_thread::get_id() != event_loop)
+				invoked_elsewhere++;
+			invoked++;
+			if (res.has_hit())
+				hits++;
+		});
+	}
+	EXPECT_EQ(num_lookups, pool.get_num_pending());
+
+	{
+		std::unique_lock<std::mutex> g(mtx);
+		cv.wait(g, [&]() { return notified == num_lookups; });
+	}
+	// all lookups finished, but their callbacks wait for the event-loop
+	EXPECT_EQ(0, invoked);
+	EXPECT_EQ(num_lookups, pool.get_num_pending());
+
+	processing = true;
+	EXPECT_EQ(num_lookups, pool.process_finished());
+	processing = false;
+
+	EXPECT_EQ(num_lookups, invoked);
+	EXPECT_EQ(0, invoked_elsewhere);
+	EXPECT_EQ(num_lookups / 2, hits);
+	EXPECT_EQ(0, pool.get_num_pending());
+	EXPECT_EQ(0, pool.process_finished());
+}
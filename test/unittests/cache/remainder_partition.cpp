@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "cache/priv/remainder_partition.h"
+
+// A 100x100 pixel raster query on [0,100]x[0,100]
+static QueryCube createRasterQuery() {
+	return QueryCube( QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 100, 100),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::pixels(100, 100)
+	));
+}
+
+static QueryCube createFeatureQuery() {
+	return QueryCube( QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 100, 100),
+		TemporalReference(TIMETYPE_UNIX, 0, 10),
+		QueryResolution::none()
+	));
+}
+
+static bool overlapping(const Cube<3> &c1, const Cube<3> &c2) {
+	for (int i = 0; i < 2; i++) {
+		if (c1.get_dimension(i).a >= c2.get_dimension(i).b || c2.get_dimension(i).a >= c1.get_dimension(i).b)
+			return false;
+	}
+	return true;
+}
+
+// checks that the pixels of the uncovered cubes are covered by exactly one remainder
+static void expectCovered(const std::vector<Cube<3>> &uncovered, const std::vector<Cube<3>> &remainders) {
+	for (auto &u : uncovered) {
+		for (double x = u.get_dimension(0).a + 0.5; x < u.get_dimension(0).b; x += 1) {
+			for (double y = u.get_dimension(1).a + 0.5; y < u.get_dimension(1).b; y += 1) {
+				int count = 0;
+				for (auto &r : remainders)
+					count += r.contains(Point3(x, y, 0.5));
+				EXPECT_EQ(1, count) << "pixel " << x << "," << y;
+			}
+		}
+	}
+	for (size_t i = 0; i < remainders.size(); i++)
+		for (size_t j = i + 1; j < remainders.size(); j++)
+			EXPECT_FALSE(overlapping(remainders[i], remainders[j]));
+}
+
+TEST(RemainderPartition, nothingUncovered) {
+	EXPECT_TRUE(RemainderPartition::compute(createRasterQuery(), std::vector<Cube<3>>()).empty());
+}
+
+TEST(RemainderPartition, fragmentsAreJoined) {
+	// the right half, dissected by several entries into fragments
+	std::vector<Cube<3>> uncovered {
+		Cube3(50, 100, 0, 20, 0, 1),
+		Cube3(50, 70, 20, 60, 0, 1),
+		Cube3(70, 100, 20, 60, 0, 1),
+		Cube3(50, 100, 60, 100, 0, 1)
+	};
+	auto remainders = RemainderPartition::compute(createRasterQuery(), uncovered);
+	ASSERT_EQ(1, remainders.size());
+	EXPECT_EQ(Cube3(50, 100, 0, 100, 0, 1), remainders[0]);
+}
+
+TEST(RemainderPartition, subPixelSliversVanish) {
+	std::vector<Cube<3>> uncovered {
+		Cube3(99.7, 100, 0, 100, 0, 1),
+		Cube3(0, 100, 0.2, 0.4, 0, 1)
+	};
+	EXPECT_TRUE(RemainderPartition::compute(createRasterQuery(), uncovered).empty());
+}
+
+TEST(RemainderPartition, boundsAreSnappedToPixels) {
+	std::vector<Cube<3>> uncovered {
+		Cube3(10.3, 20.6, 0, 100, 0, 1)
+	};
+	auto remainders = RemainderPartition::compute(createRasterQuery(), uncovered);
+	ASSERT_EQ(1, remainders.size());
+	EXPECT_EQ(Cube3(10, 21, 0, 100, 0, 1), remainders[0]);
+}
+
+TEST(RemainderPartition, nearbyRemaindersAreMerged) {
+	// separated by a cached row of one pixel, recomputing it is cheaper
+	std::vector<Cube<3>> uncovered {
+		Cube3(0, 10, 0, 50, 0, 1),
+		Cube3(0, 10, 51, 100, 0, 1)
+	};
+	auto remainders = RemainderPartition::compute(createRasterQuery(), uncovered);
+	ASSERT_EQ(1, remainders.size());
+	EXPECT_EQ(Cube3(0, 10, 0, 100, 0, 1), remainders[0]);
+}
+
+TEST(RemainderPartition, distantRemaindersAreKept) {
+	// merging would recompute most of the query
+	std::vector<Cube<3>> uncovered {
+		Cube3(0, 10, 0, 100, 0, 1),
+		Cube3(10, 100, 0, 10, 0, 1),
+		Cube3(90, 100, 10, 100, 0, 1)
+	};
+	auto remainders = RemainderPartition::compute(createRasterQuery(), uncovered);
+	EXPECT_EQ(3, remainders.size());
+	expectCovered(uncovered, remainders);
+}
+
+TEST(RemainderPartition, overlappingEntriesProduceFewRemainders) {
+	// the query minus the entries [0,60]x[0,60] and [40,100]x[40,100], dissected one after another
+	std::vector<Cube<3>> uncovered {
+		Cube3(60, 100, 0, 40, 0, 1),
+		Cube3(0, 40, 60, 100, 0, 1)
+	};
+	auto remainders = RemainderPartition::compute(createRasterQuery(), uncovered);
+	EXPECT_EQ(2, remainders.size());
+	expectCovered(uncovered, remainders);
+}
+
+TEST(RemainderPartition, featureBoundsAreKept) {
+	std::vector<Cube<3>> uncovered {
+		Cube3(10.3, 20.6, 0, 100, 0, 10)
+	};
+	auto remainders = RemainderPartition::compute(createFeatureQuery(), uncovered);
+	ASSERT_EQ(1, remainders.size());
+	EXPECT_EQ(Cube3(10.3, 20.6, 0, 100, 0, 10), remainders[0]);
+}
+
+TEST(RemainderPartition, manyFragmentsAreMerged) {
+	// a checkerboard of single pixels, separated by cached pixels
+	std::vector<Cube<3>> uncovered;
+	for (int x = 0; x < 60; x += 2)
+		for (int y = 0; y < 60; y += 2)
+			uncovered.push_back(Cube3(x, x + 1, y, y + 1, 0, 1));
+	// and a few large remainders far apart
+	uncovered.push_back(Cube3(80, 100, 0, 10, 0, 1));
+	uncovered.push_back(Cube3(0, 10, 80, 100, 0, 1));
+
+	auto remainders = RemainderPartition::compute(createRasterQuery(), uncovered);
+	EXPECT_EQ(3, remainders.size());
+	expectCovered(uncovered, remainders);
+}
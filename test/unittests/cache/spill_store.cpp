@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "cache/node/manager/spill_store.h"
+#include "util/exceptions.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static LocalRef createRef(uint64_t entry_id) {
+	return LocalRef(NodeCacheKey("sem", entry_id), CacheEntry(CacheCube(SpatioTemporalReference::unreferenced()), 1, ProfilingData()));
+}
+
+// Appends a record of about 1000 bytes holding the entry id
+static std::vector<LocalRef> append(SpillStore &store, uint64_t entry_id) {
+	BinaryWriteBuffer buffer;
+	buffer.write(entry_id);
+	buffer.write(std::string(1000, 'x'));
+	return store.append(createRef(entry_id), buffer);
+}
+
+class SpillStoreTest : public ::testing::Test {
+protected:
+	void SetUp() {
+		char tmpl[] = "/tmp/spill_test_XXXXXX";
+		ASSERT_NE(nullptr, mkdtemp(tmpl));
+		directory = tmpl;
+	}
+	void TearDown() {
+		rmdir(directory.c_str());
+	}
+	std::string directory;
+};
+
+TEST_F(SpillStoreTest, roundTrip) {
+	SpillStore store(directory, "test", 10000, std::make_unique<LocalLRU>());
+	EXPECT_TRUE(append(store, 1).empty());
+	EXPECT_TRUE(append(store, 2).empty());
+
+	auto buffer = store.read(1);
+	EXPECT_EQ(1, buffer->read<uint64_t>());
+	EXPECT_EQ(std::string(1000, 'x'), buffer->read<std::string>());
+	EXPECT_EQ(2, store.read(2)->read<uint64_t>());
+
+	EXPECT_THROW(store.read(3), NoSuchElementException);
+}
+
+TEST_F(SpillStoreTest, evictsBySize) {
+	SpillStore store(directory, "test", 2500, std::make_unique<LocalLRU>());
+	append(store, 1);
+	append(store, 2);
+	store.read(1);
+
+	auto victims = append(store, 3);
+	ASSERT_EQ(1, victims.size());
+	EXPECT_EQ(2, victims[0].entry_id);
+	EXPECT_EQ("sem", victims[0].semantic_id);
+	EXPECT_THROW(store.read(2), NoSuchElementException);
+	EXPECT_LE(store.get_current_size(), store.get_max_size());
+}
+
+TEST_F(SpillStoreTest, deadSegmentsAreDeleted) {
+	// Every record fills a segment
+	SpillStore store(directory, "test", 10000, std::make_unique<LocalLRU>(), 1000);
+	append(store, 1);
+	append(store, 2);
+	append(store, 3);
+	EXPECT_EQ(3, store.get_num_segments());
+
+	store.remove(1);
+	store.remove(2);
+	EXPECT_EQ(1, store.get_num_segments());
+	EXPECT_EQ(3, store.read(3)->read<uint64_t>());
+
+	store.remove(3);
+	EXPECT_EQ(0, store.get_num_segments());
+	EXPECT_EQ(0, store.get_current_size());
+}
@@ -109,4 +109,34 @@ TEST(GDALSource, TimeSnapSecond31) {
 
 TEST(GDALSource, TimeSnapSecond31_2) {
     testSnap(TimeUnit::Second, 31, "2010-01-01T23:59:00", "2010-01-02T00:00:01", "2010-01-01T23:59:31");
-}
\ No newline at end of file
+}
+TEST(GDALSource, LoadingTemplate) {
+    Json::Value dataset;
+    Json::Reader reader;
+    reader.parse(R"({
+        "path": "data",
+        "file_name": "ndvi_%%%TIME_STRING%%%.tif",
+        "time_format": "%Y-%m",
+        "time_start": "2014-01-01T00:00:00",
+        "time_interval": {"unit": "Month", "value": 1},
+        "coords": {"crs": "EPSG:4326"},
+        "channels": [{"nodata": 0}, {"channel": 3}]
+    })", dataset);
+
+    GDALTimesnap::GDALDataLoadingTemplate loadingTemplate(dataset, 1);
+    EXPECT_EQ(3, loadingTemplate.channel);
+
+    // 2014-03-15
+    TemporalReference tref(TIMETYPE_UNIX, 1394841600, 1394841601);
+    auto fromTemplate = GDALTimesnap::getDataLoadingInfo(loadingTemplate, tref);
+    auto fromJson = GDALTimesnap::getDataLoadingInfo(dataset, 1, tref);
+
+    EXPECT_EQ("data/ndvi_2014-03.tif", fromTemplate.fileName);
+    EXPECT_EQ(fromJson.fileName, fromTemplate.fileName);
+    EXPECT_EQ(3, fromTemplate.channel);
+    EXPECT_EQ(fromJson.tref.t1, fromTemplate.tref.t1);
+    EXPECT_EQ(fromJson.tref.t2, fromTemplate.tref.t2);
+    EXPECT_TRUE(std::isnan(fromTemplate.nodata));
+
+    EXPECT_THROW(GDALTimesnap::getDataLoadingInfo(loadingTemplate, TemporalReference(TIMETYPE_UNIX, 0, 1)), NoRasterForGivenTimeException);
+}
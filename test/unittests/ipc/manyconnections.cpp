@@ -0,0 +1,246 @@
+#include "util/server_nonblocking.h"
+#include "util/log.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm> // std::min
+#include <atomic>
+
+#include <sys/resource.h> // setrlimit
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+/*
+ * Many idle connections must neither exceed the limits of the server nor slow down the active ones.
+ *
+ * The idle connections are kept open during the whole test, while the active clients send integers,
+ * which are echoed by the server.
+ *
+ * The benchmark opens thousands of sockets on a fixed port and raises the open file limit, so it is
+ * disabled by default. Run it with --gtest_also_run_disabled_tests --gtest_filter=*ManyIdleConnections
+ */
+
+static const int NUM_IDLE_CLIENTS = 5000;
+static const int NUM_ACTIVE_CLIENTS = 200;
+static const int NUM_REQUESTS = 20;
+
+static const int SERVER_PORT = 51237;
+
+
+class ManyEchoServerConnection : public NonblockingServer::Connection {
+	public:
+		ManyEchoServerConnection(NonblockingServer &server, int fd, int id);
+		~ManyEchoServerConnection();
+	private:
+		virtual void processData(std::unique_ptr<BinaryReadBuffer> request);
+};
+
+ManyEchoServerConnection::ManyEchoServerConnection(NonblockingServer &server, int fd, int id) : Connection(server, fd, id) {
+}
+
+ManyEchoServerConnection::~ManyEchoServerConnection() {
+}
+
+void ManyEchoServerConnection::processData(std::unique_ptr<BinaryReadBuffer> request) {
+	auto response = std::make_unique<BinaryWriteBuffer>();
+	response->write(request->read<int>());
+	startWritingData(std::move(response));
+}
+
+
+class ManyEchoServer : public NonblockingServer {
+	public:
+		using NonblockingServer::NonblockingServer;
+		virtual ~ManyEchoServer() {};
+	private:
+		virtual std::unique_ptr<Connection> createConnection(int fd, int id);
+};
+
+std::unique_ptr<NonblockingServer::Connection> ManyEchoServer::createConnection(int fd, int id) {
+	return std::make_unique<ManyEchoServerConnection>(*this, fd, id);
+}
+
+/*
+ * The server is running in its own thread, so we need to synchronize initialisation with the main thread
+ */
+static std::mutex server_initialization_mutex;
+static std::atomic<bool> server_thread_failed;
+static std::unique_ptr<ManyEchoServer> server;
+
+static void run_server() {
+	try {
+		server_initialization_mutex.lock();
+
+		server = std::make_unique<ManyEchoServer>();
+		server->listen(SERVER_PORT, "127.0.0.1");
+
+		server_initialization_mutex.unlock();
+		server->start();
+		server.reset(nullptr);
+	}
+	catch (const std::exception &e) {
+		printf("Error on server: %s\n", e.what());
+		server_thread_failed = true;
+		server_initialization_mutex.unlock();
+	}
+}
+
+
+static std::atomic<bool> all_clients_successful;
+
+static void run_client(int id) {
+	int req=0;
+	try {
+		auto stream = BinaryStream::connectTCP("127.0.0.1", SERVER_PORT, true);
+
+		for (req=0;req<NUM_REQUESTS;req++) {
+			BinaryWriteBuffer request;
+			request.write((int) (id * NUM_REQUESTS + req));
+			stream.write(request);
+
+			BinaryReadBuffer response;
+			stream.read(response);
+
+			auto res = response.read<int>();
+			if (res != id * NUM_REQUESTS + req) {
+				printf("Error in client %d, got mismatching number on request %d, got %d\n", id, req, res);
+				all_clients_successful = false;
+			}
+		}
+	}
+	catch (const std::exception &e) {
+		printf("Client %d aborted with an exception in request %d of %d: %s\n", id, req, NUM_REQUESTS, e.what());
+		all_clients_successful = false;
+	}
+}
+
+
+TEST(NonblockingServer, DISABLED_ManyIdleConnections) {
+	Log::off();
+	all_clients_successful = true;
+	server_thread_failed = false;
+
+	// Both ends of all connections are open in this process
+	struct rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	int num_idle = std::min<long>(NUM_IDLE_CLIENTS, ((long) limit.rlim_cur - 2 * NUM_ACTIVE_CLIENTS - 100) / 2);
+	if (num_idle < NUM_IDLE_CLIENTS)
+		printf("Open file limit of %ld only allows %d idle connections\n", (long) limit.rlim_cur, num_idle);
+
+	std::thread server_thread(run_server);
+
+	// wait for the listening socket to exist
+	bool server_is_running = false;
+	while (!server_is_running) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		if (server_thread_failed) {
+			ADD_FAILURE() << "Problem when initializing or running the server";
+			server_thread.join();
+			return;
+		}
+		server_initialization_mutex.lock();
+		if (server != nullptr)
+			server_is_running = true;
+		server_initialization_mutex.unlock();
+	}
+
+	std::vector<BinaryStream> idle_clients;
+	try {
+		for (int i=0;i<num_idle;i++)
+			idle_clients.push_back(BinaryStream::connectTCP("127.0.0.1", SERVER_PORT, true));
+	}
+	catch (const std::exception &e) {
+		ADD_FAILURE() << "Opening idle connection " << idle_clients.size() << " failed: " << e.what();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread client_threads[NUM_ACTIVE_CLIENTS];
+	for (int i=0;i<NUM_ACTIVE_CLIENTS;i++)
+		client_threads[i] = std::thread(run_client, i);
+	for (int i=0;i<NUM_ACTIVE_CLIENTS;i++)
+		client_threads[i].join();
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	printf("%d active clients sent %d requests in %ldms while %lu connections were idle\n",
+		NUM_ACTIVE_CLIENTS, NUM_ACTIVE_CLIENTS * NUM_REQUESTS, (long) duration, idle_clients.size());
+
+	// the idle connections are still usable
+	if (!idle_clients.empty()) {
+		try {
+			BinaryWriteBuffer request;
+			request.write((int) 42);
+			idle_clients.front().write(request);
+			BinaryReadBuffer response;
+			idle_clients.front().read(response);
+			EXPECT_EQ(42, response.read<int>());
+		}
+		catch (const std::exception &e) {
+			ADD_FAILURE() << "Idle connection failed: " << e.what();
+		}
+	}
+
+	idle_clients.clear();
+	server->stop();
+	server_thread.join();
+
+	EXPECT_EQ(true, all_clients_successful);
+}
+
+
+/*
+ * Returns a port that is currently unused on the loopback interface
+ */
+static int findFreePort() {
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	bind(sock, (struct sockaddr *) &addr, sizeof(addr));
+	socklen_t len = sizeof(addr);
+	getsockname(sock, (struct sockaddr *) &addr, &len);
+	close(sock);
+	return ntohs(addr.sin_port);
+}
+
+TEST(NonblockingServer, EchoesOnAllAddresses) {
+	Log::off();
+	const int port = findFreePort();
+	const std::vector<std::string> addresses{"127.0.0.1", "127.0.0.2"};
+
+	ManyEchoServer echo_server;
+	for (auto &address : addresses)
+		echo_server.listen(port, address);
+	std::thread server_thread([&echo_server]() { echo_server.start(); });
+
+	// the listening sockets exist, so connecting does not wait for the event loop
+	std::vector<BinaryStream> clients;
+	for (int i=0;i<4;i++)
+		clients.push_back(BinaryStream::connectTCP(addresses[i % addresses.size()].c_str(), port, true));
+
+	for (int req=0;req<3;req++) {
+		for (size_t i=0;i<clients.size();i++) {
+			BinaryWriteBuffer request;
+			request.write((int) (i * 10 + req));
+			clients[i].write(request);
+		}
+		for (size_t i=0;i<clients.size();i++) {
+			BinaryReadBuffer response;
+			clients[i].read(response);
+			EXPECT_EQ((int) (i * 10 + req), response.read<int>()) << "client " << i << " on " << addresses[i % addresses.size()];
+		}
+	}
+
+	clients.clear();
+	echo_server.stop();
+	server_thread.join();
+}
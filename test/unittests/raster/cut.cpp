@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "datatypes/raster/raster_priv.h"
+
+
+TEST(RasterCut, copiesRowsOfTheSource) {
+	DataDescription dd(GDT_Int32, Unit::unknown());
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), 10, 8);
+	auto r = (Raster2D<int32_t> *) raster.get();
+	for (int y = 0; y < 8; y++)
+		for (int x = 0; x < 10; x++)
+			r->set(x, y, y * 100 + x);
+
+	auto cut = raster->cut(3, 2, 0, 4, 5, 0);
+	auto c = (Raster2D<int32_t> *) cut.get();
+	c->setRepresentation(GenericRaster::Representation::CPU);
+	ASSERT_EQ(4, c->width);
+	ASSERT_EQ(5, c->height);
+	for (int y = 0; y < 5; y++)
+		for (int x = 0; x < 4; x++)
+			EXPECT_EQ((y + 2) * 100 + x + 3, c->get(x, y)) << "pixel " << x << "," << y;
+
+	EXPECT_DOUBLE_EQ(raster->pixel_scale_x, c->pixel_scale_x);
+	EXPECT_DOUBLE_EQ(raster->stref.x1 + 3 * raster->pixel_scale_x, c->stref.x1);
+	EXPECT_DOUBLE_EQ(raster->stref.y1 + 2 * raster->pixel_scale_y, c->stref.y1);
+	EXPECT_THROW(raster->cut(7, 0, 0, 4, 1, 0), MetadataException);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/colorizer.h"
+
+#include <jpeglib.h>
+#include <sstream>
+#include <cstdlib>
+
+/*
+ * Decodes a JPEG into RGB rows
+ */
+static std::vector<std::vector<uint8_t>> decodeJPEG(const std::string &jpeg, uint32_t &width, uint32_t &height) {
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, (unsigned char *) jpeg.data(), jpeg.size());
+	jpeg_read_header(&cinfo, TRUE);
+	jpeg_start_decompress(&cinfo);
+	width = cinfo.output_width;
+	height = cinfo.output_height;
+	EXPECT_EQ(3, cinfo.output_components);
+
+	std::vector<std::vector<uint8_t>> rows;
+	while (cinfo.output_scanline < cinfo.output_height) {
+		rows.emplace_back(3 * width);
+		JSAMPROW row = rows.back().data();
+		jpeg_read_scanlines(&cinfo, &row, 1);
+	}
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	return rows;
+}
+
+static void expectColor(const std::vector<uint8_t> &row, uint32_t x, uint8_t r, uint8_t g, uint8_t b) {
+	const int tolerance = 12;
+	EXPECT_NEAR(r, row[3*x], tolerance) << "red at " << x;
+	EXPECT_NEAR(g, row[3*x+1], tolerance) << "green at " << x;
+	EXPECT_NEAR(b, row[3*x+2], tolerance) << "blue at " << x;
+}
+
+// Four vertical bands of 32 pixels: 0, 50, 100 and no data
+static std::unique_ptr<GenericRaster> createBands() {
+	DataDescription dd(GDT_Byte, Unit::unknown(), true, 255);
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), 128, 64);
+	auto r = (Raster2D<uint8_t> *) raster.get();
+	const uint8_t values[4] = {0, 50, 100, 255};
+	for (int y = 0; y < 64; y++)
+		for (int x = 0; x < 128; x++)
+			r->set(x, y, values[x / 32]);
+	return raster;
+}
+
+static Colorizer createColorizer() {
+	return Colorizer({Colorizer::Breakpoint(0, color_from_rgba(255, 0, 0)), Colorizer::Breakpoint(100, color_from_rgba(0, 0, 255))});
+}
+
+TEST(ExportJPEG, colorizedBands) {
+	auto raster = createBands();
+	std::ostringstream output;
+	raster->toJPEG(output, createColorizer(), true, false, 95, color_from_rgba(0, 255, 0));
+
+	uint32_t width = 0, height = 0;
+	auto rows = decodeJPEG(output.str(), width, height);
+	ASSERT_EQ(128, width);
+	ASSERT_EQ(64, height);
+	ASSERT_EQ(64, rows.size());
+
+	// flipped horizontally, no data is blended onto the background
+	expectColor(rows[32], 16, 0, 255, 0);
+	expectColor(rows[32], 48, 0, 0, 255);
+	expectColor(rows[32], 80, 127, 0, 127);
+	expectColor(rows[32], 112, 255, 0, 0);
+}
+
+TEST(ExportJPEG, qualityAffectsSize) {
+	DataDescription dd(GDT_Float32, Unit::unknown());
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), 256, 256);
+	auto r = (Raster2D<float> *) raster.get();
+	for (int y = 0; y < 256; y++)
+		for (int x = 0; x < 256; x++)
+			r->set(x, y, (x * 37 + y * 91) % 100);
+
+	std::ostringstream low, high;
+	raster->toJPEG(low, createColorizer(), false, false, 10);
+	raster->toJPEG(high, createColorizer(), false, false, 100);
+	EXPECT_LT(low.str().size(), high.str().size());
+
+	std::ostringstream invalid;
+	EXPECT_THROW(raster->toJPEG(invalid, createColorizer(), false, false, 101), ArgumentException);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/colorizer.h"
+#include "util/task_executor.h"
+
+#include <png.h>
+#include <sstream>
+#include <cmath>
+
+/*
+ * Decodes a palette PNG into its palette indices, row by row
+ */
+static void png_read_wrapper(png_structp png_ptr, png_bytep data, png_size_t length) {
+	std::istream *stream = (std::istream *) png_get_io_ptr(png_ptr);
+	stream->read((char *) data, length);
+}
+
+static std::vector<std::vector<uint8_t>> decodePNG(const std::string &png, uint32_t &width, uint32_t &height) {
+	std::istringstream input(png);
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	std::vector<std::vector<uint8_t>> rows;
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+		ADD_FAILURE() << "libpng could not decode the PNG";
+		return rows;
+	}
+	png_set_read_fn(png_ptr, &input, png_read_wrapper);
+	png_read_info(png_ptr, info_ptr);
+	width = png_get_image_width(png_ptr, info_ptr);
+	height = png_get_image_height(png_ptr, info_ptr);
+	EXPECT_EQ(PNG_COLOR_TYPE_PALETTE, png_get_color_type(png_ptr, info_ptr));
+	for (uint32_t y = 0; y < height; y++) {
+		rows.emplace_back(width);
+		png_read_row(png_ptr, rows.back().data(), nullptr);
+	}
+	png_read_end(png_ptr, nullptr);
+	png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+	return rows;
+}
+
+static uint8_t expectedIndex(double v, double min, double max) {
+	return std::round(253.0 * (v - min) / (max - min)) + 2;
+}
+
+template<typename T>
+static void checkRoundTrip(GDALDataType type, uint32_t width, uint32_t height, bool flipx, bool flipy, int compression) {
+	DataDescription dd(type, Unit::unknown(), true, 7);
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), width, height);
+	auto r = (Raster2D<T> *) raster.get();
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			r->set(x, y, (x * 31 + y * 17) % 1000);
+
+	auto colorizer = Colorizer::greyscale(100, 900);
+	std::ostringstream output;
+	raster->toPNG(output, *colorizer, flipx, flipy, nullptr, compression);
+
+	uint32_t png_width = 0, png_height = 0;
+	auto rows = decodePNG(output.str(), png_width, png_height);
+	ASSERT_EQ(width, png_width);
+	ASSERT_EQ(height, png_height);
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			T v = r->get(flipx ? width-x-1 : x, flipy ? height-y-1 : y);
+			uint8_t expected = v == 7 ? 0 : (v < 100 || v > 900) ? 1 : expectedIndex(v, 100, 900);
+			ASSERT_EQ(expected, rows[y][x]) << "pixel " << x << "," << y;
+		}
+	}
+}
+
+TEST(ExportPNG, lookupTable) {
+	checkRoundTrip<uint16_t>(GDT_UInt16, 300, 300, false, false, -1);
+}
+
+TEST(ExportPNG, quantizedFloats) {
+	checkRoundTrip<float>(GDT_Float32, 300, 300, true, false, 1);
+}
+
+TEST(ExportPNG, parallelStrips) {
+	// about 1.2MB of filtered rows, compressed in several strips
+	TaskExecutor::init(3);
+	checkRoundTrip<int32_t>(GDT_Int32, 1000, 1200, false, true, 9);
+	checkRoundTrip<uint16_t>(GDT_UInt16, 1000, 1200, true, true, 0);
+	TaskExecutor::init(0);
+}
+
+TEST(ExportPNG, invalidCompression) {
+	DataDescription dd(GDT_Byte, Unit::unknown());
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), 10, 10);
+	std::ostringstream output;
+	EXPECT_THROW(raster->toPNG(output, *Colorizer::greyscale(0, 1), false, false, nullptr, 10), ArgumentException);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/colorizer.h"
+#include "util/exceptions.h"
+
+#include <sstream>
+
+#ifdef MAPPING_WITH_WEBP
+#include <webp/decode.h>
+#endif
+
+// Four vertical bands of 32 pixels: 0, 50, 100 and no data
+static std::unique_ptr<GenericRaster> createBands() {
+	DataDescription dd(GDT_Byte, Unit::unknown(), true, 255);
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), 128, 64);
+	auto r = (Raster2D<uint8_t> *) raster.get();
+	const uint8_t values[4] = {0, 50, 100, 255};
+	for (int y = 0; y < 64; y++)
+		for (int x = 0; x < 128; x++)
+			r->set(x, y, values[x / 32]);
+	return raster;
+}
+
+static Colorizer createColorizer() {
+	return Colorizer({Colorizer::Breakpoint(0, color_from_rgba(255, 0, 0)), Colorizer::Breakpoint(100, color_from_rgba(0, 0, 255))});
+}
+
+#ifdef MAPPING_WITH_WEBP
+
+static void expectColor(const uint8_t *row, uint32_t x, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+	const int tolerance = 12;
+	EXPECT_NEAR(r, row[4*x], tolerance) << "red at " << x;
+	EXPECT_NEAR(g, row[4*x+1], tolerance) << "green at " << x;
+	EXPECT_NEAR(b, row[4*x+2], tolerance) << "blue at " << x;
+	EXPECT_NEAR(a, row[4*x+3], tolerance) << "alpha at " << x;
+}
+
+TEST(ExportWebP, roundTrip) {
+	auto raster = createBands();
+	std::ostringstream output;
+	raster->toWebP(output, createColorizer(), true, false, 100);
+	std::string webp = output.str();
+
+	int width = 0, height = 0;
+	uint8_t *rgba = WebPDecodeRGBA((const uint8_t *) webp.data(), webp.size(), &width, &height);
+	ASSERT_NE(nullptr, rgba);
+	EXPECT_EQ(128, width);
+	EXPECT_EQ(64, height);
+
+	// flipped horizontally, no data stays transparent
+	const uint8_t *row = rgba + 4 * 32 * width;
+	EXPECT_EQ(0, row[4*16+3]);
+	expectColor(row, 48, 0, 0, 255, 255);
+	expectColor(row, 80, 127, 0, 127, 255);
+	expectColor(row, 112, 255, 0, 0, 255);
+	WebPFree(rgba);
+
+	std::ostringstream invalid;
+	EXPECT_THROW(raster->toWebP(invalid, createColorizer(), false, false, 101), ArgumentException);
+}
+
+#else
+
+TEST(ExportWebP, unavailable) {
+	std::ostringstream output;
+	EXPECT_THROW(createBands()->toWebP(output, createColorizer()), ExporterException);
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "datatypes/raster/raster_priv.h"
+#include "operators/queryrectangle.h"
+
+
+static std::unique_ptr<GenericRaster> createNumbered(uint32_t width, uint32_t height) {
+	DataDescription dd(GDT_Int32, Unit::unknown());
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference(SpatialReference(CrsId::unreferenced(), 0, 0, width, height), TemporalReference::unreferenced()), width, height);
+	auto r = (Raster2D<int32_t> *) raster.get();
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			r->set(x, y, y * 100 + x);
+	return raster;
+}
+
+TEST(RasterView, flipDoesNotCopy) {
+	auto raster = createNumbered(5, 4);
+	auto flipped = raster->flip(true, true);
+	EXPECT_EQ(GenericRaster::Representation::VIEW, flipped->getRepresentation());
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 5; x++)
+			EXPECT_EQ((3 - y) * 100 + 4 - x, flipped->getAsDouble(x, y)) << "pixel " << x << "," << y;
+
+	// flipping twice leads back to the original pixels
+	auto restored = flipped->flip(true, true);
+	auto r = (Raster2D<int32_t> *) restored.get();
+	restored->setRepresentation(GenericRaster::Representation::CPU);
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 5; x++)
+			EXPECT_EQ(y * 100 + x, r->get(x, y));
+}
+
+TEST(RasterView, cutOfFlippedView) {
+	auto raster = createNumbered(10, 8);
+	auto view = raster->flip(true, false)->cut(2, 1, 3, 4);
+	EXPECT_EQ(GenericRaster::Representation::VIEW, view->getRepresentation());
+
+	auto data = (const int32_t *) view->getData();
+	EXPECT_EQ(GenericRaster::Representation::CPU, view->getRepresentation());
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 3; x++)
+			EXPECT_EQ((y + 1) * 100 + 7 - x, data[y * 3 + x]) << "pixel " << x << "," << y;
+}
+
+TEST(RasterView, viewOutlivesSource) {
+	auto raster = createNumbered(6, 6);
+	auto view = raster->cut(1, 1, 4, 4);
+	raster.reset();
+
+	std::vector<int32_t> scratch;
+	auto r = (Raster2D<int32_t> *) view.get();
+	EXPECT_EQ(301, r->getRow(2, scratch)[0]);
+}
+
+TEST(RasterView, writingDoesNotChangeOtherRasters) {
+	auto raster = createNumbered(6, 6);
+	auto view = raster->cut(0, 0, 6, 6);
+	raster->clear(7);
+	EXPECT_EQ(0, view->getAsDouble(0, 0));
+	EXPECT_EQ(505, view->getAsDouble(5, 5));
+
+	auto copy = view->flip(false, false);
+	auto r = (Raster2D<int32_t> *) view.get();
+	((int32_t *) view->getDataForWriting())[0] = 42;
+	EXPECT_EQ(42, r->get(0, 0));
+	EXPECT_EQ(0, copy->getAsDouble(0, 0));
+}
+
+TEST(RasterView, setDoesNotChangeViews) {
+	auto raster = createNumbered(6, 6);
+	auto view = raster->cut(1, 1, 4, 4);
+	auto r = (Raster2D<int32_t> *) raster.get();
+	r->set(1, 1, 42);
+	r->setSafe(2, 2, 43);
+	EXPECT_EQ(42, r->get(1, 1));
+	EXPECT_EQ(43, r->get(2, 2));
+	EXPECT_EQ(101, view->getAsDouble(0, 0));
+	EXPECT_EQ(202, view->getAsDouble(1, 1));
+
+	// the source owns its buffer now, so a new view sees the written pixels
+	auto view2 = raster->cut(1, 1, 4, 4);
+	EXPECT_EQ(42, view2->getAsDouble(0, 0));
+}
+
+TEST(RasterView, getAndSetOnAView) {
+	auto raster = createNumbered(6, 6);
+	auto view = raster->cut(1, 1, 4, 4);
+	auto r = (Raster2D<int32_t> *) view.get();
+	EXPECT_EQ(101, r->get(0, 0));
+	EXPECT_EQ(404, r->getSafe(3, 3));
+	EXPECT_EQ(-1, r->getSafe(4, 0, -1));
+	EXPECT_EQ(GenericRaster::Representation::VIEW, view->getRepresentation());
+
+	// writing materializes the view, the source keeps its pixels
+	r->set(0, 0, 42);
+	EXPECT_EQ(GenericRaster::Representation::CPU, view->getRepresentation());
+	EXPECT_EQ(42, r->get(0, 0));
+	EXPECT_EQ(202, r->get(1, 1));
+	EXPECT_EQ(101, raster->getAsDouble(1, 1));
+
+	auto flipped = raster->flip(true, false);
+	auto f = (Raster2D<int32_t> *) flipped.get();
+	f->setSafe(0, 0, 7);
+	EXPECT_EQ(7, f->get(0, 0));
+	EXPECT_EQ(4, f->get(1, 0));
+	EXPECT_EQ(5, raster->getAsDouble(5, 0));
+}
+
+TEST(RasterView, fitToQueryRectangle) {
+	auto raster = createNumbered(10, 10);
+
+	// aligned to the pixels and inside: a view
+	QueryRectangle inside(SpatialReference(CrsId::unreferenced(), 2, 3, 6, 8), TemporalReference::unreferenced(), QueryResolution::pixels(4, 5));
+	auto view = raster->fitToQueryRectangle(inside);
+	EXPECT_EQ(GenericRaster::Representation::VIEW, view->getRepresentation());
+	ASSERT_EQ(4, view->width);
+	ASSERT_EQ(5, view->height);
+	EXPECT_EQ(302, view->getAsDouble(0, 0));
+	EXPECT_EQ(705, view->getAsDouble(3, 4));
+
+	// partially outside: a copy, with 0 outside the source
+	QueryRectangle outside(SpatialReference(CrsId::unreferenced(), 8, 8, 12, 12), TemporalReference::unreferenced(), QueryResolution::pixels(4, 4));
+	auto copy = raster->fitToQueryRectangle(outside);
+	EXPECT_EQ(GenericRaster::Representation::CPU, copy->getRepresentation());
+	EXPECT_EQ(808, copy->getAsDouble(0, 0));
+	EXPECT_EQ(0, copy->getAsDouble(2, 0));
+	EXPECT_EQ(0, copy->getAsDouble(3, 3));
+}
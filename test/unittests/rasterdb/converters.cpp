@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "datatypes/raster/typejuggling.h"
+#include "rasterdb/converters/converter.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+template<typename T>
+struct fillRaster {
+	static void execute(Raster2D<T> *raster) {
+		// a smooth gradient with some noise, similar to real data
+		for (uint32_t y = 0; y < raster->height; y++)
+			for (uint32_t x = 0; x < raster->width; x++)
+				raster->set(x, y, (T) ((x + 2*y) % 100 + (x*7 + y*13) % 5));
+	}
+};
+
+static void checkRoundTrip(const std::string &method, GDALDataType datatype) {
+	DataDescription dd(datatype, Unit::unknown());
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), 37, 23);
+	callUnaryOperatorFunc<fillRaster>(raster.get());
+
+	auto converter = RasterConverter::getConverter(method);
+	auto encoded = converter->encode(raster.get());
+	auto decoded = converter->decode(*encoded, dd, SpatioTemporalReference::unreferenced(), raster->width, raster->height, 0);
+
+	ASSERT_EQ(raster->getDataSize(), decoded->getDataSize()) << method << " " << GDALGetDataTypeName(datatype);
+	EXPECT_EQ(0, memcmp(raster->getData(), decoded->getData(), raster->getDataSize())) << method << " " << GDALGetDataTypeName(datatype);
+}
+
+TEST(RasterConverter, roundtrip) {
+	for (auto &method : RasterConverter::getConverterNames()) {
+		for (auto datatype : {GDT_Byte, GDT_Int16, GDT_UInt16, GDT_Int32, GDT_UInt32, GDT_Float32, GDT_Float64})
+			checkRoundTrip(method, datatype);
+	}
+}
+
+TEST(RasterConverter, fastCodecs) {
+	auto names = RasterConverter::getConverterNames();
+	for (auto method : {"LZ4", "LZ4_DELTA", "LZ4_SHUFFLE", "ZSTD", "ZSTD_DELTA", "ZSTD_SHUFFLE"})
+		EXPECT_NE(names.end(), std::find(names.begin(), names.end(), std::string(method))) << method;
+}
+
+TEST(RasterConverter, unknown) {
+	EXPECT_THROW(RasterConverter::getConverter("NOPE"), ConverterException);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "rasterdb/tilecache.h"
+#include "rasterdb/rasterdb.h"
+#include "operators/queryrectangle.h"
+#include "operators/queryprofiler.h"
+#include "util/configuration.h"
+
+#include <boost/filesystem.hpp>
+#include <stdlib.h>
+
+
+static std::shared_ptr<const GenericRaster> createTile(uint32_t size) {
+	DataDescription dd(GDT_Byte, Unit::unknown());
+	return GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), size, size);
+}
+
+TEST(RasterDBTileCache, evictsLeastRecentlyUsed) {
+	RasterDBTileCache cache(3 * 100);
+
+	RasterDBTileCache::Key a("source", 0, 0), b("source", 0, 100), c("source", 0, 200), d("source", 1, 0);
+	cache.put(a, createTile(10));
+	cache.put(b, createTile(10));
+	cache.put(c, createTile(10));
+	EXPECT_EQ(300, cache.getSize());
+
+	// a is now used more recently than b
+	EXPECT_NE(nullptr, cache.get(a));
+	cache.put(d, createTile(10));
+
+	EXPECT_EQ(3, cache.getTileCount());
+	EXPECT_EQ(300, cache.getSize());
+	EXPECT_NE(nullptr, cache.get(a));
+	EXPECT_EQ(nullptr, cache.get(b));
+	EXPECT_NE(nullptr, cache.get(c));
+	EXPECT_NE(nullptr, cache.get(d));
+}
+
+TEST(RasterDBTileCache, sizeLimits) {
+	RasterDBTileCache cache(100);
+	cache.put(RasterDBTileCache::Key("source", 0, 0), createTile(11));
+	EXPECT_EQ(0, cache.getTileCount());
+
+	RasterDBTileCache disabled(0);
+	disabled.put(RasterDBTileCache::Key("source", 0, 0), createTile(1));
+	EXPECT_EQ(nullptr, disabled.get(RasterDBTileCache::Key("source", 0, 0)));
+}
+
+TEST(RasterDBTileCache, invalidate) {
+	RasterDBTileCache cache(1000);
+	cache.put(RasterDBTileCache::Key("source1", 0, 0), createTile(10));
+	cache.put(RasterDBTileCache::Key("source2", 0, 0), createTile(10));
+
+	cache.invalidate("source1");
+	EXPECT_EQ(nullptr, cache.get(RasterDBTileCache::Key("source1", 0, 0)));
+	EXPECT_NE(nullptr, cache.get(RasterDBTileCache::Key("source2", 0, 0)));
+	EXPECT_EQ(100, cache.getSize());
+}
+
+TEST(RasterDBTileCache, hitAfterReopeningTheSource) {
+	// a local source in a temporary directory, with one of the rasters of the systemtests
+	char location[] = "/tmp/mapping_rasterdb_XXXXXX";
+	ASSERT_NE(nullptr, mkdtemp(location));
+	boost::filesystem::copy_file("../../test/systemtests/data/ndvi.json", std::string(location) + "/tilecache_test.json");
+	Configuration::loadFromString(concat("[rasterdb]\nbackend=\"local\"\n[rasterdb.local]\nlocation=\"", location, "/\"\n[rasterdb.tilecache]\nsize=67108864"));
+
+	const double time_start = 1388534400;
+	{
+		auto db = RasterDB::open("tilecache_test", RasterDB::READ_WRITE);
+		db->import("../../test/systemtests/data/ndvi/MOD13A2_M_NDVI_2014-01-01_rgb_3600x1800.TIFF", 1, 0, time_start, time_start + 2678400, "RAW");
+	}
+
+	QueryRectangle rect(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 10, 10), TemporalReference(TIMETYPE_UNIX, time_start), QueryResolution::pixels(100, 100));
+	QueryProfiler first, second;
+	std::unique_ptr<GenericRaster> first_raster, second_raster;
+	{
+		auto db = RasterDB::open("tilecache_test");
+		first_raster = db->query(rect, first, 0);
+	}
+	// the source was closed in between, as it is after every query
+	{
+		auto db = RasterDB::open("tilecache_test");
+		second_raster = db->query(rect, second, 0);
+	}
+	boost::filesystem::remove_all(location);
+
+	EXPECT_EQ(0, first.tilecache_hits);
+	EXPECT_LT(0, first.tilecache_misses);
+	EXPECT_EQ(first.tilecache_misses, second.tilecache_hits);
+	EXPECT_EQ(0, second.tilecache_misses);
+	EXPECT_EQ(0, memcmp(first_raster->getData(), second_raster->getData(), first_raster->getDataSize()));
+}
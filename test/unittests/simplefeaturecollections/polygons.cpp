@@ -661,6 +661,74 @@ TEST(PolygonCollection, bulkPointInPolygon){
 	EXPECT_EQ(false, tester.pointInCollection(b));
 }
 
+static bool referencePointInRing(const std::vector<Coordinate> &ring, const Coordinate &c) {
+	bool inside = false;
+	for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+		if ((ring[i].y < c.y && ring[j].y >= c.y) || (ring[j].y < c.y && ring[i].y >= c.y)) {
+			if (ring[i].x + (c.y - ring[i].y) / (ring[j].y - ring[i].y) * (ring[j].x - ring[i].x) < c.x)
+				inside = !inside;
+		}
+	}
+	return inside;
+}
+
+TEST(PolygonCollection, bulkPointInPolygonIndexed){
+	// many small squares and a star with many edges and a hole, to use both the tree and the bands
+	PolygonCollection polygons(SpatioTemporalReference::unreferenced());
+	std::vector<std::vector<std::vector<Coordinate>>> rings; // per feature: outer ring and holes, not closed
+
+	for (int x = 0; x < 20; x++) {
+		for (int y = 0; y < 20; y++) {
+			std::vector<Coordinate> square {Coordinate(x*5, y*5), Coordinate(x*5+3, y*5), Coordinate(x*5+3, y*5+3), Coordinate(x*5, y*5+3)};
+			for (auto &c : square)
+				polygons.addCoordinate(c.x, c.y);
+			polygons.addCoordinate(square[0].x, square[0].y);
+			polygons.finishRing();
+			polygons.finishPolygon();
+			polygons.finishFeature();
+			rings.push_back({square});
+		}
+	}
+
+	std::vector<Coordinate> star, hole;
+	for (int i = 0; i < 500; i++) {
+		double angle = 2 * M_PI * i / 500;
+		double radius = (i % 2 == 0) ? 40 : 25;
+		star.push_back(Coordinate(50 + radius * cos(angle), 50 + radius * sin(angle)));
+		hole.push_back(Coordinate(50 + 10 * cos(-angle), 50 + 10 * sin(-angle)));
+	}
+	for (auto ring : {star, hole}) {
+		for (auto &c : ring)
+			polygons.addCoordinate(c.x, c.y);
+		polygons.addCoordinate(ring[0].x, ring[0].y);
+		polygons.finishRing();
+	}
+	polygons.finishPolygon();
+	polygons.finishFeature();
+	rings.push_back({star, hole});
+
+	auto tester = polygons.getPointInCollectionBulkTester();
+
+	std::vector<Coordinate> points;
+	for (int i = 0; i < 20000; i++)
+		points.push_back(Coordinate(-5 + 110.0 * ((i * 7919) % 20000) / 20000.0 + 0.0001, -5 + 110.0 * ((i * 104729) % 19997) / 19997.0 + 0.0001));
+	auto contained = tester.pointsInCollection(points);
+
+	for (size_t i = 0; i < points.size(); i++) {
+		std::vector<uint32_t> expected;
+		for (uint32_t feature = 0; feature < rings.size(); feature++) {
+			bool inside = referencePointInRing(rings[feature][0], points[i]);
+			for (size_t h = 1; h < rings[feature].size(); h++)
+				inside = inside && !referencePointInRing(rings[feature][h], points[i]);
+			if (inside)
+				expected.push_back(feature);
+		}
+		ASSERT_EQ(expected, tester.polygonsContainingPoint(points[i])) << points[i].x << "," << points[i].y;
+		ASSERT_EQ(!expected.empty(), tester.pointInCollection(points[i]));
+		ASSERT_EQ(!expected.empty(), contained[i]);
+	}
+}
+
 TEST(PolygonCollection, WKTImport){
 	std::string wkt = "GEOMETRYCOLLECTION(POLYGON((10 20, 30 30, 0 30, 10 20), (2 2, 5 2, 1 1, 2 2)))";
 	auto polygons = WKBUtil::readPolygonCollection(wkt, SpatioTemporalReference::unreferenced());
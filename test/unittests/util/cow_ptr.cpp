@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <util/cow_ptr.h>
+
+namespace {
+    class Value {
+    public:
+        explicit Value(int value) : value(value) {}
+
+        std::unique_ptr<Value> clone() const {
+            return std::make_unique<Value>(value);
+        }
+
+        int value;
+    };
+}
+
+TEST(CowPtr, owned_is_not_copied) {
+    auto value = std::make_unique<Value>(42);
+    const Value *address = value.get();
+
+    cow_ptr<Value> ptr(std::move(value));
+    EXPECT_FALSE(ptr.is_shared());
+
+    ptr.mutate().value = 7;
+    EXPECT_EQ(ptr.get(), address);
+
+    auto released = ptr.release();
+    EXPECT_EQ(released.get(), address);
+    EXPECT_EQ(released->value, 7);
+    EXPECT_FALSE(ptr);
+}
+
+TEST(CowPtr, shared_is_copied_on_write) {
+    auto shared = std::make_shared<const Value>(42);
+
+    cow_ptr<Value> ptr(shared);
+    EXPECT_TRUE(ptr.is_shared());
+    EXPECT_EQ(ptr.get(), shared.get());
+
+    ptr.mutate().value = 7;
+    EXPECT_FALSE(ptr.is_shared());
+    EXPECT_NE(ptr.get(), shared.get());
+    EXPECT_EQ(ptr->value, 7);
+    EXPECT_EQ(shared->value, 42);
+}
+
+TEST(CowPtr, shared_is_copied_on_release) {
+    auto shared = std::make_shared<const Value>(42);
+
+    cow_ptr<Value> ptr(shared);
+    auto released = ptr.release();
+    EXPECT_NE(released.get(), shared.get());
+    EXPECT_EQ(released->value, 42);
+}
+
+TEST(CowPtr, share_does_not_copy) {
+    auto value = std::make_unique<Value>(42);
+    const Value *address = value.get();
+
+    cow_ptr<Value> ptr(std::move(value));
+    auto shared = ptr.share();
+    EXPECT_EQ(shared.get(), address);
+    EXPECT_TRUE(ptr.is_shared());
+    EXPECT_EQ(ptr.get(), address);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "util/formula_program.h"
+
+#include <cmath>
+
+
+static double evaluate(const std::string &formula, std::vector<double> values = {}, FormulaProgram::Type type = FormulaProgram::Type::FLOAT) {
+	std::vector<FormulaProgram::Type> types(values.size(), type);
+	FormulaProgram program(formula, types);
+
+	std::vector<const double *> variables;
+	for (auto &value : values)
+		variables.push_back(&value);
+	double result;
+	program.evaluate(variables.data(), &result, 1);
+	return result;
+}
+
+TEST(FormulaProgram, arithmetic) {
+	EXPECT_DOUBLE_EQ(7, evaluate("1+2*3"));
+	EXPECT_DOUBLE_EQ(9, evaluate("(1+2)*3"));
+	EXPECT_DOUBLE_EQ(-1, evaluate("2-3"));
+	EXPECT_DOUBLE_EQ(1, evaluate("-2+3"));
+	EXPECT_DOUBLE_EQ(2.5, evaluate("5.0/2"));
+	EXPECT_DOUBLE_EQ(2.5, evaluate("5/2.0f"));
+	EXPECT_DOUBLE_EQ(1500, evaluate("1.5e3"));
+	EXPECT_DOUBLE_EQ(14, evaluate("A*B+C", {2, 5, 4}));
+}
+
+TEST(FormulaProgram, integerDivision) {
+	EXPECT_DOUBLE_EQ(2, evaluate("5/2"));
+	EXPECT_DOUBLE_EQ(-2, evaluate("-5/2"));
+	EXPECT_DOUBLE_EQ(3, evaluate("A/B", {7, 2}, FormulaProgram::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(3.5, evaluate("A/B", {7, 2}, FormulaProgram::Type::FLOAT));
+	EXPECT_DOUBLE_EQ(0, evaluate("A/0", {7}, FormulaProgram::Type::INTEGER));
+}
+
+TEST(FormulaProgram, logic) {
+	EXPECT_DOUBLE_EQ(1, evaluate("A < B", {1, 2}));
+	EXPECT_DOUBLE_EQ(0, evaluate("A >= B", {1, 2}));
+	EXPECT_DOUBLE_EQ(1, evaluate("A <= 1 && B != 1", {1, 2}));
+	EXPECT_DOUBLE_EQ(1, evaluate("A > 5 || !(B == 3)", {1, 2}));
+	EXPECT_DOUBLE_EQ(10, evaluate("A > 0 ? 10 : 20", {1}));
+	EXPECT_DOUBLE_EQ(20, evaluate("A > 0 ? 10 : 20", {-1}));
+	EXPECT_DOUBLE_EQ(3, evaluate("A ? 2 : B ? 3 : 4", {0, 1}));
+}
+
+TEST(FormulaProgram, functions) {
+	EXPECT_DOUBLE_EQ(8, evaluate("pow(2, 3)"));
+	EXPECT_DOUBLE_EQ(3, evaluate("sqrt(A)", {9}));
+	EXPECT_DOUBLE_EQ(1, evaluate("mod(7, 3)"));
+	EXPECT_DOUBLE_EQ(1.5, evaluate("abs(-1.5)"));
+	EXPECT_DOUBLE_EQ(0.25, evaluate("fract(-1.75)"));
+	EXPECT_DOUBLE_EQ(100, evaluate("exp10(2)"));
+	EXPECT_DOUBLE_EQ(-3, evaluate("floor(-2.5)"));
+	EXPECT_NEAR(0, evaluate("sin(0)*cos(0)"), 1e-12);
+}
+
+TEST(FormulaProgram, blocks) {
+	const size_t count = 1000;
+	std::vector<double> a(count), b(count), result(count);
+	for (size_t i = 0; i < count; i++) {
+		a[i] = i;
+		b[i] = 2*i;
+	}
+	const double *variables[] = {a.data(), b.data()};
+
+	auto program = FormulaProgram::get("A + B * 2", {FormulaProgram::Type::INTEGER, FormulaProgram::Type::INTEGER});
+	EXPECT_EQ(FormulaProgram::Type::INTEGER, program->getResultType());
+	program->evaluate(variables, result.data(), count);
+	for (size_t i = 0; i < count; i++)
+		EXPECT_DOUBLE_EQ(5*i, result[i]);
+
+	auto cached = FormulaProgram::get("A + B * 2", {FormulaProgram::Type::INTEGER, FormulaProgram::Type::INTEGER});
+	EXPECT_EQ(program.get(), cached.get());
+	auto other = FormulaProgram::get("A + B * 2", {FormulaProgram::Type::INTEGER, FormulaProgram::Type::FLOAT});
+	EXPECT_NE(program.get(), other.get());
+	EXPECT_EQ(FormulaProgram::Type::FLOAT, other->getResultType());
+}
+
+static void badProgram(const std::string &formula) {
+	EXPECT_THROW(FormulaProgram(formula, {FormulaProgram::Type::FLOAT, FormulaProgram::Type::FLOAT}), Formula::parse_error) << formula;
+}
+
+TEST(FormulaProgram, bad) {
+	badProgram("");
+	badProgram("A +");
+	badProgram("(A");
+	badProgram("A)");
+	badProgram("C");
+	badProgram("A B");
+	badProgram("return 42");
+	badProgram("42;37");
+	badProgram("A[7]");
+	badProgram("A % 10");
+	badProgram("42 // comment");
+	badProgram("exit(5)");
+	badProgram("pow(A)");
+	badProgram("*(0x0042)");
+	badProgram("0x42");
+	badProgram("statement(), 42");
+	badProgram("A = 5");
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "util/gdal.h"
+#include "util/gdal_dataset_pool.h"
+
+#include <gdal_priv.h>
+
+
+static std::string createDataset(const std::string &name) {
+	GDAL::init();
+	std::string filename = "/vsimem/" + name + ".tif";
+	auto driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+	GDALClose(driver->Create(filename.c_str(), 4, 4, 1, GDT_Byte, nullptr));
+	return filename;
+}
+
+TEST(GDALDatasetPool, reusesIdleDatasets) {
+	auto filename = createDataset("pool_reuse");
+	GDALDatasetPool pool(4, 60);
+
+	GDALDataset *first;
+	{
+		auto handle = pool.checkout(filename);
+		ASSERT_NE(nullptr, handle.get());
+		first = handle.get();
+	}
+	{
+		auto handle = pool.checkout(filename);
+		EXPECT_EQ(first, handle.get());
+	}
+	EXPECT_EQ(1, pool.getOpenCount());
+
+	pool.clear();
+	EXPECT_EQ(0, pool.getOpenCount());
+}
+
+TEST(GDALDatasetPool, checksOutExclusively) {
+	auto filename = createDataset("pool_exclusive");
+	GDALDatasetPool pool(4, 60);
+
+	auto handle1 = pool.checkout(filename);
+	auto handle2 = pool.checkout(filename);
+	ASSERT_NE(nullptr, handle1.get());
+	ASSERT_NE(nullptr, handle2.get());
+	EXPECT_NE(handle1.get(), handle2.get());
+	EXPECT_EQ(2, pool.getOpenCount());
+}
+
+TEST(GDALDatasetPool, limitsOpenDatasets) {
+	auto filename = createDataset("pool_limit");
+	GDALDatasetPool pool(1, 60);
+
+	{
+		auto handle1 = pool.checkout(filename);
+		auto handle2 = pool.checkout(filename);
+		// datasets in use are never closed
+		EXPECT_EQ(2, pool.getOpenCount());
+	}
+	EXPECT_EQ(1, pool.getOpenCount());
+
+	{
+		auto handle = pool.checkout(filename);
+		handle.discard();
+	}
+	EXPECT_EQ(0, pool.getOpenCount());
+}
+
+TEST(GDALDatasetPool, missingFile) {
+	GDALDatasetPool pool(4, 60);
+	auto handle = pool.checkout("/vsimem/pool_does_not_exist.tif");
+	EXPECT_EQ(nullptr, handle.get());
+	EXPECT_EQ(0, pool.getOpenCount());
+}
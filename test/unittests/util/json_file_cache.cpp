@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "util/json_file_cache.h"
+#include "util/exceptions.h"
+
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fstream>
+#include <unistd.h>
+
+
+static void writeFile(const std::string &filename, const std::string &content, time_t mtime) {
+	{
+		std::ofstream file(filename, std::ios::trunc);
+		file << content;
+	}
+	struct timeval times[2] = {{mtime, 0}, {mtime, 0}};
+	utimes(filename.c_str(), times);
+}
+
+TEST(JsonFileCache, reparsesChangedFiles) {
+	std::string filename = "json_file_cache_test.json";
+	JsonFileCache cache;
+
+	writeFile(filename, "{\"value\": 1}", 1000000);
+	auto first = cache.get(filename, "not found", "invalid");
+	EXPECT_EQ(1, (*first)["value"].asInt());
+	EXPECT_EQ(first, cache.get(filename, "not found", "invalid"));
+
+	// same size, different modification time
+	writeFile(filename, "{\"value\": 2}", 2000000);
+	auto second = cache.get(filename, "not found", "invalid");
+	EXPECT_NE(first, second);
+	EXPECT_EQ(2, (*second)["value"].asInt());
+	EXPECT_EQ(1, (*first)["value"].asInt());
+
+	writeFile(filename, "{\"value\": ", 3000000);
+	EXPECT_THROW(cache.get(filename, "not found", "invalid"), ArgumentException);
+
+	unlink(filename.c_str());
+	EXPECT_THROW(cache.get(filename, "not found", "invalid"), ArgumentException);
+}
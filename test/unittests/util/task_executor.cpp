@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <util/task_executor.h>
+
+#include <stdexcept>
+
+static int fibonacci(TaskExecutor &executor, int n) {
+    if (n < 2)
+        return n;
+    auto a = executor.submit([&executor, n]() { return fibonacci(executor, n - 1); });
+    auto b = executor.submit([&executor, n]() { return fibonacci(executor, n - 2); });
+    return a.get() + b.get();
+}
+
+TEST(TaskExecutor, runs_tasks) {
+    TaskExecutor executor(4);
+    std::vector<TaskFuture<int>> futures;
+    for (int i = 0; i < 100; ++i)
+        futures.push_back(executor.submit([i]() { return i * i; }));
+
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(futures[i].get(), i * i);
+}
+
+TEST(TaskExecutor, nested_tasks_do_not_block) {
+    // far more nested waits than threads
+    TaskExecutor executor(2);
+    EXPECT_EQ(fibonacci(executor, 15), 610);
+}
+
+TEST(TaskExecutor, without_threads) {
+    TaskExecutor executor(0);
+    EXPECT_EQ(executor.get_num_threads(), 0);
+    EXPECT_EQ(fibonacci(executor, 10), 55);
+}
+
+TEST(TaskExecutor, propagates_exceptions) {
+    TaskExecutor executor(2);
+    auto future = executor.submit([]() -> int { throw std::runtime_error("failed"); });
+    EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(TaskExecutor, abandoned_tasks_are_finished_or_cancelled) {
+    TaskExecutor executor(2);
+    std::atomic<int> runs(0);
+    {
+        std::vector<TaskFuture<int>> futures;
+        for (int i = 0; i < 100; ++i)
+            futures.push_back(executor.submit([&runs]() { return ++runs; }));
+    }
+    int after_destruction = runs;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(runs, after_destruction);
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include "services/wms_tilecache.h"
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+
+static std::shared_ptr<const WMSTileCache::Tile> createTile(const std::string &data) {
+	return std::make_shared<const WMSTileCache::Tile>("image/png", data, std::vector<std::string>{"data.gdal_source.srtm"});
+}
+
+TEST(WMSTileCache, evictsLeastRecentlyUsed) {
+	// every tile takes 100 bytes of data and 1 byte of fingerprint
+	WMSTileCache cache(3 * 101);
+	cache.put("a", createTile(std::string(100, 'a')));
+	cache.put("b", createTile(std::string(100, 'b')));
+	cache.put("c", createTile(std::string(100, 'c')));
+	EXPECT_EQ(303, cache.getSize());
+
+	// a is now used more recently than b
+	EXPECT_NE(nullptr, cache.get("a"));
+	cache.put("d", createTile(std::string(100, 'd')));
+
+	EXPECT_EQ(3, cache.getTileCount());
+	EXPECT_EQ(303, cache.getSize());
+	EXPECT_NE(nullptr, cache.get("a"));
+	EXPECT_EQ(nullptr, cache.get("b"));
+	EXPECT_NE(nullptr, cache.get("c"));
+	EXPECT_EQ(std::string(100, 'd'), cache.get("d")->data);
+}
+
+TEST(WMSTileCache, replacesTiles) {
+	WMSTileCache cache(1000);
+	cache.put("a", createTile("old"));
+	cache.put("a", createTile("new tile"));
+	EXPECT_EQ(1, cache.getTileCount());
+	EXPECT_EQ(9, cache.getSize());
+	EXPECT_EQ("new tile", cache.get("a")->data);
+}
+
+TEST(WMSTileCache, matchesIfNoneMatch) {
+	auto tile = createTile("data");
+	const std::string &etag = tile->etag;
+
+	EXPECT_TRUE(tile->matches(etag));
+	EXPECT_TRUE(tile->matches("*"));
+	EXPECT_TRUE(tile->matches("W/" + etag));
+	EXPECT_TRUE(tile->matches("\"other\", " + etag));
+	EXPECT_TRUE(tile->matches("\"other\",W/" + etag + " , \"third\""));
+
+	EXPECT_FALSE(tile->matches(""));
+	EXPECT_FALSE(tile->matches("\"other\", W/\"third\""));
+	// tags are only compared as a whole
+	EXPECT_FALSE(tile->matches(etag.substr(0, etag.size() - 2) + "\""));
+	EXPECT_FALSE(tile->matches("\"x" + etag.substr(1)));
+}
+
+static std::string sendTile(const WMSTileCache::Tile &tile, const std::string &if_none_match) {
+	Parameters headers;
+	if (!if_none_match.empty())
+		headers.insert(std::make_pair("if-none-match", if_none_match));
+	std::stringbuf buffer;
+	HTTPService::HTTPResponseStream response(&buffer);
+	tile.send(response, headers);
+	return buffer.str();
+}
+
+TEST(WMSTileCache, sendsNotModified) {
+	auto tile = createTile("image data");
+
+	std::string full = sendTile(*tile, "");
+	EXPECT_EQ(std::string::npos, full.find("304"));
+	EXPECT_NE(std::string::npos, full.find("ETag: " + tile->etag + "\r\n"));
+	EXPECT_NE(std::string::npos, full.find("Content-type: image/png\r\n"));
+	EXPECT_EQ("\r\n\r\nimage data", full.substr(full.size() - 14));
+
+	std::string not_modified = sendTile(*tile, "\"other\", W/" + tile->etag);
+	EXPECT_EQ(0, not_modified.find("Status: 304 Not Modified\r\n"));
+	EXPECT_NE(std::string::npos, not_modified.find("ETag: " + tile->etag + "\r\n"));
+	EXPECT_EQ(std::string::npos, not_modified.find("Content-type"));
+	EXPECT_EQ("\r\n\r\n", not_modified.substr(not_modified.size() - 4));
+
+	std::string modified = sendTile(*tile, "\"other\"");
+	EXPECT_EQ(std::string::npos, modified.find("304"));
+	EXPECT_EQ("image data", modified.substr(modified.size() - 10));
+}
+
+TEST(WMSTileCache, sizeLimits) {
+	WMSTileCache cache(100);
+	cache.put("a", createTile(std::string(100, 'a')));
+	EXPECT_EQ(0, cache.getTileCount());
+
+	WMSTileCache disabled(0);
+	disabled.put("a", createTile("a"));
+	EXPECT_EQ(nullptr, disabled.get("a"));
+}
+
+TEST(WMSTileCache, etagIdentifiesContent) {
+	auto tile = createTile("content");
+	EXPECT_EQ(42, tile->etag.size());
+	EXPECT_EQ('"', tile->etag.front());
+	EXPECT_EQ('"', tile->etag.back());
+	EXPECT_EQ(tile->etag, createTile("content")->etag);
+	EXPECT_NE(tile->etag, createTile("other content")->etag);
+}
+
+TEST(WMSTileCache, waitsForRunningComputations) {
+	WMSTileCache cache(1000);
+	auto computation = cache.beginComputation("metatile");
+	ASSERT_NE(nullptr, computation);
+	// other metatiles are not blocked
+	EXPECT_NE(nullptr, cache.beginComputation("other"));
+
+	std::atomic<bool> released(false), returned_after_release(false);
+	std::thread follower([&]() {
+		cache.beginComputation("metatile");
+		returned_after_release = released.load();
+	});
+	released = true;
+	computation.reset();
+	follower.join();
+	EXPECT_TRUE(returned_after_release);
+	EXPECT_NE(nullptr, cache.beginComputation("metatile"));
+}
+
+
+static SpatialReference world() {
+	return SpatialReference(CrsId::from_epsg_code(4326), -180, -90, 180, 90);
+}
+
+static QueryRectangle createTileQuery(double x1, double y1, double size) {
+	return QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), x1, y1, x1 + size, y1 + size),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::pixels(256, 256)
+	);
+}
+
+static void expectRect(const SpatialReference &expected, const SpatialReference &actual) {
+	EXPECT_DOUBLE_EQ(expected.x1, actual.x1);
+	EXPECT_DOUBLE_EQ(expected.y1, actual.y1);
+	EXPECT_DOUBLE_EQ(expected.x2, actual.x2);
+	EXPECT_DOUBLE_EQ(expected.y2, actual.y2);
+}
+
+TEST(WMSMetatile, lowerLeftCorner) {
+	// 8 x 4 tiles of 45 degrees, a pixel is 45/256 degrees
+	auto metatile = WMSMetatile::forTile(createTileQuery(-180, -90, 45), world(), 3, 3, 16);
+	ASSERT_NE(nullptr, metatile);
+	EXPECT_EQ(0, metatile->tile_x);
+	EXPECT_EQ(0, metatile->tile_y);
+	EXPECT_EQ(0, metatile->begin_x);
+	EXPECT_EQ(3, metatile->end_x);
+	EXPECT_EQ(0, metatile->begin_y);
+	EXPECT_EQ(3, metatile->end_y);
+
+	// the buffer is only added inside the extent
+	double buffer = 16 * 45.0 / 256;
+	expectRect(SpatialReference(CrsId::from_epsg_code(4326), -180, -90, -45 + buffer, 45 + buffer), metatile->qrect);
+	EXPECT_EQ(3 * 256 + 16, metatile->qrect.xres);
+	EXPECT_EQ(3 * 256 + 16, metatile->qrect.yres);
+
+	expectRect(SpatialReference(CrsId::from_epsg_code(4326), -135, -45, -90, 0), metatile->getTile(1, 1));
+}
+
+TEST(WMSMetatile, upperRightCorner) {
+	// the metatile of tile (7, 3) starts at tile (6, 3) and would reach beyond the extent
+	auto tile = createTileQuery(135, 45, 45);
+	auto metatile = WMSMetatile::forTile(tile, world(), 3, 3, 16);
+	ASSERT_NE(nullptr, metatile);
+	EXPECT_EQ(1, metatile->tile_x);
+	EXPECT_EQ(0, metatile->tile_y);
+	EXPECT_EQ(0, metatile->begin_x);
+	EXPECT_EQ(2, metatile->end_x);
+	EXPECT_EQ(0, metatile->begin_y);
+	EXPECT_EQ(1, metatile->end_y);
+
+	double buffer = 16 * 45.0 / 256;
+	expectRect(SpatialReference(CrsId::from_epsg_code(4326), 90 - buffer, 45 - buffer, 180, 90), metatile->qrect);
+	EXPECT_EQ(2 * 256 + 16, metatile->qrect.xres);
+	EXPECT_EQ(256 + 16, metatile->qrect.yres);
+
+	// the requested tile keeps its bbox
+	expectRect(tile, metatile->getTile(1, 0));
+	expectRect(SpatialReference(CrsId::from_epsg_code(4326), 90, 45, 135, 90), metatile->getTile(0, 0));
+}
+
+TEST(WMSMetatile, innerTile) {
+	// tile (4, 1) is in the middle of the metatile starting at tile (3, 0)
+	auto metatile = WMSMetatile::forTile(createTileQuery(0, -45, 45), world(), 3, 3, 16);
+	ASSERT_NE(nullptr, metatile);
+	EXPECT_EQ(1, metatile->tile_x);
+	EXPECT_EQ(1, metatile->tile_y);
+	EXPECT_EQ(3, metatile->end_x);
+	EXPECT_EQ(3, metatile->end_y);
+
+	double buffer = 16 * 45.0 / 256;
+	expectRect(SpatialReference(CrsId::from_epsg_code(4326), -45 - buffer, -90, 90 + buffer, 45 + buffer), metatile->qrect);
+	EXPECT_EQ(3 * 256 + 32, metatile->qrect.xres);
+	EXPECT_EQ(3 * 256 + 16, metatile->qrect.yres);
+}
+
+TEST(WMSMetatile, notApplicable) {
+	// disabled
+	EXPECT_EQ(nullptr, WMSMetatile::forTile(createTileQuery(-180, -90, 45), world(), 1, 1, 0));
+	// not aligned to the tile grid
+	EXPECT_EQ(nullptr, WMSMetatile::forTile(createTileQuery(-170, -90, 45), world(), 3, 3, 0));
+	// outside of the extent
+	EXPECT_EQ(nullptr, WMSMetatile::forTile(createTileQuery(180, -90, 45), world(), 3, 3, 0));
+	// 4 x 2 tiles of 90 degrees: the 3 x 1 metatile of tile (3, 0) is clamped to the tile itself
+	auto tile = createTileQuery(90, -90, 90);
+	EXPECT_EQ(nullptr, WMSMetatile::forTile(tile, world(), 3, 1, 0));
+	EXPECT_NE(nullptr, WMSMetatile::forTile(tile, world(), 2, 1, 0));
+}